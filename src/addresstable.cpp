@@ -0,0 +1,191 @@
+#include "addresstable.h"
+
+AddressKey AddressKey::fromIPv4(quint32 ipv4)
+{
+    return AddressKey(0, (Q_UINT64_C(0xffff) << 32) | ipv4);
+}
+
+AddressKey AddressKey::fromHostAddress(const QHostAddress& address)
+{
+    if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+        return fromIPv4(address.toIPv4Address());
+    }
+
+    Q_IPV6ADDR bytes = address.toIPv6Address();
+    quint64 hi = 0;
+    quint64 lo = 0;
+    for (int i = 0; i < 8; ++i) {
+        hi = (hi << 8) | bytes[i];
+        lo = (lo << 8) | bytes[i + 8];
+    }
+    return AddressKey(hi, lo);
+}
+
+QHostAddress AddressKey::toHostAddress() const
+{
+    if (isIPv4()) {
+        return QHostAddress(toIPv4());
+    }
+
+    Q_IPV6ADDR bytes;
+    for (int i = 0; i < 8; ++i) {
+        bytes[7 - i] = static_cast<quint8>(hi >> (i * 8));
+        bytes[15 - i] = static_cast<quint8>(lo >> (i * 8));
+    }
+    return QHostAddress(bytes);
+}
+
+AddressTable& AddressTable::instance()
+{
+    static AddressTable instance;
+    return instance;
+}
+
+AddressTable::AddressTable()
+    : m_count(1) // Id 0 is reserved for InvalidId
+{
+    for (int i = 0; i < MaxChunks; ++i) {
+        m_chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_chunks[0].store(new AddressKey[ChunkSize], std::memory_order_release);
+
+    rehash(256);
+}
+
+AddressTable::~AddressTable()
+{
+    for (int i = 0; i < MaxChunks; ++i) {
+        delete[] m_chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+quint32 AddressTable::hashKey(const AddressKey& key)
+{
+    // splitmix64 finalizer over both halves
+    quint64 h = key.hi * Q_UINT64_C(0x9e3779b97f4a7c15) ^ key.lo;
+    h ^= h >> 30;
+    h *= Q_UINT64_C(0xbf58476d1ce4e5b9);
+    h ^= h >> 27;
+    h *= Q_UINT64_C(0x94d049bb133111eb);
+    h ^= h >> 31;
+    return static_cast<quint32>(h);
+}
+
+void AddressTable::rehash(int capacity)
+{
+    QVector<AddressKey> keys(capacity);
+    QVector<AddressId> ids(capacity, InvalidId);
+    const quint32 mask = static_cast<quint32>(capacity - 1);
+
+    for (int i = 0; i < m_slotIds.size(); ++i) {
+        if (m_slotIds[i] == InvalidId) {
+            continue;
+        }
+        quint32 slot = hashKey(m_slotKeys[i]) & mask;
+        while (ids[slot] != InvalidId) {
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = m_slotKeys[i];
+        ids[slot] = m_slotIds[i];
+    }
+
+    m_slotKeys.swap(keys);
+    m_slotIds.swap(ids);
+}
+
+AddressId AddressTable::intern(const AddressKey& key)
+{
+    QMutexLocker locker(&m_mutex);
+
+    quint32 mask = static_cast<quint32>(m_slotIds.size() - 1);
+    quint32 slot = hashKey(key) & mask;
+    while (m_slotIds[slot] != InvalidId) {
+        if (m_slotKeys[slot] == key) {
+            return m_slotIds[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    const quint32 id = m_count.load(std::memory_order_relaxed);
+    const int chunk = static_cast<int>(id >> ChunkBits);
+    if (chunk >= MaxChunks) {
+        qWarning("AddressTable: address capacity exhausted");
+        return InvalidId;
+    }
+
+    AddressKey* storage = m_chunks[chunk].load(std::memory_order_relaxed);
+    if (!storage) {
+        storage = new AddressKey[ChunkSize];
+        m_chunks[chunk].store(storage, std::memory_order_release);
+    }
+    storage[id & (ChunkSize - 1)] = key;
+    m_count.store(id + 1, std::memory_order_release);
+
+    m_slotKeys[slot] = key;
+    m_slotIds[slot] = id;
+
+    // Keep the load factor at or below one half
+    if (static_cast<int>(id) * 2 >= m_slotIds.size()) {
+        rehash(m_slotIds.size() * 2);
+    }
+
+    return id;
+}
+
+AddressId AddressTable::intern(const QHostAddress& address)
+{
+    if (address.isNull()) {
+        return InvalidId;
+    }
+    return intern(AddressKey::fromHostAddress(address));
+}
+
+AddressId AddressTable::find(const AddressKey& key) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    const quint32 mask = static_cast<quint32>(m_slotIds.size() - 1);
+    quint32 slot = hashKey(key) & mask;
+    while (m_slotIds[slot] != InvalidId) {
+        if (m_slotKeys[slot] == key) {
+            return m_slotIds[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return InvalidId;
+}
+
+AddressKey AddressTable::key(AddressId id) const
+{
+    if (id == InvalidId || id >= m_count.load(std::memory_order_acquire)) {
+        return AddressKey();
+    }
+    const AddressKey* storage = m_chunks[id >> ChunkBits].load(std::memory_order_acquire);
+    return storage[id & (ChunkSize - 1)];
+}
+
+QHostAddress AddressTable::toHostAddress(AddressId id) const
+{
+    if (id == InvalidId) {
+        return QHostAddress();
+    }
+    return key(id).toHostAddress();
+}
+
+QString AddressTable::toString(AddressId id) const
+{
+    if (id == InvalidId) {
+        return QString("---");
+    }
+    return key(id).toHostAddress().toString();
+}
+
+bool AddressTable::isIPv4(AddressId id) const
+{
+    return id != InvalidId && key(id).isIPv4();
+}
+
+int AddressTable::size() const
+{
+    return static_cast<int>(m_count.load(std::memory_order_acquire)) - 1;
+}
@@ -0,0 +1,80 @@
+#ifndef ADDRESSTABLE_H
+#define ADDRESSTABLE_H
+
+#include <QString>
+#include <QHostAddress>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+
+using AddressId = quint32;
+
+// 128-bit binary address key. IPv4 addresses are stored IPv4-mapped
+// (::ffff:a.b.c.d) so both families share one key space.
+struct AddressKey {
+    quint64 hi;
+    quint64 lo;
+
+    AddressKey() : hi(0), lo(0) {}
+    AddressKey(quint64 high, quint64 low) : hi(high), lo(low) {}
+
+    static AddressKey fromIPv4(quint32 ipv4);
+    static AddressKey fromHostAddress(const QHostAddress& address);
+
+    bool isIPv4() const { return hi == 0 && (lo >> 32) == 0xffffu; }
+    quint32 toIPv4() const { return static_cast<quint32>(lo); }
+    QHostAddress toHostAddress() const;
+
+    bool operator==(const AddressKey& other) const { return hi == other.hi && lo == other.lo; }
+    bool operator!=(const AddressKey& other) const { return !(*this == other); }
+};
+
+// Process-wide table of interned host addresses.
+//
+// The core refers to hop and responder addresses only by their small,
+// stable AddressId; comparing two addresses is an integer compare and
+// strings are produced at the UI/export edge via toString(). Interning
+// takes a lock and uses an open-addressing hash map, resolving an id back
+// to its key is lock-free because keys live in chunks that never move.
+class AddressTable
+{
+public:
+    static constexpr AddressId InvalidId = 0;
+
+    static AddressTable& instance();
+
+    AddressId intern(const AddressKey& key);
+    AddressId intern(const QHostAddress& address);
+    AddressId find(const AddressKey& key) const;
+
+    AddressKey key(AddressId id) const;
+    QHostAddress toHostAddress(AddressId id) const;
+    QString toString(AddressId id) const;
+    bool isIPv4(AddressId id) const;
+
+    int size() const;
+
+private:
+    AddressTable();
+    ~AddressTable();
+    AddressTable(const AddressTable&) = delete;
+    AddressTable& operator=(const AddressTable&) = delete;
+
+    static quint32 hashKey(const AddressKey& key);
+    void rehash(int capacity);
+
+    static constexpr int ChunkBits = 12;
+    static constexpr int ChunkSize = 1 << ChunkBits;
+    static constexpr int MaxChunks = 1024;
+
+    // Open-addressing index, guarded by m_mutex
+    mutable QMutex m_mutex;
+    QVector<AddressKey> m_slotKeys;
+    QVector<AddressId> m_slotIds;
+
+    // Id -> key storage, readable without the lock
+    std::atomic<AddressKey*> m_chunks[MaxChunks];
+    std::atomic<quint32> m_count;
+};
+
+#endif // ADDRESSTABLE_H
@@ -0,0 +1,366 @@
+#include "alertengine.h"
+#include <QRegularExpression>
+#include <QHostAddress>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <cmath>
+
+namespace {
+const double BinBaseMs = 0.1;
+const double BinFactor = 1.2;
+
+QString metricName(AlertRule::Metric metric)
+{
+    switch (metric) {
+    case AlertRule::Metric::P95Latency:
+        return "p95";
+    case AlertRule::Metric::AvgLatency:
+        return "avg";
+    case AlertRule::Metric::Loss:
+        return "loss";
+    }
+    return QString();
+}
+}
+
+bool AlertRule::parse(const QString& line, AlertRule* rule, QString* error)
+{
+    static const QRegularExpression pattern(
+        "^(p95|avg|loss)\\s+(?:hop\\s+(\\d+)|e2e)\\s*>\\s*([0-9]*\\.?[0-9]+)\\s*(ms|%)?"
+        "(?:\\s+for\\s+(\\d+)\\s*(s|m|h))?(?:\\s+do\\s+(\\S.*))?$",
+        QRegularExpression::CaseInsensitiveOption);
+
+    const QString trimmed = line.trimmed();
+    const QRegularExpressionMatch match = pattern.match(trimmed);
+    if (!match.hasMatch()) {
+        *error = QString("Cannot parse rule: %1").arg(trimmed);
+        return false;
+    }
+
+    AlertRule parsed;
+    parsed.text = trimmed;
+
+    const QString metric = match.captured(1).toLower();
+    if (metric == "p95") {
+        parsed.metric = Metric::P95Latency;
+    } else if (metric == "avg") {
+        parsed.metric = Metric::AvgLatency;
+    } else {
+        parsed.metric = Metric::Loss;
+    }
+
+    // An unbounded hop would size the engine's per-hop index
+    if (!match.captured(2).isEmpty()) {
+        bool ok = false;
+        parsed.hop = match.captured(2).toInt(&ok);
+        if (!ok || parsed.hop < 1 || parsed.hop > MaxHops) {
+            *error = QString("Hop must be between 1 and %1: %2").arg(MaxHops).arg(trimmed);
+            return false;
+        }
+    }
+    parsed.threshold = match.captured(3).toDouble();
+
+    const QString unit = match.captured(4);
+    if (!unit.isEmpty() && (unit == "%") != (parsed.metric == Metric::Loss)) {
+        *error = QString("Loss thresholds are in %, latency thresholds in ms: %1").arg(trimmed);
+        return false;
+    }
+
+    if (!match.captured(5).isEmpty()) {
+        const qint64 amount = match.captured(5).toLongLong();
+        const QString scale = match.captured(6).toLower();
+        parsed.holdMs = amount * (scale == "h" ? 3600000 : scale == "m" ? 60000 : 1000);
+    }
+
+    if (!match.captured(7).isEmpty()) {
+        parsed.actions = 0;
+        const QStringList actions = match.captured(7).split(',', Qt::SkipEmptyParts);
+        for (const QString& rawAction : actions) {
+            const QString action = rawAction.trimmed();
+            if (action.compare("log", Qt::CaseInsensitive) == 0) {
+                parsed.actions |= LogAction;
+            } else if (action.startsWith("webhook=", Qt::CaseInsensitive)) {
+                parsed.webhook = QUrl(action.mid(8));
+                const QString host = parsed.webhook.host();
+
+                // Alerts may carry internal addresses, so they only go to this machine
+                if (!parsed.webhook.isValid() || !parsed.webhook.scheme().startsWith("http")
+                    || (host != "localhost" && !QHostAddress(host).isLoopback())) {
+                    *error = QString("Webhooks must be http(s) URLs on localhost: %1").arg(action);
+                    return false;
+                }
+                parsed.actions |= WebhookAction;
+            } else if (action.startsWith("script=", Qt::CaseInsensitive)) {
+                parsed.script = action.mid(7);
+                parsed.actions |= ScriptAction;
+            } else {
+                *error = QString("Unknown action: %1").arg(action);
+                return false;
+            }
+        }
+    }
+
+    *rule = parsed;
+    return true;
+}
+
+void AlertEngine::Window::clear()
+{
+    for (int i = 0; i < BinCount; ++i) {
+        bins[i] = 0;
+    }
+    next = 0;
+    count = 0;
+    lost = 0;
+    sum = 0;
+}
+
+void AlertEngine::Window::add(double rttMs)
+{
+    // Evict the oldest result once the window is full
+    if (count == WindowSamples) {
+        const float old = samples[next];
+        if (old < 0) {
+            lost--;
+        } else {
+            bins[binFor(old)]--;
+            sum -= old;
+        }
+    } else {
+        count++;
+    }
+
+    samples[next] = static_cast<float>(rttMs);
+    next = (next + 1) % WindowSamples;
+
+    if (rttMs < 0) {
+        lost++;
+    } else {
+        bins[binFor(rttMs)]++;
+        sum += static_cast<float>(rttMs);
+    }
+}
+
+double AlertEngine::Window::p95() const
+{
+    const int received = count - lost;
+    if (received == 0) {
+        return -1.0;
+    }
+
+    // Bins are 20% wide, so this is within 20% of the true p95
+    const int rank = static_cast<int>(std::ceil(0.95 * received));
+    int seen = 0;
+    for (int bin = 0; bin < BinCount; ++bin) {
+        seen += bins[bin];
+        if (seen >= rank) {
+            return binUpperEdge(bin);
+        }
+    }
+    return binUpperEdge(BinCount - 1);
+}
+
+double AlertEngine::Window::mean() const
+{
+    const int received = count - lost;
+    return received > 0 ? sum / received : -1.0;
+}
+
+double AlertEngine::Window::lossPercent() const
+{
+    return count > 0 ? 100.0 * lost / count : 0.0;
+}
+
+AlertEngine::AlertEngine(QObject *parent)
+    : QObject(parent)
+    , m_network(nullptr)
+{
+}
+
+int AlertEngine::binFor(double rttMs)
+{
+    if (rttMs <= BinBaseMs) {
+        return 0;
+    }
+    const int bin = static_cast<int>(std::log(rttMs / BinBaseMs) / std::log(BinFactor)) + 1;
+    return qMin(bin, BinCount - 1);
+}
+
+double AlertEngine::binUpperEdge(int bin)
+{
+    return BinBaseMs * std::pow(BinFactor, bin);
+}
+
+void AlertEngine::setRules(const QList<AlertRule>& rules)
+{
+    m_rules = rules;
+    m_states.fill(RuleState(), m_rules.size());
+
+    // Compile the per-hop index once; windows exist only for hops with rules
+    m_rulesByHop.clear();
+    for (int i = 0; i < m_rules.size(); ++i) {
+        const int hop = qMax(0, m_rules[i].hop);
+        if (hop >= m_rulesByHop.size()) {
+            m_rulesByHop.resize(hop + 1);
+        }
+        m_rulesByHop[hop].append(i);
+    }
+    m_windows.fill(Window(), m_rulesByHop.size());
+}
+
+QList<AlertRule> AlertEngine::rules() const
+{
+    return m_rules;
+}
+
+void AlertEngine::reset()
+{
+    m_states.fill(RuleState(), m_rules.size());
+    m_windows.fill(Window(), m_rulesByHop.size());
+}
+
+bool AlertEngine::isFiring(int rule) const
+{
+    return rule >= 0 && rule < m_states.size() && m_states[rule].firing;
+}
+
+int AlertEngine::windowSamples(int hop, float* samples) const
+{
+    if (hop < 0 || hop >= m_windows.size()) {
+        return 0;
+    }
+
+    // Once full, the oldest result is the one next would overwrite
+    const Window& window = m_windows[hop];
+    const int first = window.count == WindowSamples ? window.next : 0;
+    for (int i = 0; i < window.count; ++i) {
+        samples[i] = window.samples[(first + i) % WindowSamples];
+    }
+    return window.count;
+}
+
+void AlertEngine::restoreWindow(int hop, const float* samples, int count)
+{
+    if (hop < 0 || hop >= m_windows.size()) {
+        return;
+    }
+
+    Window& window = m_windows[hop];
+    window.clear();
+    for (int i = 0; i < qBound(0, count, WindowSamples); ++i) {
+        window.add(samples[i]);
+    }
+}
+
+void AlertEngine::addSample(int hop, int destinationHop, qint64 nowMs, double rttMs)
+{
+    if (hop > 0 && hop < m_rulesByHop.size() && !m_rulesByHop[hop].isEmpty()) {
+        m_windows[hop].add(rttMs);
+        evaluate(m_rulesByHop[hop], m_windows[hop], nowMs);
+    }
+
+    if (hop == destinationHop && !m_rulesByHop.isEmpty() && !m_rulesByHop[0].isEmpty()) {
+        m_windows[0].add(rttMs);
+        evaluate(m_rulesByHop[0], m_windows[0], nowMs);
+    }
+}
+
+double AlertEngine::metricValue(const AlertRule& rule, const Window& window) const
+{
+    switch (rule.metric) {
+    case AlertRule::Metric::P95Latency:
+        return window.p95();
+    case AlertRule::Metric::AvgLatency:
+        return window.mean();
+    case AlertRule::Metric::Loss:
+        return window.lossPercent();
+    }
+    return -1.0;
+}
+
+void AlertEngine::evaluate(const QVector<int>& ruleIndices, const Window& window, qint64 nowMs)
+{
+    // p95 and mean are shared by every rule on this window, compute them at most once
+    double p95 = -2.0;
+    for (int index : ruleIndices) {
+        const AlertRule& rule = m_rules[index];
+        RuleState& state = m_states[index];
+
+        // Too few results leave a loss rule as it was, neither raised nor cleared
+        if (rule.metric == AlertRule::Metric::Loss && window.count < MinLossSamples) {
+            continue;
+        }
+        
+        double value;
+        if (rule.metric == AlertRule::Metric::P95Latency) {
+            if (p95 < -1.5) {
+                p95 = window.p95();
+            }
+            value = p95;
+        } else {
+            value = metricValue(rule, window);
+        }
+
+        if (value > rule.threshold) {
+            if (state.conditionSinceMs < 0) {
+                state.conditionSinceMs = nowMs;
+            }
+            if (!state.firing && nowMs - state.conditionSinceMs >= rule.holdMs) {
+                state.firing = true;
+                fire(rule, value);
+            }
+        } else {
+            state.conditionSinceMs = -1;
+            if (state.firing) {
+                state.firing = false;
+                // Only a rule that logged its alert logs the all-clear
+                if (rule.actions & AlertRule::LogAction) {
+                    emit alertCleared(QString("Alert cleared: %1").arg(rule.text));
+                }
+            }
+        }
+    }
+}
+
+void AlertEngine::fire(const AlertRule& rule, double value)
+{
+    const QString unit = rule.metric == AlertRule::Metric::Loss ? "%" : " ms";
+    const QString scope = rule.hop > 0 ? QString("hop %1").arg(rule.hop) : QString("end-to-end");
+    const QString message = QString("Alert: %1 (%2 %3 is %4%5)")
+                           .arg(rule.text)
+                           .arg(scope)
+                           .arg(metricName(rule.metric))
+                           .arg(value, 0, 'f', 1)
+                           .arg(unit);
+
+    if (rule.actions & AlertRule::LogAction) {
+        emit alertRaised(message);
+    }
+
+    if (rule.actions & AlertRule::WebhookAction) {
+        if (!m_network) {
+            m_network = new QNetworkAccessManager(this);
+        }
+
+        QJsonObject payload;
+        payload["rule"] = rule.text;
+        payload["hop"] = rule.hop;
+        payload["metric"] = metricName(rule.metric);
+        payload["value"] = value;
+        payload["threshold"] = rule.threshold;
+
+        QNetworkRequest request(rule.webhook);
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        QNetworkReply* reply = m_network->post(request, QJsonDocument(payload).toJson(QJsonDocument::Compact));
+        connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+    }
+
+    if (rule.actions & AlertRule::ScriptAction) {
+        // Fire and forget, the hook gets the rule and the value as arguments
+        QProcess::startDetached(rule.script, {rule.text, QString::number(value, 'f', 1)});
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef ALERTENGINE_H
+#define ALERTENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QVector>
+#include <QList>
+
+class QNetworkAccessManager;
+
+// One alert condition, parsed from a line such as
+//   p95 hop 3 > 80ms for 2m do log,webhook=http://localhost:8080/alert
+//   loss e2e > 5% for 30s do log,script=/usr/local/bin/notify.sh
+struct AlertRule {
+    static constexpr int MaxHops = 64;  // Highest hop a tracer probes, as in PingTracer::setMaxHops
+
+    enum class Metric {
+        P95Latency,
+        AvgLatency,
+        Loss
+    };
+
+    enum Action {
+        LogAction = 0x1,
+        WebhookAction = 0x2,
+        ScriptAction = 0x4
+    };
+
+    QString text;       // Source line, used in messages
+    Metric metric;
+    int hop;            // 0 means the end-to-end (destination) hop
+    double threshold;   // ms, or percent for Loss
+    qint64 holdMs;      // Condition must hold this long before firing
+    int actions;
+    QUrl webhook;
+    QString script;
+
+    AlertRule() : metric(Metric::P95Latency), hop(0), threshold(0), holdMs(0), actions(LogAction) {}
+
+    // Returns false and sets error when the line does not parse
+    static bool parse(const QString& line, AlertRule* rule, QString* error);
+};
+
+// Evaluates alert rules incrementally as probe results arrive.
+//
+// Rules are compiled once into a per-hop index, so a result only touches the
+// rules that reference its hop (plus end-to-end rules for the destination).
+// Each hop keeps a sliding window of recent results with a log-spaced latency
+// histogram, which makes p95 a fixed-size scan instead of a sort.
+class AlertEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int WindowSamples = 120;
+    // Loss rules wait for this many results, one lost first probe is not 100% loss
+    static constexpr int MinLossSamples = 20;
+
+    explicit AlertEngine(QObject *parent = nullptr);
+
+    void setRules(const QList<AlertRule>& rules);
+    QList<AlertRule> rules() const;
+    void reset();
+
+    // One probe result; rttMs < 0 marks a lost probe
+    void addSample(int hop, int destinationHop, qint64 nowMs, double rttMs);
+
+    bool isFiring(int rule) const;
+
+    // Results in hop's window (0 for end to end), oldest first; returns how
+    // many were copied into samples, which holds WindowSamples
+    int windowSamples(int hop, float* samples) const;
+    // Refills hop's window from a saved one without evaluating any rule
+    void restoreWindow(int hop, const float* samples, int count);
+
+signals:
+    void alertRaised(const QString& message);
+    void alertCleared(const QString& message);
+
+private:
+    static constexpr int BinCount = 64;
+
+    // Recent results of one hop
+    struct Window {
+        float samples[WindowSamples];   // rtt in ms, < 0 for lost
+        quint16 bins[BinCount];
+        int next;
+        int count;
+        int lost;
+        double sum;
+
+        Window() { clear(); }
+        void clear();
+        void add(double rttMs);
+        double p95() const;
+        double mean() const;
+        double lossPercent() const;
+    };
+
+    struct RuleState {
+        qint64 conditionSinceMs;    // -1 while the condition is false
+        bool firing;
+
+        RuleState() : conditionSinceMs(-1), firing(false) {}
+    };
+
+    static int binFor(double rttMs);
+    static double binUpperEdge(int bin);
+
+    void evaluate(const QVector<int>& ruleIndices, const Window& window, qint64 nowMs);
+    double metricValue(const AlertRule& rule, const Window& window) const;
+    void fire(const AlertRule& rule, double value);
+
+    QList<AlertRule> m_rules;
+    QVector<RuleState> m_states;
+    QVector<QVector<int>> m_rulesByHop; // Index 0 holds the end-to-end rules
+    QVector<Window> m_windows;          // Index 0 is the end-to-end window
+    QNetworkAccessManager* m_network;
+};
+
+#endif // ALERTENGINE_H
@@ -0,0 +1,275 @@
+#include "appprobe.h"
+#include <QUrl>
+#include <QHostAddress>
+#include <cstring>
+
+bool DnsQuery::setName(const QString& name)
+{
+    m_packet.clear();
+    const bool root = name.isEmpty() || name == QLatin1String(".");
+    const QByteArray ace = root ? QByteArray() : QUrl::toAce(name);
+    if (!root && ace.isEmpty()) {
+        return false;
+    }
+
+    // ID patched per probe, recursion desired, one question
+    static const char header[HeaderSize] = {0, 0, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+    m_packet.reserve(HeaderSize + ace.size() + 6);
+    m_packet.append(header, HeaderSize);
+
+    for (const QByteArray& label : ace.split('.')) {
+        if (label.isEmpty()) {
+            continue; // Trailing dot of a fully qualified name
+        }
+        if (label.size() > 63) {
+            m_packet.clear();
+            return false;
+        }
+        m_packet.append(static_cast<char>(label.size()));
+        m_packet.append(label);
+    }
+    m_packet.append('\0');
+    if (m_packet.size() - HeaderSize > 255) {
+        m_packet.clear();
+        return false;
+    }
+
+    // QTYPE A, or NS for the root, QCLASS IN
+    const char question[4] = {0, static_cast<char>(root ? 2 : 1), 0, 1};
+    m_packet.append(question, sizeof(question));
+    return true;
+}
+
+bool DnsQuery::isValid() const
+{
+    return !m_packet.isEmpty();
+}
+
+const QByteArray& DnsQuery::packet(quint16 id)
+{
+    char* data = m_packet.data();
+    data[0] = static_cast<char>(id >> 8);
+    data[1] = static_cast<char>(id & 0xff);
+    return m_packet;
+}
+
+bool DnsQuery::isResponse(const char* data, qint64 size, quint16 id)
+{
+    // Matching ID with the QR bit set, whatever the RCODE: the server answered
+    if (size < HeaderSize) {
+        return false;
+    }
+    const quint8* header = reinterpret_cast<const quint8*>(data);
+    return (static_cast<quint16>(header[0] << 8) | header[1]) == id && (header[2] & 0x80);
+}
+
+HttpProbe::HttpProbe()
+    : m_state(State::Done)
+    , m_started(false)
+    , m_keepAlive(false)
+    , m_requestKeepAlive(false)
+    , m_chunked(false)
+    , m_remaining(-1)
+    , m_statusCode(0)
+{
+}
+
+void HttpProbe::setRequest(const QString& host, quint16 port, const QString& path, bool keepAlive)
+{
+    QString authority = QHostAddress(host).protocol() == QAbstractSocket::IPv6Protocol
+        ? QString("[%1]").arg(host) : host;
+    if (port != 80) {
+        authority += QString(":%1").arg(port);
+    }
+
+    m_requestKeepAlive = keepAlive;
+    m_request = "GET " + (path.startsWith('/') ? path : "/" + path).toUtf8() + " HTTP/1.1\r\n"
+              + "Host: " + authority.toUtf8() + "\r\n"
+              + "User-Agent: PingTracer\r\n"
+              + "Accept: */*\r\n"
+              + (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n")
+              + "\r\n";
+}
+
+const QByteArray& HttpProbe::request() const
+{
+    return m_request;
+}
+
+void HttpProbe::beginResponse()
+{
+    m_line.truncate(0);
+    m_state = State::Status;
+    m_started = false;
+    m_keepAlive = false;
+    m_chunked = false;
+    m_remaining = -1;
+    m_statusCode = 0;
+}
+
+bool HttpProbe::feed(const char* data, qint64 size)
+{
+    if (size > 0) {
+        m_started = true;
+    }
+
+    qint64 i = 0;
+    while (i < size) {
+        switch (m_state) {
+        case State::Body:
+        case State::ChunkData: {
+            // Body bytes are only counted, never copied
+            const qint64 take = qMin(m_remaining, size - i);
+            i += take;
+            m_remaining -= take;
+            if (m_remaining == 0) {
+                m_state = m_state == State::Body ? State::Done : State::ChunkEnd;
+            }
+            break;
+        }
+        case State::UntilClose:
+            return true;
+        case State::Done:
+            // More than the response, the connection is out of step
+            m_keepAlive = false;
+            return true;
+        case State::Failed:
+            return false;
+        default: {
+            const char* start = data + i;
+            const char* end = static_cast<const char*>(std::memchr(start, '\n', size - i));
+            const qint64 length = end ? end - start : size - i;
+            if (m_line.size() + length > MaxLineLength) {
+                m_state = State::Failed;
+                return false;
+            }
+            m_line.append(start, length);
+            i += length;
+            if (!end) {
+                break;
+            }
+            i++;
+
+            if (m_line.endsWith('\r')) {
+                m_line.chop(1);
+            }
+            const bool ok = processLine(m_line);
+            m_line.truncate(0);
+            if (!ok) {
+                m_state = State::Failed;
+                return false;
+            }
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+bool HttpProbe::processLine(const QByteArray& line)
+{
+    switch (m_state) {
+    case State::Status: {
+        // "HTTP/1.1 200 OK"
+        const int space = line.indexOf(' ');
+        bool ok = false;
+        m_statusCode = line.mid(space + 1, 3).toInt(&ok);
+        if (!line.startsWith("HTTP/1.") || space < 0 || !ok) {
+            return false;
+        }
+        m_keepAlive = m_requestKeepAlive && line.startsWith("HTTP/1.1");
+        m_chunked = false;
+        m_remaining = -1;
+        m_state = State::Headers;
+        return true;
+    }
+    case State::Headers: {
+        if (line.isEmpty()) {
+            endHeaders();
+            return true;
+        }
+        const int colon = line.indexOf(':');
+        if (colon <= 0) {
+            return false;
+        }
+
+        // Only the headers that frame the body matter
+        const char* name = line.constData();
+        if (colon == 14 && qstrnicmp(name, "content-length", 14) == 0) {
+            bool ok = false;
+            m_remaining = line.mid(colon + 1).trimmed().toLongLong(&ok);
+            return ok && m_remaining >= 0;
+        }
+        if (colon == 17 && qstrnicmp(name, "transfer-encoding", 17) == 0) {
+            m_chunked = line.mid(colon + 1).toLower().contains("chunked");
+        } else if (colon == 10 && qstrnicmp(name, "connection", 10) == 0) {
+            const QByteArray value = line.mid(colon + 1).toLower();
+            if (value.contains("close")) {
+                m_keepAlive = false;
+            } else if (value.contains("keep-alive")) {
+                m_keepAlive = m_requestKeepAlive;
+            }
+        }
+        return true;
+    }
+    case State::ChunkSize: {
+        const int extension = line.indexOf(';');
+        bool ok = false;
+        m_remaining = (extension < 0 ? line : line.left(extension)).trimmed().toLongLong(&ok, 16);
+        if (!ok || m_remaining < 0) {
+            return false;
+        }
+        m_state = m_remaining == 0 ? State::Trailers : State::ChunkData;
+        return true;
+    }
+    case State::ChunkEnd:
+        m_state = State::ChunkSize;
+        return line.isEmpty();
+    case State::Trailers:
+        if (line.isEmpty()) {
+            m_state = State::Done;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+void HttpProbe::endHeaders()
+{
+    if (m_statusCode >= 100 && m_statusCode < 200) {
+        m_state = State::Status; // Interim response, the real one follows
+    } else if (m_statusCode == 204 || m_statusCode == 304) {
+        m_state = State::Done;
+    } else if (m_chunked) {
+        m_state = State::ChunkSize;
+    } else if (m_remaining > 0) {
+        m_state = State::Body;
+    } else if (m_remaining == 0) {
+        m_state = State::Done;
+    } else {
+        // Body runs until the server closes, nothing to reuse
+        m_keepAlive = false;
+        m_state = State::UntilClose;
+    }
+}
+
+bool HttpProbe::started() const
+{
+    return m_started;
+}
+
+bool HttpProbe::complete() const
+{
+    return m_state == State::Done;
+}
+
+bool HttpProbe::reusable() const
+{
+    return m_state == State::Done && m_keepAlive;
+}
+
+int HttpProbe::statusCode() const
+{
+    return m_statusCode;
+}
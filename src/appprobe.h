@@ -0,0 +1,89 @@
+#ifndef APPPROBE_H
+#define APPPROBE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+
+// Wire format of a DNS probe: one recursive query, built once and reused.
+//
+// Only the 16-bit ID is patched per probe, and a reply is matched on its
+// header alone, so the receive path can read into a small stack buffer and
+// drop the rest of the answer.
+class DnsQuery
+{
+public:
+    static constexpr int HeaderSize = 12;
+
+    // A record query for name; empty or "." asks the root for its NS records
+    bool setName(const QString& name);
+    bool isValid() const;
+
+    // The query with id patched in place
+    const QByteArray& packet(quint16 id);
+
+    // True if data is a response to the query with this id
+    static bool isResponse(const char* data, qint64 size, quint16 id);
+
+private:
+    QByteArray m_packet;
+};
+
+// Request and response framing of an HTTP time-to-first-byte probe.
+//
+// The request is formatted once. The response is only framed, never kept:
+// feed() walks the status line, the headers and a Content-Length or chunked
+// body so the caller knows when a kept-alive connection is idle again and
+// can carry the next request.
+class HttpProbe
+{
+public:
+    HttpProbe();
+
+    // GET path from host (port goes into the Host header unless it is 80)
+    void setRequest(const QString& host, quint16 port, const QString& path, bool keepAlive);
+    const QByteArray& request() const;
+
+    // Starts framing the response to the request just sent
+    void beginResponse();
+
+    // Consumes received bytes; false if they are not a valid response
+    bool feed(const char* data, qint64 size);
+
+    bool started() const;
+    bool complete() const;
+    // Complete, and the server keeps the connection open for another request
+    bool reusable() const;
+    int statusCode() const;
+
+private:
+    static constexpr int MaxLineLength = 8192;
+
+    enum class State {
+        Status,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkEnd,
+        Trailers,
+        UntilClose,
+        Done,
+        Failed
+    };
+
+    bool processLine(const QByteArray& line);
+    void endHeaders();
+
+    QByteArray m_request;
+    QByteArray m_line;
+    State m_state;
+    bool m_started;
+    bool m_keepAlive;
+    bool m_requestKeepAlive;
+    bool m_chunked;
+    qint64 m_remaining;
+    int m_statusCode;
+};
+
+#endif // APPPROBE_H
@@ -0,0 +1,294 @@
+#include "batchtracer.h"
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "taskpool.h"
+
+BatchTracer::BatchTracer(QObject *parent)
+    : QObject(parent)
+    , m_nextTarget(0)
+    , m_completed(0)
+    , m_failed(0)
+    , m_probes(0)
+    , m_hopRecords(0)
+    , m_running(false)
+    , m_pendingWrites(0)
+{
+}
+
+BatchTracer::~BatchTracer()
+{
+    stop();
+    waitForWrites();
+}
+
+QStringList BatchTracer::loadTargets(const QString& fileName, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = QString("Could not open %1: %2").arg(fileName, file.errorString());
+        return QStringList();
+    }
+
+    QStringList targets;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().section('#', 0, 0).trimmed();
+        if (!line.isEmpty()) {
+            targets.append(line);
+        }
+    }
+
+    if (targets.isEmpty()) {
+        *error = QString("No targets found in %1").arg(fileName);
+    }
+    return targets;
+}
+
+bool BatchTracer::start(const QStringList& targets, const QString& outputFile, const Config& config, QString* error)
+{
+    if (m_running || targets.isEmpty()) {
+        return false;
+    }
+
+    m_output.setFileName(outputFile);
+    if (!m_output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = QString("Could not open %1: %2").arg(outputFile, m_output.errorString());
+        return false;
+    }
+
+    m_config = config;
+    m_config.concurrency = qBound(1, m_config.concurrency, 256);
+    m_targets = targets;
+    m_nextTarget = 0;
+    m_completed = 0;
+    m_failed = 0;
+    m_probes = 0;
+    m_hopRecords = 0;
+    m_budget.setRate(m_config.probesPerSecond);
+    m_topologyAtStart = TopologyGraph::instance().stats();
+    m_running = true;
+    m_wallTimer.start();
+
+    // Tracers are kept for the whole batch and share one network thread
+    const int tracers = qMin(m_config.concurrency, static_cast<int>(m_targets.size()));
+    while (m_tracers.size() < tracers) {
+        PingTracer* tracer = new PingTracer(this);
+
+        // Queued, so a tracer is never restarted from inside its own stop()
+        connect(tracer, &PingTracer::finished, this, &BatchTracer::onTracerFinished, Qt::QueuedConnection);
+        connect(tracer, &PingTracer::errorOccurred, this, &BatchTracer::onTracerError, Qt::QueuedConnection);
+        m_tracers.append(tracer);
+    }
+
+    for (int i = 0; i < tracers; ++i) {
+        startNext(m_tracers[i]);
+    }
+    return true;
+}
+
+void BatchTracer::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    // Partial results of the traces still running are dropped
+    m_running = false;
+    for (PingTracer* tracer : m_tracers) {
+        tracer->stop();
+    }
+    m_startedMs.clear();
+    finish();
+}
+
+bool BatchTracer::isRunning() const
+{
+    return m_running;
+}
+
+int BatchTracer::targetCount() const
+{
+    return m_targets.size();
+}
+
+int BatchTracer::completedCount() const
+{
+    return m_completed;
+}
+
+void BatchTracer::startNext(PingTracer* tracer)
+{
+    m_startedMs.remove(tracer);
+
+    if (!m_running || m_nextTarget >= m_targets.size()) {
+        if (m_running && m_startedMs.isEmpty()) {
+            finish();
+        }
+        return;
+    }
+
+    tracer->setTarget(m_targets[m_nextTarget++]);
+    tracer->setInterval(m_config.intervalMs);
+    tracer->setTimeout(m_config.timeoutMs);
+    tracer->setMaxHops(m_config.maxHops);
+    tracer->setRounds(m_config.rounds);
+    tracer->setProbeProtocol(m_config.protocol, m_config.port);
+    tracer->setApplicationProbe(m_config.query, m_config.reuseConnections);
+    tracer->setProbeBudget(&m_budget);
+    tracer->setResolveHostnames(false);
+
+    m_startedMs.insert(tracer, m_wallTimer.elapsed());
+    if (!tracer->start()) {
+        writeResult(tracer, "Could not start trace");
+        startNext(tracer);
+    }
+}
+
+void BatchTracer::onTracerFinished()
+{
+    PingTracer* tracer = qobject_cast<PingTracer*>(sender());
+    if (!tracer || !m_startedMs.contains(tracer)) {
+        return;
+    }
+
+    writeResult(tracer, QString());
+    startNext(tracer);
+}
+
+void BatchTracer::onTracerError(const QString& error)
+{
+    PingTracer* tracer = qobject_cast<PingTracer*>(sender());
+    if (!tracer || !m_startedMs.contains(tracer)) {
+        return;
+    }
+
+    tracer->stop();
+    writeResult(tracer, error);
+
+    // A tracer that gave up while running has a finished signal queued behind
+    // this one. It is no longer active, so that signal is dropped, and the
+    // next target is only taken once it came through
+    m_startedMs.remove(tracer);
+    QMetaObject::invokeMethod(this, [this, tracer]() { startNext(tracer); }, Qt::QueuedConnection);
+}
+
+void BatchTracer::writeResult(PingTracer* tracer, const QString& error)
+{
+    QJsonObject result;
+    result["target"] = tracer->getTarget();
+    result["elapsedMs"] = m_wallTimer.elapsed() - m_startedMs.value(tracer);
+
+    // The published snapshot is immutable, the path is turned into JSON off the GUI thread
+    HopSnapshot snapshot;
+    int destination = 0;
+    if (!error.isEmpty()) {
+        result["error"] = error;
+        m_failed++;
+    } else {
+        const TraceStats stats = tracer->stats();
+        m_probes += stats.sent;
+        destination = tracer->destinationHop();
+        snapshot = tracer->hopSnapshot();
+        result["address"] = tracer->targetAddress();
+        result["reached"] = destination > 0;
+        result["probes"] = static_cast<qint64>(stats.sent);
+    }
+
+    {
+        QMutexLocker locker(&m_outputMutex);
+        m_pendingWrites++;
+    }
+    TaskPool::instance().submit([this, result, snapshot, destination]() mutable {
+        quint64 hopRecords = 0;
+        if (snapshot) {
+            const int hopCount = destination > 0 ? qMin(destination, static_cast<int>(snapshot->size())) : snapshot->size();
+
+            QJsonArray hops;
+            for (int i = 0; i < hopCount; ++i) {
+                const HopData& hop = snapshot->at(i);
+                QJsonObject entry;
+                entry["hop"] = hop.hopNumber;
+                entry["address"] = hop.received > 0 ? QJsonValue(AddressTable::instance().toString(hop.address)) : QJsonValue();
+                entry["sent"] = hop.sent;
+                entry["received"] = hop.received;
+                entry["loss"] = hop.sent > 0 ? 100.0 * (hop.sent - hop.received) / hop.sent : 0.0;
+                if (hop.received > 0) {
+                    hopRecords++;
+                    entry["best"] = hop.bestTime;
+                    entry["avg"] = hop.avgTime;
+                    entry["worst"] = hop.worstTime;
+                }
+                hops.append(entry);
+            }
+            result["hops"] = hops;
+        }
+        const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Compact);
+
+        QMutexLocker locker(&m_outputMutex);
+        writeLine(json);
+        m_hopRecords += hopRecords;
+        if (--m_pendingWrites == 0) {
+            m_writesDone.wakeAll();
+        }
+    }, TaskPool::Priority::Low);
+
+    m_completed++;
+    emit progress(m_completed, m_targets.size());
+}
+
+void BatchTracer::writeLine(const QByteArray& json)
+{
+    m_output.write(json);
+    m_output.write("\n");
+}
+
+void BatchTracer::waitForWrites()
+{
+    QMutexLocker locker(&m_outputMutex);
+    while (m_pendingWrites > 0) {
+        m_writesDone.wait(&m_outputMutex);
+    }
+}
+
+void BatchTracer::finish()
+{
+    waitForWrites();
+    const qint64 wallMs = qMax<qint64>(1, m_wallTimer.elapsed());
+    const double probesPerSecond = m_probes * 1000.0 / wallMs;
+
+    QJsonObject summary;
+    summary["targets"] = static_cast<int>(m_targets.size());
+    summary["completed"] = m_completed;
+    summary["failed"] = m_failed;
+    summary["wallMs"] = wallMs;
+    summary["probes"] = static_cast<qint64>(m_probes);
+    summary["probesPerSecond"] = probesPerSecond;
+    summary["budgetDenied"] = static_cast<qint64>(m_budget.denied());
+
+    // Routers are counted once however many paths cross them, compare with hopRecords
+    const TopologyGraph::Stats topology = TopologyGraph::instance().stats();
+    const quint64 probesShared = topology.probesShared - m_topologyAtStart.probesShared;
+    summary["routers"] = topology.nodes;
+    summary["adjacencies"] = topology.edges;
+    summary["probesShared"] = static_cast<qint64>(probesShared);
+    summary["lookupsShared"] = static_cast<qint64>(topology.lookupsShared - m_topologyAtStart.lookupsShared);
+    summary["hopRecords"] = static_cast<qint64>(m_hopRecords);
+
+    QJsonObject line;
+    line["summary"] = summary;
+    writeLine(QJsonDocument(line).toJson(QJsonDocument::Compact));
+    m_output.close();
+
+    m_running = false;
+    emit finished(QString("Batch trace finished: %1 of %2 targets (%3 failed) in %4 s, %5 probes/s, "
+                          "%6 probes shared across %7 routers")
+                  .arg(m_completed)
+                  .arg(m_targets.size())
+                  .arg(m_failed)
+                  .arg(wallMs / 1000.0, 0, 'f', 1)
+                  .arg(probesPerSecond, 0, 'f', 1)
+                  .arg(probesShared)
+                  .arg(topology.nodes));
+}
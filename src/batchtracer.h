@@ -0,0 +1,94 @@
+#ifndef BATCHTRACER_H
+#define BATCHTRACER_H
+
+#include <QObject>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include "pingtracer.h"
+#include "probebudget.h"
+
+// One-shot traces of a list of targets, written out as NDJSON.
+//
+// A fixed set of tracers is reused for the whole list: each one traces its
+// target for a number of rounds, writes one JSON line and takes the next
+// target. All tracers draw on one ProbeBudget, so the total probe rate stays
+// capped however many run at once. The last line is a summary with the wall
+// clock time, the achieved probe rate and what the shared topology graph
+// saved in probes, lookups and per-target hop records. Lines are built and
+// written on TaskPool at low priority, so a large batch does not hold up the
+// GUI thread; the summary waits for the last of them.
+class BatchTracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Config {
+        int concurrency;         // Traces running at once
+        int rounds;              // Probes per hop before a trace is done
+        double probesPerSecond;  // Budget for the whole batch, <= 0 is unlimited
+        int intervalMs;
+        int timeoutMs;
+        int maxHops;
+        ProbeProtocol protocol;
+        quint16 port;            // 0 is the protocol's well-known port
+        QString query;           // DNS name or HTTP path of application probes
+        bool reuseConnections;
+
+        Config() : concurrency(32), rounds(3), probesPerSecond(1000), intervalMs(1000), timeoutMs(2000), maxHops(30),
+                   protocol(ProbeProtocol::Udp), port(0), reuseConnections(true) {}
+    };
+
+    explicit BatchTracer(QObject *parent = nullptr);
+    ~BatchTracer();
+
+    // One target per line; blank lines and # comments are skipped
+    static QStringList loadTargets(const QString& fileName, QString* error);
+
+    bool start(const QStringList& targets, const QString& outputFile, const Config& config, QString* error);
+    void stop();
+    bool isRunning() const;
+
+    int targetCount() const;
+    int completedCount() const;
+
+signals:
+    void progress(int completed, int total);
+    void finished(const QString& summary);
+
+private slots:
+    void onTracerFinished();
+    void onTracerError(const QString& error);
+
+private:
+    void startNext(PingTracer* tracer);
+    void writeResult(PingTracer* tracer, const QString& error);
+    void writeLine(const QByteArray& json);
+    void waitForWrites();
+    void finish();
+
+    Config m_config;
+    QStringList m_targets;
+    int m_nextTarget;
+    int m_completed;
+    int m_failed;
+    quint64 m_probes;
+    quint64 m_hopRecords;   // Responding hops over all written paths, guarded by m_outputMutex
+    TopologyGraph::Stats m_topologyAtStart;
+    bool m_running;
+
+    QList<PingTracer*> m_tracers;
+    QHash<PingTracer*, qint64> m_startedMs; // Active tracers and when their trace began
+    ProbeBudget m_budget;
+    QFile m_output;
+    QMutex m_outputMutex;
+    QWaitCondition m_writesDone;
+    int m_pendingWrites;    // Result lines queued on TaskPool, guarded by m_outputMutex
+    QElapsedTimer m_wallTimer;
+};
+
+#endif // BATCHTRACER_H
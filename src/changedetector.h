@@ -0,0 +1,236 @@
+#ifndef CHANGEDETECTOR_H
+#define CHANGEDETECTOR_H
+
+#include <QtGlobal>
+#include <cmath>
+
+// Streaming change-point detector for one hop's latency and loss.
+//
+// Latency runs a two-sided CUSUM on samples standardised against a slow EWMA
+// baseline; loss runs a Bernoulli log-likelihood CUSUM against the baseline
+// loss rate. When a sum crosses the threshold both sums are cleared and the
+// baseline is seeded again from the samples that follow, starting with the one
+// that tripped it, so each shift is reported once and the pre-change variance
+// does not linger. Every sample is O(1) with a few dozen bytes of state per hop.
+class ChangeDetector
+{
+public:
+    enum class Kind : quint8 {
+        None,
+        LatencyUp,
+        LatencyDown,
+        LossUp,
+        LossDown
+    };
+
+    struct Config {
+        double threshold;      // CUSUM decision interval, lower is more sensitive
+        double slack;          // Allowed drift per sample, in standard deviations
+        double baselineAlpha;  // EWMA weight of the long-run baseline
+        double levelAlpha;     // EWMA weight of the recent level
+        double minLossShift;   // Smallest loss-rate change worth reporting
+        int warmupSamples;     // Samples used to seed the baseline
+
+        Config()
+            : threshold(8.0)
+            , slack(0.5)
+            , baselineAlpha(0.02)
+            , levelAlpha(0.2)
+            , minLossShift(0.15)
+            , warmupSamples(10)
+        {}
+    };
+
+    // Everything add() has learnt, laid out for the session snapshot
+    struct State {
+        qint32 latencySamples;
+        qint32 lossSamples;
+        double mean;
+        double variance;
+        double level;
+        double upSum;
+        double downSum;
+        double lossRate;
+        double lossLevel;
+        double lossUpSum;
+        double lossDownSum;
+    };
+
+    struct Change {
+        Kind kind;
+        double before;  // ms for latency, fraction for loss
+        double after;
+
+        Change() : kind(Kind::None), before(0), after(0) {}
+    };
+
+    explicit ChangeDetector(const Config& config = Config())
+        : m_config(config)
+    {
+        reset();
+    }
+
+    void setConfig(const Config& config) { m_config = config; }
+    const Config& config() const { return m_config; }
+
+    void reset()
+    {
+        m_latencySamples = 0;
+        m_mean = 0;
+        m_variance = 0;
+        m_level = 0;
+        m_upSum = 0;
+        m_downSum = 0;
+        m_lossSamples = 0;
+        m_lossRate = 0;
+        m_lossLevel = 0;
+        m_lossUpSum = 0;
+        m_lossDownSum = 0;
+    }
+
+    // One probe result; rttMs < 0 marks a lost probe
+    Change add(double rttMs)
+    {
+        Change change = addLoss(rttMs < 0);
+        if (rttMs >= 0) {
+            const Change latency = addLatency(rttMs);
+            if (latency.kind != Kind::None) {
+                change = latency;
+            }
+        }
+        return change;
+    }
+
+    State state() const
+    {
+        return { m_latencySamples, m_lossSamples, m_mean, m_variance, m_level, m_upSum, m_downSum,
+                 m_lossRate, m_lossLevel, m_lossUpSum, m_lossDownSum };
+    }
+
+    // Carries the baseline and sums over from an earlier session
+    void restore(const State& state)
+    {
+        m_latencySamples = qBound(0, static_cast<int>(state.latencySamples), m_config.warmupSamples);
+        m_mean = state.mean;
+        m_variance = state.variance;
+        m_level = state.level;
+        m_upSum = state.upSum;
+        m_downSum = state.downSum;
+        m_lossSamples = qBound(0, static_cast<int>(state.lossSamples), m_config.warmupSamples);
+        m_lossRate = state.lossRate;
+        m_lossLevel = state.lossLevel;
+        m_lossUpSum = state.lossUpSum;
+        m_lossDownSum = state.lossDownSum;
+    }
+
+    double baselineLatency() const { return m_mean; }
+    double baselineLoss() const { return m_lossRate; }
+
+private:
+    Change addLatency(double rttMs)
+    {
+        Change change;
+        if (m_latencySamples < m_config.warmupSamples) {
+            // Plain running mean and variance until the baseline is seeded
+            m_latencySamples++;
+            const double delta = rttMs - m_mean;
+            m_mean += delta / m_latencySamples;
+            m_variance += (delta * (rttMs - m_mean) - m_variance) / m_latencySamples;
+            m_level = m_mean;
+            return change;
+        }
+
+        // Noise floor keeps near-constant hops from alarming on tiny jitter
+        const double sigma = qMax(std::sqrt(m_variance), qMax(0.5, 0.05 * m_mean));
+        const double z = (rttMs - m_mean) / sigma;
+
+        m_upSum = qMax(0.0, m_upSum + z - m_config.slack);
+        m_downSum = qMax(0.0, m_downSum - z - m_config.slack);
+        m_level += m_config.levelAlpha * (rttMs - m_level);
+
+        if (m_upSum > m_config.threshold || m_downSum > m_config.threshold) {
+            change.kind = m_upSum > m_config.threshold ? Kind::LatencyUp : Kind::LatencyDown;
+            change.before = m_mean;
+            change.after = m_level;
+
+            // Mean and variance restart from the post-change samples, the old
+            // variance would otherwise hide or exaggerate the next shift
+            m_latencySamples = 1;
+            m_mean = rttMs;
+            m_variance = 0;
+            m_level = rttMs;
+            m_upSum = 0;
+            m_downSum = 0;
+            return change;
+        }
+
+        // The baseline follows slowly, a real shift trips the CUSUM well before it catches up
+        const double delta = rttMs - m_mean;
+        m_mean += m_config.baselineAlpha * delta;
+        m_variance = (1 - m_config.baselineAlpha) * (m_variance + m_config.baselineAlpha * delta * delta);
+        return change;
+    }
+
+    Change addLoss(bool lost)
+    {
+        Change change;
+        const double x = lost ? 1.0 : 0.0;
+
+        if (m_lossSamples < m_config.warmupSamples) {
+            m_lossSamples++;
+            m_lossRate += (x - m_lossRate) / m_lossSamples;
+            m_lossLevel = m_lossRate;
+            return change;
+        }
+
+        m_lossLevel += m_config.levelAlpha * (x - m_lossLevel);
+
+        // Log-likelihood ratio of "rate moved by minLossShift" against the baseline
+        const double p0 = qBound(0.01, m_lossRate, 0.99);
+        const double up = qMin(0.99, p0 + m_config.minLossShift);
+        m_lossUpSum = qMax(0.0, m_lossUpSum + (lost ? std::log(up / p0) : std::log((1 - up) / (1 - p0))));
+
+        if (p0 - m_config.minLossShift >= 0.01) {
+            const double down = p0 - m_config.minLossShift;
+            m_lossDownSum = qMax(0.0, m_lossDownSum + (lost ? std::log(down / p0) : std::log((1 - down) / (1 - p0))));
+        } else {
+            m_lossDownSum = 0;
+        }
+
+        // Loss evidence builds more slowly than latency z-scores, a slightly lower
+        // bar gives a similar false-alarm rate
+        const double threshold = m_config.threshold * 0.75;
+        if (m_lossUpSum > threshold || m_lossDownSum > threshold) {
+            change.kind = m_lossUpSum > threshold ? Kind::LossUp : Kind::LossDown;
+            change.before = m_lossRate;
+            change.after = m_lossLevel;
+
+            m_lossSamples = 1;
+            m_lossRate = x;
+            m_lossLevel = x;
+            m_lossUpSum = 0;
+            m_lossDownSum = 0;
+            return change;
+        }
+
+        m_lossRate += m_config.baselineAlpha * (x - m_lossRate);
+        return change;
+    }
+
+    Config m_config;
+
+    int m_latencySamples;
+    double m_mean;
+    double m_variance;
+    double m_level;
+    double m_upSum;
+    double m_downSum;
+
+    int m_lossSamples;
+    double m_lossRate;
+    double m_lossLevel;
+    double m_lossUpSum;
+    double m_lossDownSum;
+};
+
+#endif // CHANGEDETECTOR_H
@@ -0,0 +1,156 @@
+#include "eventlog.h"
+#include <QDateTime>
+#include <QColor>
+
+EventLog::EventLog(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_head(0)
+    , m_count(0)
+{
+    m_events.resize(qMax(1, capacity));
+}
+
+void EventLog::append(LogEvent::Type type, const QString& message, int hop)
+{
+    // Full: drop the oldest row before adding the new one
+    if (m_count == m_events.size()) {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_head = (m_head + 1) % m_events.size();
+        m_count--;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_count, m_count);
+    LogEvent& event = m_events[(m_head + m_count) % m_events.size()];
+    event.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    event.type = type;
+    event.hop = hop;
+    event.message = message;
+    m_count++;
+    endInsertRows();
+}
+
+void EventLog::clear()
+{
+    beginResetModel();
+    m_head = 0;
+    m_count = 0;
+    endResetModel();
+}
+
+const LogEvent& EventLog::event(int row) const
+{
+    return m_events[(m_head + row) % m_events.size()];
+}
+
+QStringList EventLog::formatted(LogEvent::Type type) const
+{
+    QStringList lines;
+    for (int row = 0; row < m_count; ++row) {
+        const LogEvent& e = event(row);
+        if (e.type == type) {
+            lines.append(data(index(row), Qt::DisplayRole).toString());
+        }
+    }
+    return lines;
+}
+
+int EventLog::capacity() const
+{
+    return m_events.size();
+}
+
+QString EventLog::typeName(LogEvent::Type type)
+{
+    switch (type) {
+    case LogEvent::Type::Session:
+        return "Session";
+    case LogEvent::Type::Resolution:
+        return "Resolution";
+    case LogEvent::Type::Path:
+        return "Path";
+    case LogEvent::Type::Error:
+        return "Error";
+    case LogEvent::Type::Change:
+        return "Change";
+    case LogEvent::Type::Alert:
+        return "Alert";
+    }
+    return QString();
+}
+
+int EventLog::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+QVariant EventLog::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_count) {
+        return QVariant();
+    }
+
+    const LogEvent& e = event(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("[%1] %2")
+               .arg(QDateTime::fromMSecsSinceEpoch(e.timestampMs).toString("hh:mm:ss"))
+               .arg(e.message);
+    case Qt::ForegroundRole:
+        if (e.type == LogEvent::Type::Error || e.type == LogEvent::Type::Alert) {
+            return QColor(200, 40, 40);
+        }
+        if (e.type == LogEvent::Type::Change) {
+            return QColor(200, 120, 0);
+        }
+        return QVariant();
+    case TypeRole:
+        return static_cast<int>(e.type);
+    case TimestampRole:
+        return e.timestampMs;
+    case HopRole:
+        return e.hop;
+    default:
+        return QVariant();
+    }
+}
+
+EventLogFilter::EventLogFilter(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_type(-1)
+{
+}
+
+void EventLogFilter::setTypeFilter(int type)
+{
+    if (type == m_type) {
+        return;
+    }
+    m_type = type;
+    invalidateFilter();
+}
+
+void EventLogFilter::setTextFilter(const QString& text)
+{
+    if (text == m_text) {
+        return;
+    }
+    m_text = text;
+    invalidateFilter();
+}
+
+bool EventLogFilter::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    Q_UNUSED(sourceParent)
+
+    const EventLog* log = qobject_cast<const EventLog*>(sourceModel());
+    if (!log) {
+        return true;
+    }
+
+    const LogEvent& e = log->event(sourceRow);
+    if (m_type >= 0 && static_cast<int>(e.type) != m_type) {
+        return false;
+    }
+    return m_text.isEmpty() || e.message.contains(m_text, Qt::CaseInsensitive);
+}
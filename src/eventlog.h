@@ -0,0 +1,85 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+struct LogEvent {
+    enum class Type : quint8 {
+        Session,    // Start, stop, reset
+        Resolution, // Target resolved
+        Path,       // Path discovered or changed
+        Error,
+        Change,     // Latency or loss level shift on a hop
+        Alert       // Alert rule fired or cleared
+    };
+
+    qint64 timestampMs; // Milliseconds since epoch
+    Type type;
+    int hop;            // 0 when not tied to a hop
+    QString message;
+
+    LogEvent() : timestampMs(0), type(Type::Session), hop(0) {}
+};
+
+// Bounded log of typed events, exposed as a list model.
+//
+// Events live in a fixed-capacity ring; once full, each new event evicts the
+// oldest. Views only lay out the rows they show, so appending costs the same
+// however long the session has been running.
+class EventLog : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        TypeRole = Qt::UserRole + 1,
+        TimestampRole,
+        HopRole
+    };
+
+    explicit EventLog(int capacity = 10000, QObject *parent = nullptr);
+
+    void append(LogEvent::Type type, const QString& message, int hop = 0);
+    void clear();
+
+    const LogEvent& event(int row) const;
+    // Display text of every held event of one type, oldest first
+    QStringList formatted(LogEvent::Type type) const;
+    int capacity() const;
+
+    static QString typeName(LogEvent::Type type);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    QVector<LogEvent> m_events;
+    int m_head;  // Index of the oldest event
+    int m_count;
+};
+
+// Filters an EventLog by event type and message text
+class EventLogFilter : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit EventLogFilter(QObject *parent = nullptr);
+
+    // -1 shows every type
+    void setTypeFilter(int type);
+    void setTextFilter(const QString& text);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+
+private:
+    int m_type;
+    QString m_text;
+};
+
+#endif // EVENTLOG_H
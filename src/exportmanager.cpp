@@ -5,7 +5,7 @@
 #include <QFileInfo>
 #include <QMessageBox>
 
-bool ExportManager::exportResults(QTableWidget* table, const QString& targetHost, const QString& fileName)
+bool ExportManager::exportResults(QTableWidget* table, const QString& targetHost, const QString& fileName, const QStringList& events)
 {
     if (!table || fileName.isEmpty()) {
         return false;
@@ -24,21 +24,21 @@ bool ExportManager::exportResults(QTableWidget* table, const QString& targetHost
     QString extension = fileInfo.suffix().toLower();
     
     if (extension == "csv") {
-        out << formatAsCSV(table, targetHost);
+        out << formatAsCSV(table, targetHost, events);
     } else {
-        out << formatAsText(table, targetHost);
+        out << formatAsText(table, targetHost, events);
     }
     
     file.close();
     return true;
 }
 
-QString ExportManager::formatResultsForClipboard(QTableWidget* table, const QString& targetHost)
+QString ExportManager::formatResultsForClipboard(QTableWidget* table, const QString& targetHost, const QStringList& events)
 {
-    return formatAsText(table, targetHost);
+    return formatAsText(table, targetHost, events);
 }
 
-QString ExportManager::formatAsText(QTableWidget* table, const QString& targetHost)
+QString ExportManager::formatAsText(QTableWidget* table, const QString& targetHost, const QStringList& events)
 {
     QString result;
     QTextStream stream(&result);
@@ -99,13 +99,22 @@ QString ExportManager::formatAsText(QTableWidget* table, const QString& targetHo
     stream << "  Avg     - Average response time (ms)\n";
     stream << "  Worst   - Worst response time (ms)\n";
     stream << "\n";
+    
+    if (!events.isEmpty()) {
+        stream << "Detected Changes:\n";
+        for (const QString& event : events) {
+            stream << "  " << event << "\n";
+        }
+        stream << "\n";
+    }
+    
     stream << "Generated by PingTracer v1.0.0\n";
     stream << "Developer: Harvey - www.iqterabharvey.me\n";
     
     return result;
 }
 
-QString ExportManager::formatAsCSV(QTableWidget* table, const QString& targetHost)
+QString ExportManager::formatAsCSV(QTableWidget* table, const QString& targetHost, const QStringList& events)
 {
     QString result;
     QTextStream stream(&result);
@@ -143,6 +152,15 @@ QString ExportManager::formatAsCSV(QTableWidget* table, const QString& targetHos
         stream << rowData.join(",") << "\n";
     }
     
+    // Events go after the rows as comments so the table stays machine-readable
+    if (!events.isEmpty()) {
+        stream << "#\n";
+        stream << "# Detected Changes:\n";
+        for (const QString& event : events) {
+            stream << "# " << event << "\n";
+        }
+    }
+    
     return result;
 }
 
@@ -3,16 +3,18 @@
 
 #include <QString>
 #include <QTableWidget>
+#include <QStringList>
 
 class ExportManager
 {
 public:
-    static bool exportResults(QTableWidget* table, const QString& targetHost, const QString& fileName);
-    static QString formatResultsForClipboard(QTableWidget* table, const QString& targetHost);
+    // events are optional log lines (e.g. detected changes) appended after the table
+    static bool exportResults(QTableWidget* table, const QString& targetHost, const QString& fileName, const QStringList& events = QStringList());
+    static QString formatResultsForClipboard(QTableWidget* table, const QString& targetHost, const QStringList& events = QStringList());
     
 private:
-    static QString formatAsText(QTableWidget* table, const QString& targetHost);
-    static QString formatAsCSV(QTableWidget* table, const QString& targetHost);
+    static QString formatAsText(QTableWidget* table, const QString& targetHost, const QStringList& events);
+    static QString formatAsCSV(QTableWidget* table, const QString& targetHost, const QStringList& events);
     static QString getCurrentTimestamp();
 };
 
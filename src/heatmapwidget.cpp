@@ -0,0 +1,373 @@
+#include "heatmapwidget.h"
+#include "taskpool.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <cmath>
+
+namespace {
+const int LeftMargin = 32;
+const int RightMargin = 8;
+const int TopMargin = 4;
+const int BottomMargin = 20;
+
+// Cells per pool task; a few fresh columns stay on the calling thread
+const int CellsPerTask = 4096;
+const qint64 MinSpanMs = 10 * 1000;
+const qint64 MaxSpanMs = Q_INT64_C(7) * 24 * 3600 * 1000;
+
+qint64 ringSlot(qint64 column, int width)
+{
+    const qint64 slot = column % width;
+    return slot < 0 ? slot + width : slot;
+}
+}
+
+HeatmapWidget::HeatmapWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_store(nullptr)
+    , m_hopCount(0)
+    , m_latencyScaleMs(150.0)
+    , m_spanMs(10 * 60 * 1000)
+    , m_viewEndMs(0)
+    , m_followLive(true)
+    , m_columnMs(0)
+    , m_firstColumn(0)
+    , m_dirtyFromMs(-1)
+    , m_lastSeenMs(-1)
+    , m_imageValid(false)
+    , m_emptyColor(0)
+    , m_renderedColumns(0)
+    , m_dragging(false)
+    , m_dragMoved(false)
+    , m_dragStartX(0)
+    , m_dragStartEndMs(0)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setToolTip(tr("Click a row to graph that hop, wheel to zoom, drag to scroll back, double-click to follow live"));
+}
+
+quint64 HeatmapWidget::renderedColumns() const
+{
+    return m_renderedColumns;
+}
+
+QSize HeatmapWidget::sizeHint() const
+{
+    return QSize(600, 200);
+}
+
+QSize HeatmapWidget::minimumSizeHint() const
+{
+    return QSize(200, 80);
+}
+
+void HeatmapWidget::setSampleStore(const SampleStore* store)
+{
+    m_store = store;
+    reset();
+}
+
+void HeatmapWidget::setHopCount(int hops)
+{
+    if (hops == m_hopCount) {
+        return;
+    }
+    m_hopCount = hops;
+    invalidate();
+    update();
+}
+
+void HeatmapWidget::setLatencyScale(double ms)
+{
+    m_latencyScaleMs = qMax(1.0, ms);
+    invalidate();
+    update();
+}
+
+void HeatmapWidget::setTimeSpan(qint64 spanMs)
+{
+    spanMs = qBound(MinSpanMs, spanMs, MaxSpanMs);
+    if (spanMs == m_spanMs) {
+        return;
+    }
+    m_spanMs = spanMs;
+    update();
+}
+
+void HeatmapWidget::setFollowLive(bool follow)
+{
+    m_followLive = follow;
+    update();
+}
+
+void HeatmapWidget::samplesUpdated()
+{
+    if (!m_store) {
+        return;
+    }
+
+    const qint64 lastMs = m_store->lastTimeMs();
+    if (lastMs < m_lastSeenMs) {
+        invalidate();
+    } else if (m_imageValid && m_lastSeenMs >= 0) {
+        // Columns before the previous newest sample are final
+        m_dirtyFromMs = m_dirtyFromMs < 0 ? m_lastSeenMs : qMin(m_dirtyFromMs, m_lastSeenMs);
+    }
+    m_lastSeenMs = lastMs;
+
+    update();
+}
+
+void HeatmapWidget::reset()
+{
+    m_lastSeenMs = -1;
+    m_viewEndMs = 0;
+    m_followLive = true;
+    invalidate();
+    update();
+}
+
+void HeatmapWidget::invalidate()
+{
+    m_imageValid = false;
+    m_dirtyFromMs = -1;
+}
+
+QRect HeatmapWidget::plotRect() const
+{
+    return rect().adjusted(LeftMargin, TopMargin, -RightMargin, -BottomMargin);
+}
+
+qint64 HeatmapWidget::columnWidthMs() const
+{
+    return qMax<qint64>(1, m_spanMs / qMax(1, plotRect().width()));
+}
+
+QRgb HeatmapWidget::cellColor(const SampleBucket& bucket) const
+{
+    if (bucket.isEmpty()) {
+        return m_emptyColor;
+    }
+    if (bucket.received == 0) {
+        return qRgb(90, 0, 0);
+    }
+
+    // Green through yellow to red as latency approaches the scale
+    const double level = qBound(0.0, bucket.mean() / m_latencyScaleMs, 1.0);
+    QColor color = QColor::fromHsvF((1.0 - level) / 3.0, 0.85, 0.9);
+
+    // Loss darkens the cell
+    if (bucket.lost > 0) {
+        color = color.darker(110 + static_cast<int>(bucket.lossPercent() * 2));
+    }
+    return color.rgb();
+}
+
+void HeatmapWidget::renderColumns(qint64 firstColumn, qint64 count)
+{
+    const int width = m_image.width();
+    if (count <= 0 || width <= 0) {
+        return;
+    }
+    m_renderedColumns += static_cast<quint64>(count);
+
+    // Rows are independent, so a full repaint spreads them over the task pool.
+    // Nothing writes the sample store while this thread waits here
+    uchar* bits = m_image.bits();
+    const qsizetype bytesPerLine = m_image.bytesPerLine();
+    TaskPool::instance().parallelFor(0, m_image.height(), [&](int firstRow, int lastRow) {
+        QVector<SampleBucket> buckets(static_cast<int>(count));
+        for (int row = firstRow; row < lastRow; ++row) {
+            QRgb* line = reinterpret_cast<QRgb*>(bits + row * bytesPerLine);
+            const SampleSeries* series = m_store ? m_store->series(row + 1) : nullptr;
+            if (series) {
+                series->columns(firstColumn * m_columnMs, m_columnMs, static_cast<int>(count), buckets.data());
+            } else {
+                buckets.fill(SampleBucket());
+            }
+            for (qint64 i = 0; i < count; ++i) {
+                line[ringSlot(firstColumn + i, width)] = cellColor(buckets[static_cast<int>(i)]);
+            }
+        }
+    }, qMax<int>(1, CellsPerTask / count));
+}
+
+void HeatmapWidget::updateImage()
+{
+    const int width = qMax(1, plotRect().width());
+    const int rows = qMax(1, m_hopCount);
+    const qint64 columnMs = columnWidthMs();
+
+    if (m_followLive && m_store) {
+        m_viewEndMs = m_store->lastTimeMs();
+    }
+    const qint64 firstColumn = qMax<qint64>(0, m_viewEndMs) / columnMs - width + 1;
+
+    if (!m_imageValid || columnMs != m_columnMs || m_image.width() != width || m_image.height() != rows) {
+        m_image = QImage(width, rows, QImage::Format_RGB32);
+        m_emptyColor = palette().color(QPalette::Base).rgb();
+        m_columnMs = columnMs;
+        m_firstColumn = firstColumn;
+        renderColumns(firstColumn, width);
+        m_imageValid = true;
+        m_dirtyFromMs = -1;
+        return;
+    }
+
+    // Only columns that scrolled into view need rendering
+    const qint64 shift = firstColumn - m_firstColumn;
+    if (qAbs(shift) >= width) {
+        renderColumns(firstColumn, width);
+    } else if (shift > 0) {
+        renderColumns(m_firstColumn + width, shift);
+    } else if (shift < 0) {
+        renderColumns(firstColumn, -shift);
+    }
+    m_firstColumn = firstColumn;
+
+    // Plus the ones new samples landed in
+    if (m_dirtyFromMs >= 0) {
+        const qint64 from = qMax(firstColumn, m_dirtyFromMs / columnMs);
+        renderColumns(from, firstColumn + width - from);
+        m_dirtyFromMs = -1;
+    }
+}
+
+void HeatmapWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    updateImage();
+
+    QPainter painter(this);
+    const QPalette pal = palette();
+    painter.fillRect(rect(), pal.color(QPalette::Window));
+
+    const QRect plot = plotRect();
+    if (plot.width() <= 0 || plot.height() <= 0) {
+        return;
+    }
+
+    // Unroll the ring: the oldest column sits at the current offset
+    const int width = m_image.width();
+    const int rows = m_image.height();
+    const int offset = static_cast<int>(ringSlot(m_firstColumn, width));
+    painter.drawImage(QRect(plot.left(), plot.top(), width - offset, plot.height()),
+                      m_image, QRect(offset, 0, width - offset, rows));
+    if (offset > 0) {
+        painter.drawImage(QRect(plot.left() + width - offset, plot.top(), offset, plot.height()),
+                          m_image, QRect(0, 0, offset, rows));
+    }
+
+    // Hop labels, thinned out when rows get too short for text
+    painter.setPen(pal.color(QPalette::WindowText));
+    const QFontMetrics fm = painter.fontMetrics();
+    const double rowHeight = static_cast<double>(plot.height()) / rows;
+    const int labelStep = qMax(1, static_cast<int>(std::ceil(fm.height() / rowHeight)));
+    for (int row = 0; row < m_hopCount; row += labelStep) {
+        const int y = plot.top() + static_cast<int>(row * rowHeight);
+        painter.drawText(QRect(0, y, LeftMargin - 4, qMax(fm.height(), static_cast<int>(rowHeight))),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(row + 1));
+    }
+
+    const QRect axis(plot.left(), plot.bottom() + 2, plot.width(), BottomMargin - 2);
+    const qint64 behindSeconds = m_store && !m_followLive ? (m_store->lastTimeMs() - m_viewEndMs) / 1000 : 0;
+    painter.drawText(axis, Qt::AlignRight | Qt::AlignVCenter,
+                     m_followLive ? tr("now") : tr("-%1s").arg(behindSeconds));
+    painter.drawText(axis, Qt::AlignLeft | Qt::AlignVCenter,
+                     tr("%1 s window, red at %2 ms").arg(m_spanMs / 1000).arg(m_latencyScaleMs));
+}
+
+void HeatmapWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    invalidate();
+}
+
+void HeatmapWidget::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::PaletteChange) {
+        invalidate();
+    }
+    QWidget::changeEvent(event);
+}
+
+void HeatmapWidget::wheelEvent(QWheelEvent *event)
+{
+    const int delta = event->angleDelta().y();
+    if (delta == 0) {
+        event->ignore();
+        return;
+    }
+
+    if (event->modifiers() & Qt::ShiftModifier) {
+        const qint64 lastMs = m_store ? m_store->lastTimeMs() : 0;
+        m_viewEndMs = qBound<qint64>(0, m_viewEndMs - static_cast<qint64>((delta / 120.0) * m_spanMs / 10), lastMs);
+        m_followLive = m_viewEndMs >= lastMs;
+        update();
+    } else {
+        setTimeSpan(static_cast<qint64>(m_spanMs * std::pow(1.25, -delta / 120.0)));
+    }
+    event->accept();
+}
+
+void HeatmapWidget::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = true;
+        m_dragMoved = false;
+        m_dragStartX = event->position().toPoint().x();
+        m_dragStartEndMs = m_followLive && m_store ? m_store->lastTimeMs() : m_viewEndMs;
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void HeatmapWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_dragging) {
+        const int dx = event->position().toPoint().x() - m_dragStartX;
+        if (qAbs(dx) > 2) {
+            m_dragMoved = true;
+            setCursor(Qt::ClosedHandCursor);
+        }
+        if (m_dragMoved) {
+            const qint64 lastMs = m_store ? m_store->lastTimeMs() : 0;
+            m_viewEndMs = qBound<qint64>(0, m_dragStartEndMs - dx * columnWidthMs(), lastMs);
+            m_followLive = m_viewEndMs >= lastMs;
+            update();
+        }
+    }
+    QWidget::mouseMoveEvent(event);
+}
+
+void HeatmapWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton && m_dragging) {
+        m_dragging = false;
+        unsetCursor();
+        if (!m_dragMoved) {
+            const int hop = hopAt(event->position().toPoint());
+            if (hop > 0) {
+                emit hopClicked(hop);
+            }
+        }
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+void HeatmapWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    setFollowLive(true);
+    QWidget::mouseDoubleClickEvent(event);
+}
+
+int HeatmapWidget::hopAt(const QPoint& pos) const
+{
+    const QRect plot = plotRect();
+    if (m_hopCount <= 0 || !plot.contains(pos)) {
+        return 0;
+    }
+    return (pos.y() - plot.top()) * m_hopCount / plot.height() + 1;
+}
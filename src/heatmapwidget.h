@@ -0,0 +1,86 @@
+#ifndef HEATMAPWIDGET_H
+#define HEATMAPWIDGET_H
+
+#include <QWidget>
+#include <QImage>
+#include <QColor>
+#include "samplestore.h"
+
+// Hops × time heatmap of latency and loss, MTR style.
+//
+// Cells are kept in a backing QImage with one pixel per time column and one
+// row per hop. The image is a ring over absolute column indices, so when time
+// advances only the newly exposed columns (and the one still filling) are
+// computed; painting scales the two halves of the ring into place. Columns
+// wider than a second are read from the sample store's rollup tiers, so
+// zooming out over long sessions costs the same as a live view.
+class HeatmapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HeatmapWidget(QWidget *parent = nullptr);
+
+    void setSampleStore(const SampleStore* store);
+    void setHopCount(int hops);
+    void setLatencyScale(double ms); // Latency drawn at full red
+    void setTimeSpan(qint64 spanMs);
+    void setFollowLive(bool follow);
+
+    // Columns computed since construction, a full redraw is one per pixel of width
+    quint64 renderedColumns() const;
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+public slots:
+    void samplesUpdated();
+    void reset();
+
+signals:
+    void hopClicked(int hop);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private:
+    QRect plotRect() const;
+    qint64 columnWidthMs() const;
+    void updateImage();
+    void renderColumns(qint64 firstColumn, qint64 count);
+    QRgb cellColor(const SampleBucket& bucket) const;
+    void invalidate();
+    int hopAt(const QPoint& pos) const;
+
+    const SampleStore* m_store;
+    int m_hopCount;
+    double m_latencyScaleMs;
+    qint64 m_spanMs;
+    qint64 m_viewEndMs;
+    bool m_followLive;
+
+    // Backing image, column c lives at x = c % width
+    QImage m_image;
+    qint64 m_columnMs;
+    qint64 m_firstColumn;   // Absolute index of the oldest column on screen
+    qint64 m_dirtyFromMs;
+    qint64 m_lastSeenMs;
+    bool m_imageValid;
+    QRgb m_emptyColor;
+    quint64 m_renderedColumns;
+
+    // Panning
+    bool m_dragging;
+    bool m_dragMoved;
+    int m_dragStartX;
+    qint64 m_dragStartEndMs;
+};
+
+#endif // HEATMAPWIDGET_H
@@ -0,0 +1,422 @@
+#include "latencygraphwidget.h"
+#include "taskpool.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QPolygonF>
+#include <cstring>
+#include <cmath>
+
+namespace {
+const int LeftMargin = 48;
+const int RightMargin = 8;
+const int TopMargin = 8;
+const int BottomMargin = 20;
+const qint64 MinSpanMs = 10 * 1000;
+const qint64 MaxSpanMs = Q_INT64_C(7) * 24 * 3600 * 1000;
+
+// Columns per pool task; scrolling by a few columns stays on the calling thread
+const int ColumnsPerTask = 256;
+}
+
+LatencyGraphWidget::LatencyGraphWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_store(nullptr)
+    , m_hop(0)
+    , m_endToEndHop(0)
+    , m_spanMs(5 * 60 * 1000)
+    , m_viewEndMs(0)
+    , m_followLive(true)
+    , m_columnsStartMs(0)
+    , m_columnMs(0)
+    , m_cachedHop(-1)
+    , m_dirtyFromMs(-1)
+    , m_lastSeenMs(-1)
+    , m_cacheValid(false)
+    , m_dragging(false)
+    , m_dragStartX(0)
+    , m_dragStartEndMs(0)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMouseTracking(false);
+    setToolTip(tr("Wheel to zoom, drag to scroll back, double-click to follow live"));
+}
+
+QSize LatencyGraphWidget::sizeHint() const
+{
+    return QSize(600, 160);
+}
+
+QSize LatencyGraphWidget::minimumSizeHint() const
+{
+    return QSize(200, 80);
+}
+
+void LatencyGraphWidget::setSampleStore(const SampleStore* store)
+{
+    m_store = store;
+    reset();
+}
+
+void LatencyGraphWidget::setHop(int hop)
+{
+    if (hop == m_hop) {
+        return;
+    }
+    m_hop = hop;
+    invalidate();
+    update();
+}
+
+void LatencyGraphWidget::setEndToEndHop(int hop)
+{
+    if (hop == m_endToEndHop) {
+        return;
+    }
+    m_endToEndHop = hop;
+    if (m_hop == 0) {
+        invalidate();
+        update();
+    }
+}
+
+void LatencyGraphWidget::setTimeSpan(qint64 spanMs)
+{
+    spanMs = qBound(MinSpanMs, spanMs, MaxSpanMs);
+    if (spanMs == m_spanMs) {
+        return;
+    }
+    m_spanMs = spanMs;
+    update();
+}
+
+void LatencyGraphWidget::setFollowLive(bool follow)
+{
+    m_followLive = follow;
+    update();
+}
+
+void LatencyGraphWidget::samplesUpdated()
+{
+    if (!m_store) {
+        return;
+    }
+
+    const qint64 lastMs = m_store->lastTimeMs();
+    if (lastMs < m_lastSeenMs) {
+        // The store was reset underneath us
+        invalidate();
+    } else if (m_cacheValid && m_lastSeenMs >= 0) {
+        // Everything older than the previous newest sample is final
+        m_dirtyFromMs = m_dirtyFromMs < 0 ? m_lastSeenMs : qMin(m_dirtyFromMs, m_lastSeenMs);
+    }
+    m_lastSeenMs = lastMs;
+
+    if (m_followLive || m_dirtyFromMs < 0 || m_dirtyFromMs < m_columnsStartMs + m_columns.size() * m_columnMs) {
+        update();
+    }
+}
+
+void LatencyGraphWidget::reset()
+{
+    m_lastSeenMs = -1;
+    m_viewEndMs = 0;
+    m_followLive = true;
+    invalidate();
+    update();
+}
+
+void LatencyGraphWidget::invalidate()
+{
+    m_cacheValid = false;
+    m_dirtyFromMs = -1;
+}
+
+int LatencyGraphWidget::effectiveHop() const
+{
+    return m_hop > 0 ? m_hop : m_endToEndHop;
+}
+
+QRect LatencyGraphWidget::plotRect() const
+{
+    return rect().adjusted(LeftMargin, TopMargin, -RightMargin, -BottomMargin);
+}
+
+qint64 LatencyGraphWidget::columnWidthMs() const
+{
+    const int width = qMax(1, plotRect().width());
+    return qMax<qint64>(1, m_spanMs / width);
+}
+
+void LatencyGraphWidget::computeColumns(int first, int count)
+{
+    const SampleSeries* series = m_store ? m_store->series(effectiveHop()) : nullptr;
+    if (count <= 0) {
+        return;
+    }
+    if (!series) {
+        for (int i = first; i < first + count; ++i) {
+            m_columns[i] = SampleBucket();
+        }
+        return;
+    }
+
+    // A relayout recomputes every column; split it over the task pool
+    SampleBucket* columns = m_columns.data();
+    const qint64 startMs = m_columnsStartMs;
+    const qint64 columnMs = m_columnMs;
+    TaskPool::instance().parallelFor(first, first + count, [=](int from, int to) {
+        series->columns(startMs + from * columnMs, columnMs, to - from, columns + from);
+    }, ColumnsPerTask);
+}
+
+void LatencyGraphWidget::updateColumns()
+{
+    const int count = qMax(1, plotRect().width());
+    const qint64 columnMs = columnWidthMs();
+
+    if (m_followLive && m_store) {
+        m_viewEndMs = m_store->lastTimeMs();
+    }
+
+    // Align columns to absolute time so scrolling moves the cache by whole columns
+    const qint64 endMs = (m_viewEndMs / columnMs + 1) * columnMs;
+    const qint64 startMs = endMs - count * columnMs;
+
+    const bool layoutChanged = !m_cacheValid
+        || columnMs != m_columnMs
+        || count != m_columns.size()
+        || effectiveHop() != m_cachedHop;
+
+    if (layoutChanged) {
+        m_columns.resize(count);
+        m_columnMs = columnMs;
+        m_columnsStartMs = startMs;
+        m_cachedHop = effectiveHop();
+        computeColumns(0, count);
+        m_cacheValid = true;
+        m_dirtyFromMs = -1;
+        return;
+    }
+
+    // Reuse the columns that are still on screen
+    const qint64 shift = (startMs - m_columnsStartMs) / columnMs;
+    if (shift != 0) {
+        m_columnsStartMs = startMs;
+        if (qAbs(shift) >= count) {
+            computeColumns(0, count);
+            m_dirtyFromMs = -1;
+            return;
+        }
+
+        const int n = static_cast<int>(qAbs(shift));
+        SampleBucket* data = m_columns.data();
+        if (shift > 0) {
+            std::memmove(data, data + n, (count - n) * sizeof(SampleBucket));
+            computeColumns(count - n, n);
+        } else {
+            std::memmove(data + n, data, (count - n) * sizeof(SampleBucket));
+            computeColumns(0, n);
+        }
+    }
+
+    // Refresh the columns new samples may have touched
+    if (m_dirtyFromMs >= 0) {
+        const qint64 first = qMax<qint64>(0, (m_dirtyFromMs - m_columnsStartMs) / columnMs);
+        if (first < count) {
+            computeColumns(static_cast<int>(first), count - static_cast<int>(first));
+        }
+        m_dirtyFromMs = -1;
+    }
+}
+
+QString LatencyGraphWidget::formatSpan(qint64 ms) const
+{
+    const qint64 seconds = ms / 1000;
+    if (seconds < 120) {
+        return QString("%1s").arg(seconds);
+    }
+    if (seconds < 2 * 3600) {
+        return QString("%1m").arg(seconds / 60);
+    }
+    if (seconds < 2 * 86400) {
+        return QString("%1h").arg(seconds / 3600);
+    }
+    return QString("%1d").arg(seconds / 86400);
+}
+
+void LatencyGraphWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    updateColumns();
+
+    QPainter painter(this);
+    const QPalette pal = palette();
+    painter.fillRect(rect(), pal.color(QPalette::Window));
+
+    const QRect plot = plotRect();
+    painter.fillRect(plot, pal.color(QPalette::Base));
+    if (plot.width() <= 0 || plot.height() <= 0) {
+        return;
+    }
+
+    // Scale the y axis to the visible maximum, rounded up to a 1-2-5 step
+    float peak = 0;
+    for (const SampleBucket& column : m_columns) {
+        if (column.received > 0) {
+            peak = qMax(peak, column.max);
+        }
+    }
+    static const double stepFactors[] = { 2.0, 2.5, 2.0 };
+    double step = 1.0;
+    for (int f = 0; step * 4 < peak; f = (f + 1) % 3) {
+        step *= stepFactors[f];
+    }
+    const double yMax = step * 4;
+    const double yScale = plot.height() / yMax;
+
+    // Grid and axis labels
+    QColor gridColor = pal.color(QPalette::Text);
+    gridColor.setAlpha(40);
+    painter.setPen(gridColor);
+    for (int i = 1; i <= 4; ++i) {
+        const int y = plot.bottom() - static_cast<int>(i * step * yScale);
+        painter.drawLine(plot.left(), y, plot.right(), y);
+    }
+
+    painter.setPen(pal.color(QPalette::WindowText));
+    const QFontMetrics fm = painter.fontMetrics();
+    for (int i = 0; i <= 4; ++i) {
+        const int y = plot.bottom() - static_cast<int>(i * step * yScale);
+        const QString label = QString("%1 ms").arg(i * step);
+        painter.drawText(QRect(0, y - fm.height() / 2, LeftMargin - 4, fm.height()),
+                         Qt::AlignRight | Qt::AlignVCenter, label);
+    }
+
+    const QString rightLabel = m_followLive ? tr("now") : tr("-%1").arg(formatSpan(m_store ? m_store->lastTimeMs() - m_viewEndMs : 0));
+    painter.drawText(QRect(plot.left(), plot.bottom() + 2, plot.width(), BottomMargin - 2),
+                     Qt::AlignRight | Qt::AlignVCenter, rightLabel);
+    painter.drawText(QRect(plot.left(), plot.bottom() + 2, plot.width(), BottomMargin - 2),
+                     Qt::AlignLeft | Qt::AlignVCenter, tr("%1 window").arg(formatSpan(m_spanMs)));
+
+    painter.setClipRect(plot);
+
+    // Min/max band, one vertical line per pixel column
+    QColor bandColor = pal.color(QPalette::Highlight);
+    bandColor.setAlpha(90);
+    painter.setPen(bandColor);
+    const int count = m_columns.size();
+    for (int i = 0; i < count; ++i) {
+        const SampleBucket& column = m_columns[i];
+        if (column.received == 0) {
+            continue;
+        }
+        const int x = plot.left() + i;
+        const int top = plot.bottom() - static_cast<int>(column.max * yScale);
+        const int bottom = plot.bottom() - static_cast<int>(column.min * yScale);
+        painter.drawLine(x, top, x, bottom);
+    }
+
+    // Mean line, broken where a column has no replies
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(pal.color(QPalette::Highlight), 1.5));
+    QPolygonF line;
+    line.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const SampleBucket& column = m_columns[i];
+        if (column.received == 0) {
+            if (line.size() > 1) {
+                painter.drawPolyline(line);
+            }
+            line.clear();
+            continue;
+        }
+        line.append(QPointF(plot.left() + i + 0.5, plot.bottom() - column.mean() * yScale));
+    }
+    if (line.size() > 1) {
+        painter.drawPolyline(line);
+    }
+    painter.setRenderHint(QPainter::Antialiasing, false);
+
+    // Loss markers along the bottom edge, stronger for heavier loss
+    for (int i = 0; i < count; ++i) {
+        const SampleBucket& column = m_columns[i];
+        if (column.lost == 0) {
+            continue;
+        }
+        QColor lossColor(220, 40, 40);
+        lossColor.setAlpha(80 + static_cast<int>(column.lossPercent() * 1.75));
+        painter.setPen(lossColor);
+        painter.drawLine(plot.left() + i, plot.bottom(), plot.left() + i, plot.bottom() - 6);
+    }
+}
+
+void LatencyGraphWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    invalidate();
+}
+
+void LatencyGraphWidget::wheelEvent(QWheelEvent *event)
+{
+    const int delta = event->angleDelta().y();
+    if (delta == 0) {
+        event->ignore();
+        return;
+    }
+
+    if (event->modifiers() & Qt::ShiftModifier) {
+        // Scroll through history by a tenth of the window per notch
+        m_followLive = false;
+        m_viewEndMs -= (delta / 120.0) * m_spanMs / 10;
+        m_viewEndMs = qBound<qint64>(0, m_viewEndMs, m_store ? m_store->lastTimeMs() : 0);
+        if (m_store && m_viewEndMs >= m_store->lastTimeMs()) {
+            m_followLive = true;
+        }
+        update();
+    } else {
+        const double factor = std::pow(1.25, -delta / 120.0);
+        setTimeSpan(static_cast<qint64>(m_spanMs * factor));
+    }
+    event->accept();
+}
+
+void LatencyGraphWidget::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = true;
+        m_dragStartX = event->position().toPoint().x();
+        m_dragStartEndMs = m_followLive && m_store ? m_store->lastTimeMs() : m_viewEndMs;
+        setCursor(Qt::ClosedHandCursor);
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void LatencyGraphWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_dragging) {
+        const int dx = event->position().toPoint().x() - m_dragStartX;
+        const qint64 lastMs = m_store ? m_store->lastTimeMs() : 0;
+        m_viewEndMs = qBound<qint64>(0, m_dragStartEndMs - dx * columnWidthMs(), lastMs);
+        m_followLive = m_viewEndMs >= lastMs;
+        update();
+    }
+    QWidget::mouseMoveEvent(event);
+}
+
+void LatencyGraphWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = false;
+        unsetCursor();
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+void LatencyGraphWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    setFollowLive(true);
+    QWidget::mouseDoubleClickEvent(event);
+}
@@ -0,0 +1,76 @@
+#ifndef LATENCYGRAPHWIDGET_H
+#define LATENCYGRAPHWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+#include "samplestore.h"
+
+// Latency-over-time chart for one hop, painted with QPainter.
+//
+// Every pixel column shows the min/max band and mean of the samples that fall
+// into it, read from the sample store's rollup tiers, so a frame costs the
+// same for ten minutes or seven days of history. Column aggregates are cached
+// on an absolute time grid: scrolling shifts the cache and only computes the
+// columns that came into view, and new samples only invalidate the columns
+// from the previous newest sample onwards.
+class LatencyGraphWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LatencyGraphWidget(QWidget *parent = nullptr);
+
+    void setSampleStore(const SampleStore* store);
+    void setHop(int hop);           // 0 shows the end-to-end hop
+    void setEndToEndHop(int hop);
+    void setTimeSpan(qint64 spanMs);
+    void setFollowLive(bool follow);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+public slots:
+    void samplesUpdated();
+    void reset();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    int effectiveHop() const;
+    QRect plotRect() const;
+    qint64 columnWidthMs() const;
+    void updateColumns();
+    void computeColumns(int first, int count);
+    void invalidate();
+    QString formatSpan(qint64 ms) const;
+
+    const SampleStore* m_store;
+    int m_hop;
+    int m_endToEndHop;
+    qint64 m_spanMs;
+    qint64 m_viewEndMs;
+    bool m_followLive;
+
+    // Column cache
+    QVector<SampleBucket> m_columns;
+    qint64 m_columnsStartMs;
+    qint64 m_columnMs;
+    int m_cachedHop;
+    qint64 m_dirtyFromMs;   // Columns at or after this time need recomputing
+    qint64 m_lastSeenMs;    // Newest sample time at the previous refresh
+    bool m_cacheValid;
+
+    // Panning
+    bool m_dragging;
+    int m_dragStartX;
+    qint64 m_dragStartEndMs;
+};
+
+#endif // LATENCYGRAPHWIDGET_H
@@ -0,0 +1,149 @@
+#ifndef LOSSLOCALIZER_H
+#define LOSSLOCALIZER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <cmath>
+
+// Tells loss a router creates for everything behind it apart from routers
+// that only drop the ICMP replies addressed to themselves.
+//
+// Probes are counted per hop during an interval and folded into a loss level
+// once per interval: a plain mean over the intervals so far, turning into an
+// EWMA once there are 1/alpha of them, so a first lost probe weighs no more
+// than any other. Hops get a verdict after a few intervals. A packet that is really dropped at hop N is also
+// missing at every hop after N, so the loss that carries through from hop i
+// is the minimum loss over hops i..end. Loss at a hop above what carries
+// through is control-plane rate limiting; the first hop where the carried
+// loss steps up is where forwarding loss starts. An update is one backward
+// pass over the path and keeps no history.
+class LossLocalizer
+{
+public:
+    enum class Verdict : quint8 {
+        None,           // No significant loss
+        RateLimited,    // Loss that later hops do not show
+        LossOrigin,     // First hop where forwarding loss persists downstream
+        Downstream      // Carries loss that started at an earlier hop
+    };
+
+    struct Config {
+        double alpha;          // EWMA weight of one interval
+        double minLossPercent; // Loss below this is noise
+        double marginPercent;  // Excess over carried loss that counts as rate limiting
+        int minIntervals;      // Intervals a hop needs before it gets a verdict
+
+        Config() : alpha(0.03), minLossPercent(2.0), marginPercent(5.0), minIntervals(3) {}
+    };
+
+    explicit LossLocalizer(const Config& config = Config()) : m_config(config), m_originHop(0) {}
+
+    void reset(int hops)
+    {
+        m_hops.fill(Hop(), hops);
+        m_originHop = 0;
+    }
+
+    void record(int hop, bool lost)
+    {
+        if (hop < 1 || hop > m_hops.size()) {
+            return;
+        }
+        Hop& h = m_hops[hop - 1];
+        h.sent++;
+        if (lost) {
+            h.lost++;
+        }
+    }
+
+    // Folds this interval's counts in and reclassifies hops 1..pathLength
+    void update(int pathLength)
+    {
+        pathLength = qMin(pathLength, static_cast<int>(m_hops.size()));
+
+        for (int i = 0; i < pathLength; ++i) {
+            Hop& h = m_hops[i];
+            if (h.sent > 0) {
+                const double loss = 100.0 * h.lost / h.sent;
+                h.intervals++;
+                h.weight = qMax(m_config.alpha, 1.0 / h.intervals);
+                h.loss += h.weight * (loss - h.loss);
+            }
+            h.sent = 0;
+            h.lost = 0;
+        }
+
+        // Carried loss: minimum over this hop and everything behind it. Each
+        // estimate is one probe per interval, so take the minimum of the upper
+        // noise bounds; a plain minimum over noisy hops reads far too low
+        double carried = 100.0;
+        for (int i = pathLength - 1; i >= 0; --i) {
+            Hop& h = m_hops[i];
+            if (ready(h)) {
+                carried = qMin(carried, h.loss + noise(h));
+            }
+            h.carried = qMin(carried, h.loss);
+        }
+
+        m_originHop = 0;
+        double previousCarried = 0.0;
+        for (int i = 0; i < pathLength; ++i) {
+            Hop& h = m_hops[i];
+            if (!ready(h)) {
+                h.verdict = Verdict::None;
+                continue;
+            }
+
+            if (h.carried - previousCarried >= m_config.minLossPercent && h.carried >= m_config.minLossPercent) {
+                h.verdict = Verdict::LossOrigin;
+                if (m_originHop == 0) {
+                    m_originHop = i + 1;
+                }
+            } else if (h.loss - h.carried >= qMax(m_config.marginPercent, 2.0 * noise(h)) && h.loss >= m_config.minLossPercent) {
+                h.verdict = Verdict::RateLimited;
+            } else if (h.carried >= m_config.minLossPercent) {
+                h.verdict = Verdict::Downstream;
+            } else {
+                h.verdict = Verdict::None;
+            }
+            previousCarried = qMax(previousCarried, h.carried);
+        }
+    }
+
+    Verdict verdict(int hop) const { return valid(hop) ? m_hops[hop - 1].verdict : Verdict::None; }
+    double hopLoss(int hop) const { return valid(hop) ? m_hops[hop - 1].loss : 0.0; }
+    double carriedLoss(int hop) const { return valid(hop) ? m_hops[hop - 1].carried : 0.0; }
+
+    // First hop where forwarding loss starts, 0 when there is none
+    int originHop() const { return m_originHop; }
+
+private:
+    struct Hop {
+        quint32 sent;
+        quint32 lost;
+        double loss;
+        double carried;
+        double weight;      // Weight the last interval got
+        int intervals;
+        Verdict verdict;
+
+        Hop() : sent(0), lost(0), loss(0), carried(0), weight(1.0), intervals(0), verdict(Verdict::None) {}
+    };
+
+    bool valid(int hop) const { return hop >= 1 && hop <= m_hops.size(); }
+    bool ready(const Hop& h) const { return h.intervals >= m_config.minIntervals; }
+
+    // Standard deviation of a hop's loss estimate fed one probe per interval,
+    // as an EWMA of its current weight; the plain mean of n intervals is close to it
+    double noise(const Hop& h) const
+    {
+        const double p = h.loss / 100.0;
+        return 100.0 * std::sqrt(h.weight / (2.0 - h.weight) * p * (1.0 - p));
+    }
+
+    Config m_config;
+    QVector<Hop> m_hops;
+    int m_originHop;
+};
+
+#endif // LOSSLOCALIZER_H
@@ -9,14 +9,30 @@
 #include <QFontMetrics>
 #include <QSplitter>
 #include <QDateTime>
+#include <QScrollBar>
+#include <QShowEvent>
+#include <QHideEvent>
+#include <QInputDialog>
+#include <QCloseEvent>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
+#include <QHostInfo>
+#include <QSignalBlocker>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_pingTracer(nullptr)
+    , m_pingTracerV6(nullptr)
+    , m_batchTracer(nullptr)
+    , m_throughputTest(nullptr)
+    , m_reflector(nullptr)
     , m_updateTimer(new QTimer(this))
+    , m_sessionSaveTimer(new QTimer(this))
     , m_isRunning(false)
-    , m_totalPacketsSent(0)
-    , m_totalPacketsReceived(0)
+    , m_throughputStartMs(-1)
+    , m_hopsDirty(false)
+    , m_hopsV6Dirty(false)
 {
     setupUI();
     setupMenus();
@@ -32,11 +48,68 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::onTracerouteUpdate);
     connect(m_pingTracer, &PingTracer::errorOccurred, 
             this, &MainWindow::onTracerouteError);
+    connect(m_pingTracer, &PingTracer::pathDiscovered,
+            this, &MainWindow::onPathDiscovered);
+    connect(m_pingTracer, &PingTracer::targetResolved,
+            this, &MainWindow::onTargetResolved);
+    connect(m_pingTracer, &PingTracer::changeDetected,
+            this, &MainWindow::onChangeDetected);
+    connect(m_pingTracer, &PingTracer::lossOriginChanged,
+            this, &MainWindow::onLossOriginChanged);
+    connect(m_pingTracer, &PingTracer::pathMtuChanged,
+            this, &MainWindow::onPathMtuChanged);
+    connect(m_pingTracer->alertEngine(), &AlertEngine::alertRaised,
+            this, &MainWindow::onAlert);
+    connect(m_pingTracer->alertEngine(), &AlertEngine::alertCleared,
+            this, &MainWindow::onAlert);
+    
+    m_latencyGraph->setSampleStore(&m_pingTracer->sampleStore());
+    m_heatmap->setSampleStore(&m_pingTracer->sampleStore());
+    
+    // IPv6 half of a dual-stack session, with its own hop table
+    m_pingTracerV6 = new PingTracer(this);
+    m_pingTracerV6->setAddressFamily(PingTracer::AddressFamily::IPv6);
+    connect(m_pingTracerV6, &PingTracer::hopDataUpdated,
+            this, &MainWindow::onDualStackUpdate);
+    connect(m_pingTracerV6, &PingTracer::errorOccurred,
+            this, &MainWindow::onDualStackError);
+    connect(m_pingTracerV6, &PingTracer::targetResolved,
+            this, &MainWindow::onTargetResolved);
+    connect(m_pingTracerV6, &PingTracer::changeDetected,
+            this, &MainWindow::onChangeDetected);
+    connect(m_pingTracerV6, &PingTracer::lossOriginChanged,
+            this, &MainWindow::onLossOriginChanged);
+    connect(m_pingTracerV6, &PingTracer::pathMtuChanged,
+            this, &MainWindow::onPathMtuChanged);
+    connect(m_pingTracerV6->alertEngine(), &AlertEngine::alertRaised,
+            this, &MainWindow::onAlert);
+    connect(m_pingTracerV6->alertEngine(), &AlertEngine::alertCleared,
+            this, &MainWindow::onAlert);
+    
+    // One-shot traces of a target list, independent of the interactive session
+    m_batchTracer = new BatchTracer(this);
+    connect(m_batchTracer, &BatchTracer::progress,
+            this, &MainWindow::onBatchProgress);
+    connect(m_batchTracer, &BatchTracer::finished,
+            this, &MainWindow::onBatchFinished);
+    
+    // Bulk load against a reflector, and the reflector for another PingTracer's tests
+    m_throughputTest = new ThroughputTest(this);
+    connect(m_throughputTest, &ThroughputTest::progress,
+            this, &MainWindow::onThroughputProgress);
+    connect(m_throughputTest, &ThroughputTest::finished,
+            this, &MainWindow::onThroughputFinished);
+    m_reflector = new ThroughputReflector(this);
+    connect(m_reflector, &ThroughputReflector::sessionFinished,
+            this, &MainWindow::onReflectorSession, Qt::QueuedConnection);
     
     // Initial state
     updateButtonStates();
     applyCurrentTheme();
     
+    // Pick up the session that was running when the app last closed
+    restoreSession();
+    
     // Set window properties
     setWindowTitle("PingTracer by Harvey - www.iqterabharvey.me");
     setMinimumSize(800, 600);
@@ -48,6 +121,9 @@ MainWindow::~MainWindow()
     if (m_pingTracer && m_pingTracer->isRunning()) {
         m_pingTracer->stop();
     }
+    if (m_pingTracerV6 && m_pingTracerV6->isRunning()) {
+        m_pingTracerV6->stop();
+    }
 }
 
 void MainWindow::setupUI()
@@ -96,6 +172,36 @@ void MainWindow::setupUI()
     m_timeoutSpinBox->setSuffix(" ms");
     m_inputLayout->addWidget(m_timeoutSpinBox, 1, 3);
     
+    // Address family
+    m_inputLayout->addWidget(new QLabel("Family:"), 0, 3);
+    m_familyComboBox = new QComboBox(this);
+    m_familyComboBox->addItems({"Auto", "IPv4", "IPv6", "Dual stack"});
+    m_familyComboBox->setToolTip("Auto traces whichever of A/AAAA answers first");
+    m_inputLayout->addWidget(m_familyComboBox, 0, 4);
+    
+    // Probe protocol, TCP aims at a service port so it passes where UDP is filtered,
+    // DNS and HTTP time the service itself
+    m_inputLayout->addWidget(new QLabel("Protocol:"), 1, 4);
+    m_protocolComboBox = new QComboBox(this);
+    m_protocolComboBox->addItems({"UDP", "TCP", "DNS", "HTTP"});
+    m_protocolComboBox->setToolTip("TCP times the handshake, per hop where the system can send a TTL-limited SYN.\n"
+                                   "DNS times a query to the target, HTTP the first byte of a GET from it");
+    m_portSpinBox = new QSpinBox(this);
+    m_portSpinBox->setRange(1, 65535);
+    m_portSpinBox->setValue(defaultProbePort(ProbeProtocol::Tcp));
+    m_portSpinBox->setPrefix("port ");
+    m_requestLineEdit = new QLineEdit(this);
+    m_requestLineEdit->setPlaceholderText("DNS name or HTTP path");
+    m_reuseCheckBox = new QCheckBox("Reuse connections", this);
+    m_reuseCheckBox->setChecked(true);
+    m_reuseCheckBox->setToolTip("Keep the DNS socket and the HTTP connection open between probes");
+    QHBoxLayout* protocolLayout = new QHBoxLayout();
+    protocolLayout->addWidget(m_protocolComboBox);
+    protocolLayout->addWidget(m_portSpinBox);
+    protocolLayout->addWidget(m_requestLineEdit);
+    protocolLayout->addWidget(m_reuseCheckBox);
+    m_inputLayout->addLayout(protocolLayout, 1, 5);
+    
     // Control buttons
     m_startButton = new QPushButton("Start", this);
     m_stopButton = new QPushButton("Stop", this);
@@ -111,6 +217,12 @@ void MainWindow::setupUI()
     buttonLayout->addWidget(m_resetButton);
     buttonLayout->addStretch();
     
+    // Fast start probes every hop in the first round
+    m_fastStartCheckBox = new QCheckBox("Fast start", this);
+    m_fastStartCheckBox->setChecked(true);
+    m_fastStartCheckBox->setToolTip("Probe all hops in parallel when tracing starts");
+    buttonLayout->addWidget(m_fastStartCheckBox);
+    
     m_inputLayout->addLayout(buttonLayout, 2, 0, 1, 4);
     
     // Status label
@@ -124,25 +236,33 @@ void MainWindow::setupUI()
     m_resultsGroup = new QGroupBox("Traceroute Results", this);
     m_resultsLayout = new QVBoxLayout(m_resultsGroup);
     
-    // Results table
-    m_resultsTable = new QTableWidget(this);
-    m_resultsTable->setColumnCount(7);
-    QStringList headers = {"Hop", "Hostname", "IP Address", "Loss %", "Sent", "Best", "Avg", "Worst"};
-    m_resultsTable->setHorizontalHeaderLabels(headers);
-    
-    // Table properties
-    m_resultsTable->setAlternatingRowColors(true);
-    m_resultsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_resultsTable->setSelectionMode(QAbstractItemView::SingleSelection);
-    m_resultsTable->setSortingEnabled(false);
-    m_resultsTable->verticalHeader()->setVisible(false);
-    
-    // Header properties
-    QHeaderView* header = m_resultsTable->horizontalHeader();
-    header->setStretchLastSection(true);
-    header->setSectionResizeMode(QHeaderView::Interactive);
-    
-    m_resultsLayout->addWidget(m_resultsTable);
+    // Results tables, one per traced address family
+    m_resultsTable = createResultsTable();
+    m_resultsTableV6 = createResultsTable();
+    
+    m_resultsTabs = new QTabWidget(this);
+    m_resultsTabs->addTab(m_resultsTable, "Results");
+    m_resultsTabs->addTab(m_resultsTableV6, "IPv6");
+    m_resultsTabs->setTabVisible(1, false);
+    
+    m_resultsLayout->addWidget(m_resultsTabs);
+    
+    // Latency over time for one hop
+    QHBoxLayout* graphHeaderLayout = new QHBoxLayout();
+    graphHeaderLayout->addWidget(new QLabel("Latency graph:", this));
+    m_graphHopComboBox = new QComboBox(this);
+    m_graphHopComboBox->addItem("End-to-end", 0);
+    graphHeaderLayout->addWidget(m_graphHopComboBox);
+    graphHeaderLayout->addStretch();
+    m_resultsLayout->addLayout(graphHeaderLayout);
+    
+    m_latencyGraph = new LatencyGraphWidget(this);
+    m_heatmap = new HeatmapWidget(this);
+    
+    m_historyTabs = new QTabWidget(this);
+    m_historyTabs->addTab(m_latencyGraph, "Latency");
+    m_historyTabs->addTab(m_heatmap, "Heatmap");
+    m_resultsLayout->addWidget(m_historyTabs);
     leftLayout->addWidget(m_resultsGroup);
     
     // Control group
@@ -167,10 +287,37 @@ void MainWindow::setupUI()
     m_statsGroup = new QGroupBox("Statistics & Log", this);
     m_statsLayout = new QVBoxLayout(m_statsGroup);
     
-    m_statsTextEdit = new QTextEdit(this);
-    m_statsTextEdit->setReadOnly(true);
-    m_statsTextEdit->setFont(QFont("Courier New", 9));
-    m_statsLayout->addWidget(m_statsTextEdit);
+    m_summaryStats = new SummaryStatsWidget(this);
+    m_statsLayout->addWidget(m_summaryStats);
+    
+    // Event log with type and text filters
+    QHBoxLayout* logFilterLayout = new QHBoxLayout();
+    m_logTypeComboBox = new QComboBox(this);
+    m_logTypeComboBox->addItem("All events", -1);
+    m_logTypeComboBox->addItem(EventLog::typeName(LogEvent::Type::Session), static_cast<int>(LogEvent::Type::Session));
+    m_logTypeComboBox->addItem(EventLog::typeName(LogEvent::Type::Resolution), static_cast<int>(LogEvent::Type::Resolution));
+    m_logTypeComboBox->addItem(EventLog::typeName(LogEvent::Type::Path), static_cast<int>(LogEvent::Type::Path));
+    m_logTypeComboBox->addItem(EventLog::typeName(LogEvent::Type::Error), static_cast<int>(LogEvent::Type::Error));
+    m_logTypeComboBox->addItem(EventLog::typeName(LogEvent::Type::Change), static_cast<int>(LogEvent::Type::Change));
+    m_logTypeComboBox->addItem(EventLog::typeName(LogEvent::Type::Alert), static_cast<int>(LogEvent::Type::Alert));
+    m_logFilterLineEdit = new QLineEdit(this);
+    m_logFilterLineEdit->setPlaceholderText("Filter log...");
+    m_logFilterLineEdit->setClearButtonEnabled(true);
+    logFilterLayout->addWidget(m_logTypeComboBox);
+    logFilterLayout->addWidget(m_logFilterLineEdit);
+    m_statsLayout->addLayout(logFilterLayout);
+    
+    m_eventLog = new EventLog(10000, this);
+    m_eventLogFilter = new EventLogFilter(this);
+    m_eventLogFilter->setSourceModel(m_eventLog);
+    
+    m_logView = new QListView(this);
+    m_logView->setModel(m_eventLogFilter);
+    m_logView->setUniformItemSizes(true);
+    m_logView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_logView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_logView->setFont(QFont("Courier New", 9));
+    m_statsLayout->addWidget(m_logView, 1);
     
     // Add panels to splitter
     m_mainSplitter->addWidget(leftPanel);
@@ -222,6 +369,42 @@ void MainWindow::setupMenus()
     
     m_viewMenu->addAction(m_darkModeAction);
     
+    // Tools menu
+    m_toolsMenu = m_menuBar->addMenu("&Tools");
+    
+    m_alertRulesAction = new QAction("&Alert Rules...", this);
+    m_alertRulesAction->setStatusTip("Edit latency and loss alert rules");
+    
+    m_changeSensitivityAction = new QAction("Change &Sensitivity...", this);
+    m_changeSensitivityAction->setStatusTip("Set how much evidence a latency or loss shift needs before it is logged");
+    
+    m_injectShiftAction = new QAction("&Inject Shift...", this);
+    m_injectShiftAction->setStatusTip("Add delay or loss from a hop onward to check that change detection reports it");
+    
+    m_batchTraceAction = new QAction("&Batch Trace...", this);
+    m_batchTraceAction->setStatusTip("Trace every target in a file once and write the results as NDJSON");
+    
+    m_sizeSweepAction = new QAction("Path &MTU Sweep", this);
+    m_sizeSweepAction->setCheckable(true);
+    m_sizeSweepAction->setStatusTip("Probe each hop at varying sizes with DF set to find the path MTU and link bandwidths");
+    
+    m_throughputAction = new QAction("&Throughput Test...", this);
+    m_throughputAction->setStatusTip("Load the path with TCP or UDP against a reflector and compare per-hop latency under load");
+    
+    m_reflectorAction = new QAction("Throughput &Reflector", this);
+    m_reflectorAction->setCheckable(true);
+    m_reflectorAction->setStatusTip("Answer throughput tests from other PingTracer instances");
+    
+    m_toolsMenu->addAction(m_alertRulesAction);
+    m_toolsMenu->addAction(m_changeSensitivityAction);
+    m_toolsMenu->addAction(m_injectShiftAction);
+    m_toolsMenu->addAction(m_batchTraceAction);
+    m_toolsMenu->addSeparator();
+    m_toolsMenu->addAction(m_sizeSweepAction);
+    m_toolsMenu->addSeparator();
+    m_toolsMenu->addAction(m_throughputAction);
+    m_toolsMenu->addAction(m_reflectorAction);
+    
     // Help menu
     m_helpMenu = m_menuBar->addMenu("&Help");
     
@@ -256,11 +439,13 @@ void MainWindow::setupStatusBar()
     m_statusBar = statusBar();
     
     m_statusInfo = new QLabel("Ready");
+    m_pathInfo = new QLabel();
     m_progressBar = new QProgressBar();
     m_progressBar->setVisible(false);
     m_progressBar->setMaximumWidth(200);
     
     m_statusBar->addWidget(m_statusInfo);
+    m_statusBar->addPermanentWidget(m_pathInfo);
     m_statusBar->addPermanentWidget(m_progressBar);
 }
 
@@ -280,11 +465,20 @@ void MainWindow::setupConnections()
     connect(m_exportAction, &QAction::triggered, this, &MainWindow::exportResults);
     connect(m_exitAction, &QAction::triggered, this, &QWidget::close);
     connect(m_darkModeAction, &QAction::triggered, this, &MainWindow::toggleDarkMode);
+    connect(m_alertRulesAction, &QAction::triggered, this, &MainWindow::editAlertRules);
+    connect(m_changeSensitivityAction, &QAction::triggered, this, &MainWindow::editChangeSensitivity);
+    connect(m_injectShiftAction, &QAction::triggered, this, &MainWindow::injectShift);
+    connect(m_batchTraceAction, &QAction::triggered, this, &MainWindow::runBatchTrace);
+    connect(m_sizeSweepAction, &QAction::toggled, this, &MainWindow::toggleSizeSweep);
+    connect(m_throughputAction, &QAction::triggered, this, &MainWindow::runThroughputTest);
+    connect(m_reflectorAction, &QAction::toggled, this, &MainWindow::toggleReflector);
     connect(m_aboutAction, &QAction::triggered, this, &MainWindow::showAbout);
     connect(m_helpAction, &QAction::triggered, this, &MainWindow::showHelp);
     
     // Input connections
     connect(m_hostLineEdit, &QLineEdit::textChanged, this, &MainWindow::onHostChanged);
+    connect(m_protocolComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onProtocolChanged);
     connect(m_intervalSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), 
             this, &MainWindow::onIntervalChanged);
     connect(m_timeoutSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), 
@@ -293,8 +487,35 @@ void MainWindow::setupConnections()
     // Theme connections
     connect(m_darkModeCheckBox, &QCheckBox::toggled, this, &MainWindow::toggleDarkMode);
     
+    connect(m_graphHopComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onGraphHopChanged);
+    connect(m_resultsTabs, &QTabWidget::currentChanged, this, &MainWindow::onResultsTabChanged);
+    connect(m_heatmap, &HeatmapWidget::hopClicked, this, [this](int hop) {
+        if (hop < m_graphHopComboBox->count()) {
+            m_graphHopComboBox->setCurrentIndex(hop);
+            m_historyTabs->setCurrentWidget(m_latencyGraph);
+        }
+    });
+    
+    connect(m_logTypeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        m_eventLogFilter->setTypeFilter(m_logTypeComboBox->itemData(index).toInt());
+    });
+    connect(m_logFilterLineEdit, &QLineEdit::textChanged, m_eventLogFilter, &EventLogFilter::setTextFilter);
+    
+    // Keep the newest event in view unless the user scrolled up
+    connect(m_eventLogFilter, &QAbstractItemModel::rowsInserted, this, [this]() {
+        QScrollBar* bar = m_logView->verticalScrollBar();
+        if (bar->value() >= bar->maximum() - 1) {
+            m_logView->scrollToBottom();
+        }
+    });
+    
     // Update timer
-    connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::updateStatusBar);
+    connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::refreshViews);
+    
+    // Closing saves too; this bounds what a crash or a killed process loses
+    m_sessionSaveTimer->setInterval(SessionSaveIntervalMs);
+    connect(m_sessionSaveTimer, &QTimer::timeout, this, &MainWindow::saveSession);
 }
 
 void MainWindow::startTracing()
@@ -310,57 +531,190 @@ void MainWindow::startTracing()
         m_pingTracer->stop();
     }
     
+    if (m_pingTracerV6->isRunning()) {
+        m_pingTracerV6->stop();
+    }
+    
     // Clear previous results
     m_resultsTable->setRowCount(0);
-    m_statsTextEdit->clear();
+    m_resultsTableV6->setRowCount(0);
+    m_summaryStats->clear();
     
     // Configure and start tracer
+    const bool dualStack = isDualStack();
+    switch (m_familyComboBox->currentIndex()) {
+    case 1:
+    case 3:
+        m_pingTracer->setAddressFamily(PingTracer::AddressFamily::IPv4);
+        break;
+    case 2:
+        m_pingTracer->setAddressFamily(PingTracer::AddressFamily::IPv6);
+        break;
+    default:
+        m_pingTracer->setAddressFamily(PingTracer::AddressFamily::Any);
+        break;
+    }
     m_pingTracer->setTarget(host);
     m_pingTracer->setInterval(m_intervalSpinBox->value());
     m_pingTracer->setTimeout(m_timeoutSpinBox->value());
+    m_pingTracer->setFastStart(m_fastStartCheckBox->isChecked());
+    m_pingTracer->setProbeProtocol(probeProtocol(), static_cast<quint16>(m_portSpinBox->value()));
+    m_pingTracer->setApplicationProbe(m_requestLineEdit->text().trimmed(), m_reuseCheckBox->isChecked());
     
     if (m_pingTracer->start()) {
-        m_isRunning = true;
-        m_currentHost = host;
-        m_totalPacketsSent = 0;
-        m_totalPacketsReceived = 0;
-        
-        m_statusLabel->setText(QString("Tracing route to %1...").arg(host));
-        m_statusInfo->setText("Running");
-        m_progressBar->setVisible(true);
-        m_progressBar->setRange(0, 0); // Indeterminate progress
+        beginSession(host, dualStack);
         
-        m_updateTimer->start(500); // Update every 500ms
-        
-        // Log start
-        QString startMsg = QString("[%1] Started tracing to %2")
-                          .arg(QDateTime::currentDateTime().toString("hh:mm:ss"))
-                          .arg(host);
-        m_statsTextEdit->append(startMsg);
+        if (dualStack) {
+            m_pingTracerV6->setTarget(host);
+            m_pingTracerV6->setInterval(m_intervalSpinBox->value());
+            m_pingTracerV6->setTimeout(m_timeoutSpinBox->value());
+            m_pingTracerV6->setFastStart(m_fastStartCheckBox->isChecked());
+            m_pingTracerV6->setProbeProtocol(probeProtocol(), static_cast<quint16>(m_portSpinBox->value()));
+            m_pingTracerV6->setApplicationProbe(m_requestLineEdit->text().trimmed(), m_reuseCheckBox->isChecked());
+            m_pingTracerV6->start();
+        }
         
-        updateButtonStates();
+        m_eventLog->append(LogEvent::Type::Session, QString("Started tracing to %1").arg(host));
     } else {
         QMessageBox::critical(this, "PingTracer", 
                              "Failed to start network tracing. Please check your network permissions.");
     }
 }
 
+void MainWindow::beginSession(const QString& host, bool dualStack)
+{
+    m_resultsTabs->setTabText(0, dualStack ? "IPv4" : "Results");
+    m_resultsTabs->setTabText(1, "IPv6");
+    m_resultsTabs->setTabVisible(1, dualStack);
+    m_pathInfo->clear();
+    m_graphHopComboBox->setCurrentIndex(0);
+    while (m_graphHopComboBox->count() > 1) {
+        m_graphHopComboBox->removeItem(1);
+    }
+    
+    m_latencyGraph->reset();
+    m_heatmap->reset();
+    m_isRunning = true;
+    m_currentHost = host;
+    
+    m_statusLabel->setText(QString("Tracing route to %1...").arg(host));
+    m_statusInfo->setText("Running");
+    m_progressBar->setVisible(true);
+    m_progressBar->setRange(0, 0); // Indeterminate progress
+    
+    m_shownHops.clear();
+    m_shownHopsV6.clear();
+    m_hopsDirty = false;
+    m_hopsV6Dirty = false;
+    m_statusClock.invalidate();
+    updateRefreshRate();
+    m_updateTimer->start();
+    m_sessionSaveTimer->start();
+    
+    m_summaryStats->setField(SummaryStatsWidget::Target, host);
+    
+    updateButtonStates();
+}
+
+QString MainWindow::sessionFileName() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/session.ptsession";
+}
+
+void MainWindow::saveSession()
+{
+    // Only a running session is carried over, a stopped one starts fresh
+    const QString fileName = sessionFileName();
+    if (!m_isRunning || !m_pingTracer->isRunning()) {
+        QFile::remove(fileName);
+        return;
+    }
+    
+    SessionWriter writer;
+    m_pingTracer->saveState(writer);
+    if (isDualStack() && m_pingTracerV6->isRunning()) {
+        m_pingTracerV6->saveState(writer);
+    }
+    
+    QString error;
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    if (!writer.commit(fileName, &error)) {
+        qWarning("MainWindow: %s", qPrintable(error));
+    }
+}
+
+void MainWindow::restoreSession()
+{
+    if (!QFile::exists(sessionFileName())) {
+        return;
+    }
+    
+    QElapsedTimer restoreTimer;
+    restoreTimer.start();
+    
+    SessionSnapshot snapshot;
+    QString error;
+    if (!snapshot.open(sessionFileName(), &error)) {
+        m_eventLog->append(LogEvent::Type::Error, QString("Session not restored: %1").arg(error));
+        return;
+    }
+    if (snapshot.tracerCount() == 0) {
+        return;
+    }
+    
+    // Inputs show what the restored session traces, so Start repeats it
+    const SessionTracer& tracer = snapshot.tracer(0);
+    const QString host = snapshot.string(tracer.target);
+    const bool dualStack = snapshot.tracerCount() > 1;
+    m_hostLineEdit->setText(host);
+    m_familyComboBox->setCurrentIndex(dualStack ? 3 : qBound(0, static_cast<int>(tracer.family), 2));
+    m_intervalSpinBox->setValue(tracer.intervalMs);
+    m_timeoutSpinBox->setValue(tracer.timeoutMs);
+    m_fastStartCheckBox->setChecked(tracer.flags & SessionTracer::FastStart);
+    // The port after the protocol, picking a protocol resets it to the well-known one
+    m_protocolComboBox->setCurrentIndex(qBound(0, static_cast<int>(tracer.protocol), 3));
+    m_portSpinBox->setValue(tracer.port);
+    m_requestLineEdit->setText(snapshot.string(tracer.query));
+    m_reuseCheckBox->setChecked(tracer.flags & SessionTracer::ReuseConnections);
+    m_alertRulesText = snapshot.string(tracer.alertRules);
+    
+    if (!m_pingTracer->resume(snapshot, 0)) {
+        m_eventLog->append(LogEvent::Type::Error, "Session not restored: snapshot has no target");
+        return;
+    }
+    beginSession(host, dualStack);
+    if (dualStack) {
+        m_pingTracerV6->resume(snapshot, 1);
+    } else {
+        m_pingTracerV6->setAlertRules(m_pingTracer->alertEngine()->rules());
+    }
+    
+    const qint64 ageSeconds = (QDateTime::currentMSecsSinceEpoch() - snapshot.savedAtMs()) / 1000;
+    m_eventLog->append(LogEvent::Type::Session, QString("Session to %1 restored in %2 ms (saved %3 s ago)")
+                       .arg(host)
+                       .arg(restoreTimer.elapsed())
+                       .arg(ageSeconds));
+}
+
 void MainWindow::stopTracing()
 {
     if (m_pingTracer && m_pingTracer->isRunning()) {
         m_pingTracer->stop();
     }
+    m_pingTracerV6->stop();
     
     m_isRunning = false;
     m_statusLabel->setText("Tracing stopped.");
     m_statusInfo->setText("Stopped");
     m_progressBar->setVisible(false);
     m_updateTimer->stop();
+    m_sessionSaveTimer->stop();
+    QFile::remove(sessionFileName());
+    
+    // Show whatever arrived since the last frame
+    refreshViews();
     
-    // Log stop
-    QString stopMsg = QString("[%1] Tracing stopped")
-                     .arg(QDateTime::currentDateTime().toString("hh:mm:ss"));
-    m_statsTextEdit->append(stopMsg);
+    m_eventLog->append(LogEvent::Type::Session, "Tracing stopped");
     
     updateButtonStates();
 }
@@ -370,24 +724,35 @@ void MainWindow::resetResults()
     if (m_pingTracer && m_pingTracer->isRunning()) {
         m_pingTracer->stop();
     }
+    m_pingTracerV6->stop();
     
     m_resultsTable->setRowCount(0);
-    m_statsTextEdit->clear();
+    m_resultsTableV6->setRowCount(0);
+    m_resultsTabs->setTabText(0, "Results");
+    m_resultsTabs->setTabVisible(1, false);
+    m_summaryStats->clear();
+    m_eventLog->clear();
     m_isRunning = false;
-    m_totalPacketsSent = 0;
-    m_totalPacketsReceived = 0;
     
     m_statusLabel->setText("Ready to start tracing...");
     m_statusInfo->setText("Ready");
+    m_pathInfo->clear();
     m_progressBar->setVisible(false);
     m_updateTimer->stop();
+    m_sessionSaveTimer->stop();
+    m_shownHops.clear();
+    m_shownHopsV6.clear();
+    m_hopsDirty = false;
+    m_hopsV6Dirty = false;
+    QFile::remove(sessionFileName());
     
     updateButtonStates();
 }
 
 void MainWindow::exportResults()
 {
-    if (m_resultsTable->rowCount() == 0) {
+    QTableWidget* table = currentResultsTable();
+    if (table->rowCount() == 0) {
         QMessageBox::information(this, "PingTracer", "No results to export.");
         return;
     }
@@ -400,19 +765,20 @@ void MainWindow::exportResults()
     );
     
     if (!fileName.isEmpty()) {
-        ExportManager::exportResults(m_resultsTable, m_currentHost, fileName);
+        ExportManager::exportResults(table, m_currentHost, fileName, m_eventLog->formatted(LogEvent::Type::Change));
         m_statusInfo->setText("Results exported successfully");
     }
 }
 
 void MainWindow::copyToClipboard()
 {
-    if (m_resultsTable->rowCount() == 0) {
+    QTableWidget* table = currentResultsTable();
+    if (table->rowCount() == 0) {
         QMessageBox::information(this, "PingTracer", "No results to copy.");
         return;
     }
     
-    QString clipboardText = ExportManager::formatResultsForClipboard(m_resultsTable, m_currentHost);
+    QString clipboardText = ExportManager::formatResultsForClipboard(table, m_currentHost, m_eventLog->formatted(LogEvent::Type::Change));
     QApplication::clipboard()->setText(clipboardText);
     
     m_statusInfo->setText("Results copied to clipboard");
@@ -426,99 +792,149 @@ void MainWindow::onHostChanged()
 
 void MainWindow::onTracerouteUpdate(const QList<HopData>& hops)
 {
-    // Update results table
-    m_resultsTable->setRowCount(hops.size());
+    // Applied on the next frame, however many batches arrive before it. Copied into
+    // our own buffer, sharing the tracer's list would make its next change reallocate
+    copyElements(m_pendingHops, hops);
+    m_hopsDirty = true;
+}
+
+void MainWindow::onDualStackUpdate(const QList<HopData>& hops)
+{
+    copyElements(m_pendingHopsV6, hops);
+    m_hopsV6Dirty = true;
+}
+
+void MainWindow::refreshViews()
+{
+    bool tablesChanged = false;
+    const bool v4Changed = m_hopsDirty;
+    const bool v6Changed = m_hopsV6Dirty;
+    const bool countersChanged = v4Changed || v6Changed;
+    
+    if (m_hopsDirty) {
+        m_hopsDirty = false;
+        tablesChanged |= ResultsTable::update(m_resultsTable, m_shownHops, m_pendingHops);
+        copyElements(m_shownHops, m_pendingHops);
+    }
     
-    for (int i = 0; i < hops.size(); ++i) {
-        const HopData& hop = hops[i];
-        
-        // Hop number
-        QTableWidgetItem* hopItem = new QTableWidgetItem(QString::number(hop.hopNumber));
-        hopItem->setTextAlignment(Qt::AlignCenter);
-        m_resultsTable->setItem(i, 0, hopItem);
-        
-        // Hostname
-        QTableWidgetItem* hostnameItem = new QTableWidgetItem(hop.hostname);
-        m_resultsTable->setItem(i, 1, hostnameItem);
-        
-        // IP Address
-        QTableWidgetItem* ipItem = new QTableWidgetItem(hop.ipAddress);
-        m_resultsTable->setItem(i, 2, ipItem);
-        
-        // Loss percentage
-        double lossPercent = hop.sent > 0 ? ((double)(hop.sent - hop.received) / hop.sent) * 100.0 : 0.0;
-        QTableWidgetItem* lossItem = new QTableWidgetItem(QString::number(lossPercent, 'f', 1));
-        lossItem->setTextAlignment(Qt::AlignCenter);
+    if (m_hopsV6Dirty) {
+        m_hopsV6Dirty = false;
+        tablesChanged |= ResultsTable::update(m_resultsTableV6, m_shownHopsV6, m_pendingHopsV6);
+        copyElements(m_shownHopsV6, m_pendingHopsV6);
+    }
+    
+    // The graph and heatmap show the family whose results tab is on view
+    const PingTracer* history = historyTracer();
+    const bool historyV6 = history == m_pingTracerV6;
+    if (historyV6 ? v6Changed : v4Changed) {
+        const QList<HopData>& hops = historyV6 ? m_shownHopsV6 : m_shownHops;
         
-        // Color code based on packet loss
-        if (lossPercent > 50) {
-            lossItem->setBackground(QColor(255, 200, 200)); // Light red
-        } else if (lossPercent > 10) {
-            lossItem->setBackground(QColor(255, 255, 200)); // Light yellow
-        } else {
-            lossItem->setBackground(QColor(200, 255, 200)); // Light green
+        // Offer every hop seen so far in the graph selector
+        for (int i = m_graphHopComboBox->count(); i <= hops.size(); ++i) {
+            m_graphHopComboBox->addItem(QString("Hop %1").arg(i), i);
         }
+        const int pathLength = history->destinationHop() > 0 ? history->destinationHop() : hops.size();
+        m_latencyGraph->setEndToEndHop(pathLength);
+        m_latencyGraph->samplesUpdated();
+        m_heatmap->setHopCount(pathLength);
+        m_heatmap->samplesUpdated();
         
-        m_resultsTable->setItem(i, 3, lossItem);
-        
-        // Sent packets
-        QTableWidgetItem* sentItem = new QTableWidgetItem(QString::number(hop.sent));
-        sentItem->setTextAlignment(Qt::AlignCenter);
-        m_resultsTable->setItem(i, 4, sentItem);
-        
-        // Best time
-        QTableWidgetItem* bestItem = new QTableWidgetItem(
-            hop.bestTime >= 0 ? QString::number(hop.bestTime, 'f', 1) + " ms" : "---");
-        bestItem->setTextAlignment(Qt::AlignCenter);
-        m_resultsTable->setItem(i, 5, bestItem);
-        
-        // Average time
-        QTableWidgetItem* avgItem = new QTableWidgetItem(
-            hop.avgTime >= 0 ? QString::number(hop.avgTime, 'f', 1) + " ms" : "---");
-        avgItem->setTextAlignment(Qt::AlignCenter);
-        m_resultsTable->setItem(i, 6, avgItem);
-        
-        // Worst time
-        QTableWidgetItem* worstItem = new QTableWidgetItem(
-            hop.worstTime >= 0 ? QString::number(hop.worstTime, 'f', 1) + " ms" : "---");
-        worstItem->setTextAlignment(Qt::AlignCenter);
-        m_resultsTable->setItem(i, 7, worstItem);
-        
-        // Update statistics
-        m_totalPacketsSent += hop.sent;
-        m_totalPacketsReceived += hop.received;
-    }
-    
-    resizeColumnsToContent();
-    
-    // Update statistics text
-    QString statsText = QString(
-        "=== PingTracer Statistics ===\n"
-        "Target: %1\n"
-        "Total Hops: %2\n"
-        "Total Packets Sent: %3\n"
-        "Total Packets Received: %4\n"
-        "Overall Loss: %5%\n"
-        "Last Update: %6\n\n"
-    ).arg(m_currentHost)
-     .arg(hops.size())
-     .arg(m_totalPacketsSent)
-     .arg(m_totalPacketsReceived)
-     .arg(m_totalPacketsSent > 0 ? QString::number(((double)(m_totalPacketsSent - m_totalPacketsReceived) / m_totalPacketsSent) * 100.0, 'f', 2) : "0.00")
-     .arg(QDateTime::currentDateTime().toString("hh:mm:ss"));
-    
-    // Add detailed hop information
-    statsText += "=== Hop Details ===\n";
-    for (const HopData& hop : hops) {
-        statsText += QString("Hop %1: %2 (%3) - Loss: %4% - Avg: %5ms\n")
-                    .arg(hop.hopNumber)
-                    .arg(hop.hostname)
-                    .arg(hop.ipAddress)
-                    .arg(hop.sent > 0 ? QString::number(((double)(hop.sent - hop.received) / hop.sent) * 100.0, 'f', 1) : "0.0")
-                    .arg(hop.avgTime >= 0 ? QString::number(hop.avgTime, 'f', 1) : "---");
-    }
-    
-    m_statsTextEdit->setPlainText(statsText);
+        // Per-hop detail lives in the results table
+        m_summaryStats->setField(SummaryStatsWidget::Hops, QString::number(pathLength));
+    }
+    
+    if (tablesChanged) {
+        resizeColumnsToContent();
+    }
+    
+    // Counters are read from the tracers, the rates and status line do not need frame rate
+    const bool statusDue = !m_statusClock.isValid() || m_statusClock.elapsed() >= StatusIntervalMs;
+    if (countersChanged || statusDue) {
+        updateSummary();
+    }
+    if (statusDue) {
+        m_statusClock.start();
+        updateStatusBar();
+    }
+}
+
+TraceStats MainWindow::sessionStats() const
+{
+    TraceStats stats = m_pingTracer->stats();
+    if (isDualStack()) {
+        stats += m_pingTracerV6->stats();
+    }
+    return stats;
+}
+
+void MainWindow::updateSummary()
+{
+    const TraceStats stats = sessionStats();
+    m_summaryStats->setField(SummaryStatsWidget::PacketsSent, QString::number(stats.sent));
+    m_summaryStats->setField(SummaryStatsWidget::PacketsReceived, QString::number(stats.received));
+    m_summaryStats->setField(SummaryStatsWidget::Loss, QString::number(stats.lossPercent(), 'f', 2) + "%");
+    m_summaryStats->setField(SummaryStatsWidget::ProbeRate, QString("%1 sent/s, %2 received/s")
+                             .arg(stats.sentPerSecond, 0, 'f', 1)
+                             .arg(stats.receivedPerSecond, 0, 'f', 1));
+    m_summaryStats->setField(SummaryStatsWidget::LastUpdate, QDateTime::currentDateTime().toString("hh:mm:ss"));
+}
+
+void MainWindow::updateRefreshRate()
+{
+    // Nobody is looking: keep the views roughly current without burning frames
+    const bool visible = isVisible() && !isMinimized();
+    m_updateTimer->setInterval(visible ? FrameIntervalMs : HiddenIntervalMs);
+}
+
+void MainWindow::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::WindowStateChange) {
+        updateRefreshRate();
+    }
+    QMainWindow::changeEvent(event);
+}
+
+void MainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+    updateRefreshRate();
+}
+
+void MainWindow::hideEvent(QHideEvent *event)
+{
+    QMainWindow::hideEvent(event);
+    updateRefreshRate();
+}
+
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    saveSession();
+    QMainWindow::closeEvent(event);
+}
+
+void MainWindow::onGraphHopChanged(int index)
+{
+    m_latencyGraph->setHop(index >= 0 ? m_graphHopComboBox->itemData(index).toInt() : 0);
+}
+
+void MainWindow::onResultsTabChanged(int index)
+{
+    Q_UNUSED(index)
+    
+    // In dual stack the history views switch stores with the results tab
+    PingTracer* tracer = historyTracer();
+    if (!tracer) {
+        return;
+    }
+    m_latencyGraph->setSampleStore(&tracer->sampleStore());
+    m_heatmap->setSampleStore(&tracer->sampleStore());
+    
+    // Redrawn from the other family's hops on the next frame
+    if (tracer == m_pingTracerV6) {
+        m_hopsV6Dirty = true;
+    } else {
+        m_hopsDirty = true;
+    }
 }
 
 void MainWindow::onTracerouteError(const QString& error)
@@ -527,16 +943,445 @@ void MainWindow::onTracerouteError(const QString& error)
     m_statusInfo->setText("Error");
     m_progressBar->setVisible(false);
     
-    QString errorMsg = QString("[%1] ERROR: %2")
-                      .arg(QDateTime::currentDateTime().toString("hh:mm:ss"))
-                      .arg(error);
-    m_statsTextEdit->append(errorMsg);
+    m_eventLog->append(LogEvent::Type::Error, QString("ERROR: %1").arg(error));
     
     QMessageBox::warning(this, "PingTracer", QString("Network error occurred:\n%1").arg(error));
     
     stopTracing();
 }
 
+void MainWindow::onPathDiscovered(int hopCount, qint64 elapsedMs)
+{
+    m_pathInfo->setText(QString("Full path: %1 hops in %2 ms").arg(hopCount).arg(elapsedMs));
+    
+    m_eventLog->append(LogEvent::Type::Path, QString("Discovered %1 hops in %2 ms").arg(hopCount).arg(elapsedMs));
+}
+
+void MainWindow::onTargetResolved(const QString& address, qint64 timeToFirstProbeMs)
+{
+    const bool isV6Tracer = sender() == m_pingTracerV6;
+    const bool isV4 = QHostAddress(address).protocol() == QAbstractSocket::IPv4Protocol;
+    
+    if (isDualStack()) {
+        m_resultsTabs->setTabText(isV6Tracer ? 1 : 0, QString("%1 (%2)").arg(isV4 ? "IPv4" : "IPv6").arg(address));
+    }
+    
+    m_eventLog->append(LogEvent::Type::Resolution, QString("%1 target %2, first probe after %3 ms")
+                       .arg(isV4 ? "IPv4" : "IPv6")
+                       .arg(address)
+                       .arg(timeToFirstProbeMs));
+}
+
+void MainWindow::onChangeDetected(int hop, ChangeDetector::Kind kind, double before, double after)
+{
+    const QString family = sender() == m_pingTracerV6 ? " (IPv6)" : "";
+    QString message;
+    switch (kind) {
+    case ChangeDetector::Kind::LatencyUp:
+    case ChangeDetector::Kind::LatencyDown:
+        message = QString("Hop %1%2 latency %3: %4 ms -> %5 ms")
+                 .arg(hop)
+                 .arg(family)
+                 .arg(kind == ChangeDetector::Kind::LatencyUp ? "up" : "down")
+                 .arg(before, 0, 'f', 1)
+                 .arg(after, 0, 'f', 1);
+        break;
+    case ChangeDetector::Kind::LossUp:
+    case ChangeDetector::Kind::LossDown:
+        message = QString("Hop %1%2 loss %3: %4% -> %5%")
+                 .arg(hop)
+                 .arg(family)
+                 .arg(kind == ChangeDetector::Kind::LossUp ? "up" : "down")
+                 .arg(before * 100.0, 0, 'f', 1)
+                 .arg(after * 100.0, 0, 'f', 1);
+        break;
+    case ChangeDetector::Kind::None:
+        return;
+    }
+    
+    m_eventLog->append(LogEvent::Type::Change, message, hop);
+}
+
+void MainWindow::onLossOriginChanged(int hop, double lossPercent)
+{
+    const QString family = sender() == m_pingTracerV6 ? " (IPv6)" : "";
+    if (hop > 0) {
+        m_eventLog->append(LogEvent::Type::Path, QString("Forwarding loss%1 starts at hop %2 (%3%)")
+                           .arg(family)
+                           .arg(hop)
+                           .arg(lossPercent, 0, 'f', 1), hop);
+    } else {
+        m_eventLog->append(LogEvent::Type::Path, QString("Forwarding loss%1 cleared").arg(family));
+    }
+}
+
+void MainWindow::onPathMtuChanged(int mtu, int hop)
+{
+    const QString family = sender() == m_pingTracerV6 ? " (IPv6)" : "";
+    if (mtu > 0) {
+        m_eventLog->append(LogEvent::Type::Path, QString("Path MTU%1 is %2 bytes, limited at hop %3")
+                           .arg(family)
+                           .arg(mtu)
+                           .arg(hop), hop);
+    }
+}
+
+void MainWindow::toggleSizeSweep(bool enabled)
+{
+    m_pingTracer->setSizeSweep(enabled);
+    m_pingTracerV6->setSizeSweep(enabled);
+}
+
+void MainWindow::onAlert(const QString& message)
+{
+    const QString family = sender() == m_pingTracerV6->alertEngine() ? " (IPv6)" : "";
+    m_eventLog->append(LogEvent::Type::Alert, message + family);
+}
+
+void MainWindow::editAlertRules()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getMultiLineText(this, "Alert Rules",
+        "One rule per line, for example:\n"
+        "  p95 hop 3 > 80ms for 2m do log\n"
+        "  loss e2e > 5% for 30s do log,webhook=http://localhost:8080/alert\n"
+        "  avg e2e > 150ms do script=/usr/local/bin/notify.sh",
+        m_alertRulesText, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    // Compile everything up front, a bad line rejects the whole set
+    QList<AlertRule> rules;
+    const QStringList lines = text.split('\n');
+    for (const QString& line : lines) {
+        if (line.trimmed().isEmpty() || line.trimmed().startsWith('#')) {
+            continue;
+        }
+        
+        AlertRule rule;
+        QString error;
+        if (!AlertRule::parse(line, &rule, &error)) {
+            QMessageBox::warning(this, "PingTracer", error);
+            return;
+        }
+        rules.append(rule);
+    }
+    
+    m_alertRulesText = text;
+    m_pingTracer->setAlertRules(rules);
+    m_pingTracerV6->setAlertRules(rules);
+    m_eventLog->append(LogEvent::Type::Alert, QString("Loaded %1 alert rule(s)").arg(rules.size()));
+}
+
+void MainWindow::editChangeSensitivity()
+{
+    bool ok = false;
+    const double threshold = QInputDialog::getDouble(this, "Change Sensitivity",
+        "CUSUM threshold, lower reports smaller shifts sooner:",
+        m_pingTracer->changeSensitivity(), 1, 50, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    m_pingTracer->setChangeSensitivity(threshold);
+    m_pingTracerV6->setChangeSensitivity(threshold);
+}
+
+void MainWindow::injectShift()
+{
+    bool ok = false;
+    const int hop = QInputDialog::getInt(this, "Inject Shift", "From hop:", 1, 1, 255, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    const int delayMs = QInputDialog::getInt(this, "Inject Shift", "Extra delay (ms):", 50, 0, 10000, 10, &ok);
+    if (!ok) {
+        return;
+    }
+    const int lossPercent = QInputDialog::getInt(this, "Inject Shift", "Extra loss (%):", 0, 0, 100, 5, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    // Takes effect from now on; no delay and no loss takes a shift out again
+    const bool clear = delayMs == 0 && lossPercent == 0;
+    for (PingTracer* tracer : { m_pingTracer, m_pingTracerV6 }) {
+        tracer->setSimulatedShift(clear ? 0 : hop, tracer->isRunning() ? tracer->stats().elapsedMs : 0,
+                                  delayMs, lossPercent);
+    }
+    m_eventLog->append(LogEvent::Type::Session, clear
+        ? QString("Removed the injected shift")
+        : QString("Injected %1 ms and %2% loss from hop %3 on").arg(delayMs).arg(lossPercent).arg(hop));
+}
+
+void MainWindow::runBatchTrace()
+{
+    if (m_batchTracer->isRunning()) {
+        if (QMessageBox::question(this, "Batch Trace", "A batch trace is running. Stop it?") == QMessageBox::Yes) {
+            m_batchTracer->stop();
+        }
+        return;
+    }
+    
+    const QString targetsFile = QFileDialog::getOpenFileName(this, "Batch Trace Targets", QString(),
+                                                             "Text Files (*.txt);;All Files (*)");
+    if (targetsFile.isEmpty()) {
+        return;
+    }
+    
+    QString error;
+    const QStringList targets = BatchTracer::loadTargets(targetsFile, &error);
+    if (targets.isEmpty()) {
+        QMessageBox::warning(this, "Batch Trace", error);
+        return;
+    }
+    
+    const QString outputFile = QFileDialog::getSaveFileName(this, "Batch Trace Results", "batch_trace.ndjson",
+                                                            "NDJSON Files (*.ndjson *.jsonl);;All Files (*)");
+    if (outputFile.isEmpty()) {
+        return;
+    }
+    
+    BatchTracer::Config config;
+    config.protocol = probeProtocol();
+    config.port = static_cast<quint16>(m_portSpinBox->value());
+    config.query = m_requestLineEdit->text().trimmed();
+    config.reuseConnections = m_reuseCheckBox->isChecked();
+    bool ok = false;
+    config.concurrency = QInputDialog::getInt(this, "Batch Trace",
+        QString("%1 targets loaded. Traces to run at once:").arg(targets.size()),
+        config.concurrency, 1, 256, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    config.rounds = QInputDialog::getInt(this, "Batch Trace", "Probes per hop before a trace is done:",
+                                         config.rounds, 1, 100, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    config.probesPerSecond = QInputDialog::getInt(this, "Batch Trace", "Probe budget for the whole batch (probes/s):",
+                                                  static_cast<int>(config.probesPerSecond), 10, 100000, 100, &ok);
+    if (!ok) {
+        return;
+    }
+    config.intervalMs = m_intervalSpinBox->value();
+    config.timeoutMs = m_timeoutSpinBox->value();
+    
+    if (!m_batchTracer->start(targets, outputFile, config, &error)) {
+        QMessageBox::critical(this, "Batch Trace", error);
+        return;
+    }
+    
+    m_batchTraceAction->setText("Stop &Batch Trace");
+    m_eventLog->append(LogEvent::Type::Session, QString("Batch trace of %1 targets started, %2 at once, writing %3")
+                       .arg(targets.size())
+                       .arg(config.concurrency)
+                       .arg(outputFile));
+}
+
+void MainWindow::onBatchProgress(int completed, int total)
+{
+    m_statusBar->showMessage(QString("Batch trace: %1 of %2 targets").arg(completed).arg(total));
+}
+
+void MainWindow::onBatchFinished(const QString& summary)
+{
+    m_batchTraceAction->setText("&Batch Trace...");
+    m_statusBar->clearMessage();
+    m_eventLog->append(LogEvent::Type::Session, summary);
+}
+
+void MainWindow::runThroughputTest()
+{
+    if (m_throughputTest->isRunning()) {
+        if (QMessageBox::question(this, "Throughput Test", "A throughput test is running. Stop it?") == QMessageBox::Yes) {
+            m_throughputTest->stop();
+        }
+        return;
+    }
+    
+    bool ok = false;
+    const QString reflector = QInputDialog::getText(this, "Throughput Test", "Reflector (host or host:port):",
+                                                    QLineEdit::Normal, m_currentHost, &ok).trimmed();
+    if (!ok || reflector.isEmpty()) {
+        return;
+    }
+    
+    // A bare IPv6 address has colons of its own, a port then needs brackets
+    ThroughputTest::Config config;
+    QString host = reflector;
+    const int colon = reflector.lastIndexOf(':');
+    if (colon > 0 && (reflector.count(':') == 1 || reflector.contains("]:"))) {
+        config.port = static_cast<quint16>(reflector.mid(colon + 1).toUInt(&ok));
+        if (!ok || config.port == 0) {
+            QMessageBox::warning(this, "Throughput Test", QString("Invalid port in %1").arg(reflector));
+            return;
+        }
+        host = reflector.left(colon);
+    }
+    host.remove('[').remove(']');
+    
+    const QString mode = QInputDialog::getItem(this, "Throughput Test", "Load:", {"TCP", "UDP"}, 0, false, &ok);
+    if (!ok) {
+        return;
+    }
+    config.mode = mode == "UDP" ? ThroughputTest::Mode::Udp : ThroughputTest::Mode::Tcp;
+    config.durationMs = QInputDialog::getInt(this, "Throughput Test", "Duration (s):",
+                                             config.durationMs / 1000, 1, 600, 1, &ok) * 1000;
+    if (!ok) {
+        return;
+    }
+    if (config.mode == ThroughputTest::Mode::Udp) {
+        config.udpRateMbps = QInputDialog::getDouble(this, "Throughput Test", "UDP rate (Mbit/s):",
+                                                     config.udpRateMbps, 1, 100000, 0, &ok);
+        if (!ok) {
+            return;
+        }
+    }
+    
+    config.reflector = QHostAddress(host);
+    if (!config.reflector.isNull()) {
+        startThroughputTest(config);
+        return;
+    }
+    
+    // A name is resolved in the background, a slow resolver must not freeze the window
+    m_throughputAction->setEnabled(false);
+    m_statusBar->showMessage(QString("Resolving %1...").arg(host));
+    QHostInfo::lookupHost(host, this, [this, host, config](const QHostInfo& info) mutable {
+        m_throughputAction->setEnabled(true);
+        m_statusBar->clearMessage();
+        if (info.addresses().isEmpty()) {
+            QMessageBox::warning(this, "Throughput Test", QString("Could not resolve %1").arg(host));
+            return;
+        }
+        config.reflector = info.addresses().first();
+        startThroughputTest(config);
+    });
+}
+
+void MainWindow::startThroughputTest(const ThroughputTest::Config& config)
+{
+    if (!m_throughputTest->start(config)) {
+        QMessageBox::critical(this, "Throughput Test", "Could not start the throughput test.");
+        return;
+    }
+    
+    // Per-hop RTT under load is read back from the trace that runs alongside
+    m_throughputStartMs = m_isRunning ? m_pingTracer->stats().elapsedMs : -1;
+    m_throughputAction->setText("Stop &Throughput Test");
+    m_eventLog->append(LogEvent::Type::Session, QString("%1 throughput test to %2 port %3 started for %4 s")
+                       .arg(config.mode == ThroughputTest::Mode::Udp ? "UDP" : "TCP")
+                       .arg(config.reflector.toString())
+                       .arg(config.port)
+                       .arg(config.durationMs / 1000));
+}
+
+void MainWindow::onThroughputProgress(double sentMbps, int elapsedMs)
+{
+    m_statusBar->showMessage(QString("Throughput test: %1 Mbit/s sent, %2 s")
+                             .arg(sentMbps, 0, 'f', 1)
+                             .arg(elapsedMs / 1000));
+}
+
+void MainWindow::onThroughputFinished(const ThroughputTest::Result& result)
+{
+    m_throughputAction->setText("&Throughput Test...");
+    m_statusBar->clearMessage();
+    
+    QString text = result.summary();
+    if (result.ok()) {
+        m_eventLog->append(LogEvent::Type::Session, text);
+    } else {
+        m_eventLog->append(LogEvent::Type::Error, text);
+    }
+    
+    if (result.ok() && m_throughputStartMs >= 0) {
+        const QString hops = latencyUnderLoad(m_throughputStartMs, result.durationMs);
+        if (!hops.isEmpty()) {
+            m_eventLog->append(LogEvent::Type::Session, "Per-hop RTT idle / under load: " + QString(hops).replace('\n', "; "));
+            text += "\n\nPer-hop RTT idle / under load:\n" + hops;
+        }
+    }
+    m_throughputStartMs = -1;
+    
+    if (result.ok()) {
+        QMessageBox::information(this, "Throughput Test", text);
+    } else {
+        QMessageBox::warning(this, "Throughput Test", text);
+    }
+}
+
+QString MainWindow::latencyUnderLoad(qint64 startMs, int durationMs) const
+{
+    // Same length of trace right before the test is the baseline
+    const qint64 baselineMs = qMin<qint64>(durationMs, startMs);
+    if (baselineMs <= 0) {
+        return QString();
+    }
+    
+    QStringList lines;
+    const SampleStore& store = m_pingTracer->sampleStore();
+    for (int hop = 1; hop <= store.hopCount(); ++hop) {
+        const SampleSeries* series = store.series(hop);
+        if (!series || series->isEmpty()) {
+            continue;
+        }
+        SampleBucket idle;
+        SampleBucket loaded;
+        series->columns(startMs - baselineMs, baselineMs, 1, &idle);
+        series->columns(startMs, durationMs, 1, &loaded);
+        if (idle.received == 0 || loaded.received == 0) {
+            continue;
+        }
+        lines.append(QString("hop %1: %2 / %3 ms (%4%5 ms, %6% loss under load)")
+                     .arg(hop)
+                     .arg(idle.mean(), 0, 'f', 2)
+                     .arg(loaded.mean(), 0, 'f', 2)
+                     .arg(loaded.mean() >= idle.mean() ? "+" : "")
+                     .arg(loaded.mean() - idle.mean(), 0, 'f', 2)
+                     .arg(loaded.lossPercent(), 0, 'f', 1));
+    }
+    return lines.join('\n');
+}
+
+void MainWindow::toggleReflector(bool enabled)
+{
+    if (!enabled) {
+        m_reflector->stop();
+        m_eventLog->append(LogEvent::Type::Session, "Throughput reflector stopped");
+        return;
+    }
+    
+    bool ok = false;
+    const int port = QInputDialog::getInt(this, "Throughput Reflector", "Port for TCP and UDP:",
+                                          ThroughputTest::DefaultPort, 1, 65535, 1, &ok);
+    QString error;
+    if (!ok || !m_reflector->start(static_cast<quint16>(port), &error)) {
+        if (ok) {
+            QMessageBox::warning(this, "Throughput Reflector", error);
+        }
+        QSignalBlocker blocker(m_reflectorAction);
+        m_reflectorAction->setChecked(false);
+        return;
+    }
+    m_eventLog->append(LogEvent::Type::Session, QString("Throughput reflector listening on port %1").arg(port));
+}
+
+void MainWindow::onReflectorSession(const QString& summary)
+{
+    m_eventLog->append(LogEvent::Type::Session, summary);
+}
+
+void MainWindow::onDualStackError(const QString& error)
+{
+    // A missing AAAA record should not stop the IPv4 half of the session
+    m_eventLog->append(LogEvent::Type::Error, QString("IPv6 ERROR: %1").arg(error));
+    
+    m_pingTracerV6->stop();
+}
+
 void MainWindow::onThemeChanged()
 {
     applyCurrentTheme();
@@ -622,6 +1467,10 @@ void MainWindow::onIntervalChanged()
     if (m_pingTracer && m_pingTracer->isRunning()) {
         m_pingTracer->setInterval(m_intervalSpinBox->value());
     }
+    // The IPv6 tracer of a dual-stack session follows the same settings
+    if (m_pingTracerV6 && m_pingTracerV6->isRunning()) {
+        m_pingTracerV6->setInterval(m_intervalSpinBox->value());
+    }
 }
 
 void MainWindow::onTimeoutChanged()
@@ -629,6 +1478,9 @@ void MainWindow::onTimeoutChanged()
     if (m_pingTracer && m_pingTracer->isRunning()) {
         m_pingTracer->setTimeout(m_timeoutSpinBox->value());
     }
+    if (m_pingTracerV6 && m_pingTracerV6->isRunning()) {
+        m_pingTracerV6->setTimeout(m_timeoutSpinBox->value());
+    }
 }
 
 void MainWindow::updateButtonStates()
@@ -650,6 +1502,13 @@ void MainWindow::updateButtonStates()
     
     // Input fields
     m_hostLineEdit->setEnabled(!isRunning);
+    m_fastStartCheckBox->setEnabled(!isRunning);
+    m_familyComboBox->setEnabled(!isRunning);
+    m_protocolComboBox->setEnabled(!isRunning);
+    const bool application = probeProtocol() == ProbeProtocol::Dns || probeProtocol() == ProbeProtocol::Http;
+    m_portSpinBox->setEnabled(!isRunning && probeProtocol() != ProbeProtocol::Udp);
+    m_requestLineEdit->setEnabled(!isRunning && application);
+    m_reuseCheckBox->setEnabled(!isRunning && application);
     m_intervalSpinBox->setEnabled(true); // Can be changed during operation
     m_timeoutSpinBox->setEnabled(true);  // Can be changed during operation
 }
@@ -657,18 +1516,85 @@ void MainWindow::updateButtonStates()
 void MainWindow::updateStatusBar()
 {
     if (m_isRunning && m_pingTracer) {
-        QString status = QString("Running - Packets sent: %1, received: %2")
-                        .arg(m_totalPacketsSent)
-                        .arg(m_totalPacketsReceived);
+        const TraceStats stats = m_pingTracer->stats();
+        QString status = QString("Running - Packets sent: %1, received: %2, %3/s, in flight: %4 (peak %5)")
+                        .arg(stats.sent)
+                        .arg(stats.received)
+                        .arg(stats.sentPerSecond, 0, 'f', 1)
+                        .arg(m_pingTracer->inFlightCount())
+                        .arg(m_pingTracer->peakInFlightCount());
+        status += QString(", overhead %1 us/probe").arg(stats.overheadUsPerProbe(), 0, 'f', 1);
+        
+        // Per-target figures when two families are traced side by side
+        if (isDualStack()) {
+            const TraceStats v6 = m_pingTracerV6->stats();
+            status += QString(" | IPv6 sent: %1, received: %2, %3/s")
+                     .arg(v6.sent)
+                     .arg(v6.received)
+                     .arg(v6.sentPerSecond, 0, 'f', 1);
+        }
         m_statusInfo->setText(status);
     }
 }
 
 void MainWindow::resizeColumnsToContent()
 {
-    for (int i = 0; i < m_resultsTable->columnCount(); ++i) {
-        m_resultsTable->resizeColumnToContents(i);
+    QTableWidget* table = currentResultsTable();
+    for (int i = 0; i < table->columnCount(); ++i) {
+        table->resizeColumnToContents(i);
+    }
+}
+
+QTableWidget* MainWindow::createResultsTable()
+{
+    QTableWidget* table = new QTableWidget(this);
+    QStringList headers = {"Hop", "Hostname", "IP Address", "Loss %", "Sent", "Best", "Avg", "Worst"};
+    table->setColumnCount(headers.size());
+    table->setHorizontalHeaderLabels(headers);
+    
+    // Table properties
+    table->setAlternatingRowColors(true);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    table->setSortingEnabled(false);
+    table->verticalHeader()->setVisible(false);
+    
+    // Header properties
+    QHeaderView* header = table->horizontalHeader();
+    header->setStretchLastSection(true);
+    header->setSectionResizeMode(QHeaderView::Interactive);
+    
+    return table;
+}
+
+QTableWidget* MainWindow::currentResultsTable() const
+{
+    QTableWidget* table = qobject_cast<QTableWidget*>(m_resultsTabs->currentWidget());
+    return table ? table : m_resultsTable;
+}
+
+bool MainWindow::isDualStack() const
+{
+    return m_familyComboBox->currentIndex() == 3;
+}
+
+PingTracer* MainWindow::historyTracer() const
+{
+    return isDualStack() && m_resultsTabs->currentIndex() == 1 ? m_pingTracerV6 : m_pingTracer;
+}
+
+ProbeProtocol MainWindow::probeProtocol() const
+{
+    return static_cast<ProbeProtocol>(qBound(0, m_protocolComboBox->currentIndex(), 3));
+}
+
+void MainWindow::onProtocolChanged()
+{
+    // Each protocol starts out on its well-known port
+    if (probeProtocol() != ProbeProtocol::Udp) {
+        m_portSpinBox->setValue(defaultProbePort(probeProtocol()));
     }
+    updateButtonStates();
 }
 
 void MainWindow::applyCurrentTheme()
@@ -0,0 +1,69 @@
+#include "mainwindow.h"
+#include "throughputtest.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <cstring>
+
+namespace {
+
+// "--reflector [port]" answers throughput tests without a window, so the
+// second PingTracer of a loopback or netns test can run on a headless host
+int runReflector(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("PingTracer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Network path latency and throughput tracer");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("reflector", "Answer throughput tests headless, without the window."));
+    parser.addPositionalArgument("port", QString("Port for TCP and UDP, %1 by default.").arg(ThroughputTest::DefaultPort),
+                                 "[port]");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    quint16 port = ThroughputTest::DefaultPort;
+    if (!parser.positionalArguments().isEmpty()) {
+        bool ok = false;
+        const uint value = parser.positionalArguments().first().toUInt(&ok);
+        if (!ok || value < 1 || value > 65535) {
+            err << "Invalid port: " << parser.positionalArguments().first() << Qt::endl;
+            return 1;
+        }
+        port = static_cast<quint16>(value);
+    }
+
+    ThroughputReflector reflector;
+    QObject::connect(&reflector, &ThroughputReflector::sessionFinished, &app, [&out](const QString& summary) {
+        out << summary << Qt::endl;
+    }, Qt::QueuedConnection);
+
+    QString error;
+    if (!reflector.start(port, &error)) {
+        err << error << Qt::endl;
+        return 1;
+    }
+    out << "Throughput reflector listening on port " << port << Qt::endl;
+    return app.exec();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // Decided before any application object exists, the reflector needs no GUI
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--reflector") == 0) {
+            return runReflector(argc, argv);
+        }
+    }
+
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("PingTracer");
+
+    MainWindow window;
+    window.show();
+    return app.exec();
+}
@@ -3,7 +3,9 @@
 
 #include <QMainWindow>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QTableWidget>
+#include <QTabWidget>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QLabel>
@@ -18,10 +20,17 @@
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QSplitter>
-#include <QTextEdit>
+#include <QListView>
 #include <QCheckBox>
 #include "pingtracer.h"
+#include "batchtracer.h"
+#include "latencygraphwidget.h"
+#include "heatmapwidget.h"
+#include "eventlog.h"
+#include "summarystatswidget.h"
 #include "thememanager.h"
+#include "throughputtest.h"
+#include "resultstable.h"
 
 QT_BEGIN_NAMESPACE
 QT_END_NAMESPACE
@@ -34,6 +43,12 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    void changeEvent(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
     void startTracing();
     void stopTracing();
@@ -43,12 +58,36 @@ private slots:
     void onHostChanged();
     void onTracerouteUpdate(const QList<HopData>& hops);
     void onTracerouteError(const QString& error);
+    void onPathDiscovered(int hopCount, qint64 elapsedMs);
+    void onTargetResolved(const QString& address, qint64 timeToFirstProbeMs);
+    void onDualStackUpdate(const QList<HopData>& hops);
+    void onDualStackError(const QString& error);
+    void onChangeDetected(int hop, ChangeDetector::Kind kind, double before, double after);
+    void onLossOriginChanged(int hop, double lossPercent);
+    void onPathMtuChanged(int mtu, int hop);
+    void toggleSizeSweep(bool enabled);
+    void onAlert(const QString& message);
+    void editAlertRules();
+    void editChangeSensitivity();
+    void injectShift();
+    void runBatchTrace();
+    void onBatchProgress(int completed, int total);
+    void onBatchFinished(const QString& summary);
+    void runThroughputTest();
+    void onThroughputProgress(double sentMbps, int elapsedMs);
+    void onThroughputFinished(const ThroughputTest::Result& result);
+    void toggleReflector(bool enabled);
+    void onReflectorSession(const QString& summary);
+    void onGraphHopChanged(int index);
+    void onResultsTabChanged(int index);
     void onThemeChanged();
     void showAbout();
     void showHelp();
     void toggleDarkMode();
     void onIntervalChanged();
     void onTimeoutChanged();
+    void onProtocolChanged();
+    void refreshViews();
 
 private:
     void setupUI();
@@ -57,13 +96,32 @@ private:
     void setupStatusBar();
     void setupConnections();
     void updateButtonStates();
+    void beginSession(const QString& host, bool dualStack);
+    QString sessionFileName() const;
+    void saveSession();
+    void restoreSession();
     void updateStatusBar();
+    void updateSummary();
+    TraceStats sessionStats() const;
     void resizeColumnsToContent();
+    QTableWidget* createResultsTable();
+    void updateRefreshRate();
+    QTableWidget* currentResultsTable() const;
+    bool isDualStack() const;
+    PingTracer* historyTracer() const;
+    QString latencyUnderLoad(qint64 startMs, int durationMs) const;
+    ProbeProtocol probeProtocol() const;
+    void startThroughputTest(const ThroughputTest::Config& config);
     void applyCurrentTheme();
     
     // Core components
     PingTracer* m_pingTracer;
+    PingTracer* m_pingTracerV6; // Second family when tracing dual-stack
+    BatchTracer* m_batchTracer;
+    ThroughputTest* m_throughputTest;
+    ThroughputReflector* m_reflector;
     QTimer* m_updateTimer;
+    QTimer* m_sessionSaveTimer; // Writes the running session out now and then, in case of a crash
     
     // Central widget and layouts
     QWidget* m_centralWidget;
@@ -79,17 +137,34 @@ private:
     QPushButton* m_resetButton;
     QSpinBox* m_intervalSpinBox;
     QSpinBox* m_timeoutSpinBox;
+    QCheckBox* m_fastStartCheckBox;
+    QComboBox* m_familyComboBox;
+    QComboBox* m_protocolComboBox;
+    QSpinBox* m_portSpinBox;
+    QLineEdit* m_requestLineEdit;
+    QCheckBox* m_reuseCheckBox;
     QLabel* m_statusLabel;
     
     // Results table
     QGroupBox* m_resultsGroup;
     QVBoxLayout* m_resultsLayout;
+    QTabWidget* m_resultsTabs;
     QTableWidget* m_resultsTable;
+    QTableWidget* m_resultsTableV6;
+    QComboBox* m_graphHopComboBox;
+    QTabWidget* m_historyTabs;
+    LatencyGraphWidget* m_latencyGraph;
+    HeatmapWidget* m_heatmap;
     
     // Statistics panel
     QGroupBox* m_statsGroup;
     QVBoxLayout* m_statsLayout;
-    QTextEdit* m_statsTextEdit;
+    SummaryStatsWidget* m_summaryStats;
+    QComboBox* m_logTypeComboBox;
+    QLineEdit* m_logFilterLineEdit;
+    QListView* m_logView;
+    EventLog* m_eventLog;
+    EventLogFilter* m_eventLogFilter;
     
     // Control panel
     QGroupBox* m_controlGroup;
@@ -103,11 +178,13 @@ private:
     QMenuBar* m_menuBar;
     QMenu* m_fileMenu;
     QMenu* m_viewMenu;
+    QMenu* m_toolsMenu;
     QMenu* m_helpMenu;
     QToolBar* m_toolBar;
     QStatusBar* m_statusBar;
     QProgressBar* m_progressBar;
     QLabel* m_statusInfo;
+    QLabel* m_pathInfo;
     
     // Actions
     QAction* m_startAction;
@@ -118,12 +195,32 @@ private:
     QAction* m_darkModeAction;
     QAction* m_aboutAction;
     QAction* m_helpAction;
+    QAction* m_alertRulesAction;
+    QAction* m_changeSensitivityAction;
+    QAction* m_injectShiftAction;
+    QAction* m_batchTraceAction;
+    QAction* m_sizeSweepAction;
+    QAction* m_throughputAction;
+    QAction* m_reflectorAction;
     
     // State variables
     bool m_isRunning;
     QString m_currentHost;
-    int m_totalPacketsSent;
-    int m_totalPacketsReceived;
+    QString m_alertRulesText;
+    qint64 m_throughputStartMs; // Session time the running throughput test started at, -1 without a trace
+    
+    // Frame-paced refresh: tracer updates land here and are applied by refreshViews()
+    static constexpr int FrameIntervalMs = 16;
+    static constexpr int HiddenIntervalMs = 1000;
+    static constexpr int StatusIntervalMs = 500;
+    static constexpr int SessionSaveIntervalMs = 60000;
+    QList<HopData> m_pendingHops;
+    QList<HopData> m_pendingHopsV6;
+    QList<HopData> m_shownHops;
+    QList<HopData> m_shownHopsV6;
+    bool m_hopsDirty;
+    bool m_hopsV6Dirty;
+    QElapsedTimer m_statusClock;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,252 @@
+#include "mtusweep.h"
+#include <cmath>
+
+MtuSweep::MtuSweep(const Config& config)
+    : m_config(config)
+    , m_nextHop(1)
+{
+}
+
+void MtuSweep::setConfig(const Config& config)
+{
+    m_config = config;
+    m_config.ladderSteps = qMax(2, m_config.ladderSteps);
+    m_config.maxSize = qMax(m_config.minSize, m_config.maxSize);
+    reset(m_hops.size());
+}
+
+const MtuSweep::Config& MtuSweep::config() const
+{
+    return m_config;
+}
+
+void MtuSweep::reset(int hops)
+{
+    Hop hop;
+    hop.failed = m_config.maxSize + 1;
+    hop.minRtt.fill(-1.0, m_config.ladderSteps);
+    hop.samples.fill(0, m_config.ladderSteps);
+    m_hops.fill(hop, hops);
+    m_nextHop = 1;
+}
+
+int MtuSweep::searchSize(int hop) const
+{
+    const Hop& h = m_hops[hop - 1];
+    int ceiling = h.failed - 1;
+    if (hop > 1 && m_hops[hop - 2].result.mtuFinal) {
+        ceiling = qMin(ceiling, m_hops[hop - 2].result.mtu);
+    }
+
+    // Try the ceiling first, it is the answer on most paths, then bisect
+    if (h.failed > m_config.maxSize) {
+        return ceiling;
+    }
+    return h.passed + (ceiling - h.passed + 1) / 2;
+}
+
+int MtuSweep::ladderSize(const Hop& h, int step) const
+{
+    return m_config.minSize + (h.result.mtu - m_config.minSize) * step / (m_config.ladderSteps - 1);
+}
+
+int MtuSweep::retries(const Hop& h) const
+{
+    // Enough silences in a row that plain loss explains them less than 1% of the time
+    if (h.asked < 10 || h.answered == 0) {
+        return MinRetries;
+    }
+    const double loss = 1.0 - static_cast<double>(h.answered) / h.asked;
+    if (loss <= 0.01) {
+        return MinRetries;
+    }
+    return qBound(MinRetries, static_cast<int>(std::ceil(std::log(0.01) / std::log(loss))), MaxRetries);
+}
+
+void MtuSweep::reopen(Hop& h, int passed)
+{
+    h.passed = passed;
+    h.failed = m_config.maxSize + 1;
+    h.silent = 0;
+    h.result = HopResult();
+    h.result.mtu = passed;
+}
+
+MtuSweep::Probe MtuSweep::next(int pathLength)
+{
+    pathLength = qMin(pathLength, static_cast<int>(m_hops.size()));
+    if (pathLength < 1) {
+        return Probe{0, 0};
+    }
+
+    if (m_nextHop > pathLength) {
+        m_nextHop = 1;
+    }
+    const int hop = m_nextHop;
+    m_nextHop = hop % pathLength + 1;
+
+    Hop& h = m_hops[hop - 1];
+    if (!h.responsive) {
+        return Probe{hop, m_config.minSize};
+    }
+    if (!h.result.mtuFinal) {
+        return Probe{hop, searchSize(hop)};
+    }
+
+    const int step = h.nextStep;
+    h.nextStep = (step + 1) % m_config.ladderSteps;
+    return Probe{hop, ladderSize(h, step)};
+}
+
+bool MtuSweep::record(int hop, int size, ProbeStatus status, double rttMs)
+{
+    if (!valid(hop) || size <= 0) {
+        return false;
+    }
+
+    Hop& h = m_hops[hop - 1];
+    const HopResult before = h.result;
+    bool reopened = false;
+
+    if (size <= qMax(h.passed, m_config.minSize)) {
+        h.asked++;
+        if (status == ProbeStatus::Success) {
+            h.answered++;
+        }
+    }
+
+    if (status == ProbeStatus::Success && rttMs >= 0) {
+        h.responsive = true;
+        h.passed = qMax(h.passed, size);
+        h.silent = 0;
+
+        // Whatever reached this hop went through every hop before it
+        for (int i = 0; i < hop - 1; ++i) {
+            if (m_hops[i].result.mtuFinal && m_hops[i].result.mtu < size) {
+                reopen(m_hops[i], size);
+                reopened = true;
+            }
+        }
+
+        if (h.result.mtuFinal) {
+            // Steps share a size when the MTU is barely above minSize
+            bool sampled = false;
+            for (int step = 0; step < m_config.ladderSteps; ++step) {
+                if (ladderSize(h, step) != size) {
+                    continue;
+                }
+                double& minRtt = h.minRtt[step];
+                minRtt = minRtt < 0 ? rttMs : qMin(minRtt, rttMs);
+                h.samples[step]++;
+                sampled = true;
+            }
+            if (sampled) {
+                fit(hop);
+            }
+        }
+    } else if (status == ProbeStatus::TooBig) {
+        // Rejected outright, no need to wait for more silence
+        h.failed = qMin(h.failed, size);
+        h.silent = 0;
+    } else if (status == ProbeStatus::Timeout && h.responsive && !h.result.mtuFinal && size > h.passed) {
+        if (++h.silent >= retries(h)) {
+            h.failed = qMin(h.failed, size);
+            h.silent = 0;
+        }
+    }
+
+    if (!h.responsive || h.result.mtuFinal) {
+        return reopened || h.result != before;
+    }
+
+    // A size that passed can not also be too big, the path changed under us
+    if (h.failed <= h.passed) {
+        h.failed = m_config.maxSize + 1;
+    }
+
+    h.result.mtu = h.passed;
+    int ceiling = h.failed - 1;
+    if (hop > 1 && m_hops[hop - 2].result.mtuFinal) {
+        ceiling = qMin(ceiling, m_hops[hop - 2].result.mtu);
+    }
+    if (h.passed >= ceiling) {
+        h.result.mtuFinal = true;
+        h.nextStep = 0;
+        h.minRtt.fill(-1.0);
+        h.samples.fill(0);
+    }
+    return reopened || h.result != before;
+}
+
+void MtuSweep::fit(int hop)
+{
+    Hop& h = m_hops[hop - 1];
+    const int steps = m_config.ladderSteps;
+    for (int step = 0; step < steps; ++step) {
+        if (h.samples[step] < MinSamplesPerSize) {
+            return;
+        }
+    }
+
+    // Least squares over (size, minimum RTT)
+    double meanSize = 0;
+    double meanRtt = 0;
+    for (int step = 0; step < steps; ++step) {
+        meanSize += ladderSize(h, step);
+        meanRtt += h.minRtt[step];
+    }
+    meanSize /= steps;
+    meanRtt /= steps;
+
+    double covariance = 0;
+    double variance = 0;
+    for (int step = 0; step < steps; ++step) {
+        const double dx = ladderSize(h, step) - meanSize;
+        covariance += dx * (h.minRtt[step] - meanRtt);
+        variance += dx * dx;
+    }
+    if (variance <= 0) {
+        return;
+    }
+
+    HopResult& result = h.result;
+    result.msPerByte = qMax(0.0, covariance / variance);
+
+    // The link's share is what this hop adds over the nearest fitted hop before it
+    double previous = 0;
+    for (int i = hop - 2; i >= 0; --i) {
+        if (m_hops[i].result.msPerByte >= 0) {
+            previous = m_hops[i].result.msPerByte;
+            break;
+        }
+    }
+    result.linkMsPerByte = result.msPerByte - previous;
+
+    // 8 bits per byte over ms per byte is kbit/s
+    result.linkMbps = result.linkMsPerByte > 0 ? 8.0 / result.linkMsPerByte / 1000.0 : -1.0;
+}
+
+MtuSweep::HopResult MtuSweep::result(int hop) const
+{
+    return valid(hop) ? m_hops[hop - 1].result : HopResult();
+}
+
+int MtuSweep::pathMtu(int pathLength, int* limitingHop) const
+{
+    pathLength = qMin(pathLength, static_cast<int>(m_hops.size()));
+
+    int mtu = 0;
+    int limiting = 0;
+    for (int i = 0; i < pathLength; ++i) {
+        const HopResult& result = m_hops[i].result;
+        if (result.mtuFinal && (mtu == 0 || result.mtu < mtu)) {
+            mtu = result.mtu;
+            limiting = i + 1;
+        }
+    }
+
+    if (limitingHop) {
+        *limitingHop = limiting;
+    }
+    return mtu;
+}
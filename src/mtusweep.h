@@ -0,0 +1,108 @@
+#ifndef MTUSWEEP_H
+#define MTUSWEEP_H
+
+#include <QtGlobal>
+#include <QVector>
+#include "proberesultqueue.h"
+
+// Path MTU and latency-versus-size per hop, from probes sent with DF set.
+//
+// Each hop first gets its MTU by binary search between the largest size that
+// came back and the smallest that did not. The search starts at the previous
+// hop's MTU, since a hop further out can only be reached through it, so on
+// most paths it costs one probe per hop. A size counts as too big when the
+// sender rejects it or after enough silent probes in a row that the hop's
+// ordinary loss is an unlikely explanation, so a lossy router does not shrink
+// the MTU. A later hop answering above an earlier hop's MTU reopens that hop.
+//
+// With the MTU known, the hop is probed at a ladder of sizes up to it. The
+// minimum RTT per size filters out queueing, and a least-squares fit over the
+// minima gives the serialization delay per byte up to that hop. The
+// difference to the previous hop is the delay the link into this hop adds,
+// which is its bandwidth estimate.
+//
+// next() hands out one probe per hop in turn, so a sweep spreads over the
+// path instead of piling onto one router.
+class MtuSweep
+{
+public:
+    struct Config {
+        int minSize;      // Smallest probe, IP packet bytes
+        int maxSize;      // Largest probe tried, the MTU reported when nothing is smaller
+        int ladderSteps;  // Sizes sampled for the latency fit
+
+        Config() : minSize(64), maxSize(1500), ladderSteps(6) {}
+    };
+
+    struct Probe {
+        int hop;          // 0 when there is nothing to probe
+        int size;
+    };
+
+    struct HopResult {
+        int mtu;              // Largest size that got through, 0 while unknown
+        bool mtuFinal;        // Search finished, mtu is exact
+        double msPerByte;     // Fitted delay per byte up to this hop, < 0 while unknown
+        double linkMsPerByte; // Share of the link into this hop, < 0 while unknown
+        double linkMbps;      // Bandwidth estimate of that link, < 0 while unknown
+
+        HopResult() : mtu(0), mtuFinal(false), msPerByte(-1), linkMsPerByte(-1), linkMbps(-1) {}
+
+        bool operator==(const HopResult& other) const
+        {
+            return mtu == other.mtu && mtuFinal == other.mtuFinal && linkMbps == other.linkMbps;
+        }
+        bool operator!=(const HopResult& other) const { return !(*this == other); }
+    };
+
+    explicit MtuSweep(const Config& config = Config());
+
+    void setConfig(const Config& config);
+    const Config& config() const;
+
+    void reset(int hops);
+
+    // Next probe for hops 1..pathLength
+    Probe next(int pathLength);
+
+    // Outcome of a probe handed out by next(); returns true if any hop's result changed
+    bool record(int hop, int size, ProbeStatus status, double rttMs);
+
+    HopResult result(int hop) const;
+
+    // Smallest final MTU over hops 1..pathLength and the first hop that has it, 0 while unknown
+    int pathMtu(int pathLength, int* limitingHop = nullptr) const;
+
+private:
+    static constexpr int MinRetries = 2;
+    static constexpr int MaxRetries = 8;
+    static constexpr int MinSamplesPerSize = 3;
+
+    struct Hop {
+        int passed;           // Largest size that came back
+        int failed;           // Smallest size known to be too big
+        int silent;           // Timeouts in a row at the current search size
+        bool responsive;      // A minimum-size probe came back
+        quint32 asked;        // Probes at sizes known to fit, for the hop's own loss rate
+        quint32 answered;
+        int nextStep;         // Ladder position of the next fit probe
+        QVector<double> minRtt; // ms per ladder step, double so the per-byte slope keeps its digits
+        QVector<int> samples;
+        HopResult result;
+
+        Hop() : passed(0), failed(0), silent(0), responsive(false), asked(0), answered(0), nextStep(0) {}
+    };
+
+    int searchSize(int hop) const;
+    int ladderSize(const Hop& h, int step) const;
+    int retries(const Hop& h) const;
+    void reopen(Hop& h, int passed);
+    void fit(int hop);
+    bool valid(int hop) const { return hop >= 1 && hop <= m_hops.size(); }
+
+    Config m_config;
+    QVector<Hop> m_hops;
+    int m_nextHop;
+};
+
+#endif // MTUSWEEP_H
@@ -1,18 +1,88 @@
 #include "networktester.h"
 #include <QRandomGenerator>
 #include <QHostInfo>
-#include <QNetworkDatagram>
+#include <QThreadStorage>
+#include <cstring>
+#include <utility>
 
-quint16 NetworkTester::s_globalSequence = 1;
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketLength = int;
+using NativeSocket = SOCKET;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <cerrno>
+using SocketLength = socklen_t;
+using NativeSocket = int;
+#endif
+
+namespace {
+
+bool isTooBig()
+{
+#ifdef Q_OS_WIN
+    return WSAGetLastError() == WSAEMSGSIZE;
+#else
+    return errno == EMSGSIZE;
+#endif
+}
+
+SocketLength toSocketAddress(const QHostAddress& host, quint16 port, sockaddr_storage* address)
+{
+    std::memset(address, 0, sizeof(*address));
+    if (host.protocol() == QAbstractSocket::IPv6Protocol) {
+        sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(address);
+        const Q_IPV6ADDR bytes = host.toIPv6Address();
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        std::memcpy(&in6->sin6_addr, bytes.c, sizeof(bytes.c));
+        return sizeof(sockaddr_in6);
+    }
+    sockaddr_in* in4 = reinterpret_cast<sockaddr_in*>(address);
+    in4->sin_family = AF_INET;
+    in4->sin_port = htons(port);
+    in4->sin_addr.s_addr = htonl(host.toIPv4Address());
+    return sizeof(sockaddr_in);
+}
+
+}
+
+std::atomic<quint16> NetworkTester::s_globalSequence(1);
 
 NetworkTester::NetworkTester(QObject *parent)
     : QObject(parent)
+    , m_address(AddressTable::InvalidId)
     , m_hop(0)
     , m_timeout(5000)
     , m_running(false)
+    , m_simulatedDelayMs(0)
+    , m_simulatedLossPercent(0)
+    , m_packetSize(0)
+    , m_dontFragment(false)
+    , m_protocol(ProbeProtocol::Udp)
+    , m_port(443)
+    , m_replyFrom(AddressTable::InvalidId)
+    , m_requestPort(0)
+    , m_requestProtocol(ProbeProtocol::Udp)
+    , m_reuseConnection(true)
+    , m_httpReused(false)
+    , m_overheadNs(0)
     , m_socket(nullptr)
+    , m_sharedSocket(nullptr)
+    , m_tcpNotifier(nullptr)
+    , m_httpSocket(nullptr)
     , m_timeoutTimer(new QTimer(this))
-    , m_sequenceNumber(0)
+    , m_deadlineNs(0)
+    , m_dispatcher(nullptr)
+    , m_resultQueue(nullptr)
+    , m_resultSink(nullptr)
+    , m_arena(nullptr)
+    , m_probe(nullptr)
+    , m_configSource(nullptr)
+    , m_configGeneration(0)
+    , m_session(0)
 {
     m_timeoutTimer->setSingleShot(true);
     connect(m_timeoutTimer, &QTimer::timeout, this, &NetworkTester::onTimeout);
@@ -21,11 +91,16 @@ NetworkTester::NetworkTester(QObject *parent)
 NetworkTester::~NetworkTester()
 {
     stopTest();
+    setDispatcher(nullptr);
 }
 
-void NetworkTester::setTarget(const QString& ip, int hop)
+void NetworkTester::setTarget(AddressId address, int hop)
 {
-    m_targetIP = ip;
+    // Only convert to a socket address when the hop's responder changes
+    if (address != m_address) {
+        m_address = address;
+        m_targetAddress = AddressTable::instance().toHostAddress(address);
+    }
     m_hop = hop;
 }
 
@@ -34,11 +109,126 @@ void NetworkTester::setTimeout(int timeoutMs)
     m_timeout = timeoutMs;
 }
 
-void NetworkTester::startTest()
+void NetworkTester::setResultQueue(ProbeResultQueue* queue, ResultCollector::Sink* sink)
+{
+    m_resultQueue = queue;
+    m_resultSink = sink;
+}
+
+void NetworkTester::setProbeArena(ProbeArena* arena)
 {
-    if (m_running || m_targetIP.isEmpty()) {
+    m_arena = arena;
+}
+
+void NetworkTester::setSimulatedImpairment(int extraDelayMs, int extraLossPercent)
+{
+    m_simulatedDelayMs = extraDelayMs;
+    m_simulatedLossPercent = extraLossPercent;
+}
+
+void NetworkTester::setConfigSource(const SnapshotPublisher<ProbeConfig>* source)
+{
+    m_configSource = source;
+    m_configGeneration = 0;
+}
+
+void NetworkTester::setProtocol(ProbeProtocol protocol, quint16 port)
+{
+    m_protocol = protocol;
+    m_port = port;
+}
+
+void NetworkTester::setApplicationRequest(const QString& host, const QString& query, bool reuseConnection)
+{
+    // The wire format is only rebuilt when the request changed. Whether it is valid
+    // does not count: a bad DNS name stays bad, an HTTP path is never a DNS name
+    if (host == m_requestHost && query == m_requestQuery && m_port == m_requestPort
+        && m_protocol == m_requestProtocol && reuseConnection == m_reuseConnection) {
         return;
     }
+    m_requestHost = host;
+    m_requestQuery = query;
+    m_requestPort = m_port;
+    m_requestProtocol = m_protocol;
+    m_reuseConnection = reuseConnection;
+    
+    if (m_protocol == ProbeProtocol::Dns) {
+        // Without a name to look up, an address target is asked for the root servers
+        QString name = query;
+        if (name.isEmpty()) {
+            name = QHostAddress(host).isNull() ? host : QString(".");
+        }
+        m_dnsQuery.setName(name);
+    } else if (m_protocol == ProbeProtocol::Http) {
+        m_http.setRequest(host, m_port, query.isEmpty() ? QString("/") : query, reuseConnection);
+        
+        // A connection kept for the old request must not carry the new one
+        if (m_httpSocket && !m_running) {
+            m_httpSocket->abort();
+        }
+    }
+}
+
+void NetworkTester::setDontFragment(bool enabled)
+{
+    m_dontFragment = enabled;
+}
+
+void NetworkTester::setDispatcher(ProbeDispatcher* dispatcher)
+{
+    if (dispatcher == m_dispatcher) {
+        return;
+    }
+    if (m_dispatcher) {
+        m_dispatcher->unwatch(this);
+    }
+    m_dispatcher = dispatcher;
+    if (m_dispatcher) {
+        m_dispatcher->watch(this);
+    }
+}
+
+bool NetworkTester::checkDeadline(qint64 nowNs)
+{
+    if (m_deadlineNs == 0) {
+        return false;
+    }
+    if (nowNs < m_deadlineNs) {
+        return true;
+    }
+    
+    onTimeout();
+    return false;
+}
+
+void NetworkTester::armTimeout()
+{
+    m_deadlineNs = probeClockNs() + static_cast<qint64>(m_timeout) * 1000000;
+    
+    // Starting a timer per probe would register a new one with the event loop each time
+    if (m_dispatcher) {
+        m_dispatcher->wakeTicker();
+    } else {
+        m_timeoutTimer->start(m_timeout);
+    }
+}
+
+bool NetworkTester::usesSharedSocket() const
+{
+    return !m_dontFragment
+        && (m_protocol == ProbeProtocol::Udp || (m_protocol == ProbeProtocol::Dns && m_reuseConnection));
+}
+
+bool NetworkTester::bindSocket()
+{
+    const bool ipv6 = m_targetAddress.protocol() == QAbstractSocket::IPv6Protocol;
+    if (usesSharedSocket()) {
+        m_sharedSocket = SharedProbeSocket::forCurrentThread(ipv6, m_protocol == ProbeProtocol::Dns
+                                                                 ? SharedProbeSocket::Kind::Dns
+                                                                 : SharedProbeSocket::Kind::Echo);
+        return m_sharedSocket->isBound();
+    }
+    m_sharedSocket = nullptr;
     
     if (!m_socket) {
         m_socket = new QUdpSocket(this);
@@ -47,24 +237,173 @@ void NetworkTester::startTest()
                 this, &NetworkTester::onSocketError);
     }
     
+    // Bound once for the target's family, a session on the other family rebinds
+    if (m_socket->state() == QAbstractSocket::BoundState) {
+        if ((m_socket->localAddress().protocol() == QAbstractSocket::IPv6Protocol) == ipv6) {
+            return true;
+        }
+        m_socket->close();
+    }
+    return m_socket->bind(ipv6 ? QHostAddress(QHostAddress::AnyIPv6) : QHostAddress(QHostAddress::AnyIPv4), 0);
+}
+
+qint64 NetworkTester::sendDatagram(const char* data, qint64 size, quint16 port)
+{
+    // QUdpSocket::writeDatagram builds a packet header per call, and its unused
+    // sender address allocates. The bound socket's descriptor is written directly
+    if (!bindSocket()) {
+        return -1;
+    }
+    
+    sockaddr_storage address;
+    const SocketLength length = toSocketAddress(m_targetAddress, port, &address);
+    const qintptr fd = m_sharedSocket ? m_sharedSocket->descriptor() : m_socket->socketDescriptor();
+    const qint64 sent = ::sendto(static_cast<NativeSocket>(fd), data, static_cast<int>(size), 0,
+                                 reinterpret_cast<const sockaddr*>(&address), length);
+    
+    // The reply comes in on the shared socket and is routed back by the probe's sequence
+    if (sent >= 0 && m_sharedSocket) {
+        m_sharedSocket->expect(m_probe->sequence, this);
+    }
+    return sent;
+}
+
+void NetworkTester::forgetSequence()
+{
+    if (m_sharedSocket && m_probe) {
+        m_sharedSocket->forget(m_probe->sequence, this);
+    }
+}
+
+bool NetworkTester::applyDontFragment()
+{
+    // The socket has to exist before its options can be set
+    if (!bindSocket()) {
+        return false;
+    }
+    
+    const qintptr fd = m_socket->socketDescriptor();
+    const bool ipv6 = m_socket->localAddress().protocol() == QAbstractSocket::IPv6Protocol;
+#if defined(Q_OS_WIN)
+    DWORD on = 1;
+    return setsockopt(fd, ipv6 ? IPPROTO_IPV6 : IPPROTO_IP, ipv6 ? IPV6_DONTFRAG : IP_DONTFRAGMENT,
+                      reinterpret_cast<const char*>(&on), sizeof(on)) == 0;
+#elif defined(IP_MTU_DISCOVER)
+    // DO also makes the kernel reject sizes it learned are too big from ICMP
+    int mode = ipv6 ? IPV6_PMTUDISC_DO : IP_PMTUDISC_DO;
+    return setsockopt(fd, ipv6 ? IPPROTO_IPV6 : IPPROTO_IP, ipv6 ? IPV6_MTU_DISCOVER : IP_MTU_DISCOVER,
+                      &mode, sizeof(mode)) == 0;
+#elif defined(IP_DONTFRAG)
+    int on = 1;
+    return setsockopt(fd, ipv6 ? IPPROTO_IPV6 : IPPROTO_IP, ipv6 ? IPV6_DONTFRAG : IP_DONTFRAG,
+                      &on, sizeof(on)) == 0;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(ipv6);
+    return false;
+#endif
+}
+
+void NetworkTester::startTest()
+{
+    if (m_running || m_address == AddressTable::InvalidId || !m_arena) {
+        return;
+    }
+    
+    // Who answers a TCP probe is only known once its handshake ends
+    m_replyFrom = m_protocol == ProbeProtocol::Tcp ? AddressTable::InvalidId : m_address;
+    m_overheadNs = 0;
+    
+    m_probe = m_arena->acquire();
+    if (!m_probe) {
+        // Too many probes in flight on this worker, report it so the hop is not left pending
+        m_running = true;
+        finishProbe(ProbeStatus::SendFailed, -1);
+        return;
+    }
+    m_probe->address = m_address;
+    m_probe->hop = static_cast<quint16>(m_hop);
+    
+    if (m_protocol == ProbeProtocol::Tcp) {
+        m_running = true;
+        sendTcpProbe();
+        return;
+    }
+    
+    if (m_protocol == ProbeProtocol::Http) {
+        m_running = true;
+        sendHttpRequest();
+        return;
+    }
+    
     m_running = true;
-    m_sequenceNumber = s_globalSequence++;
     
-    sendPing();
+    if (m_dontFragment && !applyDontFragment()) {
+        finishProbe(ProbeStatus::SendFailed, -1);
+        return;
+    }
+    
+    if (m_protocol == ProbeProtocol::Dns) {
+        sendDnsQuery();
+    } else {
+        sendPing();
+    }
+}
+
+void NetworkTester::startProbe(AddressId address, int hop, int timeoutMs, int packetSize)
+{
+    setTarget(address, hop);
+    setTimeout(timeoutMs);
+    m_packetSize = qBound(0, packetSize, MaxPacketSize);
+    if (m_packetSize > 0 && m_sizedPacket.isEmpty()) {
+        m_sizedPacket.fill('\0', MaxPacketSize);
+    }
+    startTest();
+}
+
+void NetworkTester::startProbe(const ProbeCommand& command)
+{
+    // Session settings are only read again after the tracer published new ones
+    if (m_configSource && m_configSource->generation() != m_configGeneration) {
+        const SnapshotPublisher<ProbeConfig>::Snapshot config = m_configSource->load();
+        m_configGeneration = config.generation();
+        setProtocol(config->protocol, config->port);
+        if (config->protocol == ProbeProtocol::Dns || config->protocol == ProbeProtocol::Http) {
+            setApplicationRequest(config->host, config->query, config->reuseConnection);
+        }
+    }
+    
+    // A probe still pending from the tracer's last session is abandoned, not reported
+    if (command.session != m_session) {
+        stopTest();
+        m_session = command.session;
+    }
+    
+    setSimulatedImpairment(command.extraDelayMs, command.extraLossPercent);
+    startProbe(command.address, command.hop, command.timeoutMs, command.packetSize);
 }
 
 void NetworkTester::stopTest()
 {
-    if (!m_running) {
-        return;
+    if (m_running) {
+        m_running = false;
+        m_deadlineNs = 0;
+        m_timeoutTimer->stop();
     }
     
-    m_running = false;
-    m_timeoutTimer->stop();
+    if (m_probe) {
+        forgetSequence();
+        m_arena->release(m_probe);
+        m_probe = nullptr;
+    }
     
+    closeTcpProbe();
     if (m_socket) {
         m_socket->close();
     }
+    if (m_httpSocket) {
+        m_httpSocket->abort();
+    }
 }
 
 bool NetworkTester::isRunning() const
@@ -74,75 +413,240 @@ bool NetworkTester::isRunning() const
 
 void NetworkTester::sendPing()
 {
-    if (!m_running || !m_socket) {
+    if (!m_running || !m_probe) {
         return;
     }
     
-    m_sendTime = QDateTime::currentDateTime();
+    const qint64 beginNs = probeClockNs();
     
-    // Create a simple UDP packet (simulating ICMP)
-    QByteArray data;
-    data.append("PING");
-    data.append(reinterpret_cast<const char*>(&m_sequenceNumber), sizeof(m_sequenceNumber));
-    data.append(m_sendTime.toString().toUtf8());
+    // Patch the preformatted packet (simulating ICMP) in place
+    m_probe->stamp(s_globalSequence.fetch_add(1, std::memory_order_relaxed), probeClockNs());
     
     // For simulation, we'll use a high port number
     quint16 port = 33434 + m_hop; // Traceroute-like port
     
-    qint64 sent = m_socket->writeDatagram(data, QHostAddress(m_targetIP), port);
+    qint64 sent;
+    if (m_packetSize > 0) {
+        // Same header, padded from the preallocated buffer to the requested size
+        const int headers = m_targetAddress.protocol() == QAbstractSocket::IPv6Protocol ? 48 : 28;
+        const int payload = qMax(m_packetSize - headers, static_cast<int>(ProbeContext::HeaderSize));
+        std::memcpy(m_sizedPacket.data(), m_probe->packet, ProbeContext::HeaderSize);
+        sent = sendDatagram(m_sizedPacket.constData(), payload, port);
+    } else {
+        sent = sendDatagram(m_probe->packet, m_probe->packetSize, port);
+    }
     
-    if (sent > 0) {
-        m_timeoutTimer->start(m_timeout);
+    chargeOverhead(beginNs);
+    if (sent < 0) {
+        // Nothing left the host, the tracer tells that apart from a probe lost on the way
+        finishProbe(isTooBig() ? ProbeStatus::TooBig : ProbeStatus::SendFailed, -1,
+                    static_cast<quint8>(QAbstractSocket::NetworkError));
+        return;
+    }
+    armTimeout();
+}
+
+void NetworkTester::sendTcpProbe()
+{
+    const qint64 beginNs = probeClockNs();
+    m_probe->stamp(s_globalSequence.fetch_add(1, std::memory_order_relaxed), probeClockNs());
+    
+    // TTL-limited where the router it expires at can be named, end to end otherwise
+    if (!m_tcpProbe.start(m_targetAddress, m_port, TcpProbe::supportsTtl() ? m_hop : 0)) {
+        finishProbe(ProbeStatus::SendFailed, -1);
+        return;
+    }
+    
+    // The network thread's event loop multiplexes every handshake in flight
+    if (!m_tcpNotifier) {
+        m_tcpNotifier = new QSocketNotifier(QSocketNotifier::Write, this);
+        connect(m_tcpNotifier, &QSocketNotifier::activated, this, &NetworkTester::onTcpReady);
+    }
+    m_tcpNotifier->setSocket(m_tcpProbe.descriptor());
+    m_tcpNotifier->setEnabled(true);
+    armTimeout();
+    chargeOverhead(beginNs);
+}
+
+void NetworkTester::onTcpReady()
+{
+    if (!m_running || !m_tcpProbe.isOpen()) {
+        closeTcpProbe();
+        return;
+    }
+    
+    const qint64 rttNs = calculateResponseTimeNs();
+    const qint64 beginNs = probeClockNs();
+    AddressKey responder;
+    if (m_tcpProbe.finish(&responder) == TcpProbe::Outcome::Failed) {
+        finishProbe(ProbeStatus::SocketError, -1);
+        return;
+    }
+    
+    // SYN-ACK and RST both come from the target, an ICMP error from the router
+    m_replyFrom = AddressTable::instance().intern(responder);
+    chargeOverhead(beginNs);
+    finishProbe(ProbeStatus::Success, rttNs);
+}
+
+void NetworkTester::closeTcpProbe()
+{
+    if (m_tcpNotifier) {
+        m_tcpNotifier->setEnabled(false);
+    }
+    m_tcpProbe.close();
+}
+
+void NetworkTester::sendDnsQuery()
+{
+    const qint64 beginNs = probeClockNs();
+    if (!m_dnsQuery.isValid()) {
+        finishProbe(ProbeStatus::SendFailed, -1);
+        return;
+    }
+    
+    // Without reuse every query leaves from a fresh socket and source port
+    if (!m_reuseConnection && m_socket) {
+        m_socket->close();
+    }
+    
+    // The sequence doubles as the query ID, only those two bytes change
+    m_probe->stamp(s_globalSequence.fetch_add(1, std::memory_order_relaxed), probeClockNs());
+    const QByteArray& query = m_dnsQuery.packet(m_probe->sequence);
+    if (sendDatagram(query.constData(), query.size(), m_port) < 0) {
+        finishProbe(ProbeStatus::SendFailed, -1);
+        return;
+    }
+    armTimeout();
+    chargeOverhead(beginNs);
+}
+
+void NetworkTester::sendHttpRequest()
+{
+    const qint64 beginNs = probeClockNs();
+    if (!m_httpSocket) {
+        m_httpSocket = new QTcpSocket(this);
+        connect(m_httpSocket, &QTcpSocket::connected, this, &NetworkTester::onHttpConnected);
+        connect(m_httpSocket, &QTcpSocket::readyRead, this, &NetworkTester::onHttpReadyRead);
+        connect(m_httpSocket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::errorOccurred),
+                this, &NetworkTester::onHttpError);
+    }
+    
+    // A kept-alive connection only carries the next request once the last response was read in full.
+    // Time to first byte then includes the connect whenever a new connection is needed
+    m_httpReused = m_reuseConnection && m_http.reusable()
+                   && m_httpSocket->state() == QAbstractSocket::ConnectedState
+                   && m_httpSocket->peerAddress() == m_targetAddress && m_httpSocket->peerPort() == m_port;
+    m_http.beginResponse();
+    m_probe->stamp(s_globalSequence.fetch_add(1, std::memory_order_relaxed), probeClockNs());
+    
+    if (m_httpReused) {
+        m_httpSocket->write(m_http.request());
     } else {
-        // Simulate response for demonstration
-        QTimer::singleShot(QRandomGenerator::global()->bounded(10, 200), this, [this]() {
+        m_httpSocket->abort();
+        m_httpSocket->connectToHost(m_targetAddress, m_port);
+    }
+    armTimeout();
+    chargeOverhead(beginNs);
+}
+
+void NetworkTester::onHttpConnected()
+{
+    if (m_running && m_protocol == ProbeProtocol::Http) {
+        const qint64 beginNs = probeClockNs();
+        m_httpSocket->write(m_http.request());
+        chargeOverhead(beginNs);
+    }
+}
+
+void NetworkTester::onHttpReadyRead()
+{
+    const qint64 beginNs = probeClockNs();
+    
+    // The body is framed in a stack buffer and dropped, only its end matters
+    char buffer[4096];
+    qint64 size;
+    while ((size = m_httpSocket->read(buffer, sizeof(buffer))) > 0) {
+        const bool first = !m_http.started();
+        if (!m_http.feed(buffer, size)) {
+            m_httpSocket->abort();
             if (m_running) {
-                NetworkTestResult result;
-                result.hop = m_hop;
-                result.ipAddress = m_targetIP;
-                result.hostname = "";
-                result.responseTime = calculateResponseTime();
-                result.success = QRandomGenerator::global()->bounded(100) < 85; // 85% success rate
-                
-                if (!result.success) {
-                    result.responseTime = -1;
-                }
-                
-                emit testCompleted(m_hop, result);
-                stopTest();
+                finishProbe(ProbeStatus::SocketError, -1);
             }
-        });
+            return;
+        }
+        
+        if (first && m_running && m_probe) {
+            const qint64 rttNs = calculateResponseTimeNs();
+            chargeOverhead(beginNs);
+            finishProbe(ProbeStatus::Success, rttNs);
+        }
+    }
+    
+    // Closed by the response or by us, either way the next probe connects anew
+    if (m_http.complete() && !m_http.reusable()) {
+        m_httpSocket->disconnectFromHost();
     }
 }
 
+void NetworkTester::onHttpError(QAbstractSocket::SocketError error)
+{
+    if (!m_running || m_protocol != ProbeProtocol::Http) {
+        return; // An idle kept-alive connection closed by the server
+    }
+    
+    // The server may close an idle connection just as a request goes out on it, retry once on a new one
+    if (m_httpReused && !m_http.started() && error == QAbstractSocket::RemoteHostClosedError) {
+        m_httpReused = false;
+        m_http.beginResponse();
+        m_httpSocket->abort();
+        m_probe->stamp(m_probe->sequence, probeClockNs());
+        m_httpSocket->connectToHost(m_targetAddress, m_port);
+        return;
+    }
+    
+    finishProbe(ProbeStatus::SocketError, -1, static_cast<quint8>(qBound(0, static_cast<int>(error), 255)));
+}
+
+void NetworkTester::chargeOverhead(qint64 sinceNs)
+{
+    m_overheadNs += probeClockNs() - sinceNs;
+}
+
 void NetworkTester::onTimeout()
 {
+    m_deadlineNs = 0;
     if (!m_running) {
         return;
     }
     
-    NetworkTestResult result;
-    result.hop = m_hop;
-    result.ipAddress = m_targetIP;
-    result.hostname = "";
-    result.responseTime = -1;
-    result.success = false;
-    result.error = "Timeout";
-    
-    emit testCompleted(m_hop, result);
-    stopTest();
+    finishProbe(ProbeStatus::Timeout, -1);
 }
 
 void NetworkTester::onSocketReadyRead()
 {
-    if (!m_running || !m_socket) {
+    if (!m_socket) {
         return;
     }
     
+    // Read into a stack buffer, QNetworkDatagram would allocate per reply.
+    // A DNS answer is cut short here, its header is all that is matched
+    const qint64 beginNs = probeClockNs();
+    char buffer[ProbeContext::PacketCapacity];
     while (m_socket->hasPendingDatagrams()) {
-        QNetworkDatagram datagram = m_socket->receiveDatagram();
+        onDatagram(buffer, m_socket->readDatagram(buffer, sizeof(buffer)), beginNs);
+    }
+}
+
+void NetworkTester::onDatagram(const char* data, qint64 size, qint64 beginNs)
+{
+    // Ignore late replies to earlier probes
+    const bool matched = m_running && m_probe
+        && (m_protocol == ProbeProtocol::Dns ? DnsQuery::isResponse(data, size, m_probe->sequence)
+                                              : m_probe->matches(data, size));
+    if (matched) {
+        chargeOverhead(beginNs);
         handleResponse();
-        break; // Handle only first response
     }
 }
 
@@ -152,40 +656,331 @@ void NetworkTester::onSocketError(QAbstractSocket::SocketError error)
         return;
     }
     
-    NetworkTestResult result;
-    result.hop = m_hop;
-    result.ipAddress = m_targetIP;
-    result.hostname = "";
-    result.responseTime = -1;
-    result.success = false;
-    result.error = QString("Socket error: %1").arg(error);
-    
-    emit testCompleted(m_hop, result);
-    stopTest();
+    finishProbe(ProbeStatus::SocketError, -1, static_cast<quint8>(qBound(0, static_cast<int>(error), 255)));
 }
 
 void NetworkTester::handleResponse()
 {
-    NetworkTestResult result;
-    result.hop = m_hop;
-    result.ipAddress = m_targetIP;
-    result.hostname = "";
-    result.responseTime = calculateResponseTime();
-    result.success = true;
+    finishProbe(ProbeStatus::Success, calculateResponseTimeNs());
+}
+
+void NetworkTester::finishProbe(ProbeStatus status, qint64 rttNs, quint8 socketError)
+{
+    // An injected impairment turns answers into losses or adds to their time
+    if (status == ProbeStatus::Success) {
+        if (m_simulatedLossPercent > 0 && QRandomGenerator::global()->bounded(100) < m_simulatedLossPercent) {
+            status = ProbeStatus::Timeout;
+            rttNs = -1;
+        } else {
+            rttNs += static_cast<qint64>(m_simulatedDelayMs) * 1000000;
+        }
+    }
     
-    emit testCompleted(m_hop, result);
-    stopTest();
+    ProbeResult result;
+    result.rttNs = rttNs;
+    result.address = m_replyFrom;
+    result.hop = static_cast<quint16>(m_hop);
+    result.sequence = m_probe ? m_probe->sequence : 0;
+    result.packetSize = static_cast<quint16>(m_packetSize);
+    result.status = status;
+    result.socketError = socketError;
+    result.overheadNs = static_cast<quint32>(qBound<qint64>(0, m_overheadNs, 0xffffffff));
+    result.session = m_session;
+    
+    // Finish the probe but keep the socket bound for the next one
+    m_running = false;
+    m_deadlineNs = 0;
+    m_timeoutTimer->stop();
+    forgetSequence();
+    m_arena->release(m_probe);
+    m_probe = nullptr;
+    closeTcpProbe();
+    
+    if (m_resultQueue && m_resultQueue->push(result)) {
+        if (m_resultSink) {
+            m_resultSink->notifyReady();
+        } else {
+            emit resultsReady();
+        }
+    }
 }
 
-double NetworkTester::calculateResponseTime()
+qint64 NetworkTester::calculateResponseTimeNs()
 {
-    if (m_sendTime.isValid()) {
-        qint64 elapsed = m_sendTime.msecsTo(QDateTime::currentDateTime());
-        return static_cast<double>(elapsed);
+    if (m_probe && m_probe->sendTimeNs > 0) {
+        return probeClockNs() - m_probe->sendTimeNs;
     }
     
     // Simulate realistic response times
     int baseTime = m_hop * 10; // Base latency increases with hops
     int variation = QRandomGenerator::global()->bounded(50); // Add some variation
-    return baseTime + variation;
+    return static_cast<qint64>(baseTime + variation) * 1000000;
+}
+
+namespace {
+
+constexpr int SequenceCount = 1 << 16;
+constexpr int SharedSocketCount = 4;
+
+// Shared sockets of one network thread, by family and kind
+struct SharedProbeSockets {
+    SharedProbeSocket* sockets[SharedSocketCount] = {};
+    
+    ~SharedProbeSockets()
+    {
+        for (SharedProbeSocket* socket : sockets) {
+            delete socket;
+        }
+    }
+};
+
+}
+
+SharedProbeSocket::SharedProbeSocket(bool ipv6, Kind kind)
+    : m_socket(new QUdpSocket(this))
+    , m_ipv6(ipv6)
+    , m_kind(kind)
+    , m_waiting(new NetworkTester*[SequenceCount]())
+{
+    connect(m_socket, &QUdpSocket::readyRead, this, &SharedProbeSocket::onReadyRead);
+}
+
+SharedProbeSocket::~SharedProbeSocket()
+{
+    delete[] m_waiting;
+}
+
+SharedProbeSocket* SharedProbeSocket::forCurrentThread(bool ipv6, Kind kind)
+{
+    static QThreadStorage<SharedProbeSockets*> sockets;
+    if (!sockets.hasLocalData()) {
+        sockets.setLocalData(new SharedProbeSockets());
+    }
+    
+    SharedProbeSocket*& socket = sockets.localData()->sockets[(ipv6 ? 2 : 0) + static_cast<int>(kind)];
+    if (!socket) {
+        socket = new SharedProbeSocket(ipv6, kind);
+    }
+    return socket;
+}
+
+bool SharedProbeSocket::isBound()
+{
+    if (m_socket->state() == QAbstractSocket::BoundState) {
+        return true;
+    }
+    return m_socket->bind(m_ipv6 ? QHostAddress(QHostAddress::AnyIPv6) : QHostAddress(QHostAddress::AnyIPv4), 0);
+}
+
+qintptr SharedProbeSocket::descriptor() const
+{
+    return m_socket->socketDescriptor();
+}
+
+void SharedProbeSocket::expect(quint16 sequence, NetworkTester* tester)
+{
+    m_waiting[sequence] = tester;
+}
+
+void SharedProbeSocket::forget(quint16 sequence, NetworkTester* tester)
+{
+    if (m_waiting[sequence] == tester) {
+        m_waiting[sequence] = nullptr;
+    }
+}
+
+void SharedProbeSocket::onReadyRead()
+{
+    const qint64 beginNs = probeClockNs();
+    char buffer[ProbeContext::PacketCapacity];
+    while (m_socket->hasPendingDatagrams()) {
+        const qint64 size = m_socket->readDatagram(buffer, sizeof(buffer));
+        
+        // The sequence is where the probe put it; the tester still checks the whole reply
+        quint16 sequence;
+        if (m_kind == Kind::Dns) {
+            if (size < 2) {
+                continue;
+            }
+            sequence = static_cast<quint16>(static_cast<quint8>(buffer[0]) << 8 | static_cast<quint8>(buffer[1]));
+        } else {
+            if (size < ProbeContext::HeaderSize) {
+                continue;
+            }
+            std::memcpy(&sequence, buffer + ProbeContext::SequenceOffset, sizeof(sequence));
+        }
+        
+        if (NetworkTester* tester = m_waiting[sequence]) {
+            tester->onDatagram(buffer, size, beginNs);
+        }
+    }
+}
+
+ResultCollector::Sink::Sink()
+    : m_collector(ResultCollector::forCurrentThread())
+    , m_nextReady(nullptr)
+{
+}
+
+ResultCollector::Sink::~Sink()
+{
+    m_collector->remove(this);
+}
+
+void ResultCollector::Sink::notifyReady()
+{
+    m_collector->push(this);
+}
+
+ResultCollector::ResultCollector(QAbstractEventDispatcher* dispatcher)
+    : m_ready(nullptr)
+    , m_dispatcher(dispatcher)
+{
+    connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &ResultCollector::collect);
+    connect(dispatcher, &QAbstractEventDispatcher::awake, this, &ResultCollector::collect);
+}
+
+ResultCollector* ResultCollector::forCurrentThread()
+{
+    static QThreadStorage<ResultCollector*> collectors;
+    if (!collectors.hasLocalData()) {
+        collectors.setLocalData(new ResultCollector(QAbstractEventDispatcher::instance()));
+    }
+    return collectors.localData();
+}
+
+void ResultCollector::push(Sink* sink)
+{
+    // The ring's wake flag keeps a sink from being pushed again before it was drained
+    Sink* head = m_ready.load(std::memory_order_relaxed);
+    do {
+        sink->m_nextReady = head;
+    } while (!m_ready.compare_exchange_weak(head, sink, std::memory_order_release, std::memory_order_relaxed));
+    
+    // The first sink on an empty list wakes the thread, later ones are collected with it
+    if (!head) {
+        m_dispatcher->wakeUp();
+    }
+}
+
+void ResultCollector::remove(Sink* sink)
+{
+    // Testers of other sinks may push meanwhile, so the list is taken whole and the rest put back
+    Sink* ready = m_ready.exchange(nullptr, std::memory_order_acquire);
+    while (ready) {
+        Sink* next = ready->m_nextReady;
+        if (ready != sink) {
+            push(ready);
+        }
+        ready = next;
+    }
+}
+
+void ResultCollector::collect()
+{
+    if (!m_ready.load(std::memory_order_relaxed)) {
+        return;
+    }
+    
+    // A sink is only pushed again once it was drained, so its link is read first
+    Sink* ready = m_ready.exchange(nullptr, std::memory_order_acquire);
+    while (ready) {
+        Sink* next = ready->m_nextReady;
+        ready->drainProbeResults();
+        ready = next;
+    }
+}
+
+ProbeDispatcher::ProbeDispatcher(QObject *parent)
+    : QObject(parent)
+    , m_dispatcher(nullptr)
+    , m_closed(false)
+    , m_ticker(new QTimer(this))
+    , m_idleTicks(0)
+{
+    m_ticker->setInterval(TickMs);
+    connect(m_ticker, &QTimer::timeout, this, &ProbeDispatcher::onTick);
+}
+
+ProbeDispatcher::~ProbeDispatcher()
+{
+    for (NetworkTester* tester : std::exchange(m_testers, QVector<NetworkTester*>())) {
+        tester->setDispatcher(nullptr);
+    }
+}
+
+bool ProbeDispatcher::post(const ProbeCommand& command)
+{
+    if (m_queue.isFull()) {
+        return false;
+    }
+    
+    if (m_queue.push(command)) {
+        // Until attach() ran on the network thread a queued call stands in for the wake-up
+        if (QAbstractEventDispatcher* dispatcher = m_dispatcher.load(std::memory_order_acquire)) {
+            dispatcher->wakeUp();
+        } else {
+            QMetaObject::invokeMethod(this, &ProbeDispatcher::drain, Qt::QueuedConnection);
+        }
+    }
+    return true;
+}
+
+void ProbeDispatcher::close()
+{
+    m_closed.store(true, std::memory_order_release);
+}
+
+void ProbeDispatcher::attach()
+{
+    // Commands pushed before the loop blocks are drained right then, later ones wake it
+    QAbstractEventDispatcher* dispatcher = QAbstractEventDispatcher::instance();
+    connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &ProbeDispatcher::drain);
+    connect(dispatcher, &QAbstractEventDispatcher::awake, this, &ProbeDispatcher::drain);
+    m_dispatcher.store(dispatcher, std::memory_order_release);
+    drain();
+}
+
+void ProbeDispatcher::drain()
+{
+    const bool closed = m_closed.load(std::memory_order_acquire);
+    m_queue.drain([this, closed](const ProbeCommand& command) {
+        if (!closed) {
+            command.tester->setDispatcher(this);
+            command.tester->startProbe(command);
+        }
+    });
+}
+
+void ProbeDispatcher::watch(NetworkTester* tester)
+{
+    m_testers.append(tester);
+}
+
+void ProbeDispatcher::unwatch(NetworkTester* tester)
+{
+    m_testers.removeOne(tester);
+}
+
+void ProbeDispatcher::wakeTicker()
+{
+    m_idleTicks = 0;
+    if (!m_ticker->isActive()) {
+        m_ticker->start();
+    }
+}
+
+void ProbeDispatcher::onTick()
+{
+    const qint64 nowNs = probeClockNs();
+    bool pending = false;
+    for (NetworkTester* tester : m_testers) {
+        pending |= tester->checkDeadline(nowNs);
+    }
+    
+    if (pending) {
+        m_idleTicks = 0;
+    } else if (++m_idleTicks >= IdleTicks) {
+        m_ticker->stop();
+    }
 }
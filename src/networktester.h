@@ -4,19 +4,159 @@
 #include <QObject>
 #include <QTimer>
 #include <QUdpSocket>
+#include <QTcpSocket>
 #include <QHostAddress>
-#include <QDateTime>
 #include <QThread>
+#include <QSocketNotifier>
+#include <QAbstractEventDispatcher>
+#include <QVector>
+#include <atomic>
+#include "addresstable.h"
+#include "probearena.h"
+#include "proberesultqueue.h"
+#include "snapshotpublisher.h"
+#include "tcpprobe.h"
+#include "appprobe.h"
 
-struct NetworkTestResult {
-    int hop;
-    QString ipAddress;
-    QString hostname;
-    double responseTime; // -1 if timeout
-    bool success;
-    QString error;
+enum class ProbeProtocol : quint8 {
+    Udp,    // Datagram to a traceroute port
+    Tcp,    // SYN to a service port, timed to the handshake or the router's ICMP error
+    Dns,    // Query to the target as a DNS server, timed to its answer
+    Http    // GET from the target, timed to the first byte of the response
+};
+
+// Well-known port a probe protocol aims at when none is given
+inline quint16 defaultProbePort(ProbeProtocol protocol)
+{
+    switch (protocol) {
+    case ProbeProtocol::Tcp:
+        return 443;
+    case ProbeProtocol::Dns:
+        return 53;
+    case ProbeProtocol::Http:
+        return 80;
+    default:
+        return 0;
+    }
+}
+
+// Settings every probe of a session shares. Testers re-read them only when
+// the tracer published a new generation, not with every probe
+struct ProbeConfig {
+    ProbeProtocol protocol = ProbeProtocol::Udp;
+    quint16 port = 0;
+    QString host;             // Target name DNS and HTTP requests carry
+    QString query;
+    bool reuseConnection = true;
+};
+
+class NetworkTester;
+
+// One probe, queued from the tracer thread to a tester on the network thread
+struct ProbeCommand {
+    NetworkTester* tester;
+    AddressId address;
+    quint16 hop;
+    quint16 packetSize;
+    qint32 timeoutMs;
+    qint32 extraDelayMs;
+    qint32 extraLossPercent;
+    quint32 session;        // Stamped into the result so a reused tracer can drop stale ones
+};
+
+using ProbeCommandQueue = ProbeQueue<ProbeCommand, 1024>;
+
+class ProbeDispatcher;
+
+// Wakes the tracers of one thread when their testers queued results.
+//
+// A queued signal per batch allocates its call event. Instead a sink whose
+// ring went from empty to non-empty is pushed onto a lock-free ready list,
+// the thread's event dispatcher is woken directly, and only the sinks on the
+// list are drained when the loop wakes up or is about to block.
+class ResultCollector : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Consumer of one result ring, drained on the thread it was created on
+    class Sink
+    {
+    public:
+        Sink();
+        
+        // Producer thread, only when ProbeResultQueue::push asked for a wake-up
+        void notifyReady();
+        virtual void drainProbeResults() = 0;
+        
+    protected:
+        // No producer may notify the sink any more
+        virtual ~Sink();
+        
+    private:
+        friend class ResultCollector;
+        ResultCollector* m_collector;
+        Sink* m_nextReady;
+    };
+    
+    // Created with the first sink of a thread, deleted when the thread ends
+    static ResultCollector* forCurrentThread();
+    
+private slots:
+    void collect();
+    
+private:
+    explicit ResultCollector(QAbstractEventDispatcher* dispatcher);
+    
+    void push(Sink* sink);
+    void remove(Sink* sink);
     
-    NetworkTestResult() : hop(0), responseTime(-1), success(false) {}
+    std::atomic<Sink*> m_ready;
+    QAbstractEventDispatcher* m_dispatcher;
+};
+
+// One unconnected UDP socket per family and probe kind, shared by every
+// tester on a network thread.
+//
+// A socket per hop tester would hold a descriptor for every hop of every
+// trace, thousands in a batch. Testers send from the shared socket instead
+// and register their probe's sequence, which every reply echoes (in the probe
+// header, or as the DNS query ID); the reply is handed to the tester
+// registered under it. The table is indexed by sequence, so registering and
+// matching take no lock and allocate nothing.
+class SharedProbeSocket : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Kind : quint8 {
+        Echo,   // Traceroute probes, echoed with their header
+        Dns     // Queries, answered under their ID
+    };
+    
+    // Network thread. Created on first use, deleted when the thread ends
+    static SharedProbeSocket* forCurrentThread(bool ipv6, Kind kind);
+    
+    ~SharedProbeSocket();
+    
+    // Binds again after a failed attempt
+    bool isBound();
+    qintptr descriptor() const;
+    
+    void expect(quint16 sequence, NetworkTester* tester);
+    // Only clears the entry while it still belongs to tester
+    void forget(quint16 sequence, NetworkTester* tester);
+    
+private slots:
+    void onReadyRead();
+    
+private:
+    SharedProbeSocket(bool ipv6, Kind kind);
+    
+    QUdpSocket* m_socket;
+    bool m_ipv6;
+    Kind m_kind;
+    NetworkTester** m_waiting;  // 65536 entries, one per sequence
 };
 
 class NetworkTester : public QObject
@@ -24,41 +164,165 @@ class NetworkTester : public QObject
     Q_OBJECT
 
 public:
+    static constexpr int MaxPacketSize = 9216;
+    
     explicit NetworkTester(QObject *parent = nullptr);
     ~NetworkTester();
     
-    void setTarget(const QString& ip, int hop);
+    void setTarget(AddressId address, int hop);
     void setTimeout(int timeoutMs);
+    // Results go to queue. A sink is woken through its collector, without one resultsReady is emitted
+    void setResultQueue(ProbeResultQueue* queue, ResultCollector::Sink* sink = nullptr);
+    void setProbeArena(ProbeArena* arena);
+    // Added to the time of each answer, or the answer counted lost, until set back to 0
+    void setSimulatedImpairment(int extraDelayMs, int extraLossPercent);
+    // Protocol, port and request of the probes come from here when set
+    void setConfigSource(const SnapshotPublisher<ProbeConfig>* source);
+    void setProtocol(ProbeProtocol protocol, quint16 port);
+    // DNS name to query or HTTP path to fetch from host; reuse keeps the socket or connection between probes.
+    // Applies to the protocol already set, only its request is built
+    void setApplicationRequest(const QString& host, const QString& query, bool reuseConnection);
     void startTest();
+    // A packetSize > 0 pads the probe to that many bytes on the wire (IP packet size)
+    void startProbe(AddressId address, int hop, int timeoutMs, int packetSize = 0);
+    void startProbe(const ProbeCommand& command);
+    // Sets DF so oversized probes are rejected instead of fragmented
+    void setDontFragment(bool enabled);
     void stopTest();
     
     bool isRunning() const;
+    
+    // Network thread. Timeouts are then checked by the dispatcher's shared tick
+    void setDispatcher(ProbeDispatcher* dispatcher);
+    // Network thread, from the dispatcher's tick. False while no timeout is pending
+    bool checkDeadline(qint64 nowNs);
+    // Network thread, a datagram read from this tester's own or shared socket
+    void onDatagram(const char* data, qint64 size, qint64 beginNs);
 
 signals:
-    void testCompleted(int hop, const NetworkTestResult& result);
+    // Emitted once per batch when results were queued into an empty queue, unless a sink is set
+    void resultsReady();
     void errorOccurred(const QString& error);
 
 private slots:
     void onTimeout();
     void onSocketReadyRead();
     void onSocketError(QAbstractSocket::SocketError error);
+    void onTcpReady();
+    void onHttpConnected();
+    void onHttpReadyRead();
+    void onHttpError(QAbstractSocket::SocketError error);
 
 private:
     void sendPing();
+    // Probes that go to whoever answers share the thread's socket; DF probes and
+    // DNS queries that want a fresh source port each time keep their own
+    bool usesSharedSocket() const;
+    bool bindSocket();
+    void forgetSequence();
+    qint64 sendDatagram(const char* data, qint64 size, quint16 port);
+    void armTimeout();
+    void sendTcpProbe();
+    void closeTcpProbe();
+    void sendDnsQuery();
+    void sendHttpRequest();
+    void chargeOverhead(qint64 sinceNs);
     void handleResponse();
-    double calculateResponseTime();
+    void finishProbe(ProbeStatus status, qint64 rttNs, quint8 socketError = 0);
+    qint64 calculateResponseTimeNs();
+    bool applyDontFragment();
     
-    QString m_targetIP;
+    AddressId m_address;
+    QHostAddress m_targetAddress;
     int m_hop;
     int m_timeout;
     bool m_running;
+    int m_simulatedDelayMs;
+    int m_simulatedLossPercent;
+    int m_packetSize;
+    bool m_dontFragment;
+    QByteArray m_sizedPacket; // Allocated on the first size probe, reused after
+    ProbeProtocol m_protocol;
+    quint16 m_port;           // Service port of TCP, DNS and HTTP probes
+    AddressId m_replyFrom;    // Responder of the current probe, a router for TCP probes
+    QString m_requestHost;
+    QString m_requestQuery;
+    quint16 m_requestPort;
+    ProbeProtocol m_requestProtocol; // Protocol the current request was built for
+    bool m_reuseConnection;
+    bool m_httpReused;        // Current request went out on a kept-alive connection
+    qint64 m_overheadNs;      // Time spent in this tester on the current probe
+    DnsQuery m_dnsQuery;
+    HttpProbe m_http;
     
-    QUdpSocket* m_socket;
-    QTimer* m_timeoutTimer;
-    QDateTime m_sendTime;
-    quint16 m_sequenceNumber;
+    QUdpSocket* m_socket;       // Own socket, only created when the shared one does not fit
+    SharedProbeSocket* m_sharedSocket; // Shared socket the current probe was registered with
+    TcpProbe m_tcpProbe;
+    QSocketNotifier* m_tcpNotifier;
+    QTcpSocket* m_httpSocket;
+    QTimer* m_timeoutTimer;     // Only without a dispatcher
+    qint64 m_deadlineNs;        // Timeout of the current probe, 0 when none is pending
+    ProbeDispatcher* m_dispatcher;
+    ProbeResultQueue* m_resultQueue;
+    ResultCollector::Sink* m_resultSink;
+    ProbeArena* m_arena;
+    ProbeContext* m_probe;
+    const SnapshotPublisher<ProbeConfig>* m_configSource;
+    quint64 m_configGeneration; // Generation of the settings last applied
+    quint32 m_session;          // Tracer session of the current probe
+    
+    // Shared by the testers of every tracer, so a reply on a shared socket maps to one probe
+    static std::atomic<quint16> s_globalSequence;
+};
+
+// Hands the probe commands of one tracer to its testers on the network thread.
+//
+// A queued call per probe allocates its call event and functor; the ring is
+// allocated once. The network thread's event dispatcher is woken directly and
+// the ring drained whenever the loop is about to block or just woke up.
+//
+// Probe timeouts of the testers are checked by one repeating tick instead of
+// a timer started per probe, which registers a new timer with the event loop
+// (and allocates) every time. The tick stops once nothing was pending for a
+// second, so a steady probe rate never re-registers it.
+class ProbeDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int TickMs = 10;
+    
+    explicit ProbeDispatcher(QObject *parent = nullptr);
+    ~ProbeDispatcher();
+    
+    // Tracer thread. False when the ring is full and the probe was not queued
+    bool post(const ProbeCommand& command);
+    // Tracer thread, before its testers are deleted. Queued commands are dropped from here on
+    void close();
+    
+    // Network thread, see NetworkTester::setDispatcher
+    void watch(NetworkTester* tester);
+    void unwatch(NetworkTester* tester);
+    // Network thread, a tester armed a timeout
+    void wakeTicker();
+    
+public slots:
+    // Network thread, once after moving there
+    void attach();
+    
+private slots:
+    void drain();
+    void onTick();
+    
+private:
+    static constexpr int IdleTicks = 1000 / TickMs;
     
-    static quint16 s_globalSequence;
+    ProbeCommandQueue m_queue;
+    std::atomic<QAbstractEventDispatcher*> m_dispatcher;
+    std::atomic<bool> m_closed;
+    QVector<NetworkTester*> m_testers;
+    QTimer* m_ticker;
+    int m_idleTicks;
 };
 
 #endif // NETWORKTESTER_H
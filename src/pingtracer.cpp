@@ -4,39 +4,144 @@
 #include <QProcess>
 #include <QRegularExpression>
 #include <QDebug>
+#include <QMutex>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// One network thread serves every tracer: probes of thousands of traces share
+// its event loop and its sockets instead of a thread and sockets per trace
+QMutex g_networkThreadMutex;
+QThread* g_networkThread = nullptr;
+int g_networkThreadUsers = 0;
+
+QThread* acquireNetworkThread()
+{
+    QMutexLocker locker(&g_networkThreadMutex);
+    if (g_networkThreadUsers++ == 0) {
+        g_networkThread = new QThread();
+        g_networkThread->setObjectName("PingTracer network");
+        // Probe timing outranks the low-priority analytic workers in TaskPool
+        g_networkThread->start(QThread::HighPriority);
+    }
+    return g_networkThread;
+}
+
+void releaseNetworkThread()
+{
+    QMutexLocker locker(&g_networkThreadMutex);
+    if (--g_networkThreadUsers == 0) {
+        g_networkThread->quit();
+        g_networkThread->wait();
+        delete g_networkThread;
+        g_networkThread = nullptr;
+    }
+}
+
+}
 
 PingTracer::PingTracer(QObject *parent)
     : QObject(parent)
     , m_interval(1000)
     , m_timeout(5000)
+    , m_minTimeout(1000)
+    , m_adaptiveTimeouts(true)
+    , m_shiftHop(0)
+    , m_shiftAfterMs(0)
+    , m_shiftDelayMs(0)
+    , m_shiftLossPercent(0)
+    , m_rounds(0)
+    , m_probeBudget(nullptr)
+    , m_resolveHostnames(true)
     , m_maxHops(30)
+    , m_fastStart(true)
+    , m_burstPacing(5)
+    , m_family(AddressFamily::Any)
+    , m_nameserverPort(53)
+    , m_protocol(ProbeProtocol::Udp)
+    , m_probePort(0)
+    , m_reuseConnections(true)
     , m_running(false)
     , m_resolving(false)
+    , m_burstNextHop(1)
+    , m_destinationHop(0)
+    , m_pathDiscovered(false)
+    , m_session(0)
+    , m_sizeSweep(false)
+    , m_sweepTester(nullptr)
+    , m_sweepInFlight(false)
+    , m_sweepProbes(0)
+    , m_pathMtu(0)
+    , m_inFlight(0)
+    , m_peakInFlight(0)
+    , m_probesSent(0)
+    , m_probesReceived(0)
+    , m_sendFailures(0)
+    , m_overheadNs(0)
+    , m_overheadProbes(0)
     , m_currentHop(1)
+    , m_hopPublishPending(false)
     , m_lookupId(-1)
+    , m_probeDispatcher(nullptr)
 {
+    m_alertEngine = new AlertEngine(this);
+    
     m_traceTimer = new QTimer(this);
     m_traceTimer->setSingleShot(false);
     connect(m_traceTimer, &QTimer::timeout, this, &PingTracer::performTrace);
     
-    m_networkThread = new QThread(this);
-    m_networkThread->start();
+    // Paces the session-start burst that probes every TTL once
+    m_burstTimer = new QTimer(this);
+    m_burstTimer->setSingleShot(false);
+    m_burstTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_burstTimer, &QTimer::timeout, this, &PingTracer::performBurstStep);
+    
+    // Issues each hop's probe at its own phase inside the interval
+    m_scheduler = new ProbeScheduler(this);
+    connect(m_scheduler, &ProbeScheduler::flowDue, this, &PingTracer::onProbeDue);
+    
+    // Probe contexts are only touched on the network thread
+    m_probeArena = new ProbeArena();
+    
+    // Shared routers keep one set of stats and one hostname across all tracers
+    m_topologyPath = TopologyGraph::instance().addPath();
+    connect(&TopologyGraph::instance(), &TopologyGraph::hostnameResolved, this, &PingTracer::onHostnameResolved);
+    
+    m_networkThread = acquireNetworkThread();
+    
+    // Probes reach the testers through one preallocated ring instead of a queued call each
+    m_probeDispatcher = new ProbeDispatcher();
+    m_probeDispatcher->moveToThread(m_networkThread);
+    QMetaObject::invokeMethod(m_probeDispatcher, &ProbeDispatcher::attach, Qt::QueuedConnection);
 }
 
 PingTracer::~PingTracer()
 {
     stop();
-    if (m_networkThread) {
-        m_networkThread->quit();
-        m_networkThread->wait();
+    
+    // Testers point into this tracer's queue and arena, so they are deleted on
+    // the shared thread before those go; the thread itself keeps running
+    m_probeDispatcher->close();
+    QList<NetworkTester*> testers = std::exchange(m_networkTesters, QList<NetworkTester*>());
+    if (m_sweepTester) {
+        testers.append(m_sweepTester);
     }
+    QMetaObject::invokeMethod(m_probeDispatcher, [&testers]() {
+        qDeleteAll(testers);
+    }, Qt::BlockingQueuedConnection);
+    m_probeDispatcher->deleteLater();
+    releaseNetworkThread();
+    
+    delete m_probeArena;
+    TopologyGraph::instance().removePath(m_topologyPath);
 }
 
 void PingTracer::setTarget(const QString& host)
 {
     if (!m_running) {
         m_targetHost = host;
-        m_targetIP.clear();
+        m_targetAddress = AddressTable::InvalidId;
     }
 }
 
@@ -45,6 +150,7 @@ void PingTracer::setInterval(int intervalMs)
     m_interval = qMax(100, intervalMs);
     if (m_running) {
         m_traceTimer->setInterval(m_interval);
+        m_scheduler->setInterval(m_interval);
     }
 }
 
@@ -58,13 +164,123 @@ void PingTracer::setMaxHops(int maxHops)
     m_maxHops = qMax(1, qMin(64, maxHops));
 }
 
+void PingTracer::setFastStart(bool enabled)
+{
+    m_fastStart = enabled;
+}
+
+void PingTracer::setBurstPacing(int pacingMs)
+{
+    m_burstPacing = qMax(0, qMin(100, pacingMs));
+}
+
+void PingTracer::setAddressFamily(AddressFamily family)
+{
+    if (!m_running) {
+        m_family = family;
+    }
+}
+
+void PingTracer::setPhaseJitter(double fraction)
+{
+    m_scheduler->setJitter(fraction);
+}
+
+void PingTracer::setAdaptiveTimeouts(bool enabled)
+{
+    m_adaptiveTimeouts = enabled;
+}
+
+void PingTracer::setChangeSensitivity(double threshold)
+{
+    m_changeConfig.threshold = qMax(1.0, threshold);
+    for (ChangeDetector& detector : m_hopDetectors) {
+        detector.setConfig(m_changeConfig);
+    }
+}
+
+void PingTracer::setAlertRules(const QList<AlertRule>& rules)
+{
+    m_alertEngine->setRules(rules);
+}
+
+void PingTracer::setRounds(int rounds)
+{
+    m_rounds = qMax(0, rounds);
+}
+
+void PingTracer::setProbeBudget(ProbeBudget* budget)
+{
+    m_probeBudget = budget;
+}
+
+void PingTracer::setResolveHostnames(bool enabled)
+{
+    m_resolveHostnames = enabled;
+}
+
+double PingTracer::changeSensitivity() const
+{
+    return m_changeConfig.threshold;
+}
+
+AlertEngine* PingTracer::alertEngine() const
+{
+    return m_alertEngine;
+}
+
+void PingTracer::setSizeSweep(bool enabled)
+{
+    m_sizeSweep = enabled;
+    if (enabled) {
+        probeSizeSweep();
+    }
+}
+
+void PingTracer::setProbeProtocol(ProbeProtocol protocol, quint16 port)
+{
+    m_protocol = protocol;
+    m_probePort = port > 0 ? port : defaultProbePort(protocol);
+    publishProbeConfig();
+}
+
+void PingTracer::setApplicationProbe(const QString& query, bool reuseConnections)
+{
+    m_appQuery = query;
+    m_reuseConnections = reuseConnections;
+    publishProbeConfig();
+}
+
+void PingTracer::setSimulatedShift(int hop, qint64 afterMs, int extraDelayMs, int extraLossPercent)
+{
+    m_shiftHop = hop;
+    m_shiftAfterMs = afterMs;
+    m_shiftDelayMs = qMax(0, extraDelayMs);
+    m_shiftLossPercent = qBound(0, extraLossPercent, 100);
+}
+
+bool PingTracer::setNameserver(const QHostAddress& nameserver, quint16 port)
+{
+#if QT_VERSION < QT_VERSION_CHECK(6, 6, 0)
+    // QDnsLookup only takes a nameserver port from Qt 6.6 on
+    if (port != 53) {
+        return false;
+    }
+#endif
+    // Lets the forward lookup be pointed at a local stub server
+    m_nameserver = nameserver;
+    m_nameserverPort = port;
+    return true;
+}
+
 bool PingTracer::start()
 {
-    if (m_running || m_targetHost.isEmpty()) {
+    if (m_running || m_resolving || m_targetHost.isEmpty()) {
         return false;
     }
     
     resetData();
+    m_sessionTimer.start();
     
     // First resolve the target hostname
     resolveTarget();
@@ -73,19 +289,26 @@ bool PingTracer::start()
 
 void PingTracer::stop()
 {
+    m_resolving = false;
+    cancelLookups();
+    
     if (!m_running) {
         return;
     }
     
     m_running = false;
     m_traceTimer->stop();
+    m_burstTimer->stop();
+    m_scheduler->stop();
     
-    // Clean up network testers
+    // Testers are kept for the next session, just cancel their probes
     for (NetworkTester* tester : m_networkTesters) {
-        tester->stopTest();
-        tester->deleteLater();
+        QMetaObject::invokeMethod(tester, &NetworkTester::stopTest, Qt::QueuedConnection);
     }
-    m_networkTesters.clear();
+    if (m_sweepTester) {
+        QMetaObject::invokeMethod(m_sweepTester, &NetworkTester::stopTest, Qt::QueuedConnection);
+    }
+    m_sweepInFlight = false;
     
     emit finished();
 }
@@ -95,10 +318,167 @@ bool PingTracer::isRunning() const
     return m_running;
 }
 
+void PingTracer::saveState(SessionWriter& writer) const
+{
+    const AddressKey target = AddressTable::instance().key(m_targetAddress);
+    const int hopCount = qMin<int>(probeLimit(), m_hopData.size());
+    
+    SessionTracer tracer;
+    std::memset(&tracer, 0, sizeof(tracer));
+    tracer.target = writer.addString(m_targetHost);
+    tracer.family = static_cast<quint32>(m_family);
+    tracer.addressHi = target.hi;
+    tracer.addressLo = target.lo;
+    tracer.intervalMs = m_interval;
+    tracer.timeoutMs = m_timeout;
+    tracer.maxHops = m_maxHops;
+    tracer.destinationHop = m_destinationHop;
+    tracer.firstHop = writer.hopCount();
+    tracer.hopCount = hopCount;
+    tracer.probesSent = m_probesSent;
+    tracer.probesReceived = m_probesReceived;
+    tracer.protocol = static_cast<quint32>(m_protocol);
+    tracer.port = m_probePort;
+    tracer.query = writer.addString(m_appQuery);
+    tracer.flags = (m_fastStart ? SessionTracer::FastStart : 0)
+                   | (m_reuseConnections ? SessionTracer::ReuseConnections : 0);
+    tracer.reserved = 0;
+    
+    // Rules go back in as their source lines, parsed again on resume
+    QStringList ruleLines;
+    for (const AlertRule& rule : m_alertEngine->rules()) {
+        ruleLines.append(rule.text);
+    }
+    tracer.alertRules = ruleLines.isEmpty() ? SessionWriter::NoString : writer.addString(ruleLines.join('\n'));
+    tracer.endToEndCount = m_alertEngine->windowSamples(0, tracer.endToEnd);
+    tracer.reserved2 = 0;
+    
+    for (int i = 0; i < hopCount; ++i) {
+        const HopData& hop = m_hopData[i];
+        const AddressKey address = AddressTable::instance().key(hop.address);
+        const SampleWindow& window = m_hopWindows[i];
+        
+        SessionHop record;
+        std::memset(&record, 0, sizeof(record));
+        record.addressHi = address.hi;
+        record.addressLo = address.lo;
+        record.hostname = hop.hostname != "---" ? writer.addString(hop.hostname) : SessionWriter::NoString;
+        record.sent = hop.sent;
+        record.received = hop.received;
+        record.recentCount = window.count();
+        record.recentNext = window.next();
+        record.bestTime = hop.bestTime;
+        record.worstTime = hop.worstTime;
+        record.rttSum = hop.rttSum;
+        record.srtt = m_hopRto[i].srtt();
+        record.rttvar = m_hopRto[i].rttvar();
+        std::copy(window.samples(), window.samples() + window.count(), record.recent);
+        record.detector = m_hopDetectors[i].state();
+        record.alertCount = m_alertEngine->windowSamples(i + 1, record.alerts);
+        writer.addHop(record);
+    }
+    
+    writer.addTracer(tracer);
+}
+
+bool PingTracer::resume(const SessionSnapshot& snapshot, int index)
+{
+    if (m_running || m_resolving || index < 0 || index >= snapshot.tracerCount()) {
+        return false;
+    }
+    
+    const SessionTracer& tracer = snapshot.tracer(index);
+    const AddressKey target(tracer.addressHi, tracer.addressLo);
+    if (tracer.maxHops < 1 || target == AddressKey()) {
+        return false;
+    }
+    
+    m_targetHost = snapshot.string(tracer.target);
+    m_family = static_cast<AddressFamily>(qMin<quint32>(tracer.family, static_cast<quint32>(AddressFamily::IPv6)));
+    setInterval(tracer.intervalMs);
+    setTimeout(tracer.timeoutMs);
+    setMaxHops(tracer.maxHops);
+    setFastStart(tracer.flags & SessionTracer::FastStart);
+    const quint32 protocol = qMin<quint32>(tracer.protocol, static_cast<quint32>(ProbeProtocol::Http));
+    setProbeProtocol(static_cast<ProbeProtocol>(protocol), static_cast<quint16>(qMin<quint32>(tracer.port, 65535)));
+    setApplicationProbe(snapshot.string(tracer.query), tracer.flags & SessionTracer::ReuseConnections);
+    
+    QList<AlertRule> rules;
+    const QStringList ruleLines = snapshot.string(tracer.alertRules).split('\n', Qt::SkipEmptyParts);
+    for (const QString& line : ruleLines) {
+        AlertRule rule;
+        QString error;
+        if (AlertRule::parse(line, &rule, &error)) {
+            rules.append(rule);
+        }
+    }
+    setAlertRules(rules);
+    
+    // The saved address stands in for the lookup, the path for the burst
+    resetData();
+    m_sessionTimer.start();
+    m_targetAddress = AddressTable::instance().intern(target);
+    startTraceroute(false);
+    if (!m_running) {
+        return false;
+    }
+    
+    const SessionHop* hops = snapshot.hops(index);
+    const int hopCount = qMin<int>(tracer.hopCount, m_maxHops);
+    for (int i = 0; i < hopCount; ++i) {
+        const SessionHop& record = hops[i];
+        HopData& hop = m_hopData[i];
+        const AddressKey address(record.addressHi, record.addressLo);
+        if (address != AddressKey()) {
+            hop.address = AddressTable::instance().intern(address);
+        }
+        hop.sent = record.sent;
+        hop.received = record.received;
+        hop.bestTime = record.bestTime;
+        hop.worstTime = record.worstTime;
+        hop.rttSum = record.rttSum;
+        hop.avgTime = hop.received > 0 ? hop.rttSum / hop.received : -1;
+        
+        // Known names skip the reverse lookup, here and for other tracers
+        const QString hostname = snapshot.string(record.hostname);
+        if (!hostname.isEmpty()) {
+            hop.hostname = hostname;
+            hop.reverseLookupIssued = true;
+            TopologyGraph::instance().seedHostname(hop.address, hostname);
+        }
+        
+        m_hopRto[i].restore(record.srtt, record.rttvar);
+        m_hopWindows[i].restore(record.recent, record.recentCount, record.recentNext);
+        hop.recent = m_hopWindows[i].stats();
+        m_hopDetectors[i].restore(record.detector);
+        m_alertEngine->restoreWindow(i + 1, record.alerts, record.alertCount);
+    }
+    m_alertEngine->restoreWindow(0, tracer.endToEnd, tracer.endToEndCount);
+    
+    m_destinationHop = qBound(0, static_cast<int>(tracer.destinationHop), m_maxHops);
+    m_currentHop = m_maxHops;
+    m_pathDiscovered = true;
+    m_probesSent = tracer.probesSent;
+    m_probesReceived = tracer.probesReceived;
+    m_overheadNs = 0;
+    m_overheadProbes = 0;
+    
+    publishHopData();
+    emit hopDataUpdated(m_hopData);
+    return true;
+}
+
 QList<HopData> PingTracer::getHopData() const
 {
-    QMutexLocker locker(&m_dataMutex);
-    return m_hopData;
+    // A list of the caller's own, keeping it must not pin or share a slot
+    QList<HopData> hops;
+    copyElements(hops, *m_hopSnapshot.load());
+    return hops;
+}
+
+HopSnapshot PingTracer::hopSnapshot() const
+{
+    return m_hopSnapshot.load();
 }
 
 QString PingTracer::getTarget() const
@@ -106,21 +486,170 @@ QString PingTracer::getTarget() const
     return m_targetHost;
 }
 
+int PingTracer::destinationHop() const
+{
+    return m_destinationHop;
+}
+
+PingTracer::AddressFamily PingTracer::addressFamily() const
+{
+    return m_family;
+}
+
+QString PingTracer::targetAddress() const
+{
+    return AddressTable::instance().toString(m_targetAddress);
+}
+
+ProbeScheduler::Stats PingTracer::schedulerStats() const
+{
+    return m_scheduler->stats();
+}
+
+QThread* PingTracer::networkThread() const
+{
+    return m_networkThread;
+}
+
+int PingTracer::inFlightCount() const
+{
+    return m_inFlight;
+}
+
+int PingTracer::peakInFlightCount() const
+{
+    return m_peakInFlight;
+}
+
+TraceStats PingTracer::stats() const
+{
+    TraceStats stats;
+    stats.sent = m_probesSent;
+    stats.received = m_probesReceived;
+    stats.overheadNs = m_overheadNs;
+    stats.overheadProbes = m_overheadProbes;
+    if (m_sessionTimer.isValid()) {
+        const qint64 nowMs = m_sessionTimer.elapsed();
+        stats.elapsedMs = nowMs;
+        stats.sentPerSecond = m_sentRate.rate(nowMs);
+        stats.receivedPerSecond = m_receivedRate.rate(nowMs);
+    }
+    return stats;
+}
+
+int PingTracer::hopTimeout(int hop) const
+{
+    if (!m_adaptiveTimeouts || hop < 1 || hop > m_hopRto.size()) {
+        return m_timeout;
+    }
+    
+    // m_timeout is the upper bound, a fast hop gets a shorter deadline. The
+    // floor is the RFC 6298 one second: a reply after the deadline would be
+    // counted as lost, and spikes of slow ICMP generation blow far past SRTT
+    return m_hopRto[hop - 1].timeout(qMin(m_minTimeout, m_timeout), m_timeout);
+}
+
+const SampleStore& PingTracer::sampleStore() const
+{
+    return m_sampleStore;
+}
+
 void PingTracer::resolveTarget()
 {
     m_resolving = true;
+    m_targetAddress = AddressTable::InvalidId;
     
     // Check if target is already an IP address
     QHostAddress addr(m_targetHost);
     if (!addr.isNull()) {
-        m_targetIP = m_targetHost;
+        m_resolving = false;
+        if (!acceptsFamily(addr)) {
+            emit errorOccurred("Target address does not match the selected address family");
+            return;
+        }
+        m_targetAddress = AddressTable::instance().intern(addr);
         startTraceroute();
         return;
     }
     
-    // Resolve hostname
-    m_lookupId = QHostInfo::lookupHost(m_targetHost, this, 
-                                       SLOT(onHostLookupFinished(QHostInfo)));
+    // Race the A and AAAA queries, the first family to answer gets traced
+    if (m_family != AddressFamily::IPv6) {
+        startDnsLookup(QDnsLookup::A);
+    }
+    if (m_family != AddressFamily::IPv4) {
+        startDnsLookup(QDnsLookup::AAAA);
+    }
+}
+
+void PingTracer::startDnsLookup(QDnsLookup::Type type)
+{
+    QDnsLookup* lookup = new QDnsLookup(type, m_targetHost, this);
+    if (!m_nameserver.isNull()) {
+        lookup->setNameserver(m_nameserver);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        lookup->setNameserverPort(m_nameserverPort);
+#endif
+    }
+    
+    connect(lookup, &QDnsLookup::finished, this, &PingTracer::onDnsLookupFinished);
+    m_dnsLookups.append(lookup);
+    lookup->lookup();
+}
+
+void PingTracer::onDnsLookupFinished()
+{
+    QDnsLookup* lookup = qobject_cast<QDnsLookup*>(sender());
+    if (!lookup || !m_dnsLookups.removeOne(lookup)) {
+        return; // Cancelled or lost the race
+    }
+    lookup->deleteLater();
+    
+    if (!m_resolving) {
+        return;
+    }
+    
+    const QList<QDnsHostAddressRecord> records = lookup->hostAddressRecords();
+    if (lookup->error() == QDnsLookup::NoError && !records.isEmpty()) {
+        m_resolving = false;
+        cancelLookups();
+        m_targetAddress = AddressTable::instance().intern(records.first().value());
+        startTraceroute();
+        return;
+    }
+    
+    if (m_dnsLookups.isEmpty()) {
+        // Neither query answered, fall back to the system resolver (hosts file, mDNS, ...)
+        m_lookupId = QHostInfo::lookupHost(m_targetHost, this, 
+                                           SLOT(onHostLookupFinished(QHostInfo)));
+    }
+}
+
+void PingTracer::cancelLookups()
+{
+    // abort() reports the lookup finished right away, which must not reach
+    // onDnsLookupFinished and the list while it is walked
+    for (QDnsLookup* lookup : std::exchange(m_dnsLookups, QList<QDnsLookup*>())) {
+        disconnect(lookup, nullptr, this, nullptr);
+        lookup->abort();
+        lookup->deleteLater();
+    }
+    
+    if (m_lookupId != -1) {
+        QHostInfo::abortHostLookup(m_lookupId);
+        m_lookupId = -1;
+    }
+}
+
+bool PingTracer::acceptsFamily(const QHostAddress& address) const
+{
+    switch (m_family) {
+    case AddressFamily::IPv4:
+        return address.protocol() == QAbstractSocket::IPv4Protocol;
+    case AddressFamily::IPv6:
+        return address.protocol() == QAbstractSocket::IPv6Protocol;
+    default:
+        return true;
+    }
 }
 
 void PingTracer::onHostLookupFinished(const QHostInfo& hostInfo)
@@ -130,13 +659,20 @@ void PingTracer::onHostLookupFinished(const QHostInfo& hostInfo)
     if (hostInfo.lookupId() != m_lookupId) {
         return; // Not our lookup
     }
+    m_lookupId = -1;
     
     if (hostInfo.error() != QHostInfo::NoError) {
         emit errorOccurred(QString("Failed to resolve hostname: %1").arg(hostInfo.errorString()));
         return;
     }
     
-    QList<QHostAddress> addresses = hostInfo.addresses();
+    QList<QHostAddress> addresses;
+    for (const QHostAddress& addr : hostInfo.addresses()) {
+        if (acceptsFamily(addr)) {
+            addresses.append(addr);
+        }
+    }
+    
     if (addresses.isEmpty()) {
         emit errorOccurred("No IP addresses found for hostname");
         return;
@@ -145,163 +681,521 @@ void PingTracer::onHostLookupFinished(const QHostInfo& hostInfo)
     // Prefer IPv4 addresses
     for (const QHostAddress& addr : addresses) {
         if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
-            m_targetIP = addr.toString();
+            m_targetAddress = AddressTable::instance().intern(addr);
             break;
         }
     }
     
-    if (m_targetIP.isEmpty()) {
-        m_targetIP = addresses.first().toString();
+    if (m_targetAddress == AddressTable::InvalidId) {
+        m_targetAddress = AddressTable::instance().intern(addresses.first());
     }
     
     startTraceroute();
 }
 
-void PingTracer::startTraceroute()
+void PingTracer::startTraceroute(bool discover)
 {
-    if (m_targetIP.isEmpty()) {
+    if (m_targetAddress == AddressTable::InvalidId) {
         emit errorOccurred("No target IP address available");
         return;
     }
     
     m_running = true;
+    m_session++;
     m_currentHop = 1;
+    m_destinationHop = endToEnd() ? 1 : 0;
+    m_pathDiscovered = false;
+    publishProbeConfig();
     
     // Initialize hop data
-    QMutexLocker locker(&m_dataMutex);
     m_hopData.clear();
+    m_hopAddresses.clear();
+    m_hopRto.fill(RtoEstimator(), m_maxHops);
+    m_hopDetectors.fill(ChangeDetector(m_changeConfig), m_maxHops);
+    m_hopWindows.fill(SampleWindow(), m_maxHops);
+    m_lossLocalizer.reset(m_maxHops);
+    m_mtuSweep.reset(m_maxHops);
+    m_sweepProbes = 0;
+    m_pathMtu = 0;
+    TopologyGraph::instance().clearPath(m_topologyPath);
+    m_alertEngine->reset();
+    m_hopInFlight.fill(false, m_maxHops);
+    m_inFlight = 0;
+    m_sampleStore.reset(m_maxHops);
+    m_peakInFlight = 0;
+    m_sendFailures = 0;
+    m_probesSent = 0;
+    m_probesReceived = 0;
+    m_overheadNs = 0;
+    m_overheadProbes = 0;
+    m_sentRate.reset();
+    m_receivedRate.reset();
     for (int i = 0; i < m_maxHops; ++i) {
         HopData hop;
         hop.hopNumber = i + 1;
         hop.hostname = "---";
-        hop.ipAddress = "---";
         m_hopData.append(hop);
+        m_hopAddresses.append(simulateHopIP(i + 1));
     }
-    locker.unlock();
+    publishHopData();
     
-    // Start the tracing timer
-    m_traceTimer->start(m_interval);
+    // Phases depend on the target so concurrent tracers do not align
+    const AddressKey targetKey = AddressTable::instance().key(m_targetAddress);
+    m_scheduler->setSeed(targetKey.hi ^ targetKey.lo);
+    m_scheduler->setInterval(m_interval);
+    m_scheduler->setFlowCount(m_maxHops);
     
-    // Perform initial trace
-    performTrace();
+    if (m_fastStart && discover) {
+        // Probe every TTL once up front, then settle into interval probing
+        m_currentHop = m_maxHops;
+        m_burstNextHop = 1;
+        m_burstTimer->start(m_burstPacing);
+        performBurstStep();
+    } else {
+        // Start the tracing timer and the per-hop schedule
+        m_traceTimer->start(m_interval);
+        m_scheduler->start();
+    }
+    
+    emit targetResolved(AddressTable::instance().toString(m_targetAddress), m_sessionTimer.elapsed());
 }
 
-void PingTracer::performTrace()
+void PingTracer::performBurstStep()
 {
     if (!m_running) {
+        m_burstTimer->stop();
         return;
     }
     
-    // Create network testers for each hop (simulate traceroute behavior)
-    // In a real implementation, this would use raw sockets with TTL manipulation
-    // For this demo, we'll simulate the behavior
-    
-    for (int hop = 1; hop <= qMin(m_currentHop + 3, m_maxHops); ++hop) {
-        if (hop > m_networkTesters.size()) {
-            NetworkTester* tester = new NetworkTester();
-            tester->moveToThread(m_networkThread);
-            tester->setTimeout(m_timeout);
-            
-            connect(tester, &NetworkTester::testCompleted,
-                    this, &PingTracer::onNetworkTestResult);
-            
-            m_networkTesters.append(tester);
-        }
-        
-        if (hop <= m_networkTesters.size()) {
-            NetworkTester* tester = m_networkTesters[hop - 1];
-            
-            // Simulate different IP addresses for different hops
-            QString hopIP = simulateHopIP(hop);
-            tester->setTarget(hopIP, hop);
-            
-            QMetaObject::invokeMethod(tester, "startTest", Qt::QueuedConnection);
+    // Without pacing the whole burst goes out in one step. The destination may
+    // have answered since the last step, so the limit is checked before each probe
+    const int limit = probeLimit();
+    while (m_burstNextHop <= limit) {
+        probeHop(m_burstNextHop++);
+        if (m_burstPacing > 0) {
+            break;
         }
     }
     
+    if (m_burstNextHop > limit) {
+        m_burstTimer->stop();
+        m_traceTimer->start(m_interval);
+        m_scheduler->start();
+    }
+}
+
+void PingTracer::performTrace()
+{
+    if (!m_running) {
+        return;
+    }
+    
+    // Probes are issued by m_scheduler at each hop's phase, the round
+    // timer only widens the probed range by one hop per interval
     if (m_currentHop < m_maxHops) {
         m_currentHop++;
     }
+    
+    localizeLoss();
+    
+    // A publish that found every slot pinned is retried here when no results come in
+    if (m_hopPublishPending) {
+        publishHopData();
+    }
+    
+    m_sweepProbes = 0;
+    probeSizeSweep();
+}
+
+void PingTracer::localizeLoss()
+{
+    // One pass over the path per interval, the localizer keeps no history
+    const int previousOrigin = m_lossLocalizer.originHop();
+    const int limit = probeLimit();
+    m_lossLocalizer.update(limit);
+    
+    for (int i = 0; i < limit; ++i) {
+        m_hopData[i].lossVerdict = m_lossLocalizer.verdict(i + 1);
+    }
+    
+    const int origin = m_lossLocalizer.originHop();
+    if (origin != previousOrigin) {
+        emit lossOriginChanged(origin, m_lossLocalizer.carriedLoss(origin));
+    }
+}
+
+void PingTracer::onProbeDue(int hop)
+{
+    if (!m_running || hop > qMin(m_currentHop + 3, probeLimit())) {
+        return;
+    }
+    
+    probeHop(hop);
+}
+
+void PingTracer::probeHop(int hop)
+{
+    // A hop still waiting for its last probe is not probed again
+    if (m_hopInFlight[hop - 1]) {
+        return;
+    }
+    
+    // Another target just probed this router at the same TTL, take its result
+    ProbeResult shared;
+    const HopData& known = m_hopData[hop - 1];
+    if (known.received > 0
+        && TopologyGraph::instance().borrowProbe(m_topologyPath, hop, known.address, m_interval, &shared)) {
+        applyProbeResult(shared, true);
+        return;
+    }
+    
+    // Over the shared budget, the scheduler comes back to this hop next interval
+    if (m_probeBudget && !m_probeBudget->tryAcquire()) {
+        return;
+    }
+    
+    while (hop > m_networkTesters.size()) {
+        NetworkTester* tester = new NetworkTester();
+        tester->moveToThread(m_networkThread);
+        tester->setResultQueue(&m_resultQueue, this);
+        tester->setProbeArena(m_probeArena);
+        tester->setConfigSource(&m_probeConfig);
+        m_networkTesters.append(tester);
+    }
+    
+    // Simulate different IP addresses for different hops. Every other protocol aims
+    // at the target and learns the hop from whoever answers
+    ProbeCommand command;
+    command.tester = m_networkTesters[hop - 1];
+    command.address = m_protocol == ProbeProtocol::Udp ? m_hopAddresses[hop - 1] : m_targetAddress;
+    command.hop = static_cast<quint16>(hop);
+    command.packetSize = 0;
+    command.timeoutMs = hopTimeout(hop);
+    
+    // An injected shift hits its hop and every hop behind it
+    const bool shifted = m_shiftHop > 0 && hop >= m_shiftHop && m_sessionTimer.elapsed() >= m_shiftAfterMs;
+    command.extraDelayMs = shifted ? m_shiftDelayMs : 0;
+    command.extraLossPercent = shifted ? m_shiftLossPercent : 0;
+    command.session = m_session;
+    
+    // Target and timeout travel with the command, so they are only written on the tester's thread
+    if (!m_probeDispatcher->post(command)) {
+        if (m_probeBudget) {
+            m_probeBudget->refund();
+        }
+        return;
+    }
+    
+    m_hopInFlight[hop - 1] = true;
+    m_peakInFlight = qMax(m_peakInFlight, ++m_inFlight);
+}
+
+void PingTracer::probeSizeSweep()
+{
+    // One size probe at a time and a few per interval keep the sweep light
+    if (!m_running || !m_sizeSweep || m_sweepInFlight || m_sweepProbes >= SweepProbesPerInterval) {
+        return;
+    }
+    
+    const MtuSweep::Probe probe = m_mtuSweep.next(qMin(m_currentHop, probeLimit()));
+    if (probe.hop == 0 || (m_probeBudget && !m_probeBudget->tryAcquire())) {
+        return;
+    }
+    
+    if (!m_sweepTester) {
+        m_sweepTester = new NetworkTester();
+        m_sweepTester->moveToThread(m_networkThread);
+        m_sweepTester->setResultQueue(&m_resultQueue, this);
+        m_sweepTester->setProbeArena(m_probeArena);
+        m_sweepTester->setDontFragment(true);
+    }
+    
+    ProbeCommand command;
+    command.tester = m_sweepTester;
+    command.address = m_hopAddresses[probe.hop - 1];
+    command.hop = static_cast<quint16>(probe.hop);
+    command.packetSize = static_cast<quint16>(probe.size);
+    command.timeoutMs = hopTimeout(probe.hop);
+    command.extraDelayMs = 0;
+    command.extraLossPercent = 0;
+    command.session = m_session;
+    if (!m_probeDispatcher->post(command)) {
+        if (m_probeBudget) {
+            m_probeBudget->refund();
+        }
+        return;
+    }
+    
+    m_sweepInFlight = true;
+    m_sweepProbes++;
 }
 
-QString PingTracer::simulateHopIP(int hop)
+void PingTracer::applySizeResult(const ProbeResult& result)
+{
+    m_sweepInFlight = false;
+    if (!m_running || !m_mtuSweep.record(result.hop, result.packetSize, result.status, result.rttMs())) {
+        return;
+    }
+    
+    // A result can reopen earlier hops, so every hop is refreshed
+    for (int i = 0; i < m_hopData.size(); ++i) {
+        m_hopData[i].sizeSweep = m_mtuSweep.result(i + 1);
+    }
+    
+    int limitingHop = 0;
+    const int mtu = m_mtuSweep.pathMtu(probeLimit(), &limitingHop);
+    if (mtu != m_pathMtu) {
+        m_pathMtu = mtu;
+        emit pathMtuChanged(mtu, limitingHop);
+    }
+}
+
+int PingTracer::probeLimit() const
+{
+    // Nothing beyond the destination needs probing once it has answered
+    return m_destinationHop > 0 ? m_destinationHop : m_maxHops;
+}
+
+bool PingTracer::endToEnd() const
+{
+    // Application probes, and SYNs that can not be TTL-limited, always reach the target at hop 1
+    return m_protocol == ProbeProtocol::Dns || m_protocol == ProbeProtocol::Http
+           || (m_protocol == ProbeProtocol::Tcp && !TcpProbe::supportsTtl());
+}
+
+AddressId PingTracer::simulateHopIP(int hop) const
 {
     // This is a simulation - in real implementation, this would come from actual traceroute
-    QStringList targetParts = m_targetIP.split('.');
-    if (targetParts.size() == 4) {
-        // Simulate intermediate hops
-        if (hop < m_maxHops) {
-            return QString("192.168.%1.%2").arg(hop).arg((hop * 7) % 255 + 1);
+    if (hop >= m_maxHops) {
+        return m_targetAddress; // Final destination
+    }
+    
+    // Simulate intermediate hops
+    const quint32 host = static_cast<quint32>((hop * 7) % 255 + 1);
+    if (AddressTable::instance().isIPv4(m_targetAddress)) {
+        quint32 hopIP = (192u << 24) | (168u << 16) | (static_cast<quint32>(hop) << 8) | host;
+        return AddressTable::instance().intern(AddressKey::fromIPv4(hopIP));
+    }
+    
+    // fd00:0:0:<hop>::<host>
+    return AddressTable::instance().intern(AddressKey(Q_UINT64_C(0xfd00000000000000) | static_cast<quint64>(hop), host));
+}
+
+void PingTracer::drainProbeResults()
+{
+    bool sized = false;
+    int applied = 0;
+    m_resultQueue.drain([this, &sized, &applied](const ProbeResult& result) {
+        // Left over from a run that was stopped, BatchTracer reuses its tracers
+        if (result.session != m_session) {
+            return;
+        }
+        applied++;
+        if (result.packetSize > 0) {
+            applySizeResult(result);
+            sized = true;
         } else {
-            return m_targetIP; // Final destination
+            applyProbeResult(result);
         }
+    });
+    
+    if (applied == 0 || !m_running) {
+        if (m_hopPublishPending) {
+            publishHopData();
+        }
+        return;
+    }
+    
+    // Every probe of several rounds failed to leave the host: report the
+    // target as failed rather than keep probing it
+    if (m_sendFailures >= SendFailureRounds * probeLimit()) {
+        emit errorOccurred(QString("Probes to %1 cannot be sent: no usable socket or route").arg(m_targetHost));
+        stop();
+        return;
+    }
+    
+    checkPathDiscovered();
+    
+    // Publish once per batch rather than once per probe. Listeners copy the list
+    // into buffers of their own, so m_hopData is never shared and never detaches
+    publishHopData();
+    emit hopDataUpdated(m_hopData);
+    
+    if (m_rounds > 0 && roundsComplete()) {
+        stop();
+    } else if (sized) {
+        probeSizeSweep();
     }
-    return m_targetIP;
 }
 
-void PingTracer::onNetworkTestResult(int hop, const NetworkTestResult& result)
+void PingTracer::applyProbeResult(const ProbeResult& result, bool borrowed)
 {
+    const int hop = result.hop;
     if (!m_running || hop < 1 || hop > m_hopData.size()) {
         return;
     }
     
-    QMutexLocker locker(&m_dataMutex);
+    if (m_hopInFlight[hop - 1]) {
+        m_hopInFlight[hop - 1] = false;
+        m_inFlight--;
+    }
+    
+    // Nothing left the host, so there is nothing to count. Failures in a row
+    // are counted so drainProbeResults can give up on a target none reach
+    if (result.status == ProbeStatus::SendFailed) {
+        m_sendFailures++;
+        return;
+    }
+    m_sendFailures = 0;
+    
+    if (!borrowed) {
+        TopologyGraph::instance().recordProbe(m_topologyPath, result);
+    }
     
     HopData& hopData = m_hopData[hop - 1];
     hopData.hopNumber = hop;
-    hopData.ipAddress = result.ipAddress;
+    
+    // Timeouts from a TCP probe carry no responder, the hop keeps the one it has
+    if (result.address != AddressTable::InvalidId) {
+        hopData.address = result.address;
+    }
     hopData.sent++;
     
-    if (result.success && result.responseTime >= 0) {
+    const qint64 nowMs = m_sessionTimer.elapsed();
+    m_sampleStore.add(hop, nowMs, result.success() ? result.rttMs() : -1.0);
+    
+    const ChangeDetector::Change change = m_hopDetectors[hop - 1].add(result.success() ? result.rttMs() : -1.0);
+    if (change.kind != ChangeDetector::Kind::None) {
+        emit changeDetected(hop, change.kind, change.before, change.after);
+    }
+    m_lossLocalizer.record(hop, !result.success());
+    
+    // Recent-window figures come from one vectorized pass over the hop's window
+    m_hopWindows[hop - 1].add(result.success() ? result.rttMs() : -1.0);
+    hopData.recent = m_hopWindows[hop - 1].stats();
+    
+    // Session counters move by one per result, never by re-summing hops.
+    // Borrowed results never went on the wire, so they only count for the hop
+    if (!borrowed) {
+        m_probesSent++;
+        m_sentRate.add(nowMs);
+        m_overheadNs += result.overheadNs;
+        m_overheadProbes++;
+        if (result.success()) {
+            m_probesReceived++;
+            m_receivedRate.add(nowMs);
+        }
+        
+        if (result.success()) {
+            m_hopRto[hop - 1].addSample(result.rttMs());
+        } else if (result.status == ProbeStatus::Timeout) {
+            m_hopRto[hop - 1].backoff();
+        }
+    }
+    
+    // The first hop answering from the target is the end of the path
+    if (result.success() && result.address == m_targetAddress
+        && (m_destinationHop == 0 || hop < m_destinationHop)) {
+        m_destinationHop = hop;
+    }
+    
+    // Only rules indexed under this hop (or end-to-end) are looked at
+    m_alertEngine->addSample(hop, m_destinationHop, nowMs, result.success() ? result.rttMs() : -1.0);
+    
+    if (result.success()) {
+        const double responseTime = result.rttMs();
         hopData.received++;
-        hopData.responseTimes.append(result.responseTime);
+        hopData.rttSum += responseTime;
         
         // Update statistics
-        if (hopData.bestTime < 0 || result.responseTime < hopData.bestTime) {
-            hopData.bestTime = result.responseTime;
+        if (hopData.bestTime < 0 || responseTime < hopData.bestTime) {
+            hopData.bestTime = responseTime;
         }
         
-        if (hopData.worstTime < 0 || result.responseTime > hopData.worstTime) {
-            hopData.worstTime = result.responseTime;
+        if (hopData.worstTime < 0 || responseTime > hopData.worstTime) {
+            hopData.worstTime = responseTime;
         }
         
-        // Calculate average
-        double sum = 0;
-        for (double time : hopData.responseTimes) {
-            sum += time;
-        }
-        hopData.avgTime = sum / hopData.responseTimes.size();
+        // Session average from the running sum
+        hopData.avgTime = hopData.rttSum / hopData.received;
         
-        // Resolve hostname if not already done
-        if (hopData.hostname == "---" && !result.hostname.isEmpty()) {
-            hopData.hostname = result.hostname;
-        } else if (hopData.hostname == "---") {
-            // Try to resolve hostname
-            QHostInfo::lookupHost(result.ipAddress, [this, hop](const QHostInfo& info) {
-                if (info.error() == QHostInfo::NoError && !info.hostName().isEmpty()) {
-                    QMutexLocker locker(&m_dataMutex);
-                    if (hop <= m_hopData.size()) {
-                        m_hopData[hop - 1].hostname = info.hostName();
-                    }
-                }
-            });
+        // Resolve hostname once per router, however many targets pass it
+        if (m_resolveHostnames && hopData.hostname == "---" && !hopData.reverseLookupIssued) {
+            hopData.reverseLookupIssued = true;
+            const QString hostname = TopologyGraph::instance().lookupHostname(hopData.address);
+            if (!hostname.isEmpty()) {
+                hopData.hostname = hostname;
+            }
+        }
+    }
+}
+
+void PingTracer::onHostnameResolved(AddressId address, const QString& hostname)
+{
+    bool changed = false;
+    for (HopData& hop : m_hopData) {
+        if (hop.address == address && hop.reverseLookupIssued && hop.hostname == "---") {
+            hop.hostname = hostname;
+            changed = true;
         }
     }
     
-    locker.unlock();
+    if (changed) {
+        publishHopData();
+        emit hopDataUpdated(m_hopData);
+    }
+}
+
+void PingTracer::checkPathDiscovered()
+{
+    if (m_pathDiscovered) {
+        return;
+    }
+    
+    const int limit = probeLimit();
+    for (int i = 0; i < limit; ++i) {
+        if (m_hopData[i].sent == 0) {
+            return;
+        }
+    }
     
-    // Emit updated data
-    emit hopDataUpdated(getHopData());
+    m_pathDiscovered = true;
+    emit pathDiscovered(limit, m_sessionTimer.elapsed());
 }
 
-void PingTracer::resetData()
+bool PingTracer::roundsComplete() const
 {
-    QMutexLocker locker(&m_dataMutex);
-    m_hopData.clear();
-    m_currentHop = 1;
+    const int limit = probeLimit();
+    for (int i = 0; i < limit; ++i) {
+        if (m_hopData[i].sent < m_rounds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PingTracer::publishHopData()
+{
+    // Copied into the publisher's own buffers, m_hopData is never shared. With every
+    // slot pinned by readers nothing is published, the next drain or interval retries
+    m_hopPublishPending = !m_hopSnapshot.publish(m_hopData);
+}
+
+void PingTracer::publishProbeConfig()
+{
+    // Testers pick the settings up with their next probe
+    ProbeConfig config;
+    config.protocol = m_protocol;
+    config.port = m_probePort;
+    config.host = m_targetHost;
+    config.query = m_appQuery;
+    config.reuseConnection = m_reuseConnections;
+    m_probeConfig.publish(config);
 }
 
-void PingTracer::updateStatistics()
+void PingTracer::resetData()
 {
-    // Statistics are updated in onNetworkTestResult
+    m_hopData.clear();
+    publishHopData();
+    m_currentHop = 1;
 }
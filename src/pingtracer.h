@@ -3,32 +3,87 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QThread>
-#include <QMutex>
 #include <QHostInfo>
+#include <QDnsLookup>
 #include <QString>
 #include <QList>
+#include <QVector>
 #include "networktester.h"
+#include "snapshotpublisher.h"
+#include "probescheduler.h"
+#include "rtoestimator.h"
+#include "samplestore.h"
+#include "ratecounter.h"
+#include "changedetector.h"
+#include "alertengine.h"
+#include "losslocalizer.h"
+#include "windowstats.h"
+#include "probebudget.h"
+#include "topologygraph.h"
+#include "sessionsnapshot.h"
+#include "mtusweep.h"
 
 struct HopData {
     int hopNumber;
     QString hostname;
-    QString ipAddress;
+    AddressId address;
     int sent;
     int received;
     double bestTime;
     double avgTime;
     double worstTime;
-    QList<double> responseTimes;
+    double rttSum;
+    WindowStats recent;     // Last SampleWindow::Capacity results
+    bool reverseLookupIssued;
+    LossLocalizer::Verdict lossVerdict;
+    MtuSweep::HopResult sizeSweep;
     
-    HopData() : hopNumber(0), sent(0), received(0), bestTime(-1), avgTime(-1), worstTime(-1) {}
+    HopData() : hopNumber(0), address(AddressTable::InvalidId), sent(0), received(0), bestTime(-1), avgTime(-1), worstTime(-1), rttSum(0), reverseLookupIssued(false), lossVerdict(LossLocalizer::Verdict::None) {}
 };
 
-class PingTracer : public QObject
+using HopSnapshot = SnapshotPublisher<QList<HopData>>::Snapshot;
+
+// Probe counters for one traced target, kept incrementally as results arrive
+struct TraceStats {
+    quint64 sent;
+    quint64 received;
+    double sentPerSecond;
+    double receivedPerSecond;
+    qint64 elapsedMs;
+    quint64 overheadNs;     // Tester time spent on overheadProbes probes
+    quint64 overheadProbes;
+    
+    TraceStats() : sent(0), received(0), sentPerSecond(0), receivedPerSecond(0), elapsedMs(0), overheadNs(0), overheadProbes(0) {}
+    
+    double lossPercent() const { return sent > 0 ? 100.0 * (sent - received) / sent : 0.0; }
+    double overheadUsPerProbe() const { return overheadProbes > 0 ? overheadNs / 1000.0 / overheadProbes : 0.0; }
+    
+    TraceStats& operator+=(const TraceStats& other)
+    {
+        sent += other.sent;
+        received += other.received;
+        sentPerSecond += other.sentPerSecond;
+        receivedPerSecond += other.receivedPerSecond;
+        elapsedMs = qMax(elapsedMs, other.elapsedMs);
+        overheadNs += other.overheadNs;
+        overheadProbes += other.overheadProbes;
+        return *this;
+    }
+};
+
+class PingTracer : public QObject, private ResultCollector::Sink
 {
     Q_OBJECT
 
 public:
+    enum class AddressFamily {
+        Any,    // Race A and AAAA, trace whichever answers first
+        IPv4,
+        IPv6
+    };
+
     explicit PingTracer(QObject *parent = nullptr);
     ~PingTracer();
     
@@ -37,53 +92,184 @@ public:
     void setInterval(int intervalMs);
     void setTimeout(int timeoutMs);
     void setMaxHops(int maxHops);
+    void setFastStart(bool enabled);
+    void setBurstPacing(int pacingMs);
+    void setAddressFamily(AddressFamily family);
+    // False for a port other than 53 before Qt 6.6, which can not send lookups to one
+    bool setNameserver(const QHostAddress& nameserver, quint16 port = 53);
+    void setPhaseJitter(double fraction);
+    void setAdaptiveTimeouts(bool enabled);
+    void setChangeSensitivity(double threshold);
+    void setAlertRules(const QList<AlertRule>& rules);
+    // Stop by itself once every hop on the path has been probed this often, 0 runs until stop()
+    void setRounds(int rounds);
+    // Shared cap on the probe rate, probes over budget wait for the hop's next turn
+    void setProbeBudget(ProbeBudget* budget);
+    void setResolveHostnames(bool enabled);
+    // DF probes at varying sizes for each hop's MTU and link bandwidth, alongside normal probing
+    void setSizeSweep(bool enabled);
+    // TCP probes time the handshake to port, hop by hop where the platform allows a TTL-limited SYN.
+    // DNS and HTTP probes time the target's answer end to end. Port 0 is the protocol's well-known one
+    void setProbeProtocol(ProbeProtocol protocol, quint16 port = 0);
+    // DNS name to query (default: the target's own name) or HTTP path to fetch (default: /)
+    void setApplicationProbe(const QString& query, bool reuseConnections);
+    // Simulation only: from afterMs into the session, hop and everything behind it gets slower and lossier
+    void setSimulatedShift(int hop, qint64 afterMs, int extraDelayMs, int extraLossPercent);
     
     // Control
     bool start();
     void stop();
     bool isRunning() const;
     
+    // Session persistence
+    void saveState(SessionWriter& writer) const;
+    // Continues tracer index of a snapshot without resolving or rediscovering the path
+    bool resume(const SessionSnapshot& snapshot, int index);
+    
     // Data access
     QList<HopData> getHopData() const;
+    HopSnapshot hopSnapshot() const;
     QString getTarget() const;
+    int destinationHop() const;
+    AddressFamily addressFamily() const;
+    QString targetAddress() const;
+    ProbeScheduler::Stats schedulerStats() const;
+    int inFlightCount() const;
+    // Shared by every tracer of the process
+    QThread* networkThread() const;
+    int peakInFlightCount() const;
+    int hopTimeout(int hop) const;
+    const SampleStore& sampleStore() const;
+    TraceStats stats() const;
+    double changeSensitivity() const;
+    AlertEngine* alertEngine() const;
 
 signals:
+    // hops is the tracer's own list, valid during the call. Copy it with copyElements()
+    // rather than keeping a shared copy, which would make the tracer's next change reallocate
     void hopDataUpdated(const QList<HopData>& hops);
     void errorOccurred(const QString& error);
     void finished();
+    // The target resolved and its first probe went out
+    void targetResolved(const QString& address, qint64 timeToFirstProbeMs);
+    // Every hop up to the destination (or m_maxHops) has been probed once
+    void pathDiscovered(int hopCount, qint64 elapsedMs);
+    // A hop's latency or loss level shifted; before/after are ms or loss fractions
+    void changeDetected(int hop, ChangeDetector::Kind kind, double before, double after);
+    // Forwarding loss now starts at hop (0 when it went away)
+    void lossOriginChanged(int hop, double lossPercent);
+    // The smallest MTU found on the path and the first hop limited to it
+    void pathMtuChanged(int mtu, int hop);
 
 private slots:
     void performTrace();
+    void performBurstStep();
+    void onProbeDue(int hop);
     void onHostLookupFinished(const QHostInfo& hostInfo);
-    void onNetworkTestResult(int hop, const NetworkTestResult& result);
+    void onDnsLookupFinished();
+    void onHostnameResolved(AddressId address, const QString& hostname);
 
 private:
     void resolveTarget();
+    void startDnsLookup(QDnsLookup::Type type);
+    void cancelLookups();
+    bool acceptsFamily(const QHostAddress& address) const;
     void resetData();
-    void updateStatistics();
-    void startTraceroute();
+    void startTraceroute(bool discover = true);
+    void publishHopData();
+    void publishProbeConfig();
+    // Woken by this thread's ResultCollector when testers queued results
+    void drainProbeResults() override;
+    AddressId simulateHopIP(int hop) const;
+    void applyProbeResult(const ProbeResult& result, bool borrowed = false);
+    void probeHop(int hop);
+    int probeLimit() const;
+    bool endToEnd() const;
+    void checkPathDiscovered();
+    bool roundsComplete() const;
+    void localizeLoss();
+    void probeSizeSweep();
+    void applySizeResult(const ProbeResult& result);
     
     // Configuration
     QString m_targetHost;
-    QString m_targetIP;
+    AddressId m_targetAddress;
     int m_interval;
     int m_timeout;
+    int m_minTimeout;
+    bool m_adaptiveTimeouts;
+    ChangeDetector::Config m_changeConfig;
+    int m_shiftHop;
+    qint64 m_shiftAfterMs;
+    int m_shiftDelayMs;
+    int m_shiftLossPercent;
+    int m_rounds;
+    ProbeBudget* m_probeBudget;
+    bool m_resolveHostnames;
     int m_maxHops;
+    bool m_fastStart;
+    int m_burstPacing;
+    AddressFamily m_family;
+    QHostAddress m_nameserver;
+    quint16 m_nameserverPort;
+    ProbeProtocol m_protocol;
+    quint16 m_probePort;
+    QString m_appQuery;
+    bool m_reuseConnections;
     
     // State
     bool m_running;
     bool m_resolving;
     QTimer* m_traceTimer;
-    QMutex m_dataMutex;
+    QTimer* m_burstTimer;
+    ProbeScheduler* m_scheduler;
+    AlertEngine* m_alertEngine;
+    int m_burstNextHop;
+    int m_destinationHop;
+    bool m_pathDiscovered;
+    QElapsedTimer m_sessionTimer;
+    quint32 m_session;          // Bumped per run, results of an earlier run are dropped
     
-    // Data
+    // Data (m_hopData is private to the tracer thread, readers go through m_hopSnapshot)
     QList<HopData> m_hopData;
+    QVector<AddressId> m_hopAddresses;
+    QVector<RtoEstimator> m_hopRto;
+    QVector<ChangeDetector> m_hopDetectors;
+    QVector<SampleWindow> m_hopWindows;
+    LossLocalizer m_lossLocalizer;
+    MtuSweep m_mtuSweep;
+    bool m_sizeSweep;
+    NetworkTester* m_sweepTester;   // Sends every size probe, one at a time
+    bool m_sweepInFlight;
+    int m_sweepProbes;              // Size probes sent this interval
+    int m_pathMtu;
+    int m_topologyPath;
+    QVector<bool> m_hopInFlight;
+    int m_inFlight;
+    int m_peakInFlight;
+    quint64 m_probesSent;
+    quint64 m_probesReceived;
+    int m_sendFailures;         // Results in a row whose probe never left the host
+    quint64 m_overheadNs;
+    quint64 m_overheadProbes;   // Probes sent this run, a restored session has no overhead figures
+    RateCounter m_sentRate;
+    RateCounter m_receivedRate;
+    SnapshotPublisher<QList<HopData>> m_hopSnapshot;
+    bool m_hopPublishPending;       // Last publish found every slot pinned
+    SampleStore m_sampleStore;
     int m_currentHop;
     int m_lookupId;
+    QList<QDnsLookup*> m_dnsLookups;
     
     // Network testing
+    static constexpr int SweepProbesPerInterval = 8;
+    static constexpr int SendFailureRounds = 3;   // Rounds of nothing getting out before the target fails
     QList<NetworkTester*> m_networkTesters;
-    QThread* m_networkThread;
+    ProbeDispatcher* m_probeDispatcher;
+    SnapshotPublisher<ProbeConfig> m_probeConfig;
+    ProbeResultQueue m_resultQueue;
+    ProbeArena* m_probeArena;
+    QThread* m_networkThread;       // Shared, see networkThread()
 };
 
 #endif // PINGTRACER_H
@@ -0,0 +1,123 @@
+#ifndef PROBEARENA_H
+#define PROBEARENA_H
+
+#include <QtGlobal>
+#include <chrono>
+#include <cstring>
+#include "addresstable.h"
+
+// Monotonic clock used for binary probe timestamps
+inline qint64 probeClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// State of one in-flight probe, including its preformatted packet.
+//
+// Packet layout: "PING" | sequence (2 bytes) | send timestamp (8 bytes, ns)
+// followed by padding up to packetSize. Only the sequence and timestamp are
+// patched per send.
+struct ProbeContext {
+    static constexpr int MagicSize = 4;
+    static constexpr int SequenceOffset = MagicSize;
+    static constexpr int TimestampOffset = SequenceOffset + sizeof(quint16);
+    static constexpr int HeaderSize = TimestampOffset + sizeof(qint64);
+    static constexpr int PacketCapacity = 64;
+
+    qint64 sendTimeNs;
+    AddressId address;
+    quint16 sequence;
+    quint16 hop;
+    int packetSize;
+    ProbeContext* nextFree;
+    char packet[PacketCapacity];
+
+    void stamp(quint16 seq, qint64 nowNs)
+    {
+        sequence = seq;
+        sendTimeNs = nowNs;
+        std::memcpy(packet + SequenceOffset, &seq, sizeof(seq));
+        std::memcpy(packet + TimestampOffset, &nowNs, sizeof(nowNs));
+    }
+
+    // True if data echoes this probe's header
+    bool matches(const char* data, qint64 size) const
+    {
+        return size >= HeaderSize && std::memcmp(data, packet, HeaderSize) == 0;
+    }
+};
+
+// Slab of probe contexts owned by one network worker thread.
+//
+// All contexts and their packet buffers are allocated up front and recycled
+// through an intrusive free list, so setting up a probe never allocates or
+// formats strings. Not thread-safe: only the owning worker may use it.
+class ProbeArena
+{
+public:
+    explicit ProbeArena(int capacity = 1024)
+        : m_contexts(new ProbeContext[capacity])
+        , m_capacity(capacity)
+        , m_freeList(nullptr)
+        , m_inUse(0)
+        , m_exhausted(0)
+    {
+        for (int i = capacity - 1; i >= 0; --i) {
+            ProbeContext& ctx = m_contexts[i];
+            std::memset(ctx.packet, 0, sizeof(ctx.packet));
+            std::memcpy(ctx.packet, "PING", ProbeContext::MagicSize);
+            ctx.packetSize = ProbeContext::HeaderSize;
+            ctx.sendTimeNs = 0;
+            ctx.address = AddressTable::InvalidId;
+            ctx.sequence = 0;
+            ctx.hop = 0;
+            ctx.nextFree = m_freeList;
+            m_freeList = &ctx;
+        }
+    }
+
+    ~ProbeArena()
+    {
+        delete[] m_contexts;
+    }
+
+    ProbeArena(const ProbeArena&) = delete;
+    ProbeArena& operator=(const ProbeArena&) = delete;
+
+    ProbeContext* acquire()
+    {
+        ProbeContext* ctx = m_freeList;
+        if (!ctx) {
+            ++m_exhausted;
+            return nullptr;
+        }
+        m_freeList = ctx->nextFree;
+        ctx->nextFree = nullptr;
+        ++m_inUse;
+        return ctx;
+    }
+
+    void release(ProbeContext* ctx)
+    {
+        if (!ctx) {
+            return;
+        }
+        ctx->nextFree = m_freeList;
+        m_freeList = ctx;
+        --m_inUse;
+    }
+
+    int capacity() const { return m_capacity; }
+    int inUse() const { return m_inUse; }
+    quint64 exhaustedCount() const { return m_exhausted; }
+
+private:
+    ProbeContext* m_contexts;
+    int m_capacity;
+    ProbeContext* m_freeList;
+    int m_inUse;
+    quint64 m_exhausted;
+};
+
+#endif // PROBEARENA_H
@@ -0,0 +1,74 @@
+#ifndef PROBEBUDGET_H
+#define PROBEBUDGET_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+
+// Token bucket shared by every tracer of a batch, capping the total probe
+// rate however many traces run at once. Tokens refill continuously and up to
+// a tenth of a second of probes may go out back to back. Used from the
+// thread the tracers live on, so it takes no lock.
+class ProbeBudget
+{
+public:
+    // probesPerSecond <= 0 means unlimited
+    explicit ProbeBudget(double probesPerSecond = 0) { setRate(probesPerSecond); }
+
+    void setRate(double probesPerSecond)
+    {
+        m_rate = probesPerSecond;
+        m_capacity = qMax(1.0, m_rate / 10.0);
+        m_tokens = m_capacity;
+        m_granted = 0;
+        m_denied = 0;
+        m_clock.start();
+        m_lastNs = 0;
+    }
+
+    bool tryAcquire()
+    {
+        if (m_rate <= 0) {
+            m_granted++;
+            return true;
+        }
+
+        const qint64 nowNs = m_clock.nsecsElapsed();
+        m_tokens = qMin(m_capacity, m_tokens + (nowNs - m_lastNs) * m_rate / 1e9);
+        m_lastNs = nowNs;
+
+        if (m_tokens < 1.0) {
+            m_denied++;
+            return false;
+        }
+        m_tokens -= 1.0;
+        m_granted++;
+        return true;
+    }
+
+    // Hands back a token for a probe that was granted but never went out
+    void refund()
+    {
+        if (m_granted == 0) {
+            return;
+        }
+        m_granted--;
+        if (m_rate > 0) {
+            m_tokens = qMin(m_capacity, m_tokens + 1.0);
+        }
+    }
+
+    double rate() const { return m_rate; }
+    quint64 granted() const { return m_granted; }
+    quint64 denied() const { return m_denied; }
+
+private:
+    double m_rate;
+    double m_capacity;
+    double m_tokens;
+    quint64 m_granted;
+    quint64 m_denied;
+    QElapsedTimer m_clock;
+    qint64 m_lastNs;
+};
+
+#endif // PROBEBUDGET_H
@@ -0,0 +1,111 @@
+#ifndef PROBERESULTQUEUE_H
+#define PROBERESULTQUEUE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <type_traits>
+#include "addresstable.h"
+
+enum class ProbeStatus : quint8 {
+    Success,
+    Timeout,
+    SocketError,
+    SendFailed,
+    TooBig          // Size probe over the MTU, rejected with DF set
+};
+
+// Compact, trivially copyable record for one probe outcome.
+// Strings are only produced at the UI/export edge.
+struct ProbeResult {
+    qint64 rttNs;           // -1 if no reply
+    AddressId address;
+    quint16 hop;
+    quint16 sequence;
+    quint16 packetSize;     // IP packet size of a size probe, 0 for regular probes
+    ProbeStatus status;
+    quint8 socketError;     // QAbstractSocket::SocketError when status == SocketError
+    quint32 overheadNs;     // Time the tester itself spent sending and matching the probe
+    quint32 session;        // Tracer session the probe was sent in, see ProbeCommand
+
+    bool success() const { return status == ProbeStatus::Success && rttNs >= 0; }
+    double rttMs() const { return rttNs >= 0 ? rttNs / 1000000.0 : -1.0; }
+};
+
+static_assert(std::is_trivially_copyable<ProbeResult>::value,
+              "ProbeResult must stay a POD so batches can be moved without allocation");
+
+// Single-producer/single-consumer ring of trivially copyable records.
+//
+// Carries probe results from a tracer's testers, which all live on its
+// network thread, to the tracer that drains everything in one go on its own
+// thread, and probe commands the other way. The storage is allocated once, so
+// steady-state probing does not touch the heap. A wake flag coalesces
+// notifications so the producer signals at most once per drained batch
+// instead of once per record.
+template <typename T, quint32 Capacity>
+class ProbeQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "Records are copied into the ring as plain bytes");
+
+public:
+    ProbeQueue() : m_head(0), m_tail(0), m_wakePending(false), m_dropped(0) {}
+
+    ProbeQueue(const ProbeQueue&) = delete;
+    ProbeQueue& operator=(const ProbeQueue&) = delete;
+
+    // Producer side. Returns true if the consumer has to be woken up.
+    bool push(const T& record)
+    {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= Capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_ring[tail & (Capacity - 1)] = record;
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return !m_wakePending.exchange(true, std::memory_order_acq_rel);
+    }
+
+    // Producer side. Only the consumer frees space, so a push right after
+    // a false return is never dropped.
+    bool isFull() const
+    {
+        return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire) >= Capacity;
+    }
+
+    // Consumer side. Calls fn(const T&) for every queued record
+    // and returns how many were consumed.
+    template <typename Fn>
+    int drain(Fn&& fn)
+    {
+        // Clear before reading so a push racing with the drain re-arms the wake
+        m_wakePending.store(false, std::memory_order_release);
+
+        quint32 head = m_head.load(std::memory_order_relaxed);
+        const quint32 tail = m_tail.load(std::memory_order_acquire);
+        const int count = static_cast<int>(tail - head);
+
+        for (; head != tail; ++head) {
+            fn(m_ring[head & (Capacity - 1)]);
+        }
+
+        m_head.store(head, std::memory_order_release);
+        return count;
+    }
+
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    T m_ring[Capacity];
+    alignas(64) std::atomic<quint32> m_head;
+    alignas(64) std::atomic<quint32> m_tail;
+    std::atomic<bool> m_wakePending;
+    std::atomic<quint64> m_dropped;
+};
+
+using ProbeResultQueue = ProbeQueue<ProbeResult, 4096>;
+
+#endif // PROBERESULTQUEUE_H
@@ -0,0 +1,173 @@
+#include "probescheduler.h"
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+// Half a millisecond of slack absorbs timer rounding
+constexpr qint64 SlackNs = 500000;
+
+}
+
+ProbeScheduler::ProbeScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_intervalNs(Q_INT64_C(1000000000))
+    , m_jitter(0.0)
+    , m_seed(0)
+    , m_flowCount(0)
+    , m_currentMs(-1)
+    , m_currentMsCount(0)
+{
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &ProbeScheduler::onTimer);
+}
+
+void ProbeScheduler::setInterval(int intervalMs)
+{
+    const qint64 intervalNs = static_cast<qint64>(qMax(1, intervalMs)) * 1000000;
+    if (intervalNs == m_intervalNs) {
+        return;
+    }
+    m_intervalNs = intervalNs;
+
+    // Re-phase running flows against the new interval
+    if (isActive()) {
+        start();
+    }
+}
+
+void ProbeScheduler::setJitter(double fraction)
+{
+    m_jitter = qBound(0.0, fraction, 0.5);
+}
+
+void ProbeScheduler::setSeed(quint64 seed)
+{
+    m_seed = seed;
+}
+
+void ProbeScheduler::setFlowCount(int count)
+{
+    m_flowCount = qMax(0, count);
+    m_heap.reserve(m_flowCount);
+}
+
+void ProbeScheduler::start()
+{
+    m_heap.clear();
+    m_clock.start();
+    m_stats = Stats();
+    m_currentMs = -1;
+    m_currentMsCount = 0;
+
+    for (int flow = 1; flow <= m_flowCount; ++flow) {
+        schedule(flow, static_cast<qint64>(phaseFor(m_seed, flow) * m_intervalNs));
+    }
+
+    if (m_heap.empty()) {
+        m_timer->stop();
+    } else {
+        m_timer->start(tickMs());
+    }
+}
+
+void ProbeScheduler::stop()
+{
+    m_timer->stop();
+    m_heap.clear();
+}
+
+bool ProbeScheduler::isActive() const
+{
+    return !m_heap.empty();
+}
+
+ProbeScheduler::Stats ProbeScheduler::stats() const
+{
+    Stats stats = m_stats;
+    stats.elapsedMs = m_clock.isValid() ? m_clock.elapsed() : 0;
+    return stats;
+}
+
+double ProbeScheduler::phaseFor(quint64 seed, int flow)
+{
+    // splitmix64 gives each target its own starting point...
+    quint64 h = seed + Q_UINT64_C(0x9e3779b97f4a7c15);
+    h = (h ^ (h >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+    h ^= h >> 31;
+    const double offset = static_cast<double>(h >> 11) / static_cast<double>(Q_UINT64_C(1) << 53);
+
+    // ...and the golden-ratio sequence spreads a target's hops evenly from there
+    const double phase = offset + flow * 0.6180339887498949;
+    return phase - std::floor(phase);
+}
+
+void ProbeScheduler::schedule(int flow, qint64 nominalNs)
+{
+    Entry entry;
+    entry.nominalNs = nominalNs;
+    entry.dueNs = nominalNs;
+    entry.flow = flow;
+
+    if (m_jitter > 0.0) {
+        const double spread = (QRandomGenerator::global()->generateDouble() - 0.5) * m_jitter;
+        entry.dueNs += static_cast<qint64>(spread * m_intervalNs);
+    }
+
+    m_heap.push_back(entry);
+    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+}
+
+int ProbeScheduler::tickMs() const
+{
+    return static_cast<int>(qMax<qint64>(1, m_intervalNs / 1000000 / qMax(1, m_flowCount)));
+}
+
+void ProbeScheduler::onTimer()
+{
+    fireDue(m_clock.nsecsElapsed());
+}
+
+void ProbeScheduler::fireDue(qint64 nowNs)
+{
+    // Fire everything due now
+    while (!m_heap.empty() && m_heap.front().dueNs <= nowNs + SlackNs) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        const Entry entry = m_heap.back();
+        m_heap.pop_back();
+
+        // After a stall the next slot may be gone already, those are skipped
+        // rather than fired back to back, the flow keeps its phase
+        qint64 nextNs = entry.nominalNs + m_intervalNs;
+        if (nextNs <= nowNs + SlackNs) {
+            const qint64 missed = (nowNs + SlackNs - nextNs) / m_intervalNs + 1;
+            nextNs += missed * m_intervalNs;
+            m_stats.skipped += static_cast<quint64>(missed);
+        }
+        schedule(entry.flow, nextNs);
+        recordFiring(nowNs);
+
+        emit flowDue(entry.flow);
+
+        // A slot may have stopped us
+        if (m_heap.empty()) {
+            return;
+        }
+    }
+}
+
+void ProbeScheduler::recordFiring(qint64 nowNs)
+{
+    const qint64 nowMs = nowNs / 1000000;
+    if (nowMs != m_currentMs) {
+        m_currentMs = nowMs;
+        m_currentMsCount = 0;
+    }
+
+    m_stats.fired++;
+    m_stats.peakPerMs = qMax(m_stats.peakPerMs, ++m_currentMsCount);
+}
@@ -0,0 +1,88 @@
+#ifndef PROBESCHEDULER_H
+#define PROBESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+
+// Spreads periodic probe flows evenly over the probing interval.
+//
+// Each flow (one hop of one target) gets a stable phase offset inside the
+// interval, derived from the target seed and a golden-ratio sequence, so the
+// hops of a target and different targets do not all fire on the same tick.
+// Optional jitter randomizes each firing around its nominal slot. A single
+// precise timer ticks once per flow spacing (interval / flows) and fires
+// whatever is due, so a flow goes out at most one tick after its slot. The
+// timer is never re-armed while running: every re-arm registers a new timer
+// with the event loop, which allocates. Slots a stalled loop missed are
+// skipped, each flow fires once when it catches up rather than once per slot.
+class ProbeScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 fired;
+        quint64 skipped;    // slots missed while the event loop stalled
+        quint32 peakPerMs;  // most flows fired within one millisecond
+        qint64 elapsedMs;
+
+        Stats() : fired(0), skipped(0), peakPerMs(0), elapsedMs(0) {}
+        double meanPerMs() const { return elapsedMs > 0 ? static_cast<double>(fired) / elapsedMs : 0.0; }
+    };
+
+    explicit ProbeScheduler(QObject *parent = nullptr);
+
+    void setInterval(int intervalMs);
+    void setJitter(double fraction);
+    void setSeed(quint64 seed);
+    void setFlowCount(int count);
+
+    void start();
+    void stop();
+    bool isActive() const;
+
+    Stats stats() const;
+
+    // Fires every flow due at nowNs, counted from start(). The timer passes its
+    // clock; a benchmark can step virtual time instead of processing events
+    void fireDue(qint64 nowNs);
+
+    // Stable phase of a flow as a fraction of the interval, in [0, 1)
+    static double phaseFor(quint64 seed, int flow);
+
+signals:
+    void flowDue(int flow);
+
+private slots:
+    void onTimer();
+
+private:
+    struct Entry {
+        qint64 nominalNs;   // Slot without jitter, keeps flows from drifting
+        qint64 dueNs;
+        int flow;
+
+        bool operator>(const Entry& other) const { return dueNs > other.dueNs; }
+    };
+
+    void schedule(int flow, qint64 nominalNs);
+    int tickMs() const;
+    void recordFiring(qint64 nowNs);
+
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    std::vector<Entry> m_heap;
+    qint64 m_intervalNs;
+    double m_jitter;
+    quint64 m_seed;
+    int m_flowCount;
+
+    // Firing statistics
+    qint64 m_currentMs;
+    quint32 m_currentMsCount;
+    Stats m_stats;
+};
+
+#endif // PROBESCHEDULER_H
@@ -0,0 +1,68 @@
+#ifndef RATECOUNTER_H
+#define RATECOUNTER_H
+
+#include <QtGlobal>
+
+// Events per second over a sliding window of whole seconds.
+// Counts go into a small ring of one-second slots, so adding and reading are O(1).
+class RateCounter
+{
+public:
+    static constexpr int WindowSeconds = 5;
+
+    RateCounter() { reset(); }
+
+    void reset()
+    {
+        for (int i = 0; i < SlotCount; ++i) {
+            m_slots[i] = 0;
+            m_seconds[i] = -1;
+        }
+        m_startMs = -1;
+    }
+
+    void add(qint64 nowMs, quint32 count = 1)
+    {
+        if (m_startMs < 0) {
+            m_startMs = nowMs;
+        }
+
+        const qint64 second = nowMs / 1000;
+        const int slot = static_cast<int>(second % SlotCount);
+        if (m_seconds[slot] != second) {
+            m_seconds[slot] = second;
+            m_slots[slot] = 0;
+        }
+        m_slots[slot] += count;
+    }
+
+    // Rate over the last WindowSeconds, or over the time since the first event if shorter
+    double rate(qint64 nowMs) const
+    {
+        if (m_startMs < 0) {
+            return 0.0;
+        }
+
+        const qint64 second = nowMs / 1000;
+        quint64 total = 0;
+        for (int i = 0; i < SlotCount; ++i) {
+            if (m_seconds[i] > second - WindowSeconds && m_seconds[i] <= second) {
+                total += m_slots[i];
+            }
+        }
+
+        // The window ends now and starts at the oldest counted second (or the first event)
+        const qint64 windowStartMs = qMax((second - WindowSeconds + 1) * 1000, m_startMs);
+        const qint64 spanMs = qMax<qint64>(1000, nowMs - windowStartMs);
+        return total * 1000.0 / spanMs;
+    }
+
+private:
+    static constexpr int SlotCount = WindowSeconds + 1;
+
+    quint32 m_slots[SlotCount];
+    qint64 m_seconds[SlotCount];
+    qint64 m_startMs;
+};
+
+#endif // RATECOUNTER_H
@@ -0,0 +1,154 @@
+#include "resultstable.h"
+#include <QColor>
+
+namespace {
+
+// Item roles are only written when they differ, each write notifies the view
+void setToolTip(QTableWidgetItem* item, const QString& toolTip)
+{
+    if (item->toolTip() != toolTip) {
+        item->setToolTip(toolTip);
+    }
+}
+
+void setBackground(QTableWidgetItem* item, const QColor& color)
+{
+    if (item->background().color() != color) {
+        item->setBackground(color);
+    }
+}
+
+}
+
+bool ResultsTable::update(QTableWidget* table, const QList<HopData>& shown, const QList<HopData>& hops)
+{
+    bool changed = false;
+    if (table->rowCount() != hops.size()) {
+        table->setRowCount(hops.size());
+        changed = true;
+    }
+
+    for (int i = 0; i < hops.size(); ++i) {
+        const HopData& hop = hops[i];
+
+        // Only rows whose figures moved since the last frame are looked at
+        if (i < shown.size() && table->item(i, 0) && !rowChanged(shown[i], hop)) {
+            continue;
+        }
+
+        // Hop number
+        setCell(table, i, 0, QString::number(hop.hopNumber), Qt::AlignCenter, &changed);
+
+        // Hostname
+        setCell(table, i, 1, hop.hostname, Qt::AlignLeft | Qt::AlignVCenter, &changed);
+
+        // IP Address, with what the size sweep found for the link into this hop
+        QTableWidgetItem* addressItem = setCell(table, i, 2, AddressTable::instance().toString(hop.address),
+                                                Qt::AlignLeft | Qt::AlignVCenter, &changed);
+        const MtuSweep::HopResult& sweep = hop.sizeSweep;
+        QString sweepTip;
+        if (sweep.mtu > 0) {
+            sweepTip = QString(sweep.mtuFinal ? "MTU %1 bytes" : "MTU at least %1 bytes").arg(sweep.mtu);
+        }
+        if (sweep.linkMbps > 0) {
+            sweepTip += QString(", link about %1 Mbit/s (%2 us per byte)")
+                        .arg(sweep.linkMbps, 0, 'f', 1)
+                        .arg(sweep.linkMsPerByte * 1000.0, 0, 'f', 3);
+        }
+        setToolTip(addressItem, sweepTip);
+
+        // Loss percentage
+        double lossPercent = hop.sent > 0 ? ((double)(hop.sent - hop.received) / hop.sent) * 100.0 : 0.0;
+        QTableWidgetItem* lossItem = setCell(table, i, 3, QString::number(lossPercent, 'f', 1), Qt::AlignCenter,
+                                             &changed);
+
+        // Color code based on packet loss; loss that later hops do not show
+        // is the router limiting its ICMP replies, not dropping traffic
+        if (hop.lossVerdict == LossLocalizer::Verdict::RateLimited) {
+            setBackground(lossItem, QColor(220, 220, 220)); // Light grey
+        } else if (lossPercent > 50) {
+            setBackground(lossItem, QColor(255, 200, 200)); // Light red
+        } else if (lossPercent > 10) {
+            setBackground(lossItem, QColor(255, 255, 200)); // Light yellow
+        } else {
+            setBackground(lossItem, QColor(200, 255, 200)); // Light green
+        }
+
+        switch (hop.lossVerdict) {
+        case LossLocalizer::Verdict::RateLimited:
+            setToolTip(lossItem, "ICMP rate limiting: later hops do not show this loss");
+            break;
+        case LossLocalizer::Verdict::LossOrigin:
+            setToolTip(lossItem, "Forwarding loss starts at this hop");
+            break;
+        case LossLocalizer::Verdict::Downstream:
+            setToolTip(lossItem, "Carries forwarding loss from an earlier hop");
+            break;
+        case LossLocalizer::Verdict::None:
+            setToolTip(lossItem, QString());
+            break;
+        }
+
+        // Sent packets
+        setCell(table, i, 4, QString::number(hop.sent), Qt::AlignCenter, &changed);
+
+        // Best time
+        setCell(table, i, 5, hop.bestTime >= 0 ? QString::number(hop.bestTime, 'f', 1) + " ms" : "---",
+                Qt::AlignCenter, &changed);
+
+        // Average time
+        QTableWidgetItem* avgItem = setCell(table, i, 6, hop.avgTime >= 0 ? QString::number(hop.avgTime, 'f', 1) + " ms" : "---",
+                                            Qt::AlignCenter, &changed);
+        if (hop.recent.received > 0) {
+            setToolTip(avgItem, QString("Last %1 probes: %2 - %3 ms, mean %4 ms, std dev %5 ms, loss %6%")
+                                .arg(hop.recent.count)
+                                .arg(hop.recent.min, 0, 'f', 1)
+                                .arg(hop.recent.max, 0, 'f', 1)
+                                .arg(hop.recent.mean(), 0, 'f', 1)
+                                .arg(hop.recent.stdDev(), 0, 'f', 1)
+                                .arg(hop.recent.lossPercent(), 0, 'f', 1));
+        }
+
+        // Worst time
+        setCell(table, i, 7, hop.worstTime >= 0 ? QString::number(hop.worstTime, 'f', 1) + " ms" : "---",
+                Qt::AlignCenter, &changed);
+    }
+
+    return changed;
+}
+
+QTableWidgetItem* ResultsTable::setCell(QTableWidget* table, int row, int column, const QString& text,
+                                        Qt::Alignment alignment, bool* changed)
+{
+    // Reuse the existing item so a refresh does not reallocate the whole table
+    QTableWidgetItem* item = table->item(row, column);
+    if (!item) {
+        item = new QTableWidgetItem(text);
+        item->setTextAlignment(alignment);
+        table->setItem(row, column, item);
+    } else if (item->text() != text) {
+        item->setText(text);
+    } else {
+        return item;
+    }
+    if (changed) {
+        *changed = true;
+    }
+    return item;
+}
+
+bool ResultsTable::rowChanged(const HopData& before, const HopData& after)
+{
+    return before.hopNumber != after.hopNumber
+        || before.sent != after.sent
+        || before.received != after.received
+        || before.address != after.address
+        || before.hostname != after.hostname
+        || before.bestTime != after.bestTime
+        || before.worstTime != after.worstTime
+        || before.avgTime != after.avgTime
+        || before.lossVerdict != after.lossVerdict
+        || before.sizeSweep != after.sizeSweep
+        || before.recent.count != after.recent.count
+        || before.recent.sum != after.recent.sum;
+}
@@ -0,0 +1,24 @@
+#ifndef RESULTSTABLE_H
+#define RESULTSTABLE_H
+
+#include <QTableWidget>
+#include <QList>
+#include "pingtracer.h"
+
+// Writes hop rows into a results table.
+// Only rows whose figures changed since the shown list are looked at, and of
+// those only the cells, tooltips and colours that differ are written, so the
+// view is told about exactly what moved. Existing items are reused.
+class ResultsTable
+{
+public:
+    // Returns true if any cell's text changed or rows were added or removed
+    static bool update(QTableWidget* table, const QList<HopData>& shown, const QList<HopData>& hops);
+    // Sets *changed when the text was written
+    static QTableWidgetItem* setCell(QTableWidget* table, int row, int column, const QString& text,
+                                     Qt::Alignment alignment = Qt::AlignLeft | Qt::AlignVCenter,
+                                     bool* changed = nullptr);
+    static bool rowChanged(const HopData& before, const HopData& after);
+};
+
+#endif // RESULTSTABLE_H
@@ -0,0 +1,80 @@
+#ifndef RTOESTIMATOR_H
+#define RTOESTIMATOR_H
+
+#include <QtGlobal>
+#include <cmath>
+
+// Retransmission-timeout estimator after RFC 6298.
+//
+// Tracks a smoothed RTT and its mean deviation per hop and derives how long
+// a probe may stay unanswered before it is declared lost. Until the first
+// sample arrives, and after repeated losses, the timeout sits at the
+// configured maximum.
+class RtoEstimator
+{
+public:
+    RtoEstimator() : m_srtt(-1), m_rttvar(0), m_backoff(1) {}
+
+    void reset()
+    {
+        m_srtt = -1;
+        m_rttvar = 0;
+        m_backoff = 1;
+    }
+
+    void addSample(double rttMs)
+    {
+        if (rttMs < 0) {
+            return;
+        }
+
+        if (m_srtt < 0) {
+            m_srtt = rttMs;
+            m_rttvar = rttMs / 2;
+        } else {
+            m_rttvar = 0.75 * m_rttvar + 0.25 * std::fabs(m_srtt - rttMs);
+            m_srtt = 0.875 * m_srtt + 0.125 * rttMs;
+        }
+
+        // A fresh sample ends any loss backoff
+        m_backoff = 1;
+    }
+
+    // Carries the estimate over from an earlier session, srtt < 0 means none
+    void restore(double srtt, double rttvar)
+    {
+        m_srtt = srtt;
+        m_rttvar = srtt < 0 ? 0 : rttvar;
+        m_backoff = 1;
+    }
+
+    // Called when a probe timed out; doubles the timeout for the next one
+    void backoff()
+    {
+        if (m_backoff < 64) {
+            m_backoff *= 2;
+        }
+    }
+
+    // Timeout in ms, clamped to [minMs, maxMs]
+    int timeout(int minMs, int maxMs) const
+    {
+        if (m_srtt < 0) {
+            return maxMs;
+        }
+
+        const double rto = (m_srtt + qMax(1.0, 4 * m_rttvar)) * m_backoff;
+        return qBound(minMs, static_cast<int>(std::ceil(rto)), maxMs);
+    }
+
+    bool hasSamples() const { return m_srtt >= 0; }
+    double srtt() const { return m_srtt; }
+    double rttvar() const { return m_rttvar; }
+
+private:
+    double m_srtt;
+    double m_rttvar;
+    int m_backoff;
+};
+
+#endif // RTOESTIMATOR_H
@@ -0,0 +1,256 @@
+#include "samplestore.h"
+#include "windowstats.h"
+#include <QtAlgorithms>
+
+SampleSeries::SampleSeries()
+    : m_firstTimeMs(-1)
+    , m_lastTimeMs(-1)
+{
+}
+
+void SampleSeries::clear()
+{
+    for (Tier& tier : m_tiers) {
+        tier = Tier();
+    }
+    m_firstTimeMs = -1;
+    m_lastTimeMs = -1;
+}
+
+qint64 SampleSeries::bucketWidthMs(int tier)
+{
+    qint64 width = BaseBucketMs;
+    for (int i = 0; i < tier; ++i) {
+        width *= TierFactor;
+    }
+    return width;
+}
+
+int SampleSeries::tierForResolution(qint64 resolutionMs)
+{
+    int tier = 0;
+    while (tier + 1 < TierCount && bucketWidthMs(tier + 1) <= resolutionMs) {
+        ++tier;
+    }
+    return tier;
+}
+
+void SampleSeries::add(qint64 timeMs, double rttMs)
+{
+    if (timeMs < 0) {
+        return;
+    }
+
+    if (m_firstTimeMs < 0) {
+        m_firstTimeMs = timeMs;
+    }
+    m_lastTimeMs = qMax(m_lastTimeMs, timeMs);
+
+    for (int i = 0; i < TierCount; ++i) {
+        addToTier(m_tiers[i], timeMs / bucketWidthMs(i), rttMs);
+    }
+}
+
+void SampleSeries::growTier(Tier& tier, int capacity)
+{
+    Tier grown;
+    grown.mins.resize(capacity);
+    grown.maxs.resize(capacity);
+    grown.sums.resize(capacity);
+    grown.received.resize(capacity);
+    grown.lost.resize(capacity);
+    grown.firstIndex = tier.firstIndex;
+    grown.lastIndex = tier.lastIndex;
+
+    // Re-home the live buckets under the larger mask
+    if (tier.capacity() > 0) {
+        for (qint64 index = tier.firstIndex; index <= tier.lastIndex; ++index) {
+            const int from = tier.slot(index);
+            const int to = grown.slot(index);
+            grown.mins[to] = tier.mins[from];
+            grown.maxs[to] = tier.maxs[from];
+            grown.sums[to] = tier.sums[from];
+            grown.received[to] = tier.received[from];
+            grown.lost[to] = tier.lost[from];
+        }
+    }
+
+    tier = grown;
+}
+
+void SampleSeries::addToTier(Tier& tier, qint64 index, double rttMs)
+{
+    if (tier.capacity() == 0) {
+        growTier(tier, InitialTierCapacity);
+    }
+
+    if (tier.lastIndex < 0) {
+        tier.firstIndex = index;
+        tier.lastIndex = index - 1;
+    }
+
+    if (index < tier.firstIndex) {
+        return; // Older than anything this tier still holds
+    }
+
+    // Grow the ring while the tier has not reached its full history yet
+    while (index - tier.firstIndex + 1 > tier.capacity() && tier.capacity() < TierCapacity) {
+        growTier(tier, tier.capacity() * 2);
+    }
+
+    // Open new buckets up to index, clearing the ring slots they reuse
+    if (index > tier.lastIndex) {
+        const qint64 from = qMax(tier.lastIndex + 1, index - tier.capacity() + 1);
+        for (qint64 i = from; i <= index; ++i) {
+            const int slot = tier.slot(i);
+            tier.mins[slot] = 0;
+            tier.maxs[slot] = 0;
+            tier.sums[slot] = 0;
+            tier.received[slot] = 0;
+            tier.lost[slot] = 0;
+        }
+        tier.lastIndex = index;
+        tier.firstIndex = qMax(tier.firstIndex, index - tier.capacity() + 1);
+    }
+
+    const int slot = tier.slot(index);
+    if (rttMs < 0) {
+        tier.lost[slot]++;
+        return;
+    }
+
+    const float rtt = static_cast<float>(rttMs);
+    if (tier.received[slot] == 0) {
+        tier.mins[slot] = rtt;
+        tier.maxs[slot] = rtt;
+    } else {
+        tier.mins[slot] = qMin(tier.mins[slot], rtt);
+        tier.maxs[slot] = qMax(tier.maxs[slot], rtt);
+    }
+    tier.sums[slot] += rtt;
+    tier.received[slot]++;
+}
+
+qint64 SampleSeries::firstTimeMs() const
+{
+    return m_firstTimeMs;
+}
+
+qint64 SampleSeries::lastTimeMs() const
+{
+    return m_lastTimeMs;
+}
+
+bool SampleSeries::isEmpty() const
+{
+    return m_lastTimeMs < 0;
+}
+
+SampleBucket SampleSeries::aggregate(int tier, qint64 fromMs, qint64 toMs) const
+{
+    SampleBucket result;
+    if (tier < 0 || tier >= TierCount || toMs <= fromMs) {
+        return result;
+    }
+
+    const Tier& t = m_tiers[tier];
+    const qint64 width = bucketWidthMs(tier);
+
+    // A bucket belongs to the range its start falls in, so adjacent ranges
+    // never count it twice; a range narrower than a bucket reads the bucket
+    // that contains it
+    qint64 first = (fromMs + width - 1) / width;
+    qint64 last = (toMs + width - 1) / width - 1;
+    if (first > last) {
+        first = last = fromMs / width;
+    }
+    first = qMax(first, t.firstIndex);
+    last = qMin(last, t.lastIndex);
+
+    // The range is at most two contiguous runs of the ring
+    qint64 index = first;
+    while (index <= last) {
+        const int slot = t.slot(index);
+        const int run = static_cast<int>(qMin<qint64>(last - index + 1, t.capacity() - slot));
+        result.merge(WindowKernels::buckets(t.mins.constData() + slot, t.maxs.constData() + slot,
+                                            t.sums.constData() + slot, t.received.constData() + slot,
+                                            t.lost.constData() + slot, run));
+        index += run;
+    }
+    return result;
+}
+
+bool SampleSeries::tierHolds(int tier, qint64 timeMs) const
+{
+    // A tier that never dropped a bucket holds everything since the first sample
+    const qint64 startMs = m_tiers[tier].firstIndex * bucketWidthMs(tier);
+    return timeMs >= startMs || startMs <= m_firstTimeMs;
+}
+
+void SampleSeries::columns(qint64 startMs, qint64 columnMs, int count, SampleBucket* out) const
+{
+    // Each column spans at most TierFactor buckets of the chosen tier. Columns
+    // older than that tier's ring read the finest coarser tier still holding them
+    const int finest = tierForResolution(columnMs);
+    for (int i = 0; i < count; ++i) {
+        const qint64 from = startMs + i * columnMs;
+        int tier = finest;
+        while (tier + 1 < TierCount && !tierHolds(tier, from)) {
+            ++tier;
+        }
+        out[i] = aggregate(tier, from, from + columnMs);
+    }
+}
+
+SampleStore::SampleStore()
+    : m_lastTimeMs(-1)
+    , m_revision(0)
+{
+}
+
+SampleStore::~SampleStore()
+{
+    qDeleteAll(m_series);
+}
+
+void SampleStore::reset(int hopCount)
+{
+    qDeleteAll(m_series);
+    m_series.clear();
+    for (int i = 0; i < hopCount; ++i) {
+        m_series.append(new SampleSeries());
+    }
+    m_lastTimeMs = -1;
+    m_revision++;
+}
+
+void SampleStore::add(int hop, qint64 timeMs, double rttMs)
+{
+    if (hop < 1 || hop > m_series.size()) {
+        return;
+    }
+
+    m_series[hop - 1]->add(timeMs, rttMs);
+    m_lastTimeMs = qMax(m_lastTimeMs, timeMs);
+    m_revision++;
+}
+
+int SampleStore::hopCount() const
+{
+    return m_series.size();
+}
+
+const SampleSeries* SampleStore::series(int hop) const
+{
+    return hop >= 1 && hop <= m_series.size() ? m_series[hop - 1] : nullptr;
+}
+
+qint64 SampleStore::lastTimeMs() const
+{
+    return m_lastTimeMs;
+}
+
+quint64 SampleStore::revision() const
+{
+    return m_revision;
+}
@@ -0,0 +1,130 @@
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Aggregate of the samples that fell into one time range
+struct SampleBucket {
+    float min;
+    float max;
+    float sum;
+    quint32 received;
+    quint32 lost;
+
+    SampleBucket() : min(0), max(0), sum(0), received(0), lost(0) {}
+
+    bool isEmpty() const { return received == 0 && lost == 0; }
+    double mean() const { return received > 0 ? sum / received : -1.0; }
+    double lossPercent() const
+    {
+        const quint32 total = received + lost;
+        return total > 0 ? 100.0 * lost / total : 0.0;
+    }
+
+    void merge(const SampleBucket& other)
+    {
+        if (other.received > 0) {
+            if (received == 0) {
+                min = other.min;
+                max = other.max;
+            } else {
+                min = qMin(min, other.min);
+                max = qMax(max, other.max);
+            }
+            sum += other.sum;
+        }
+        received += other.received;
+        lost += other.lost;
+    }
+};
+
+// Latency history of one hop as a pyramid of time-bucket rollups.
+//
+// Tier 0 holds one bucket per BaseBucketMs, every further tier is
+// TierFactor times coarser. Each tier is a ring stored as structure-of-arrays
+// that grows up to TierCapacity buckets, so old fine-grained data ages out
+// while coarse tiers keep days of history. Reading any time range at a given
+// resolution picks the coarsest tier that is still fine enough, or a coarser
+// one for history the finer tier has already dropped, so the cost depends on
+// the number of output columns, not on how much history is stored.
+class SampleSeries
+{
+public:
+    static constexpr int TierCount = 5;
+    static constexpr int TierFactor = 8;
+    static constexpr qint64 BaseBucketMs = 1000;
+    static constexpr int InitialTierCapacity = 256;
+    static constexpr int TierCapacity = 1 << 16;
+
+    SampleSeries();
+
+    void clear();
+    void add(qint64 timeMs, double rttMs); // rttMs < 0 marks a lost probe
+
+    qint64 firstTimeMs() const;
+    qint64 lastTimeMs() const;
+    bool isEmpty() const;
+
+    static qint64 bucketWidthMs(int tier);
+    static int tierForResolution(qint64 resolutionMs);
+
+    // Aggregate over [fromMs, toMs) from the given tier
+    SampleBucket aggregate(int tier, qint64 fromMs, qint64 toMs) const;
+
+    // Fills count consecutive columns of columnMs each, starting at startMs
+    void columns(qint64 startMs, qint64 columnMs, int count, SampleBucket* out) const;
+
+private:
+    struct Tier {
+        QVector<float> mins;
+        QVector<float> maxs;
+        QVector<float> sums;
+        QVector<quint32> received;
+        QVector<quint32> lost;
+        qint64 firstIndex; // Oldest bucket index still held
+        qint64 lastIndex;  // Newest bucket index, -1 while empty
+
+        Tier() : firstIndex(0), lastIndex(-1) {}
+
+        int capacity() const { return mins.size(); }
+        int slot(qint64 index) const { return static_cast<int>(index & (capacity() - 1)); }
+    };
+
+    void addToTier(Tier& tier, qint64 index, double rttMs);
+    bool tierHolds(int tier, qint64 timeMs) const;
+    void growTier(Tier& tier, int capacity);
+
+    Tier m_tiers[TierCount];
+    qint64 m_firstTimeMs;
+    qint64 m_lastTimeMs;
+};
+
+// Per-hop sample history for a tracing session.
+// Written by the tracer as results are applied; the GUI reads it on the same thread.
+class SampleStore
+{
+public:
+    SampleStore();
+    ~SampleStore();
+
+    void reset(int hopCount);
+    void add(int hop, qint64 timeMs, double rttMs);
+
+    int hopCount() const;
+    const SampleSeries* series(int hop) const;
+    qint64 lastTimeMs() const;
+
+    // Bumped on every add, lets views skip redraws when nothing arrived
+    quint64 revision() const;
+
+private:
+    SampleStore(const SampleStore&) = delete;
+    SampleStore& operator=(const SampleStore&) = delete;
+
+    QVector<SampleSeries*> m_series;
+    qint64 m_lastTimeMs;
+    quint64 m_revision;
+};
+
+#endif // SAMPLESTORE_H
@@ -0,0 +1,205 @@
+#include "sessionsnapshot.h"
+#include <QSaveFile>
+#include <QDateTime>
+#include <cstring>
+
+namespace {
+
+const char SessionMagic[8] = { 'P', 'T', 'S', 'E', 'S', 'S', 'N', '\0' };
+constexpr quint32 SessionVersion = 3;
+constexpr quint32 ByteOrderMark = 0x01020304u;
+
+qint64 alignUp(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+}
+
+quint32 SessionWriter::addString(const QString& text)
+{
+    const auto it = m_stringOffsets.constFind(text);
+    if (it != m_stringOffsets.constEnd()) {
+        return it.value();
+    }
+
+    const QByteArray utf8 = text.toUtf8();
+    const quint32 offset = m_strings.size();
+    const quint32 length = utf8.size();
+    m_strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    m_strings.append(utf8);
+    while (m_strings.size() % 4 != 0) {
+        m_strings.append('\0');
+    }
+
+    m_stringOffsets.insert(text, offset);
+    return offset;
+}
+
+quint32 SessionWriter::hopCount() const
+{
+    return m_hops.size();
+}
+
+void SessionWriter::addHop(const SessionHop& hop)
+{
+    m_hops.append(hop);
+}
+
+void SessionWriter::addTracer(const SessionTracer& tracer)
+{
+    m_tracers.append(tracer);
+}
+
+bool SessionWriter::commit(const QString& fileName, QString* error) const
+{
+    SessionHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SessionMagic, sizeof(header.magic));
+    header.version = SessionVersion;
+    header.byteOrder = ByteOrderMark;
+    header.tracerCount = m_tracers.size();
+    header.hopCount = m_hops.size();
+    header.stringsOffset = alignUp(sizeof(SessionHeader) + m_tracers.size() * sizeof(SessionTracer)
+                                   + m_hops.size() * sizeof(SessionHop));
+    header.stringsSize = m_strings.size();
+    header.savedAtMs = QDateTime::currentMSecsSinceEpoch();
+
+    // One buffer, one write: the file is the image the reader maps
+    QByteArray image(header.stringsOffset + header.stringsSize, '\0');
+    char* out = image.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    std::memcpy(out, m_tracers.constData(), m_tracers.size() * sizeof(SessionTracer));
+    out += m_tracers.size() * sizeof(SessionTracer);
+    std::memcpy(out, m_hops.constData(), m_hops.size() * sizeof(SessionHop));
+    std::memcpy(image.data() + header.stringsOffset, m_strings.constData(), m_strings.size());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = QString("Could not open %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    if (file.write(image) != image.size() || !file.commit()) {
+        *error = QString("Could not write %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+SessionSnapshot::SessionSnapshot()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_header(nullptr)
+    , m_tracers(nullptr)
+    , m_hops(nullptr)
+    , m_strings(nullptr)
+{
+}
+
+SessionSnapshot::~SessionSnapshot()
+{
+    close();
+}
+
+bool SessionSnapshot::open(const QString& fileName, QString* error)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        *error = QString("Could not open %1: %2").arg(fileName, m_file.errorString());
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size < static_cast<qint64>(sizeof(SessionHeader))) {
+        *error = QString("%1 is not a session snapshot").arg(fileName);
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        *error = QString("Could not map %1: %2").arg(fileName, m_file.errorString());
+        close();
+        return false;
+    }
+
+    // Every offset and count is checked once here, accessors trust them
+    const SessionHeader* header = reinterpret_cast<const SessionHeader*>(m_data);
+    const quint64 recordsEnd = sizeof(SessionHeader) + quint64(header->tracerCount) * sizeof(SessionTracer)
+                               + quint64(header->hopCount) * sizeof(SessionHop);
+    if (std::memcmp(header->magic, SessionMagic, sizeof(header->magic)) != 0
+        || header->version != SessionVersion || header->byteOrder != ByteOrderMark
+        || header->stringsOffset < recordsEnd || header->stringsOffset > quint64(m_size)
+        || header->stringsSize > quint64(m_size) - header->stringsOffset) {
+        *error = QString("%1 is not a compatible session snapshot").arg(fileName);
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_tracers = reinterpret_cast<const SessionTracer*>(m_data + sizeof(SessionHeader));
+    m_hops = reinterpret_cast<const SessionHop*>(m_tracers + header->tracerCount);
+    m_strings = m_data + header->stringsOffset;
+
+    for (quint32 i = 0; i < header->tracerCount; ++i) {
+        const SessionTracer& tracer = m_tracers[i];
+        if (quint64(tracer.firstHop) + tracer.hopCount > header->hopCount) {
+            *error = QString("%1 is damaged").arg(fileName);
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SessionSnapshot::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+    m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_tracers = nullptr;
+    m_hops = nullptr;
+    m_strings = nullptr;
+}
+
+int SessionSnapshot::tracerCount() const
+{
+    return m_header ? m_header->tracerCount : 0;
+}
+
+const SessionTracer& SessionSnapshot::tracer(int index) const
+{
+    return m_tracers[index];
+}
+
+const SessionHop* SessionSnapshot::hops(int index) const
+{
+    return m_hops + m_tracers[index].firstHop;
+}
+
+QString SessionSnapshot::string(quint32 offset) const
+{
+    if (!m_header || offset == SessionWriter::NoString
+        || quint64(offset) + sizeof(quint32) > m_header->stringsSize) {
+        return QString();
+    }
+
+    quint32 length;
+    std::memcpy(&length, m_strings + offset, sizeof(length));
+    if (length > m_header->stringsSize - offset - sizeof(quint32)) {
+        return QString();
+    }
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_strings + offset + sizeof(quint32)), length);
+}
+
+qint64 SessionSnapshot::savedAtMs() const
+{
+    return m_header ? m_header->savedAtMs : 0;
+}
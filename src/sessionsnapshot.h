@@ -0,0 +1,133 @@
+#ifndef SESSIONSNAPSHOT_H
+#define SESSIONSNAPSHOT_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include "windowstats.h"
+#include "changedetector.h"
+#include "alertengine.h"
+
+// On-disk session layout. A snapshot is one file laid out as
+//   SessionHeader | SessionTracer[tracerCount] | SessionHop[hopCount] | strings
+// and is read straight from a memory map: the records are plain structs at
+// fixed offsets, so restoring is a bounds check and a copy per field rather
+// than a parse. Strings are stored once as a 32-bit length plus UTF-8 bytes
+// and referenced by their offset into the string area.
+
+struct SessionHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;      // ByteOrderMark as written, rejects foreign-endian files
+    quint32 tracerCount;
+    quint32 hopCount;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+    qint64 savedAtMs;
+};
+
+struct SessionTracer {
+    enum Flags {
+        FastStart = 0x1,
+        ReuseConnections = 0x2
+    };
+
+    quint32 target;         // String offset of the host as entered
+    quint32 family;         // PingTracer::AddressFamily
+    quint64 addressHi;      // Resolved target, AddressKey halves
+    quint64 addressLo;
+    qint32 intervalMs;
+    qint32 timeoutMs;
+    qint32 maxHops;
+    qint32 destinationHop;
+    quint32 firstHop;       // Index of this tracer's first SessionHop
+    quint32 hopCount;
+    quint64 probesSent;
+    quint64 probesReceived;
+    quint32 protocol;       // ProbeProtocol
+    quint32 port;
+    quint32 query;          // String offset of the DNS name or HTTP path
+    quint32 alertRules;     // String offset of the rule lines, NoString without rules
+    quint32 flags;
+    quint32 reserved;
+    qint32 endToEndCount;   // End-to-end alert window, oldest first
+    qint32 reserved2;
+    float endToEnd[AlertEngine::WindowSamples];
+};
+
+struct SessionHop {
+    quint64 addressHi;
+    quint64 addressLo;
+    quint32 hostname;       // String offset, NoString when unresolved
+    qint32 sent;
+    qint32 received;
+    qint32 recentCount;
+    qint32 recentNext;
+    qint32 reserved;
+    double bestTime;
+    double worstTime;
+    double rttSum;
+    double srtt;            // RTO estimator state, srtt < 0 without samples
+    double rttvar;
+    ChangeDetector::State detector;
+    qint32 alertCount;      // Alert window of the hop, oldest first, 0 without hop rules
+    qint32 reserved2;
+    float recent[SampleWindow::Capacity];
+    float alerts[AlertEngine::WindowSamples];
+};
+
+// Collects records and writes a snapshot in one go
+class SessionWriter
+{
+public:
+    static constexpr quint32 NoString = 0xffffffffu;
+
+    quint32 addString(const QString& text);
+    quint32 hopCount() const;
+    void addHop(const SessionHop& hop);
+    void addTracer(const SessionTracer& tracer);
+
+    // Replaces fileName atomically, a crash mid-write keeps the old snapshot
+    bool commit(const QString& fileName, QString* error) const;
+
+private:
+    QVector<SessionTracer> m_tracers;
+    QVector<SessionHop> m_hops;
+    QByteArray m_strings;
+    QHash<QString, quint32> m_stringOffsets;
+};
+
+// Read-only view of a mapped snapshot
+class SessionSnapshot
+{
+public:
+    SessionSnapshot();
+    ~SessionSnapshot();
+
+    bool open(const QString& fileName, QString* error);
+    void close();
+
+    int tracerCount() const;
+    const SessionTracer& tracer(int index) const;
+    // The tracer's hop records, tracer(index).hopCount of them
+    const SessionHop* hops(int index) const;
+    QString string(quint32 offset) const;
+    qint64 savedAtMs() const;
+
+private:
+    SessionSnapshot(const SessionSnapshot&) = delete;
+    SessionSnapshot& operator=(const SessionSnapshot&) = delete;
+
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    const SessionHeader* m_header;
+    const SessionTracer* m_tracers;
+    const SessionHop* m_hops;
+    const uchar* m_strings;
+};
+
+#endif // SESSIONSNAPSHOT_H
@@ -0,0 +1,161 @@
+#ifndef SNAPSHOTPUBLISHER_H
+#define SNAPSHOTPUBLISHER_H
+
+#include <QtGlobal>
+#include <QList>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+// Copies source into target's own buffer. Plain assignment would share
+// source's, and whichever of the two changes next detaches and reallocates
+template <typename E>
+void copyElements(QList<E>& target, const QList<E>& source)
+{
+    target.resize(source.size());
+    std::copy(source.cbegin(), source.cend(), target.begin());
+}
+
+// Lock-free publication of immutable snapshots.
+//
+// A single writer builds the next state privately and copies it into a free
+// slot with publish(); one atomic store of the generation-indexed slot then
+// makes it current. Readers call load() and pin the current slot for as long
+// as they keep the returned Snapshot. The writer only ever writes a slot that
+// is neither current nor pinned, so neither side takes a lock: a reader
+// retries only when a publish raced with its pin, and the writer never waits.
+// With every other slot pinned, publish() leaves the current snapshot in place
+// and returns false; the writer has to publish again later to catch up.
+template <typename T, int Slots = 4>
+class SnapshotPublisher
+{
+    static_assert(Slots >= 2 && Slots <= 256, "Slot index is kept in the low byte of the generation word");
+
+    struct Slot {
+        T value;
+        quint64 generation;
+        std::atomic<int> pins;
+
+        Slot() : generation(0), pins(0) {}
+    };
+
+public:
+    // Pinned view of one published value, valid until the Snapshot is dropped
+    class Snapshot
+    {
+    public:
+        Snapshot() : m_slot(nullptr) {}
+        Snapshot(const Snapshot& other) : m_slot(other.m_slot)
+        {
+            if (m_slot) {
+                m_slot->pins.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        Snapshot(Snapshot&& other) noexcept : m_slot(other.m_slot) { other.m_slot = nullptr; }
+        ~Snapshot()
+        {
+            if (m_slot) {
+                m_slot->pins.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        Snapshot& operator=(Snapshot other) noexcept
+        {
+            std::swap(m_slot, other.m_slot);
+            return *this;
+        }
+
+        const T& operator*() const { return m_slot->value; }
+        const T* operator->() const { return &m_slot->value; }
+        explicit operator bool() const { return m_slot != nullptr; }
+
+        // Generation this value was published under
+        quint64 generation() const { return m_slot ? m_slot->generation : 0; }
+
+    private:
+        friend class SnapshotPublisher;
+        explicit Snapshot(Slot* slot) : m_slot(slot) {}
+
+        Slot* m_slot;
+    };
+
+    SnapshotPublisher() : m_current(0), m_skipped(0) {}
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Writer side, from one thread only
+    bool publish(const T& value)
+    {
+        const quint64 current = m_current.load(std::memory_order_relaxed);
+        const int currentSlot = static_cast<int>(current & SlotMask);
+
+        for (int i = 1; i < Slots; ++i) {
+            const int index = (currentSlot + i) % Slots;
+            Slot& slot = m_slots[index];
+            if (slot.pins.load(std::memory_order_seq_cst) != 0) {
+                continue;
+            }
+
+            const quint64 generation = (current >> SlotBits) + 1;
+            assign(slot.value, value);
+            slot.generation = generation;
+            m_current.store((generation << SlotBits) | static_cast<quint64>(index), std::memory_order_seq_cst);
+            return true;
+        }
+
+        m_skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Reader side, from any thread
+    Snapshot load() const
+    {
+        for (;;) {
+            const quint64 current = m_current.load(std::memory_order_seq_cst);
+            Slot* slot = &m_slots[current & SlotMask];
+            slot->pins.fetch_add(1, std::memory_order_seq_cst);
+
+            // Still current after the pin, so the writer will leave the slot alone
+            if (m_current.load(std::memory_order_seq_cst) == current) {
+                return Snapshot(slot);
+            }
+            slot->pins.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // Bumped on every publish, lets pollers skip unchanged snapshots cheaply
+    quint64 generation() const
+    {
+        return m_current.load(std::memory_order_acquire) >> SlotBits;
+    }
+
+    // Publishes that found every slot pinned
+    quint64 skippedCount() const
+    {
+        return m_skipped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int SlotBits = 8;
+    static constexpr quint64 SlotMask = (1u << SlotBits) - 1;
+
+    template <typename U>
+    static void assign(U& slot, const U& value)
+    {
+        slot = value;
+    }
+
+    // Sharing the writer's list would make its next change detach, one allocation per publish
+    template <typename E>
+    static void assign(QList<E>& slot, const QList<E>& value)
+    {
+        copyElements(slot, value);
+    }
+
+    mutable Slot m_slots[Slots];
+    std::atomic<quint64> m_current;   // Generation << SlotBits | slot index
+    std::atomic<quint64> m_skipped;
+};
+
+#endif // SNAPSHOTPUBLISHER_H
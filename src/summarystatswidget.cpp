@@ -0,0 +1,40 @@
+#include "summarystatswidget.h"
+#include <QFormLayout>
+
+SummaryStatsWidget::SummaryStatsWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    static const char* const names[FieldCount] = {
+        "Target:",
+        "Total Hops:",
+        "Packets Sent:",
+        "Packets Received:",
+        "Overall Loss:",
+        "Probe Rate:",
+        "Last Update:"
+    };
+
+    QFormLayout* layout = new QFormLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    for (int i = 0; i < FieldCount; ++i) {
+        QLabel* value = new QLabel("---", this);
+        value->setTextInteractionFlags(Qt::TextSelectableByMouse);
+        layout->addRow(names[i], value);
+        m_values.append(value);
+    }
+}
+
+void SummaryStatsWidget::setField(Field field, const QString& text)
+{
+    QLabel* label = m_values.value(field);
+    if (label && label->text() != text) {
+        label->setText(text);
+    }
+}
+
+void SummaryStatsWidget::clear()
+{
+    for (QLabel* label : m_values) {
+        label->setText("---");
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef SUMMARYSTATSWIDGET_H
+#define SUMMARYSTATSWIDGET_H
+
+#include <QWidget>
+#include <QLabel>
+#include <QVector>
+#include <QString>
+
+// Fixed set of session figures shown as label pairs.
+// Each field only touches its label when the text actually changed.
+class SummaryStatsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum Field {
+        Target,
+        Hops,
+        PacketsSent,
+        PacketsReceived,
+        Loss,
+        ProbeRate,
+        LastUpdate,
+        FieldCount
+    };
+
+    explicit SummaryStatsWidget(QWidget *parent = nullptr);
+
+    void setField(Field field, const QString& text);
+    void clear();
+
+private:
+    QVector<QLabel*> m_values;
+};
+
+#endif // SUMMARYSTATSWIDGET_H
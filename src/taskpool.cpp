@@ -0,0 +1,211 @@
+#include "taskpool.h"
+#include <QtAlgorithms>
+#include <memory>
+
+namespace {
+// Which pool and worker the current thread belongs to, if any
+thread_local TaskPool* t_pool = nullptr;
+thread_local int t_workerIndex = -1;
+
+// Progress of one parallelFor, shared with the helper tasks that may outlive it
+struct ParallelRange {
+    std::function<void(int, int)> body;
+    int begin;
+    int end;
+    int grain;
+    int chunks;
+    std::atomic<int> nextChunk;
+    std::atomic<int> doneChunks;
+    QMutex mutex;
+    QWaitCondition finished;
+
+    // Claims chunks until none are left
+    void work()
+    {
+        int chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunks) {
+            const int first = begin + chunk * grain;
+            body(first, qMin(first + grain, end));
+            if (doneChunks.fetch_add(1) + 1 == chunks) {
+                QMutexLocker locker(&mutex);
+                finished.wakeAll();
+            }
+        }
+    }
+};
+}
+
+TaskPool& TaskPool::instance()
+{
+    static TaskPool instance;
+    return instance;
+}
+
+TaskPool::TaskPool(int workers)
+    : m_pending(0)
+    , m_nextWorker(0)
+    , m_stopping(false)
+{
+    if (workers <= 0) {
+        workers = qMax(1, QThread::idealThreadCount() - 1);
+    }
+
+    for (int i = 0; i < workers; ++i) {
+        m_workers.append(new Worker());
+    }
+
+    // Start only once every worker exists, thieves walk the whole list
+    for (int i = 0; i < workers; ++i) {
+        m_workers[i]->thread = QThread::create([this, i]() { run(i); });
+        m_workers[i]->thread->setObjectName(QString("TaskPool %1").arg(i));
+        m_workers[i]->thread->start(QThread::LowPriority);
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        QMutexLocker locker(&m_sleepMutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+
+    for (Worker* worker : m_workers) {
+        worker->thread->wait();
+        delete worker->thread;
+    }
+    qDeleteAll(m_workers);
+}
+
+int TaskPool::workerCount() const
+{
+    return m_workers.size();
+}
+
+void TaskPool::submit(Task task, Priority priority)
+{
+    // Tasks spawned by a worker stay local, others are dealt out round robin
+    const int index = t_pool == this ? t_workerIndex : static_cast<int>(m_nextWorker++ % m_workers.size());
+
+    Worker* worker = m_workers[index];
+    {
+        QMutexLocker locker(&worker->mutex);
+        worker->queues[static_cast<int>(priority)].push_back(std::move(task));
+    }
+
+    // Counted before taking the sleep lock, so a worker about to sleep sees it
+    m_pending++;
+    QMutexLocker locker(&m_sleepMutex);
+    m_wake.wakeOne();
+}
+
+void TaskPool::parallelFor(int begin, int end, const std::function<void(int, int)>& body, int grain, Priority priority)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    grain = qMax(1, grain);
+    const int chunks = (end - begin + grain - 1) / grain;
+    if (chunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    auto range = std::make_shared<ParallelRange>();
+    range->body = body;
+    range->begin = begin;
+    range->end = end;
+    range->grain = grain;
+    range->chunks = chunks;
+    range->nextChunk = 0;
+    range->doneChunks = 0;
+
+    // The caller takes a share itself, so one helper fewer is enough
+    const int helpers = qMin(chunks - 1, workerCount());
+    for (int i = 0; i < helpers; ++i) {
+        submit([range]() { range->work(); }, priority);
+    }
+
+    range->work();
+
+    QMutexLocker locker(&range->mutex);
+    while (range->doneChunks.load() < chunks) {
+        range->finished.wait(&range->mutex);
+    }
+}
+
+void TaskPool::run(int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+
+    Task task;
+    while (true) {
+        if (takeTask(index, &task)) {
+            task();
+            task = Task();
+            continue;
+        }
+
+        // Counted tasks can be out of reach for a moment: a victim's lock was
+        // busy, or another worker has popped one and not yet uncounted it.
+        // Wait for the next submit or a short while rather than spin on them
+        QMutexLocker locker(&m_sleepMutex);
+        if (m_pending.load() > 0 && !m_stopping) {
+            m_wake.wait(&m_sleepMutex, RetryMs);
+        }
+        while (m_pending.load() == 0 && !m_stopping) {
+            m_wake.wait(&m_sleepMutex);
+        }
+        if (m_stopping) {
+            return;
+        }
+    }
+}
+
+bool TaskPool::takeTask(int index, Task* task)
+{
+    for (int priority = 0; priority < PriorityCount; ++priority) {
+        if (popOwn(index, priority, task) || steal(index, priority, task)) {
+            m_pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::popOwn(int index, int priority, Task* task)
+{
+    // Newest first, its data is most likely still in this core's cache
+    Worker* worker = m_workers[index];
+    QMutexLocker locker(&worker->mutex);
+    std::deque<Task>& queue = worker->queues[priority];
+    if (queue.empty()) {
+        return false;
+    }
+    *task = std::move(queue.back());
+    queue.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(int thief, int priority, Task* task)
+{
+    // Oldest first from the victim, starting at the neighbour so thieves spread out
+    const int count = m_workers.size();
+    for (int offset = 1; offset < count; ++offset) {
+        Worker* victim = m_workers[(thief + offset) % count];
+        if (!victim->mutex.tryLock()) {
+            continue;
+        }
+        std::deque<Task>& queue = victim->queues[priority];
+        if (!queue.empty()) {
+            *task = std::move(queue.front());
+            queue.pop_front();
+            victim->mutex.unlock();
+            return true;
+        }
+        victim->mutex.unlock();
+    }
+    return false;
+}
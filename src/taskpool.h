@@ -0,0 +1,77 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Process-wide pool for analytic work: rollup recomputation, exports and
+// path analysis.
+//
+// Each worker owns a deque per priority. A worker pops its own newest task
+// first and, once its deques run dry, steals the oldest task of another
+// worker, so busy workers keep cache-warm work while idle ones pick up the
+// rest. A worker always takes the most urgent task it can find, its own or
+// stolen, before anything less urgent. Workers run at low OS priority and
+// leave one core free, so probe timing is not disturbed by analytic work.
+class TaskPool
+{
+public:
+    enum class Priority {
+        High,   // Someone is waiting on the result, e.g. a repaint
+        Normal,
+        Low     // Background work such as exports
+    };
+
+    using Task = std::function<void()>;
+
+    static TaskPool& instance();
+
+    // workers <= 0 uses one thread less than the machine has cores
+    explicit TaskPool(int workers = 0);
+    ~TaskPool();
+
+    void submit(Task task, Priority priority = Priority::Normal);
+
+    // Runs body(first, last) over chunks of at most grain indices in
+    // [begin, end) and returns once all of them are done. The calling
+    // thread works on chunks too, so this never deadlocks when called
+    // from inside a task.
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& body,
+                     int grain = 1, Priority priority = Priority::High);
+
+    int workerCount() const;
+
+private:
+    static constexpr int PriorityCount = 3;
+    static constexpr int RetryMs = 1;   // Longest an idle worker waits before looking for stealable work again
+
+    struct Worker {
+        QMutex mutex;
+        std::deque<Task> queues[PriorityCount];
+        QThread* thread;
+
+        Worker() : thread(nullptr) {}
+    };
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    void run(int index);
+    bool takeTask(int index, Task* task);
+    bool popOwn(int index, int priority, Task* task);
+    bool steal(int thief, int priority, Task* task);
+
+    QVector<Worker*> m_workers;
+    std::atomic<int> m_pending;     // Queued tasks across all workers
+    std::atomic<quint32> m_nextWorker;
+    std::atomic<bool> m_stopping;
+    QMutex m_sleepMutex;
+    QWaitCondition m_wake;
+};
+
+#endif // TASKPOOL_H
@@ -0,0 +1,267 @@
+#include "tcpprobe.h"
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketLength = int;
+using NativeSocket = SOCKET;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+using SocketLength = socklen_t;
+using NativeSocket = int;
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/errqueue.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+constexpr qintptr NoSocket = static_cast<qintptr>(INVALID_SOCKET);
+
+int lastSocketError()
+{
+    return WSAGetLastError();
+}
+
+bool connectPending(int error)
+{
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+}
+
+void closeSocket(qintptr fd)
+{
+    ::closesocket(static_cast<NativeSocket>(fd));
+}
+
+bool setNonBlocking(qintptr fd)
+{
+    u_long on = 1;
+    return ::ioctlsocket(static_cast<NativeSocket>(fd), FIONBIO, &on) == 0;
+}
+
+// Qt starts Winsock for its own sockets, a TCP-only session may have none yet
+void startWinsock()
+{
+    static const bool started = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    Q_UNUSED(started);
+}
+#else
+constexpr qintptr NoSocket = -1;
+
+int lastSocketError()
+{
+    return errno;
+}
+
+bool connectPending(int error)
+{
+    return error == EINPROGRESS || error == EWOULDBLOCK;
+}
+
+void closeSocket(qintptr fd)
+{
+    ::close(static_cast<NativeSocket>(fd));
+}
+
+bool setNonBlocking(qintptr fd)
+{
+    const int flags = ::fcntl(static_cast<NativeSocket>(fd), F_GETFL, 0);
+    return flags >= 0 && ::fcntl(static_cast<NativeSocket>(fd), F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void startWinsock()
+{
+}
+#endif
+
+bool isRefused(int error)
+{
+#ifdef Q_OS_WIN
+    return error == WSAECONNREFUSED;
+#else
+    return error == ECONNREFUSED;
+#endif
+}
+
+}
+
+bool TcpProbe::supportsTtl()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+TcpProbe::TcpProbe()
+    : m_fd(NoSocket)
+    , m_ipv6(false)
+{
+}
+
+TcpProbe::~TcpProbe()
+{
+    close();
+}
+
+bool TcpProbe::start(const QHostAddress& target, quint16 port, int ttl)
+{
+    close();
+    startWinsock();
+
+    sockaddr_storage address;
+    std::memset(&address, 0, sizeof(address));
+    SocketLength length;
+    m_ipv6 = target.protocol() == QAbstractSocket::IPv6Protocol;
+    if (m_ipv6) {
+        sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&address);
+        const Q_IPV6ADDR bytes = target.toIPv6Address();
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        std::memcpy(&in6->sin6_addr, bytes.c, sizeof(bytes.c));
+        length = sizeof(sockaddr_in6);
+    } else {
+        sockaddr_in* in4 = reinterpret_cast<sockaddr_in*>(&address);
+        in4->sin_family = AF_INET;
+        in4->sin_port = htons(port);
+        in4->sin_addr.s_addr = htonl(target.toIPv4Address());
+        length = sizeof(sockaddr_in);
+    }
+    m_target = AddressKey::fromHostAddress(target);
+
+    m_fd = static_cast<qintptr>(::socket(m_ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (m_fd == NoSocket || !setNonBlocking(m_fd)) {
+        close();
+        return false;
+    }
+
+    // Closing resets the connection, thousands of probes leave no TIME_WAIT behind
+    linger reset;
+    reset.l_onoff = 1;
+    reset.l_linger = 0;
+    ::setsockopt(static_cast<NativeSocket>(m_fd), SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&reset), sizeof(reset));
+
+    if (ttl > 0 && supportsTtl()) {
+#ifdef Q_OS_LINUX
+        // Hop limit on the SYN, and ICMP errors kept on the error queue with their sender
+        const NativeSocket fd = static_cast<NativeSocket>(m_fd);
+        const int on = 1;
+        const int ok = m_ipv6
+            ? ::setsockopt(fd, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &ttl, sizeof(ttl))
+                  | ::setsockopt(fd, IPPROTO_IPV6, IPV6_RECVERR, &on, sizeof(on))
+            : ::setsockopt(fd, IPPROTO_IP, IP_TTL, &ttl, sizeof(ttl))
+                  | ::setsockopt(fd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+        if (ok != 0) {
+            close();
+            return false;
+        }
+#endif
+    }
+
+    if (::connect(static_cast<NativeSocket>(m_fd), reinterpret_cast<const sockaddr*>(&address), length) == 0) {
+        return true; // Loopback can complete at once, finish() sees it as connected
+    }
+    if (!connectPending(lastSocketError())) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+TcpProbe::Outcome TcpProbe::finish(AddressKey* responder)
+{
+    if (m_fd == NoSocket) {
+        return Outcome::Failed;
+    }
+
+    int error = 0;
+    SocketLength length = sizeof(error);
+    if (::getsockopt(static_cast<NativeSocket>(m_fd), SOL_SOCKET, SO_ERROR,
+                     reinterpret_cast<char*>(&error), &length) != 0) {
+        error = lastSocketError();
+    }
+
+    if (error == 0) {
+        *responder = m_target;
+        return Outcome::Connected;
+    }
+    if (isRefused(error)) {
+        *responder = m_target;
+        return Outcome::Refused;
+    }
+    return readErrorQueue(responder) ? Outcome::HopReplied : Outcome::Failed;
+}
+
+bool TcpProbe::readErrorQueue(AddressKey* responder)
+{
+#ifdef Q_OS_LINUX
+    char control[512];
+    char data[1];
+    iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = sizeof(data);
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (::recvmsg(static_cast<NativeSocket>(m_fd), &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        return false;
+    }
+
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        const bool isError = (header->cmsg_level == IPPROTO_IP && header->cmsg_type == IP_RECVERR)
+                             || (header->cmsg_level == IPPROTO_IPV6 && header->cmsg_type == IPV6_RECVERR);
+        if (!isError) {
+            continue;
+        }
+
+        const sock_extended_err* error = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(header));
+        if (error->ee_origin != SO_EE_ORIGIN_ICMP && error->ee_origin != SO_EE_ORIGIN_ICMP6) {
+            continue;
+        }
+        const QHostAddress offender(SO_EE_OFFENDER(error));
+        if (offender.isNull()) {
+            continue;
+        }
+        *responder = AddressKey::fromHostAddress(offender);
+        return true;
+    }
+    return false;
+#else
+    Q_UNUSED(responder);
+    return false;
+#endif
+}
+
+void TcpProbe::close()
+{
+    if (m_fd != NoSocket) {
+        closeSocket(m_fd);
+        m_fd = NoSocket;
+    }
+}
+
+bool TcpProbe::isOpen() const
+{
+    return m_fd != NoSocket;
+}
+
+qintptr TcpProbe::descriptor() const
+{
+    return m_fd;
+}
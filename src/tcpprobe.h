@@ -0,0 +1,57 @@
+#ifndef TCPPROBE_H
+#define TCPPROBE_H
+
+#include <QtGlobal>
+#include <QHostAddress>
+#include "addresstable.h"
+
+// One non-blocking TCP handshake on a native socket.
+//
+// The SYN goes out with its TTL (hop limit) capped at the probed hop. A
+// router where it expires answers with ICMP time exceeded, which aborts the
+// connect; on Linux the socket's error queue (IP_RECVERR) then tells which
+// router it was. Where the platform cannot name the router, start() leaves
+// the TTL alone and the probe times the handshake with the target end to end.
+//
+// The caller owns the event loop: it waits for the descriptor to become
+// writable (connected or failed) and calls finish(). Nothing here blocks,
+// so one thread can keep thousands of handshakes in flight. Connections are
+// reset rather than closed, so finished probes hold no ports in TIME_WAIT.
+class TcpProbe
+{
+public:
+    enum class Outcome {
+        Connected,      // SYN-ACK from the target
+        Refused,        // RST from the target, it still answered
+        HopReplied,     // ICMP from a router on the way, responder says which
+        Failed          // Local error or an ICMP error without a sender
+    };
+
+    // True if a TTL-limited SYN can report the router it expired at
+    static bool supportsTtl();
+
+    TcpProbe();
+    ~TcpProbe();
+
+    // Starts connecting to target:port; ttl <= 0 keeps the system default
+    bool start(const QHostAddress& target, quint16 port, int ttl);
+
+    // Result once the descriptor is writable, *responder is the answering address
+    Outcome finish(AddressKey* responder);
+
+    void close();
+    bool isOpen() const;
+    qintptr descriptor() const;
+
+private:
+    TcpProbe(const TcpProbe&) = delete;
+    TcpProbe& operator=(const TcpProbe&) = delete;
+
+    bool readErrorQueue(AddressKey* responder);
+
+    qintptr m_fd;
+    bool m_ipv6;
+    AddressKey m_target;
+};
+
+#endif // TCPPROBE_H
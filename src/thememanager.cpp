@@ -140,7 +140,7 @@ QString ThemeManager::getProfessionalTheme()
             font-weight: bold;
         }
         
-        QTextEdit {
+        QTextEdit, QListView {
             border: 1px solid #e2e8f0;
             border-radius: 6px;
             background-color: #ffffff;
@@ -344,7 +344,7 @@ QString ThemeManager::getDarkTheme()
             font-weight: bold;
         }
         
-        QTextEdit {
+        QTextEdit, QListView {
             border: 1px solid #4a5568;
             border-radius: 6px;
             background-color: #2d3748;
@@ -550,7 +550,7 @@ QString ThemeManager::getLightTheme()
             font-weight: bold;
         }
         
-        QTextEdit {
+        QTextEdit, QListView {
             border: 1px solid #cccccc;
             border-radius: 4px;
             background-color: #ffffff;
@@ -0,0 +1,1040 @@
+#include "throughputtest.h"
+#include "probearena.h"
+#include <QtEndian>
+#include <QRandomGenerator>
+#include <QByteArray>
+#include <cstring>
+#include <limits>
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using NativeSocket = SOCKET;
+using SocketLength = int;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+using NativeSocket = int;
+using SocketLength = socklen_t;
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/errqueue.h>
+#endif
+
+namespace {
+
+constexpr quint8 ProtocolVersion = 1;
+constexpr int TcpChunkSize = 128 * 1024;
+constexpr int ReceiveBufferSize = 256 * 1024;
+constexpr int UdpBatch = 32;
+constexpr int MaxDatagramSize = 65507;
+constexpr int ProgressIntervalMs = 250;
+constexpr int ControlTimeoutMs = 5000;
+constexpr int ReportTimeoutMs = 15000;
+constexpr int IdleTimeoutMs = 10000;
+constexpr int DrainMs = 500;        // Left for datagrams still in flight when a UDP test ends
+constexpr qint64 NsPerMs = 1000000;
+
+#ifdef Q_OS_WIN
+constexpr NativeSocket NoSocket = INVALID_SOCKET;
+constexpr int ShutdownSend = SD_SEND;
+constexpr int NoSignal = 0;
+
+void closeSocket(NativeSocket fd)
+{
+    ::closesocket(fd);
+}
+
+int pollSockets(pollfd* fds, int count, int timeoutMs)
+{
+    return WSAPoll(fds, static_cast<ULONG>(count), timeoutMs);
+}
+
+int lastSocketError()
+{
+    return WSAGetLastError();
+}
+
+bool wouldBlock(int error)
+{
+    return error == WSAEWOULDBLOCK;
+}
+
+bool setNonBlocking(NativeSocket fd)
+{
+    u_long on = 1;
+    return ::ioctlsocket(fd, FIONBIO, &on) == 0;
+}
+
+void startWinsock()
+{
+    static const bool started = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    Q_UNUSED(started);
+}
+#else
+constexpr NativeSocket NoSocket = -1;
+constexpr int ShutdownSend = SHUT_WR;
+#ifdef MSG_NOSIGNAL
+constexpr int NoSignal = MSG_NOSIGNAL;
+#else
+constexpr int NoSignal = 0;
+#endif
+
+void closeSocket(NativeSocket fd)
+{
+    ::close(fd);
+}
+
+int pollSockets(pollfd* fds, int count, int timeoutMs)
+{
+    return ::poll(fds, static_cast<nfds_t>(count), timeoutMs);
+}
+
+int lastSocketError()
+{
+    return errno;
+}
+
+bool wouldBlock(int error)
+{
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+bool setNonBlocking(NativeSocket fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void startWinsock()
+{
+}
+#endif
+
+NativeSocket openSocket(int family, int type)
+{
+    startWinsock();
+    const NativeSocket fd = ::socket(family, type, type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP);
+#ifdef SO_NOSIGPIPE
+    // No MSG_NOSIGNAL here, a reset peer must not take the process down
+    if (fd != NoSocket) {
+        const int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    }
+#endif
+    return fd;
+}
+
+SocketLength toSockaddr(const QHostAddress& address, quint16 port, sockaddr_storage* out)
+{
+    std::memset(out, 0, sizeof(*out));
+    if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+        sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(out);
+        const Q_IPV6ADDR bytes = address.toIPv6Address();
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        std::memcpy(&in6->sin6_addr, bytes.c, sizeof(bytes.c));
+        return sizeof(sockaddr_in6);
+    }
+    sockaddr_in* in4 = reinterpret_cast<sockaddr_in*>(out);
+    in4->sin_family = AF_INET;
+    in4->sin_port = htons(port);
+    in4->sin_addr.s_addr = htonl(address.toIPv4Address());
+    return sizeof(sockaddr_in);
+}
+
+QString peerName(NativeSocket fd)
+{
+    sockaddr_storage address;
+    SocketLength length = sizeof(address);
+    if (::getpeername(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        return QString("unknown peer");
+    }
+    QHostAddress host(reinterpret_cast<const sockaddr*>(&address));
+    if (host.protocol() == QAbstractSocket::IPv6Protocol) {
+        bool mapped = false;
+        const quint32 v4 = host.toIPv4Address(&mapped);
+        if (mapped) {
+            host = QHostAddress(v4);
+        }
+    }
+    return host.toString();
+}
+
+// Waits for fd with poll, false on timeout or error
+bool waitFor(NativeSocket fd, short events, int timeoutMs)
+{
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    return pollSockets(&pfd, 1, timeoutMs) > 0 && (pfd.revents & events);
+}
+
+bool sendAll(NativeSocket fd, const void* data, int size, int timeoutMs)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const auto sent = ::send(fd, bytes, size, NoSignal);
+        if (sent > 0) {
+            bytes += sent;
+            size -= static_cast<int>(sent);
+        } else if (!wouldBlock(lastSocketError()) || !waitFor(fd, POLLOUT, timeoutMs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool receiveAll(NativeSocket fd, void* data, int size, int timeoutMs)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        if (!waitFor(fd, POLLIN, timeoutMs)) {
+            return false;
+        }
+        const auto received = ::recv(fd, bytes, size, 0);
+        if (received > 0) {
+            bytes += received;
+            size -= static_cast<int>(received);
+        } else if (received == 0 || !wouldBlock(lastSocketError())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads and clears the socket's pending error, 0 when there is none
+int pendingError(NativeSocket fd)
+{
+    int error = 0;
+    SocketLength errorLength = sizeof(error);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorLength) != 0) {
+        return lastSocketError();
+    }
+    return error;
+}
+
+bool connectWithin(NativeSocket fd, const sockaddr_storage& address, SocketLength length, int timeoutMs)
+{
+    if (!setNonBlocking(fd)) {
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), length) == 0) {
+        return true;
+    }
+    if (!waitFor(fd, POLLOUT, timeoutMs)) {
+        return false;
+    }
+    return pendingError(fd) == 0;
+}
+
+ThroughputReport toWire(const ThroughputReport& report)
+{
+    ThroughputReport wire;
+    wire.bytes = qToBigEndian(report.bytes);
+    wire.datagrams = qToBigEndian(report.datagrams);
+    wire.elapsedNs = qToBigEndian(report.elapsedNs);
+    return wire;
+}
+
+ThroughputReport fromWire(const ThroughputReport& wire)
+{
+    ThroughputReport report;
+    report.bytes = qFromBigEndian(wire.bytes);
+    report.datagrams = qFromBigEndian(wire.datagrams);
+    report.elapsedNs = qFromBigEndian(wire.elapsedNs);
+    return report;
+}
+
+double megabitsPerSecond(quint64 bytes, qint64 elapsedNs)
+{
+    return elapsedNs > 0 ? bytes * 8000.0 / elapsedNs : 0.0;
+}
+
+// Min, mean and max of RTT samples without keeping them
+struct RttSummary {
+    double min;
+    double max;
+    double sum;
+    int count;
+
+    RttSummary() : min(std::numeric_limits<double>::max()), max(0), sum(0), count(0) {}
+
+    void add(double rttMs)
+    {
+        min = qMin(min, rttMs);
+        max = qMax(max, rttMs);
+        sum += rttMs;
+        count++;
+    }
+
+    void store(ThroughputTest::Result* result) const
+    {
+        if (count > 0) {
+            result->rttMinMs = min;
+            result->rttAvgMs = sum / count;
+            result->rttMaxMs = max;
+        }
+        result->rttSamples = count;
+    }
+};
+
+// Smoothed RTT and retransmitted segments of a TCP connection
+bool readTcpInfo(NativeSocket fd, double* rttMs, qint64* retransmits)
+{
+#if defined(Q_OS_LINUX)
+    tcp_info info;
+    socklen_t length = sizeof(info);
+    if (::getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) != 0) {
+        return false;
+    }
+    *rttMs = info.tcpi_rtt / 1000.0;
+    *retransmits = info.tcpi_total_retrans;
+    return true;
+#elif defined(Q_OS_MACOS) && defined(TCP_CONNECTION_INFO)
+    tcp_connection_info info;
+    socklen_t length = sizeof(info);
+    if (::getsockopt(fd, IPPROTO_TCP, TCP_CONNECTION_INFO, &info, &length) != 0) {
+        return false;
+    }
+    *rttMs = info.tcpi_srtt;
+    *retransmits = static_cast<qint64>(info.tcpi_txretransmitpackets);
+    return true;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(rttMs);
+    Q_UNUSED(retransmits);
+    return false;
+#endif
+}
+
+// Completion notifications of MSG_ZEROCOPY sends
+struct ZeroCopy {
+    bool enabled;
+    quint64 completed;
+    quint64 copied;
+
+    ZeroCopy() : enabled(false), completed(0), copied(0) {}
+
+    bool enable(NativeSocket fd)
+    {
+#if defined(Q_OS_LINUX) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+        const int on = 1;
+        enabled = ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0;
+#else
+        Q_UNUSED(fd);
+#endif
+        return enabled;
+    }
+
+    int sendFlags() const
+    {
+#if defined(Q_OS_LINUX) && defined(MSG_ZEROCOPY)
+        return enabled ? MSG_ZEROCOPY : 0;
+#else
+        return 0;
+#endif
+    }
+
+    // Each notification covers a range of sends, and says if the kernel fell back to copying.
+    // Returns false when the error queue was empty, so a POLLERR was not a completion
+    bool reap(NativeSocket fd)
+    {
+#if defined(Q_OS_LINUX) && defined(SO_EE_ORIGIN_ZEROCOPY)
+        char control[128];
+        for (bool read = false;; read = true) {
+            msghdr message;
+            std::memset(&message, 0, sizeof(message));
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            if (::recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                return read;
+            }
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+                const sock_extended_err* error = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(header));
+                if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                    continue;
+                }
+                const quint32 count = error->ee_data - error->ee_info + 1;
+                completed += count;
+                if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    copied += count;
+                }
+            }
+        }
+#else
+        Q_UNUSED(fd);
+        return false;
+#endif
+    }
+};
+
+// One batch of UDP datagrams laid out back to back in one buffer
+class DatagramBatch
+{
+public:
+    DatagramBatch(int datagramSize)
+        : m_size(datagramSize)
+        , m_buffer(UdpBatch * datagramSize, 'U')
+    {
+#ifdef Q_OS_LINUX
+        std::memset(m_messages, 0, sizeof(m_messages));
+        for (int i = 0; i < UdpBatch; ++i) {
+            m_vectors[i].iov_base = m_buffer.data() + i * m_size;
+            m_vectors[i].iov_len = static_cast<size_t>(m_size);
+            m_messages[i].msg_hdr.msg_iov = &m_vectors[i];
+            m_messages[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+
+    void stamp(int index, quint32 session, quint64 sequence, qint64 nowNs)
+    {
+        ThroughputDatagram header;
+        header.session = qToBigEndian(session);
+        header.reserved = 0;
+        header.sequence = qToBigEndian(sequence);
+        header.sendNs = qToBigEndian(nowNs);
+        std::memcpy(m_buffer.data() + index * m_size, &header, sizeof(header));
+    }
+
+    // Sends the first count datagrams on a connected socket, returns how many left
+    int send(NativeSocket fd, int count)
+    {
+#ifdef Q_OS_LINUX
+        const int sent = ::sendmmsg(fd, m_messages, static_cast<unsigned int>(count), 0);
+        return sent > 0 ? sent : 0;
+#else
+        int sent = 0;
+        while (sent < count && ::send(fd, m_buffer.constData() + sent * m_size, m_size, NoSignal) == m_size) {
+            sent++;
+        }
+        return sent;
+#endif
+    }
+
+private:
+    int m_size;
+    QByteArray m_buffer;
+#ifdef Q_OS_LINUX
+    mmsghdr m_messages[UdpBatch];
+    iovec m_vectors[UdpBatch];
+#endif
+};
+
+// Reads every echo waiting on the client's UDP socket
+void readEchoes(NativeSocket fd, quint32 session, RttSummary* rtt)
+{
+    ThroughputDatagram echo;
+    while (::recv(fd, reinterpret_cast<char*>(&echo), sizeof(echo), 0) == static_cast<int>(sizeof(echo))) {
+        if (qFromBigEndian(echo.session) == session) {
+            rtt->add((probeClockNs() - qFromBigEndian(echo.sendNs)) / 1000000.0);
+        }
+    }
+}
+
+}
+
+QString ThroughputTest::Result::summary() const
+{
+    if (!ok()) {
+        return QString("Throughput test failed: %1").arg(error);
+    }
+
+    QString text = QString("%1 throughput %2 s: %3 Mbit/s goodput, %4 MB")
+                   .arg(mode == Mode::Tcp ? "TCP" : "UDP")
+                   .arg(durationMs / 1000.0, 0, 'f', 1)
+                   .arg(goodputMbps, 0, 'f', 1)
+                   .arg(bytes / 1e6, 0, 'f', 1);
+    if (mode == Mode::Tcp) {
+        text += retransmits >= 0 ? QString(", %1 retransmits").arg(retransmits) : QString(", retransmits unknown");
+        if (zeroCopy) {
+            text += QString(", zero-copy (%1% copied by the kernel)").arg(copiedPercent, 0, 'f', 0);
+        }
+    } else {
+        text += QString(", %1 of %2 datagrams arrived (%3% lost)")
+                .arg(datagramsReceived)
+                .arg(datagramsSent)
+                .arg(lossPercent(), 0, 'f', 2);
+    }
+    if (rttSamples > 0) {
+        text += QString(", RTT under load %1/%2/%3 ms (min/avg/max)")
+                .arg(rttMinMs, 0, 'f', 2)
+                .arg(rttAvgMs, 0, 'f', 2)
+                .arg(rttMaxMs, 0, 'f', 2);
+    }
+    return text;
+}
+
+ThroughputTest::ThroughputTest(QObject *parent)
+    : QObject(parent)
+    , m_thread(nullptr)
+    , m_stop(false)
+{
+}
+
+ThroughputTest::~ThroughputTest()
+{
+    stop();
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool ThroughputTest::start(const Config& config)
+{
+    if (isRunning() || config.reflector.isNull()) {
+        return false;
+    }
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+
+    m_stop = false;
+    m_thread = QThread::create([this, config]() {
+        const Result result = run(config);
+        // Handed to the owner's thread, a queued signal would need Result registered as a metatype
+        QMetaObject::invokeMethod(this, [this, result]() {
+            emit finished(result);
+        }, Qt::QueuedConnection);
+    });
+    m_thread->start();
+    return true;
+}
+
+void ThroughputTest::stop()
+{
+    m_stop = true;
+}
+
+bool ThroughputTest::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void ThroughputTest::reportProgress(quint64 bytes, qint64 elapsedNs)
+{
+    emit progress(megabitsPerSecond(bytes, elapsedNs), static_cast<int>(elapsedNs / NsPerMs));
+}
+
+ThroughputTest::Result ThroughputTest::run(const Config& config)
+{
+    Result result;
+    result.mode = config.mode;
+    result.durationMs = config.durationMs;
+
+    sockaddr_storage address;
+    const SocketLength length = toSockaddr(config.reflector, config.port, &address);
+    const NativeSocket control = openSocket(address.ss_family, SOCK_STREAM);
+    if (control == NoSocket) {
+        result.error = "Could not open a socket";
+        return result;
+    }
+    if (!connectWithin(control, address, length, ControlTimeoutMs)) {
+        closeSocket(control);
+        result.error = QString("No reflector at %1 port %2").arg(config.reflector.toString()).arg(config.port);
+        return result;
+    }
+
+    ThroughputHello hello;
+    std::memcpy(hello.magic, "PTTP", sizeof(hello.magic));
+    hello.version = ProtocolVersion;
+    hello.mode = static_cast<quint8>(config.mode);
+    hello.reserved = 0;
+    const quint32 session = QRandomGenerator::global()->generate();
+    hello.session = qToBigEndian(session);
+    hello.durationMs = qToBigEndian(static_cast<quint32>(config.durationMs));
+    if (!sendAll(control, &hello, sizeof(hello), ControlTimeoutMs)) {
+        closeSocket(control);
+        result.error = "Reflector closed the connection";
+        return result;
+    }
+
+    if (config.mode == Mode::Tcp) {
+        runTcp(static_cast<qintptr>(control), config, &result);
+    } else {
+        runUdp(static_cast<qintptr>(control), session, config, &result);
+    }
+    closeSocket(control);
+    return result;
+}
+
+void ThroughputTest::runTcp(qintptr control, const Config& config, Result* result)
+{
+    const NativeSocket fd = static_cast<NativeSocket>(control);
+    ZeroCopy zeroCopy;
+    result->zeroCopy = zeroCopy.enable(fd);
+
+    // The payload never changes, so a chunk may go out again before the kernel is done with its pages
+    const QByteArray payload(TcpChunkSize, 'P');
+    RttSummary rtt;
+    quint64 sent = 0;
+    const qint64 startNs = probeClockNs();
+    const qint64 endNs = startNs + config.durationMs * NsPerMs;
+    qint64 nextSampleNs = startNs;
+
+    for (qint64 nowNs = startNs; nowNs < endNs && !m_stop; nowNs = probeClockNs()) {
+        if (nowNs >= nextSampleNs) {
+            double rttMs;
+            qint64 retransmits;
+            if (readTcpInfo(fd, &rttMs, &retransmits) && sent > 0) {
+                rtt.add(rttMs);
+            }
+            reportProgress(sent, nowNs - startNs);
+            nextSampleNs = nowNs + ProgressIntervalMs * NsPerMs;
+        }
+
+        // Zero-copy completions show up as POLLERR and are only counted. A POLLERR
+        // with nothing queued is the connection's own error, which stays raised
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        pollSockets(&pfd, 1, 50);
+        if ((pfd.revents & POLLERR) && !zeroCopy.reap(fd) && pendingError(fd) != 0) {
+            result->error = "Connection lost while sending";
+            return;
+        }
+        if (!(pfd.revents & (POLLOUT | POLLHUP)) && !(pfd.revents & POLLERR && !zeroCopy.enabled)) {
+            continue;
+        }
+
+        const auto written = ::send(fd, payload.constData(), payload.size(), NoSignal | zeroCopy.sendFlags());
+        if (written > 0) {
+            sent += static_cast<quint64>(written);
+            continue;
+        }
+        const int error = lastSocketError();
+#ifdef ENOBUFS
+        if (error == ENOBUFS) {
+            zeroCopy.reap(fd); // Too many completions unread
+            continue;
+        }
+#endif
+        if (!wouldBlock(error)) {
+            result->error = "Connection lost while sending";
+            return;
+        }
+    }
+    result->durationMs = static_cast<int>((probeClockNs() - startNs) / NsPerMs); // Shorter when stopped
+
+    // Whatever is still buffered drains before the reflector sees the end, completions keep coming meanwhile
+    ::shutdown(fd, ShutdownSend);
+    const qint64 deadlineNs = probeClockNs() + ReportTimeoutMs * NsPerMs;
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    do {
+        pfd.revents = 0;
+        pollSockets(&pfd, 1, 100);
+        if (!zeroCopy.reap(fd) && (pfd.revents & POLLERR) && pendingError(fd) != 0) {
+            result->error = "Connection lost while sending";
+            return;
+        }
+    } while (!(pfd.revents & (POLLIN | POLLHUP)) && probeClockNs() < deadlineNs);
+
+    double lastRtt;
+    readTcpInfo(fd, &lastRtt, &result->retransmits);
+    rtt.store(result);
+    if (zeroCopy.completed > 0) {
+        result->copiedPercent = 100.0 * zeroCopy.copied / zeroCopy.completed;
+    }
+
+    ThroughputReport report;
+    if (!receiveAll(fd, &report, sizeof(report), ControlTimeoutMs)) {
+        result->error = "Reflector sent no report";
+        return;
+    }
+    report = fromWire(report);
+    result->bytes = report.bytes;
+    result->goodputMbps = megabitsPerSecond(report.bytes, static_cast<qint64>(report.elapsedNs));
+}
+
+void ThroughputTest::runUdp(qintptr control, quint32 session, const Config& config, Result* result)
+{
+    const NativeSocket controlFd = static_cast<NativeSocket>(control);
+    sockaddr_storage address;
+    const SocketLength length = toSockaddr(config.reflector, config.port, &address);
+    const NativeSocket fd = openSocket(address.ss_family, SOCK_DGRAM);
+    if (fd == NoSocket || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), length) != 0 || !setNonBlocking(fd)) {
+        if (fd != NoSocket) {
+            closeSocket(fd);
+        }
+        result->error = "Could not open the UDP socket";
+        return;
+    }
+
+    const int size = qBound(static_cast<int>(sizeof(ThroughputDatagram)), config.datagramSize, MaxDatagramSize);
+    DatagramBatch batch(size);
+    const double bytesPerNs = qMax(0.001, config.udpRateMbps) * 1e6 / 8 / 1e9;
+    RttSummary rtt;
+    quint64 sequence = 0;
+    quint64 sentBytes = 0;
+    const qint64 startNs = probeClockNs();
+    const qint64 endNs = startNs + config.durationMs * NsPerMs;
+    qint64 nextSampleNs = startNs;
+    qint64 nowNs = startNs;
+
+    for (; nowNs < endNs && !m_stop; nowNs = probeClockNs()) {
+        if (nowNs >= nextSampleNs) {
+            reportProgress(sentBytes, nowNs - startNs);
+            nextSampleNs = nowNs + ProgressIntervalMs * NsPerMs;
+        }
+
+        // Paced by the bytes already sent, echoes are read while waiting for the next batch
+        const qint64 dueNs = startNs + static_cast<qint64>(sentBytes / bytesPerNs);
+        if (nowNs < dueNs) {
+            waitFor(fd, POLLIN, static_cast<int>((dueNs - nowNs) / NsPerMs));
+            readEchoes(fd, session, &rtt);
+            continue;
+        }
+
+        for (int i = 0; i < UdpBatch; ++i) {
+            batch.stamp(i, session, sequence + i, nowNs);
+        }
+        const int sent = batch.send(fd, UdpBatch);
+        if (sent == 0) {
+            waitFor(fd, POLLOUT, 10); // Send buffer full
+        }
+        sequence += sent;
+        sentBytes += static_cast<quint64>(sent) * size;
+        readEchoes(fd, session, &rtt);
+    }
+
+    ThroughputReport sentReport;
+    sentReport.bytes = sentBytes;
+    sentReport.datagrams = sequence;
+    sentReport.elapsedNs = static_cast<quint64>(nowNs - startNs);
+    ThroughputReport wire = toWire(sentReport);
+    result->datagramsSent = sequence;
+    result->durationMs = static_cast<int>((nowNs - startNs) / NsPerMs);
+
+    // The reflector waits for stragglers before it answers, late echoes still count
+    ThroughputReport report;
+    bool answered = sendAll(controlFd, &wire, sizeof(wire), ControlTimeoutMs);
+    if (answered) {
+        pollfd fds[2];
+        fds[0].fd = controlFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = fd;
+        fds[1].events = POLLIN;
+        const qint64 deadlineNs = probeClockNs() + ReportTimeoutMs * NsPerMs;
+        for (;;) {
+            fds[0].revents = 0;
+            fds[1].revents = 0;
+            if (probeClockNs() >= deadlineNs || pollSockets(fds, 2, 100) < 0) {
+                answered = false;
+                break;
+            }
+            readEchoes(fd, session, &rtt);
+            if (fds[0].revents) {
+                answered = receiveAll(controlFd, &report, sizeof(report), ControlTimeoutMs);
+                break;
+            }
+        }
+    }
+    closeSocket(fd);
+
+    rtt.store(result);
+    if (!answered) {
+        result->error = "Reflector sent no report";
+        return;
+    }
+    report = fromWire(report);
+    result->bytes = report.bytes;
+    result->datagramsReceived = report.datagrams;
+    result->goodputMbps = megabitsPerSecond(report.bytes, static_cast<qint64>(report.elapsedNs));
+}
+
+ThroughputReflector::ThroughputReflector(QObject *parent)
+    : QObject(parent)
+    , m_thread(nullptr)
+    , m_stop(false)
+{
+}
+
+ThroughputReflector::~ThroughputReflector()
+{
+    stop();
+}
+
+bool ThroughputReflector::start(quint16 port, QString* error)
+{
+    if (isRunning()) {
+        return true;
+    }
+
+    // Dual-stack where the system allows it, IPv4 only otherwise
+    NativeSocket listener = NoSocket;
+    NativeSocket udp = NoSocket;
+    for (const int family : {AF_INET6, AF_INET}) {
+        const QHostAddress any(family == AF_INET6 ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4);
+        sockaddr_storage address;
+        const SocketLength length = toSockaddr(any, port, &address);
+        listener = openSocket(family, SOCK_STREAM);
+        udp = openSocket(family, SOCK_DGRAM);
+        if (listener != NoSocket && udp != NoSocket) {
+            const int on = 1;
+            const int off = 0;
+            ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+            if (family == AF_INET6) {
+                ::setsockopt(listener, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&off), sizeof(off));
+                ::setsockopt(udp, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&off), sizeof(off));
+            }
+            // Room for a burst while the reflector is busy echoing
+            const int receiveBuffer = 4 * 1024 * 1024;
+            ::setsockopt(udp, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receiveBuffer), sizeof(receiveBuffer));
+
+            if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), length) == 0
+                && ::bind(udp, reinterpret_cast<const sockaddr*>(&address), length) == 0
+                && ::listen(listener, 4) == 0 && setNonBlocking(listener) && setNonBlocking(udp)) {
+                break;
+            }
+        }
+        if (listener != NoSocket) {
+            closeSocket(listener);
+        }
+        if (udp != NoSocket) {
+            closeSocket(udp);
+        }
+        listener = NoSocket;
+        udp = NoSocket;
+    }
+
+    if (listener == NoSocket) {
+        if (error) {
+            *error = QString("Could not listen on port %1").arg(port);
+        }
+        return false;
+    }
+
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+    m_stop = false;
+    m_thread = QThread::create([this, listener, udp]() {
+        serve(static_cast<qintptr>(listener), static_cast<qintptr>(udp));
+    });
+    m_thread->start();
+    return true;
+}
+
+void ThroughputReflector::stop()
+{
+    m_stop = true;
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+}
+
+bool ThroughputReflector::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void ThroughputReflector::serve(qintptr listener, qintptr udp)
+{
+    const NativeSocket listenFd = static_cast<NativeSocket>(listener);
+    const NativeSocket udpFd = static_cast<NativeSocket>(udp);
+    char discard[64];
+
+    while (!m_stop) {
+        pollfd fds[2];
+        fds[0].fd = listenFd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = udpFd;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (pollSockets(fds, 2, 200) <= 0) {
+            continue;
+        }
+
+        // Stragglers of a finished test
+        while (fds[1].revents && ::recv(udpFd, discard, sizeof(discard), 0) >= 0) {
+        }
+
+        if (fds[0].revents & POLLIN) {
+            const NativeSocket control = ::accept(listenFd, nullptr, nullptr);
+            if (control == NoSocket) {
+                continue;
+            }
+            setNonBlocking(control);
+            const QString summary = serveSession(static_cast<qintptr>(control), udp);
+            closeSocket(control);
+            if (!summary.isEmpty()) {
+                emit sessionFinished(summary);
+            }
+        }
+    }
+
+    closeSocket(listenFd);
+    closeSocket(udpFd);
+}
+
+QString ThroughputReflector::serveSession(qintptr control, qintptr udp)
+{
+    const NativeSocket fd = static_cast<NativeSocket>(control);
+    const NativeSocket udpFd = static_cast<NativeSocket>(udp);
+    const QString peer = peerName(fd);
+
+    ThroughputHello hello;
+    if (!receiveAll(fd, &hello, sizeof(hello), ControlTimeoutMs) || std::memcmp(hello.magic, "PTTP", 4) != 0
+        || hello.version != ProtocolVersion || hello.mode > static_cast<quint8>(ThroughputTest::Mode::Udp)) {
+        return QString("Reflector: ignored a connection from %1 that is not a throughput test").arg(peer);
+    }
+    const quint32 session = qFromBigEndian(hello.session);
+    const bool tcp = hello.mode == static_cast<quint8>(ThroughputTest::Mode::Tcp);
+
+    ThroughputReport report;
+    report.bytes = 0;
+    report.datagrams = 0;
+    report.elapsedNs = 0;
+    qint64 firstNs = 0;
+    qint64 lastNs = 0;
+    qint64 idleSinceNs = probeClockNs();
+    bool complete = false;
+
+    if (tcp) {
+        // A sink: count and drop until the client shuts down its side
+        QByteArray buffer(ReceiveBufferSize, Qt::Uninitialized);
+        while (!m_stop && probeClockNs() - idleSinceNs < IdleTimeoutMs * NsPerMs) {
+            if (!waitFor(fd, POLLIN, 200)) {
+                continue;
+            }
+            const auto received = ::recv(fd, buffer.data(), buffer.size(), 0);
+            if (received == 0) {
+                complete = true;
+                break;
+            }
+            if (received < 0) {
+                if (wouldBlock(lastSocketError())) {
+                    continue;
+                }
+                break;
+            }
+            lastNs = probeClockNs();
+            firstNs = firstNs ? firstNs : lastNs;
+            idleSinceNs = lastNs;
+            report.bytes += static_cast<quint64>(received);
+        }
+    } else {
+        // Count this session's datagrams, reflect every EchoEvery-th header for latency under load
+        QByteArray buffer(UdpBatch * MaxDatagramSize, Qt::Uninitialized);
+        sockaddr_storage sources[UdpBatch];
+#ifdef Q_OS_LINUX
+        mmsghdr messages[UdpBatch];
+        iovec vectors[UdpBatch];
+        for (int i = 0; i < UdpBatch; ++i) {
+            vectors[i].iov_base = buffer.data() + i * MaxDatagramSize;
+            vectors[i].iov_len = MaxDatagramSize;
+        }
+#endif
+        qint64 drainUntilNs = 0;
+        while (!m_stop && probeClockNs() - idleSinceNs < IdleTimeoutMs * NsPerMs) {
+            if (drainUntilNs && probeClockNs() >= drainUntilNs) {
+                complete = true;
+                break;
+            }
+
+            pollfd fds[2];
+            fds[0].fd = fd;
+            fds[0].events = POLLIN;
+            fds[0].revents = 0;
+            fds[1].fd = udpFd;
+            fds[1].events = POLLIN;
+            fds[1].revents = 0;
+            pollSockets(fds, 2, 50);
+
+            if (fds[0].revents && !drainUntilNs) {
+                // The client is done, its report ends the test once stragglers had time to arrive
+                ThroughputReport sent;
+                if (!receiveAll(fd, &sent, sizeof(sent), ControlTimeoutMs)) {
+                    break;
+                }
+                drainUntilNs = probeClockNs() + DrainMs * NsPerMs;
+            }
+            if (!(fds[1].revents & POLLIN)) {
+                continue;
+            }
+
+            int count;
+            int sizes[UdpBatch];
+            SocketLength sourceLengths[UdpBatch];
+#ifdef Q_OS_LINUX
+            std::memset(messages, 0, sizeof(messages));
+            for (int i = 0; i < UdpBatch; ++i) {
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+                messages[i].msg_hdr.msg_name = &sources[i];
+                messages[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+            }
+            count = qMax(0, ::recvmmsg(udpFd, messages, UdpBatch, MSG_DONTWAIT, nullptr));
+            for (int i = 0; i < count; ++i) {
+                sizes[i] = static_cast<int>(messages[i].msg_len);
+                sourceLengths[i] = messages[i].msg_hdr.msg_namelen;
+            }
+#else
+            for (count = 0; count < UdpBatch; ++count) {
+                sourceLengths[count] = sizeof(sources[count]);
+                const auto received = ::recvfrom(udpFd, buffer.data() + count * MaxDatagramSize, MaxDatagramSize, 0,
+                                                 reinterpret_cast<sockaddr*>(&sources[count]), &sourceLengths[count]);
+                if (received < 0) {
+                    break;
+                }
+                sizes[count] = static_cast<int>(received);
+            }
+#endif
+            const qint64 nowNs = probeClockNs();
+            for (int i = 0; i < count; ++i) {
+                const char* data = buffer.constData() + i * MaxDatagramSize;
+                ThroughputDatagram header;
+                if (sizes[i] < static_cast<int>(sizeof(header))) {
+                    continue;
+                }
+                std::memcpy(&header, data, sizeof(header));
+                if (qFromBigEndian(header.session) != session) {
+                    continue;
+                }
+                report.bytes += static_cast<quint64>(sizes[i]);
+                report.datagrams++;
+                lastNs = nowNs;
+                firstNs = firstNs ? firstNs : nowNs;
+                idleSinceNs = nowNs;
+                if (qFromBigEndian(header.sequence) % ThroughputTest::EchoEvery == 0) {
+                    ::sendto(udpFd, data, sizeof(header), 0, reinterpret_cast<const sockaddr*>(&sources[i]), sourceLengths[i]);
+                }
+            }
+        }
+    }
+
+    if (!complete) {
+        return QString("Reflector: throughput test from %1 ended without finishing").arg(peer);
+    }
+
+    report.elapsedNs = static_cast<quint64>(lastNs - firstNs);
+    const ThroughputReport wire = toWire(report);
+    sendAll(fd, &wire, sizeof(wire), ControlTimeoutMs);
+    return QString("Reflector: %1 throughput test from %2, %3 MB at %4 Mbit/s%5")
+           .arg(tcp ? "TCP" : "UDP")
+           .arg(peer)
+           .arg(report.bytes / 1e6, 0, 'f', 1)
+           .arg(megabitsPerSecond(report.bytes, static_cast<qint64>(report.elapsedNs)), 0, 'f', 1)
+           .arg(tcp ? QString() : QString(", %1 datagrams").arg(report.datagrams));
+}
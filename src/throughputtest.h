@@ -0,0 +1,149 @@
+#ifndef THROUGHPUTTEST_H
+#define THROUGHPUTTEST_H
+
+#include <QObject>
+#include <QThread>
+#include <QHostAddress>
+#include <QString>
+#include <atomic>
+
+// Bulk-throughput test between a ThroughputTest client and a
+// ThroughputReflector, usually a second PingTracer process.
+//
+// The client opens a TCP control connection and sends a ThroughputHello. In
+// TCP mode the same connection then carries the load: the client sends for
+// the test's duration (MSG_ZEROCOPY where the system has it), shuts down its
+// side and the reflector answers with a ThroughputReport of what it took in.
+// In UDP mode the load goes as datagrams in batches (sendmmsg/recvmmsg where
+// available) at a paced rate, every EchoEvery-th datagram is reflected back
+// for latency under load, and the reports are exchanged on the control
+// connection once the client is done.
+//
+// Both ends run a blocking loop on a thread of their own, so a test at line
+// rate never competes with the tracer's event loops.
+
+// Multi-byte fields travel big-endian
+struct ThroughputHello {
+    char magic[4];          // "PTTP"
+    quint8 version;
+    quint8 mode;            // ThroughputTest::Mode
+    quint16 reserved;
+    quint32 session;        // Tags this test's UDP datagrams
+    quint32 durationMs;
+};
+
+struct ThroughputDatagram {
+    quint32 session;
+    quint32 reserved;
+    quint64 sequence;
+    qint64 sendNs;          // Client clock, reflected unchanged
+};
+
+struct ThroughputReport {
+    quint64 bytes;          // Payload bytes
+    quint64 datagrams;      // 0 for TCP
+    quint64 elapsedNs;      // First to last byte at the reflector, or the client's send time
+};
+
+static_assert(sizeof(ThroughputHello) == 16 && sizeof(ThroughputDatagram) == 24 && sizeof(ThroughputReport) == 24,
+              "Throughput messages are sent as their in-memory bytes");
+
+class ThroughputTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 DefaultPort = 5210;
+    static constexpr int EchoEvery = 64;
+
+    enum class Mode : quint8 {
+        Tcp,
+        Udp
+    };
+
+    struct Config {
+        QHostAddress reflector;
+        quint16 port;
+        Mode mode;
+        int durationMs;
+        double udpRateMbps;   // Offered UDP load, TCP sends as fast as it can
+        int datagramSize;     // UDP payload bytes per datagram
+
+        Config() : port(DefaultPort), mode(Mode::Tcp), durationMs(10000), udpRateMbps(100), datagramSize(1200) {}
+    };
+
+    struct Result {
+        QString error;          // Empty if the test ran
+        Mode mode;
+        int durationMs;
+        quint64 bytes;          // Received by the reflector
+        double goodputMbps;
+        qint64 retransmits;     // TCP segments retransmitted, -1 where the system does not tell
+        bool zeroCopy;          // TCP load went out with MSG_ZEROCOPY
+        double copiedPercent;   // Zero-copy sends the kernel copied anyway (always so on loopback)
+        quint64 datagramsSent;
+        quint64 datagramsReceived;
+        double rttMinMs;        // Latency under load: the connection's smoothed RTT (TCP) or the echoes (UDP)
+        double rttAvgMs;
+        double rttMaxMs;
+        int rttSamples;
+
+        Result() : mode(Mode::Tcp), durationMs(0), bytes(0), goodputMbps(0), retransmits(-1), zeroCopy(false),
+                   copiedPercent(0), datagramsSent(0), datagramsReceived(0), rttMinMs(-1), rttAvgMs(-1),
+                   rttMaxMs(-1), rttSamples(0) {}
+
+        bool ok() const { return error.isEmpty(); }
+        double lossPercent() const
+        {
+            return datagramsSent > 0 ? 100.0 * (datagramsSent - qMin(datagramsReceived, datagramsSent)) / datagramsSent : 0.0;
+        }
+        QString summary() const;
+    };
+
+    explicit ThroughputTest(QObject *parent = nullptr);
+    ~ThroughputTest();
+
+    bool start(const Config& config);
+    void stop();
+    bool isRunning() const;
+
+signals:
+    // Client-side send rate, a few times per second
+    void progress(double sentMbps, int elapsedMs);
+    void finished(const ThroughputTest::Result& result);
+
+private:
+    Result run(const Config& config);
+    void runTcp(qintptr control, const Config& config, Result* result);
+    void runUdp(qintptr control, quint32 session, const Config& config, Result* result);
+    void reportProgress(quint64 bytes, qint64 elapsedNs);
+
+    QThread* m_thread;
+    std::atomic<bool> m_stop;
+};
+
+class ThroughputReflector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThroughputReflector(QObject *parent = nullptr);
+    ~ThroughputReflector();
+
+    // Listens on port for TCP and UDP, one test at a time
+    bool start(quint16 port, QString* error);
+    void stop();
+    bool isRunning() const;
+
+signals:
+    void sessionFinished(const QString& summary);
+
+private:
+    void serve(qintptr listener, qintptr udp);
+    QString serveSession(qintptr control, qintptr udp);
+
+    QThread* m_thread;
+    std::atomic<bool> m_stop;
+};
+
+#endif // THROUGHPUTTEST_H
@@ -0,0 +1,265 @@
+#include "topologygraph.h"
+#include <QHostInfo>
+
+TopologyGraph::Node::Node()
+    : address(AddressTable::InvalidId)
+    , lookupIssued(false)
+    , paths(0)
+    , sent(0)
+    , received(0)
+    , rttSum(0)
+    , bestTime(-1)
+    , worstTime(-1)
+    , lastResult()
+    , lastProbeMs(-1)
+    , lastProbePath(-1)
+    , lastProbeSequence(0)
+{
+}
+
+TopologyGraph& TopologyGraph::instance()
+{
+    static TopologyGraph instance;
+    return instance;
+}
+
+TopologyGraph::TopologyGraph(QObject *parent)
+    : QObject(parent)
+    , m_probesShared(0)
+    , m_lookupsShared(0)
+    , m_probeSequence(0)
+{
+    m_clock.start();
+}
+
+int TopologyGraph::addPath()
+{
+    int path;
+    if (!m_freePaths.isEmpty()) {
+        path = m_freePaths.takeLast();
+    } else {
+        path = m_paths.size();
+        m_paths.append(Path());
+    }
+    m_paths[path].active = true;
+    return path;
+}
+
+void TopologyGraph::removePath(int path)
+{
+    if (path < 0 || path >= m_paths.size() || !m_paths[path].active) {
+        return;
+    }
+    clearPath(path);
+    m_paths[path].active = false;
+    m_freePaths.append(path);
+}
+
+void TopologyGraph::clearPath(int path)
+{
+    if (path < 0 || path >= m_paths.size()) {
+        return;
+    }
+
+    Path& p = m_paths[path];
+    for (int hop = p.nodes.size(); hop >= 1; --hop) {
+        setPathHop(p, hop, -1);
+    }
+    p.nodes.clear();
+    p.borrowed.clear();
+    p.borrowRun.clear();
+}
+
+int TopologyGraph::nodeFor(AddressId address)
+{
+    if (address >= static_cast<AddressId>(m_nodeByAddress.size())) {
+        m_nodeByAddress.resize(address + 1, -1);
+    }
+
+    int& index = m_nodeByAddress[address];
+    if (index < 0) {
+        index = m_nodes.size();
+        Node node;
+        node.address = address;
+        m_nodes.append(node);
+    }
+    return index;
+}
+
+const TopologyGraph::Node* TopologyGraph::node(AddressId address) const
+{
+    if (address >= static_cast<AddressId>(m_nodeByAddress.size()) || m_nodeByAddress[address] < 0) {
+        return nullptr;
+    }
+    return &m_nodes[m_nodeByAddress[address]];
+}
+
+void TopologyGraph::linkEdge(int from, int to, int delta)
+{
+    if (from < 0 || to < 0) {
+        return;
+    }
+    Edge& edge = m_edges[edgeKey(from, to)];
+    edge.paths += delta;
+    if (delta > 0) {
+        edge.lastSeenMs = m_clock.elapsed();
+    }
+}
+
+void TopologyGraph::setPathHop(Path& path, int hop, int node)
+{
+    if (hop > path.nodes.size()) {
+        path.nodes.resize(hop, -1);
+        path.borrowed.resize(hop, 0);
+        path.borrowRun.resize(hop, 0);
+    }
+
+    int& slot = path.nodes[hop - 1];
+    if (slot == node) {
+        return;
+    }
+
+    // Only the edges on either side of the hop change
+    const int previous = hop >= 2 ? path.nodes[hop - 2] : -1;
+    const int next = hop < path.nodes.size() ? path.nodes[hop] : -1;
+
+    if (slot >= 0) {
+        m_nodes[slot].paths--;
+        linkEdge(previous, slot, -1);
+        linkEdge(slot, next, -1);
+    }
+
+    slot = node;
+    path.borrowed[hop - 1] = 0;
+
+    if (node >= 0) {
+        m_nodes[node].paths++;
+        linkEdge(previous, node, 1);
+        linkEdge(node, next, 1);
+    }
+}
+
+void TopologyGraph::recordProbe(int path, const ProbeResult& result)
+{
+    if (path < 0 || path >= m_paths.size() || result.hop < 1) {
+        return;
+    }
+
+    // Timeouts carry no responder, they count for the node already on this hop
+    Path& p = m_paths[path];
+    int index = -1;
+    if (result.success()) {
+        index = nodeFor(result.address);
+        setPathHop(p, result.hop, index);
+    } else if (result.hop <= p.nodes.size()) {
+        index = p.nodes[result.hop - 1];
+    }
+    if (index < 0) {
+        return;
+    }
+    p.borrowRun[result.hop - 1] = 0;
+
+    Node& node = m_nodes[index];
+    node.sent++;
+    if (result.success()) {
+        const double rtt = result.rttMs();
+        node.received++;
+        node.rttSum += rtt;
+        node.bestTime = node.bestTime < 0 ? rtt : qMin(node.bestTime, rtt);
+        node.worstTime = qMax(node.worstTime, rtt);
+    }
+
+    if (result.status == ProbeStatus::Success || result.status == ProbeStatus::Timeout) {
+        node.lastResult = result;
+        node.lastResult.address = node.address;
+        node.lastProbeMs = m_clock.elapsed();
+        node.lastProbePath = path;
+        node.lastProbeSequence = ++m_probeSequence;
+    }
+}
+
+bool TopologyGraph::borrowProbe(int path, int hop, AddressId address, qint64 maxAgeMs, ProbeResult* result)
+{
+    if (path < 0 || path >= m_paths.size() || hop < 1) {
+        return false;
+    }
+
+    const Node* n = node(address);
+    if (!n || n->lastProbeMs < 0 || n->lastProbePath == path || n->lastResult.hop != hop
+        || m_clock.elapsed() - n->lastProbeMs > maxAgeMs) {
+        return false;
+    }
+
+    // The caller's hop answered before, so a loss on the other path says
+    // nothing certain about this one; it is checked with a probe of its own
+    if (!n->lastResult.success()) {
+        return false;
+    }
+
+    // Each result is lent to a path once, a second turn needs a new probe,
+    // and a hop that kept borrowing has to probe again now and then
+    Path& p = m_paths[path];
+    if (hop <= p.borrowed.size()
+        && (p.borrowed[hop - 1] == n->lastProbeSequence || p.borrowRun[hop - 1] >= MaxBorrowRun)) {
+        return false;
+    }
+    setPathHop(p, hop, m_nodeByAddress[address]);
+    p.borrowed[hop - 1] = n->lastProbeSequence;
+    p.borrowRun[hop - 1]++;
+
+    *result = n->lastResult;
+    m_probesShared++;
+    return true;
+}
+
+QString TopologyGraph::lookupHostname(AddressId address)
+{
+    Node& n = m_nodes[nodeFor(address)];
+    if (n.lookupIssued) {
+        m_lookupsShared++;
+        return n.hostname;
+    }
+
+    n.lookupIssued = true;
+    QHostInfo::lookupHost(AddressTable::instance().toString(address), this, [this, address](const QHostInfo& info) {
+        if (info.error() == QHostInfo::NoError && !info.hostName().isEmpty()) {
+            m_nodes[m_nodeByAddress[address]].hostname = info.hostName();
+            emit hostnameResolved(address, info.hostName());
+        }
+    });
+    return QString();
+}
+
+void TopologyGraph::seedHostname(AddressId address, const QString& hostname)
+{
+    Node& n = m_nodes[nodeFor(address)];
+    if (n.hostname.isEmpty()) {
+        n.hostname = hostname;
+    }
+    n.lookupIssued = true;
+}
+
+TopologyGraph::Stats TopologyGraph::stats() const
+{
+    Stats stats;
+    stats.nodes = m_nodes.size();
+    for (const Edge& edge : m_edges) {
+        if (edge.paths > 0) {
+            stats.edges++;
+        }
+    }
+    for (const Path& path : m_paths) {
+        if (!path.active) {
+            continue;
+        }
+        stats.paths++;
+        for (int node : path.nodes) {
+            if (node >= 0) {
+                stats.pathHops++;
+            }
+        }
+    }
+    stats.probesShared = m_probesShared;
+    stats.lookupsShared = m_lookupsShared;
+    return stats;
+}
@@ -0,0 +1,126 @@
+#ifndef TOPOLOGYGRAPH_H
+#define TOPOLOGYGRAPH_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QElapsedTimer>
+#include "addresstable.h"
+#include "proberesultqueue.h"
+
+// Router topology shared by every tracer in the process.
+//
+// Nodes are router interfaces, one per AddressId, and edges are adjacencies
+// seen between consecutive hops of some path. Each tracer owns a path that
+// points into the graph, so a router on many paths keeps one set of
+// statistics and one hostname. A tracer about to probe a hop that another
+// path probed at the same TTL within the last interval borrows that result
+// instead of sending its own probe. Every MaxBorrowRun-th turn, and whenever
+// the other path lost its probe, a hop probes for itself so a path of its own
+// is still noticed.
+//
+// Lookups are O(1): AddressIds are small and dense, so nodes are found by
+// indexing. Paths update incrementally, a changed hop only touches the two
+// edges next to it. Like the tracers, the graph lives on the GUI thread.
+class TopologyGraph : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Node {
+        AddressId address;
+        QString hostname;
+        bool lookupIssued;
+        int paths;              // Paths currently routed through this node
+        quint64 sent;
+        quint64 received;
+        double rttSum;
+        double bestTime;
+        double worstTime;
+
+        // Latest real probe, handed to other paths probing the same TTL
+        ProbeResult lastResult;
+        qint64 lastProbeMs;     // -1 before the first probe
+        int lastProbePath;
+        quint32 lastProbeSequence;
+
+        Node();
+        double avgTime() const { return received > 0 ? rttSum / received : -1.0; }
+    };
+
+    struct Stats {
+        int nodes;
+        int edges;
+        int paths;
+        int pathHops;           // Hops held by all paths, each one a per-target hop record without the graph
+        quint64 probesShared;   // Probes not sent because another path had a fresh result
+        quint64 lookupsShared;  // Reverse lookups answered from an earlier one
+
+        Stats() : nodes(0), edges(0), paths(0), pathHops(0), probesShared(0), lookupsShared(0) {}
+    };
+
+    // Turns in a row a hop may take other paths' results before it has to probe again
+    static constexpr int MaxBorrowRun = 4;
+
+    static TopologyGraph& instance();
+
+    int addPath();
+    void removePath(int path);
+    void clearPath(int path);
+
+    // A real probe result of path; replies also place their node on the path
+    void recordProbe(int path, const ProbeResult& result);
+
+    // A fresh result of address at this hop from another path, if there is one
+    // the caller has not borrowed yet
+    bool borrowProbe(int path, int hop, AddressId address, qint64 maxAgeMs, ProbeResult* result);
+
+    // Cached hostname, or an empty string while the shared lookup runs
+    QString lookupHostname(AddressId address);
+    // A hostname known from an earlier session, no lookup is issued for it
+    void seedHostname(AddressId address, const QString& hostname);
+
+    const Node* node(AddressId address) const;
+    Stats stats() const;
+
+signals:
+    void hostnameResolved(AddressId address, const QString& hostname);
+
+private:
+    struct Path {
+        QVector<int> nodes;             // Node per hop, -1 while unknown
+        QVector<quint32> borrowed;      // Sequence of the last result borrowed per hop
+        QVector<int> borrowRun;         // Turns per hop answered by borrowing since its own last probe
+        bool active;
+
+        Path() : active(false) {}
+    };
+
+    struct Edge {
+        int paths;
+        qint64 lastSeenMs;
+
+        Edge() : paths(0), lastSeenMs(0) {}
+    };
+
+    explicit TopologyGraph(QObject *parent = nullptr);
+
+    static quint64 edgeKey(int from, int to) { return (static_cast<quint64>(from) << 32) | static_cast<quint32>(to); }
+
+    int nodeFor(AddressId address);
+    void setPathHop(Path& path, int hop, int node);
+    void linkEdge(int from, int to, int delta);
+
+    QVector<Node> m_nodes;
+    QVector<int> m_nodeByAddress;       // AddressId -> node index, -1 if none
+    QHash<quint64, Edge> m_edges;
+    QVector<Path> m_paths;
+    QVector<int> m_freePaths;
+    quint64 m_probesShared;
+    quint64 m_lookupsShared;
+    quint32 m_probeSequence;
+    QElapsedTimer m_clock;
+};
+
+#endif // TOPOLOGYGRAPH_H
@@ -0,0 +1,368 @@
+#include "windowstats.h"
+#include <atomic>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WINDOWSTATS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 inside functions that ask for it, MSVC always can
+#if defined(WINDOWSTATS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define WINDOWSTATS_AVX2 __attribute__((target("avx2")))
+#else
+#define WINDOWSTATS_AVX2
+#endif
+
+namespace {
+const float Infinity = std::numeric_limits<float>::infinity();
+
+int maskBits(int mask)
+{
+    int bits = 0;
+    for (; mask; mask &= mask - 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+void addSample(WindowStats& stats, float rtt)
+{
+    if (rtt < 0) {
+        return;
+    }
+    if (stats.received == 0) {
+        stats.min = rtt;
+        stats.max = rtt;
+    } else {
+        stats.min = qMin(stats.min, rtt);
+        stats.max = qMax(stats.max, rtt);
+    }
+    stats.received++;
+    stats.sum += rtt;
+    stats.sumSquares += static_cast<double>(rtt) * rtt;
+}
+
+void addBucket(SampleBucket& result, float min, float max, float sum, quint32 received, quint32 lost)
+{
+    SampleBucket bucket;
+    bucket.min = min;
+    bucket.max = max;
+    bucket.sum = sum;
+    bucket.received = received;
+    bucket.lost = lost;
+    result.merge(bucket);
+}
+
+// Folds vector lane results into the scalar tail's running totals
+void mergeLanes(WindowStats& stats, float min, float max, int received, double sum, double sumSquares)
+{
+    if (received == 0) {
+        return;
+    }
+    stats.min = stats.received > 0 ? qMin(stats.min, min) : min;
+    stats.max = stats.received > 0 ? qMax(stats.max, max) : max;
+    stats.received += received;
+    stats.sum += sum;
+    stats.sumSquares += sumSquares;
+}
+
+WindowStats samplesScalar(const float* rttMs, int count)
+{
+    WindowStats stats;
+    stats.count = count;
+    for (int i = 0; i < count; ++i) {
+        addSample(stats, rttMs[i]);
+    }
+    return stats;
+}
+
+SampleBucket bucketsScalar(const float* mins, const float* maxs, const float* sums,
+                           const quint32* received, const quint32* lost, int count)
+{
+    SampleBucket result;
+    for (int i = 0; i < count; ++i) {
+        addBucket(result, mins[i], maxs[i], sums[i], received[i], lost[i]);
+    }
+    return result;
+}
+
+#ifdef WINDOWSTATS_X86
+float horizontalMin(__m128 v)
+{
+    v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_min_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+float horizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+float horizontalSum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+double horizontalSum(__m128d v)
+{
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+quint32 horizontalSum(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<quint32>(_mm_cvtsi128_si32(v));
+}
+
+// SSE2 has no blend, select through the mask by hand
+__m128 select(__m128 mask, __m128 ifSet, __m128 ifClear)
+{
+    return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+}
+
+WindowStats samplesSse2(const float* rttMs, int count)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 inf = _mm_set1_ps(Infinity);
+    const __m128 negInf = _mm_set1_ps(-Infinity);
+    __m128 vmin = inf;
+    __m128 vmax = negInf;
+    __m128d sum = _mm_setzero_pd();
+    __m128d sumSquares = _mm_setzero_pd();
+    int received = 0;
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 v = _mm_loadu_ps(rttMs + i);
+        const __m128 ok = _mm_cmpge_ps(v, zero);
+        received += maskBits(_mm_movemask_ps(ok));
+        vmin = _mm_min_ps(vmin, select(ok, v, inf));
+        vmax = _mm_max_ps(vmax, select(ok, v, negInf));
+
+        // Sums run in double, float squares lose the variance to cancellation
+        const __m128 kept = _mm_and_ps(ok, v);
+        const __m128d lo = _mm_cvtps_pd(kept);
+        const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(kept, kept));
+        sum = _mm_add_pd(sum, _mm_add_pd(lo, hi));
+        sumSquares = _mm_add_pd(sumSquares, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+    }
+
+    WindowStats stats;
+    stats.count = count;
+    for (int j = i; j < count; ++j) {
+        addSample(stats, rttMs[j]);
+    }
+    mergeLanes(stats, horizontalMin(vmin), horizontalMax(vmax), received, horizontalSum(sum), horizontalSum(sumSquares));
+    return stats;
+}
+
+SampleBucket bucketsSse2(const float* mins, const float* maxs, const float* sums,
+                         const quint32* received, const quint32* lost, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 inf = _mm_set1_ps(Infinity);
+    const __m128 negInf = _mm_set1_ps(-Infinity);
+    __m128 vmin = inf;
+    __m128 vmax = negInf;
+    __m128 vsum = _mm_setzero_ps();
+    __m128i vreceived = zero;
+    __m128i vlost = zero;
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(received + i));
+
+        // Empty buckets hold placeholder min/max and must not take part
+        const __m128 empty = _mm_castsi128_ps(_mm_cmpeq_epi32(r, zero));
+        vmin = _mm_min_ps(vmin, select(empty, inf, _mm_loadu_ps(mins + i)));
+        vmax = _mm_max_ps(vmax, select(empty, negInf, _mm_loadu_ps(maxs + i)));
+        vsum = _mm_add_ps(vsum, _mm_loadu_ps(sums + i));
+        vreceived = _mm_add_epi32(vreceived, r);
+        vlost = _mm_add_epi32(vlost, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lost + i)));
+    }
+
+    SampleBucket result;
+    addBucket(result, horizontalMin(vmin), horizontalMax(vmax), horizontalSum(vsum),
+              horizontalSum(vreceived), horizontalSum(vlost));
+    for (; i < count; ++i) {
+        addBucket(result, mins[i], maxs[i], sums[i], received[i], lost[i]);
+    }
+    return result;
+}
+
+WINDOWSTATS_AVX2 WindowStats samplesAvx2(const float* rttMs, int count)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 inf = _mm256_set1_ps(Infinity);
+    const __m256 negInf = _mm256_set1_ps(-Infinity);
+    __m256 vmin = inf;
+    __m256 vmax = negInf;
+    __m256d sum = _mm256_setzero_pd();
+    __m256d sumSquares = _mm256_setzero_pd();
+    int received = 0;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 v = _mm256_loadu_ps(rttMs + i);
+        const __m256 ok = _mm256_cmp_ps(v, zero, _CMP_GE_OQ);
+        received += maskBits(_mm256_movemask_ps(ok));
+        vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(inf, v, ok));
+        vmax = _mm256_max_ps(vmax, _mm256_blendv_ps(negInf, v, ok));
+
+        const __m256 kept = _mm256_and_ps(ok, v);
+        const __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(kept));
+        const __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(kept, 1));
+        sum = _mm256_add_pd(sum, _mm256_add_pd(lo, hi));
+        sumSquares = _mm256_add_pd(sumSquares, _mm256_add_pd(_mm256_mul_pd(lo, lo), _mm256_mul_pd(hi, hi)));
+    }
+
+    WindowStats stats;
+    stats.count = count;
+    for (int j = i; j < count; ++j) {
+        addSample(stats, rttMs[j]);
+    }
+
+    const __m128 min4 = _mm_min_ps(_mm256_castps256_ps128(vmin), _mm256_extractf128_ps(vmin, 1));
+    const __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+    const __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    const __m128d squares2 = _mm_add_pd(_mm256_castpd256_pd128(sumSquares), _mm256_extractf128_pd(sumSquares, 1));
+    mergeLanes(stats, horizontalMin(min4), horizontalMax(max4), received, horizontalSum(sum2), horizontalSum(squares2));
+    return stats;
+}
+
+WINDOWSTATS_AVX2 SampleBucket bucketsAvx2(const float* mins, const float* maxs, const float* sums,
+                                          const quint32* received, const quint32* lost, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256 inf = _mm256_set1_ps(Infinity);
+    const __m256 negInf = _mm256_set1_ps(-Infinity);
+    __m256 vmin = inf;
+    __m256 vmax = negInf;
+    __m256 vsum = _mm256_setzero_ps();
+    __m256i vreceived = zero;
+    __m256i vlost = zero;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(received + i));
+        const __m256 empty = _mm256_castsi256_ps(_mm256_cmpeq_epi32(r, zero));
+        vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(_mm256_loadu_ps(mins + i), inf, empty));
+        vmax = _mm256_max_ps(vmax, _mm256_blendv_ps(_mm256_loadu_ps(maxs + i), negInf, empty));
+        vsum = _mm256_add_ps(vsum, _mm256_loadu_ps(sums + i));
+        vreceived = _mm256_add_epi32(vreceived, r);
+        vlost = _mm256_add_epi32(vlost, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lost + i)));
+    }
+
+    SampleBucket result;
+    addBucket(result,
+              horizontalMin(_mm_min_ps(_mm256_castps256_ps128(vmin), _mm256_extractf128_ps(vmin, 1))),
+              horizontalMax(_mm_max_ps(_mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1))),
+              horizontalSum(_mm_add_ps(_mm256_castps256_ps128(vsum), _mm256_extractf128_ps(vsum, 1))),
+              horizontalSum(_mm_add_epi32(_mm256_castsi256_si128(vreceived), _mm256_extractf128_si256(vreceived, 1))),
+              horizontalSum(_mm_add_epi32(_mm256_castsi256_si128(vlost), _mm256_extractf128_si256(vlost, 1))));
+    for (; i < count; ++i) {
+        addBucket(result, mins[i], maxs[i], sums[i], received[i], lost[i]);
+    }
+    return result;
+}
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // WINDOWSTATS_X86
+
+WindowKernels::Isa detectIsa()
+{
+#ifdef WINDOWSTATS_X86
+    return cpuHasAvx2() ? WindowKernels::Isa::Avx2 : WindowKernels::Isa::Sse2;
+#else
+    return WindowKernels::Isa::Scalar;
+#endif
+}
+
+// -1 until the first call detects the CPU
+std::atomic<int> selectedIsa(-1);
+}
+
+WindowKernels::Isa WindowKernels::isa()
+{
+    int current = selectedIsa.load(std::memory_order_relaxed);
+    if (current < 0) {
+        current = static_cast<int>(detectIsa());
+        selectedIsa.store(current, std::memory_order_relaxed);
+    }
+    return static_cast<Isa>(current);
+}
+
+void WindowKernels::setIsa(Isa isa)
+{
+    // Never pick more than the CPU can run
+    const Isa supported = detectIsa();
+    selectedIsa.store(static_cast<int>(qMin(isa, supported)), std::memory_order_relaxed);
+}
+
+const char* WindowKernels::isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::Sse2:
+        return "SSE2";
+    case Isa::Avx2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+WindowStats WindowKernels::samples(const float* rttMs, int count)
+{
+    switch (isa()) {
+#ifdef WINDOWSTATS_X86
+    case Isa::Avx2:
+        return samplesAvx2(rttMs, count);
+    case Isa::Sse2:
+        return samplesSse2(rttMs, count);
+#endif
+    default:
+        return samplesScalar(rttMs, count);
+    }
+}
+
+SampleBucket WindowKernels::buckets(const float* mins, const float* maxs, const float* sums,
+                                    const quint32* received, const quint32* lost, int count)
+{
+    switch (isa()) {
+#ifdef WINDOWSTATS_X86
+    case Isa::Avx2:
+        return bucketsAvx2(mins, maxs, sums, received, lost, count);
+    case Isa::Sse2:
+        return bucketsSse2(mins, maxs, sums, received, lost, count);
+#endif
+    default:
+        return bucketsScalar(mins, maxs, sums, received, lost, count);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef WINDOWSTATS_H
+#define WINDOWSTATS_H
+
+#include <QtGlobal>
+#include <cmath>
+#include <algorithm>
+#include "samplestore.h"
+
+// Summary of a run of raw samples; rtt < 0 marks a lost probe
+struct WindowStats {
+    int count;
+    int received;
+    float min;
+    float max;
+    double sum;
+    double sumSquares;
+
+    WindowStats() : count(0), received(0), min(0), max(0), sum(0), sumSquares(0) {}
+
+    double mean() const { return received > 0 ? sum / received : -1.0; }
+    double stdDev() const
+    {
+        if (received < 2) {
+            return received == 1 ? 0.0 : -1.0;
+        }
+        const double m = sum / received;
+        return std::sqrt(qMax(0.0, sumSquares / received - m * m));
+    }
+    double lossPercent() const { return count > 0 ? 100.0 * (count - received) / count : 0.0; }
+};
+
+// Reductions over contiguous sample arrays.
+//
+// Every hop of every target is summarised from flat float arrays (raw RTT
+// windows, and the structure-of-arrays rollup tiers in SampleSeries), so the
+// loops are written once per instruction set: AVX2 and SSE2 on x86 with a
+// scalar fallback everywhere else. The widest set the CPU supports is picked
+// on first use.
+class WindowKernels
+{
+public:
+    enum class Isa {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    static WindowStats samples(const float* rttMs, int count);
+
+    // Merges count consecutive rollup buckets held as separate arrays
+    static SampleBucket buckets(const float* mins, const float* maxs, const float* sums,
+                                const quint32* received, const quint32* lost, int count);
+
+    static Isa isa();
+    static const char* isaName(Isa isa);
+
+    // Pins the implementation, e.g. to compare one against the scalar path
+    static void setIsa(Isa isa);
+};
+
+// The most recent Capacity results of one hop.
+// Slots are reused in place, so the held samples are always the first
+// count() entries of one contiguous array and reduce without unwrapping.
+class SampleWindow
+{
+public:
+    static constexpr int Capacity = 128;
+
+    SampleWindow() { clear(); }
+
+    void clear()
+    {
+        m_next = 0;
+        m_count = 0;
+    }
+
+    void add(double rttMs)
+    {
+        m_samples[m_next] = static_cast<float>(rttMs);
+        m_next = (m_next + 1) % Capacity;
+        m_count = qMin(m_count + 1, Capacity);
+    }
+
+    // Puts back a window saved from samples()/next()
+    void restore(const float* samples, int count, int next)
+    {
+        m_count = qBound(0, count, Capacity);
+        m_next = qBound(0, next, Capacity - 1);
+        std::copy(samples, samples + m_count, m_samples);
+    }
+
+    int count() const { return m_count; }
+    int next() const { return m_next; }
+    const float* samples() const { return m_samples; }
+    WindowStats stats() const { return WindowKernels::samples(m_samples, m_count); }
+
+private:
+    float m_samples[Capacity];
+    int m_next;
+    int m_count;
+};
+
+#endif // WINDOWSTATS_H
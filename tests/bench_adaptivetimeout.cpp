@@ -0,0 +1,121 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QVector>
+#include "rtoestimator.h"
+
+// Probes in flight and replies lost to the deadline under the per-hop
+// RtoEstimator, with the configured timeout alone, the old 50 ms floor and the
+// RFC 6298 one second floor. 30 hops are probed at rising rates; like
+// PingTracer, a hop with a probe still pending is skipped. Reply times follow
+// each hop's base RTT with jitter, and some replies come from the router's
+// slow path at several times the base RTT. A reply after the deadline is
+// counted as a loss; those are the false losses the floor has to prevent.
+class bench_AdaptiveTimeout : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void inFlight_data();
+    void inFlight();
+};
+
+namespace {
+
+constexpr int HopCount = 30;
+constexpr int TimeoutMs = 5000;
+constexpr qint64 RunMs = 10 * 60 * 1000;
+constexpr int LossPercent = 2;
+constexpr int SlowPathPercent = 5;
+
+struct Outcome {
+    quint64 sent = 0;
+    quint64 skipped = 0;
+    quint64 lost = 0;
+    quint64 late = 0;       // Replies that came after the deadline
+    double meanInFlight = 0;
+    int peakInFlight = 0;
+};
+
+Outcome simulate(int intervalMs, int floorMs)
+{
+    QRandomGenerator random(4711);
+    QVector<RtoEstimator> rto(HopCount);
+    QVector<qint64> busyUntil(HopCount, 0);
+    Outcome outcome;
+    double heldMs = 0;
+
+    for (qint64 now = 0; now < RunMs; now += intervalMs) {
+        int inFlight = 0;
+        for (int i = 0; i < HopCount; ++i) {
+            if (busyUntil[i] > now) {
+                outcome.skipped++;
+                inFlight++;
+                continue;
+            }
+
+            const double baseMs = 2.0 + i * 2.0;
+            double rttMs = baseMs * (1.0 + 0.2 * random.generateDouble());
+            if (static_cast<int>(random.bounded(100)) < SlowPathPercent) {
+                rttMs *= 4.0 + 8.0 * random.generateDouble();
+            }
+            const bool lost = static_cast<int>(random.bounded(100)) < LossPercent;
+            const int timeout = floorMs > 0 ? rto[i].timeout(qMin(floorMs, TimeoutMs), TimeoutMs) : TimeoutMs;
+
+            outcome.sent++;
+            double holdMs = timeout;
+            if (lost || rttMs > timeout) {
+                outcome.lost++;
+                outcome.late += lost ? 0 : 1;
+                rto[i].backoff();
+            } else {
+                holdMs = rttMs;
+                rto[i].addSample(rttMs);
+            }
+            busyUntil[i] = now + static_cast<qint64>(std::ceil(holdMs));
+            heldMs += holdMs;
+            inFlight++;
+        }
+        outcome.peakInFlight = qMax(outcome.peakInFlight, inFlight);
+    }
+
+    // Little's law: probes in flight on average = total hold time / run time
+    outcome.meanInFlight = heldMs / RunMs;
+    return outcome;
+}
+
+}
+
+void bench_AdaptiveTimeout::inFlight_data()
+{
+    QTest::addColumn<int>("intervalMs");
+
+    for (int intervalMs : {1000, 100, 20, 5}) {
+        QTest::addRow("%d ms interval", intervalMs) << intervalMs;
+    }
+}
+
+void bench_AdaptiveTimeout::inFlight()
+{
+    QFETCH(int, intervalMs);
+
+    const Outcome fixed = simulate(intervalMs, 0);
+    const Outcome floor50 = simulate(intervalMs, 50);
+    const Outcome rfc = simulate(intervalMs, 1000);
+
+    for (const auto& row : {qMakePair("configured 5 s", fixed), qMakePair("50 ms floor", floor50),
+                            qMakePair("1 s floor", rfc)}) {
+        const Outcome& o = row.second;
+        qInfo("%d ms, %s: %.1f probes/s, in flight mean %.2f peak %d, skipped %.2f%%, lost %.2f%% "
+              "of which late replies %.2f%%",
+              intervalMs, row.first, o.sent * 1000.0 / RunMs, o.meanInFlight, o.peakInFlight,
+              100.0 * o.skipped / (o.sent + o.skipped), 100.0 * o.lost / o.sent, 100.0 * o.late / o.sent);
+    }
+
+    // The one second floor stays clear of the slow path, the 50 ms one does not
+    QCOMPARE(rfc.late, quint64(0));
+    QVERIFY(floor50.late > 0);
+    QVERIFY(rfc.meanInFlight <= fixed.meanInFlight);
+}
+
+QTEST_GUILESS_MAIN(bench_AdaptiveTimeout)
+#include "bench_adaptivetimeout.moc"
@@ -0,0 +1,149 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <cstdlib>
+#include <new>
+#include "addresstable.h"
+
+// Memory per hop address, interned against the formatted string a hop used to
+// carry. A hop holds a 4 byte AddressId and nothing on the heap; the table pays
+// for a router's key and index slots once, however many hops and targets pass
+// it. Live heap bytes are counted by a size header in front of every block.
+// Also reports what comparing and looking up addresses costs either way.
+namespace {
+
+constexpr std::size_t HeaderSize = alignof(std::max_align_t);
+std::size_t g_liveBytes = 0;
+
+constexpr int Routers = 20000;
+constexpr quint32 FirstRouter = 0x0a400000;     // 10.64.0.0, nothing else in the process interns these
+constexpr int HopsPerPath = 30;
+constexpr int CompareRounds = 20000;
+
+}
+
+void* operator new(std::size_t size)
+{
+    void* block = std::malloc(HeaderSize + size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *static_cast<std::size_t*>(block) = size;
+    g_liveBytes += size;
+    return static_cast<char*>(block) + HeaderSize;
+}
+
+void operator delete(void* p) noexcept
+{
+    if (!p) {
+        return;
+    }
+    void* block = static_cast<char*>(p) - HeaderSize;
+    g_liveBytes -= *static_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+class bench_AddressTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void memoryPerHop();
+    void compare();
+};
+
+void bench_AddressTable::memoryPerHop()
+{
+    AddressTable& table = AddressTable::instance();
+    QVector<AddressId> ids;
+    ids.reserve(Routers);
+
+    // Interning grows the index and the key chunks, both stay for the process
+    const std::size_t beforeTable = g_liveBytes;
+    for (int i = 0; i < Routers; ++i) {
+        ids.append(table.intern(AddressKey::fromIPv4(FirstRouter + static_cast<quint32>(i))));
+    }
+    const double tableBytes = static_cast<double>(g_liveBytes - beforeTable) / Routers;
+
+    // What a hop carried before: the formatted address in its own string
+    QVector<QString> strings;
+    strings.reserve(Routers);
+    const std::size_t beforeStrings = g_liveBytes;
+    for (AddressId id : ids) {
+        strings.append(table.toString(id));
+    }
+    const double stringHeapBytes = static_cast<double>(g_liveBytes - beforeStrings) / Routers;
+    const double stringBytes = sizeof(QString) + stringHeapBytes;
+
+    qInfo("Per hop: %d bytes as an AddressId, %.1f as a string (%d inline + %.1f on the heap); "
+          "%.1f table bytes once per distinct router (%d routers)",
+          static_cast<int>(sizeof(AddressId)), stringBytes, static_cast<int>(sizeof(QString)), stringHeapBytes,
+          tableBytes, Routers);
+
+    // Every id resolves back to its address
+    QCOMPARE(table.find(AddressKey::fromIPv4(FirstRouter + Routers - 1)), ids.last());
+    QCOMPARE(strings.first(), QString("10.64.0.0"));
+
+    QVERIFY(sizeof(AddressId) * 4 <= stringBytes);
+    // Index slots at a load factor of at least a quarter plus the key itself
+    QVERIFY(tableBytes < 4 * (sizeof(AddressKey) + sizeof(AddressId)) + sizeof(AddressKey));
+}
+
+void bench_AddressTable::compare()
+{
+    AddressTable& table = AddressTable::instance();
+
+    // Two tracers sharing all but their last hop, compared hop by hop
+    QVector<AddressId> pathA;
+    QVector<AddressId> pathB;
+    QVector<QString> textA;
+    QVector<QString> textB;
+    for (int hop = 0; hop < HopsPerPath; ++hop) {
+        const quint32 address = FirstRouter + static_cast<quint32>(hop);
+        pathA.append(table.intern(AddressKey::fromIPv4(address)));
+        pathB.append(table.intern(AddressKey::fromIPv4(hop + 1 < HopsPerPath ? address : address + 1000)));
+        textA.append(table.toString(pathA.last()));
+        textB.append(table.toString(pathB.last()));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int shared = 0;
+    for (int round = 0; round < CompareRounds; ++round) {
+        for (int hop = 0; hop < HopsPerPath; ++hop) {
+            shared += pathA[hop] == pathB[(hop + round) % HopsPerPath] ? 1 : 0;
+        }
+    }
+    const qint64 idNs = timer.nsecsElapsed();
+
+    timer.restart();
+    int sharedText = 0;
+    for (int round = 0; round < CompareRounds; ++round) {
+        for (int hop = 0; hop < HopsPerPath; ++hop) {
+            sharedText += textA[hop] == textB[(hop + round) % HopsPerPath] ? 1 : 0;
+        }
+    }
+    const qint64 textNs = timer.nsecsElapsed();
+
+    // A responder seen again is found without a new id
+    timer.restart();
+    AddressId found = AddressTable::InvalidId;
+    for (int round = 0; round < CompareRounds; ++round) {
+        found = table.intern(AddressKey::fromIPv4(FirstRouter + static_cast<quint32>(round % Routers)));
+    }
+    const qint64 internNs = timer.nsecsElapsed();
+
+    const double compares = static_cast<double>(CompareRounds) * HopsPerPath;
+    qInfo("Compare: %.2f ns per id, %.2f ns per string; intern of a known address: %.1f ns",
+          idNs / compares, textNs / compares, static_cast<double>(internNs) / CompareRounds);
+
+    QCOMPARE(shared, sharedText);
+    QCOMPARE(found, table.find(AddressKey::fromIPv4(FirstRouter + (CompareRounds - 1) % Routers)));
+}
+
+QTEST_GUILESS_MAIN(bench_AddressTable)
+#include "bench_addresstable.moc"
@@ -0,0 +1,205 @@
+#include <QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QStandardPaths>
+#include <QTimer>
+#include <ctime>
+#include "mainwindow.h"
+
+// GUI thread CPU use while a 30-hop trace delivers 10k results/s in batches of
+// 10, as hopDataUpdated does when the tracer drains its queue every
+// millisecond. "before" is the refresh this replaced: every batch rebuilt all
+// table items and resized the columns. "after" is MainWindow itself: the
+// batches are emitted as its tracer's hopDataUpdated, which only copies them
+// into the pending list, and a 60 Hz frame timer runs refreshViews, which
+// writes the rows that changed through ResultsTable, updates the graph,
+// heatmap and summary and resizes columns only then. Table and window are
+// shown, so repainting is part of the figure.
+class bench_GuiRefresh : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void refresh_data();
+    void refresh();
+};
+
+namespace {
+
+constexpr int HopCount = 30;
+constexpr int ResultsPerSecond = 10000;
+constexpr int BatchIntervalMs = 1;
+constexpr int FrameIntervalMs = 16;
+constexpr int RunMs = 3000;
+
+double g_beforeCpuMs = -1; // Set by the "before" row, which runs first
+
+QTableWidget* createTable()
+{
+    QTableWidget* table = new QTableWidget(0, 8);
+    table->setHorizontalHeaderLabels({"Hop", "Hostname", "IP Address", "Loss %", "Sent", "Best", "Avg", "Worst"});
+    table->resize(900, 700);
+    table->show();
+    return table;
+}
+
+// The per-batch refresh from before frame pacing
+void rebuildTable(QTableWidget* table, const QList<HopData>& hops)
+{
+    table->setRowCount(hops.size());
+    for (int i = 0; i < hops.size(); ++i) {
+        const HopData& hop = hops[i];
+        const double lossPercent = hop.sent > 0 ? ((double)(hop.sent - hop.received) / hop.sent) * 100.0 : 0.0;
+        const QStringList cells = {
+            QString::number(hop.hopNumber), hop.hostname, AddressTable::instance().toString(hop.address),
+            QString::number(lossPercent, 'f', 1), QString::number(hop.sent),
+            hop.bestTime >= 0 ? QString::number(hop.bestTime, 'f', 1) + " ms" : "---",
+            hop.avgTime >= 0 ? QString::number(hop.avgTime, 'f', 1) + " ms" : "---",
+            hop.worstTime >= 0 ? QString::number(hop.worstTime, 'f', 1) + " ms" : "---"
+        };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem* item = new QTableWidgetItem(cells[column]);
+            item->setTextAlignment(column == 1 || column == 2 ? Qt::AlignLeft | Qt::AlignVCenter : Qt::AlignCenter);
+            table->setItem(i, column, item);
+        }
+    }
+    for (int column = 0; column < table->columnCount(); ++column) {
+        table->resizeColumnToContents(column);
+    }
+}
+
+void applyResult(HopData& hop, double rttMs)
+{
+    hop.sent++;
+    hop.received++;
+    hop.rttSum += rttMs;
+    hop.bestTime = hop.bestTime < 0 ? rttMs : qMin(hop.bestTime, rttMs);
+    hop.worstTime = qMax(hop.worstTime, rttMs);
+    hop.avgTime = hop.rttSum / hop.received;
+}
+
+}
+
+void bench_GuiRefresh::refresh_data()
+{
+    QTest::addColumn<bool>("paced");
+
+    QTest::newRow("before: rebuild per batch") << false;
+    QTest::newRow("after: changed rows per frame") << true;
+}
+
+void bench_GuiRefresh::refresh()
+{
+    QFETCH(bool, paced);
+
+    // No session file of the user's is restored or overwritten
+    QStandardPaths::setTestModeEnabled(true);
+    QScopedPointer<MainWindow> window;
+    QScopedPointer<QTableWidget> table;
+    PingTracer* tracer = nullptr;
+    if (paced) {
+        window.reset(new MainWindow());
+        window->show();
+        QVERIFY(QTest::qWaitForWindowExposed(window.data()));
+        tracer = window->findChild<PingTracer*>();
+        QVERIFY(tracer);
+    } else {
+        table.reset(createTable());
+    }
+
+    QList<HopData> hops;
+    for (int i = 0; i < HopCount; ++i) {
+        HopData hop;
+        hop.hopNumber = i + 1;
+        hop.hostname = QString("router-%1.example.net").arg(i + 1);
+        hop.address = AddressTable::instance().intern(AddressKey::fromIPv4((192u << 24) | (168u << 16) | (i + 1)));
+        hops.append(hop);
+    }
+
+    quint64 results = 0;
+    quint64 frames = 0;
+
+    // The tracer side, batches of results as the queue is drained
+    QTimer batches;
+    batches.setTimerType(Qt::PreciseTimer);
+    const int perBatch = ResultsPerSecond * BatchIntervalMs / 1000;
+    connect(&batches, &QTimer::timeout, this, [&]() {
+        for (int i = 0; i < perBatch; ++i, ++results) {
+            const int hop = static_cast<int>(results % HopCount);
+            applyResult(hops[hop], 2.0 * (hop + 1) + (results % 97) / 10.0);
+        }
+        if (paced) {
+            emit tracer->hopDataUpdated(hops);
+        } else {
+            rebuildTable(table.data(), hops);
+            frames++;
+        }
+    });
+
+    // MainWindow's own frame timer only runs during a session, this one stands in for it
+    QTimer frameTimer;
+    connect(&frameTimer, &QTimer::timeout, this, [&]() {
+        QMetaObject::invokeMethod(window.data(), "refreshViews");
+        frames++;
+    });
+
+    const std::clock_t cpuStart = std::clock();
+    QElapsedTimer wall;
+    wall.start();
+    batches.start(BatchIntervalMs);
+    if (paced) {
+        frameTimer.start(FrameIntervalMs);
+    }
+    // A blocking loop, so idle time does not show up as CPU
+    QEventLoop loop;
+    QTimer::singleShot(RunMs, &loop, &QEventLoop::quit);
+    loop.exec();
+    batches.stop();
+    frameTimer.stop();
+    const double cpuMs = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    const qint64 wallMs = wall.elapsed();
+
+    qInfo("%s: %.0f results/s, %llu refreshes, GUI thread CPU %.0f ms in %lld ms (%.1f%%)",
+          paced ? "after" : "before", results * 1000.0 / wallMs, static_cast<unsigned long long>(frames),
+          cpuMs, wallMs, 100.0 * cpuMs / wallMs);
+
+    QVERIFY(results > 0);
+    if (!paced) {
+        g_beforeCpuMs = cpuMs;
+        return;
+    }
+
+    // The window shows what the last batch delivered
+    QMetaObject::invokeMethod(window.data(), "refreshViews");
+    QTableWidget* shown = nullptr;
+    for (QTableWidget* candidate : window->findChildren<QTableWidget*>()) {
+        if (candidate->rowCount() == HopCount) {
+            shown = candidate;
+        }
+    }
+    QVERIFY(shown);
+    QCOMPARE(shown->item(HopCount - 1, 4)->text(), QString::number(hops.last().sent));
+
+    // No more than one refresh per frame, whatever the result rate, and less CPU for it
+    QVERIFY(frames <= static_cast<quint64>(wallMs / FrameIntervalMs + 1));
+    if (g_beforeCpuMs >= 0) {
+        qInfo("after/before GUI CPU: %.2f", cpuMs / g_beforeCpuMs);
+        QVERIFY(cpuMs < g_beforeCpuMs);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Headless by default; set QT_QPA_PLATFORM to measure against a real display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    bench_GuiRefresh bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_guirefresh.moc"
@@ -0,0 +1,103 @@
+#include <QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include "heatmapwidget.h"
+#include "samplestore.h"
+
+// Heatmap of 64 hops over 100k one-second buckets, the whole history on
+// screen, so every column is read from the rollup tiers. Reports the time of
+// the first full render and of each live update after a second of new samples,
+// and checks that an update computes only the column the new samples landed
+// in and the one they scrolled into view, never the whole image again.
+class bench_Heatmap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void liveUpdates();
+};
+
+namespace {
+
+constexpr int HopCount = 64;
+constexpr int Buckets = 100000;
+constexpr int Updates = 200;
+constexpr int PlotWidth = 1000;
+
+double rtt(int hop, qint64 second)
+{
+    return 1.0 + hop * 0.8 + (second % 13) * 0.1;
+}
+
+void addSecond(SampleStore& store, qint64 second)
+{
+    for (int hop = 1; hop <= HopCount; ++hop) {
+        // Some loss on the far hops now and then
+        store.add(hop, second * 1000, hop > 48 && second % 50 == 0 ? -1.0 : rtt(hop, second));
+    }
+}
+
+}
+
+void bench_Heatmap::liveUpdates()
+{
+    SampleStore store;
+    store.reset(HopCount);
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 second = 0; second < Buckets; ++second) {
+        addSecond(store, second);
+    }
+    const qint64 fillMs = timer.elapsed();
+
+    // The plot is the widget less its hop label and axis margins
+    HeatmapWidget heatmap;
+    heatmap.resize(PlotWidth + 40, 300);
+    heatmap.setSampleStore(&store);
+    heatmap.setHopCount(HopCount);
+    heatmap.setTimeSpan(static_cast<qint64>(Buckets) * 1000);
+    heatmap.samplesUpdated();
+    QImage frame(heatmap.size(), QImage::Format_RGB32);
+
+    timer.restart();
+    heatmap.render(&frame);
+    const qint64 fullNs = timer.nsecsElapsed();
+    const quint64 fullColumns = heatmap.renderedColumns();
+
+    qint64 updateNs = 0;
+    qint64 worstUpdateNs = 0;
+    quint64 worstColumns = 0;
+    for (int i = 0; i < Updates; ++i) {
+        addSecond(store, Buckets + i);
+        const quint64 before = heatmap.renderedColumns();
+        timer.restart();
+        heatmap.samplesUpdated();
+        heatmap.render(&frame);
+        const qint64 ns = timer.nsecsElapsed();
+        updateNs += ns;
+        worstUpdateNs = qMax(worstUpdateNs, ns);
+        worstColumns = qMax(worstColumns, heatmap.renderedColumns() - before);
+    }
+
+    qInfo("%d hops x %d buckets (filled in %lld ms): full render %.2f ms for %llu columns; live update "
+          "mean %.3f ms, worst %.3f ms, at most %llu columns",
+          HopCount, Buckets, fillMs, fullNs / 1e6, static_cast<unsigned long long>(fullColumns),
+          updateNs / 1e6 / Updates, worstUpdateNs / 1e6, static_cast<unsigned long long>(worstColumns));
+
+    QVERIFY(fullColumns >= quint64(PlotWidth / 2));
+    QVERIFY(worstColumns <= 2);
+}
+
+int main(int argc, char *argv[])
+{
+    // Headless by default; set QT_QPA_PLATFORM to measure against a real display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    bench_Heatmap bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_heatmap.moc"
@@ -0,0 +1,189 @@
+#include <QtTest>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "probescheduler.h"
+
+// Probe send pattern of several traced targets, 30 hops each, with phased
+// flows from ProbeScheduler against the old lockstep tick that fired every
+// hop at once. Reports peak and mean probes per millisecond, per target from
+// the scheduler's own stats() and across all targets from the send times,
+// and the RTT noise the bursts add: every send time is fed through a modelled
+// bottleneck that takes ServiceUs per probe, so a probe's extra delay is the
+// time it waited behind the probes sent just before it.
+//
+// Time is virtual: the test steps each scheduler at its tick instead of
+// running the event loop, so a loaded machine can not bunch the firings up.
+// The stall rows jump over several intervals at once, as a blocked GUI thread
+// would, and every flow has to fire once when time catches up, not once per
+// missed slot.
+class bench_ProbeScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void burstiness_data();
+    void burstiness();
+};
+
+namespace {
+
+constexpr int HopCount = 30;
+constexpr int IntervalMs = 100;
+constexpr int RunMs = 2000;
+constexpr int StallAtMs = 1000;
+constexpr int StallMs = 500;
+constexpr int TickMs = IntervalMs / HopCount;   // ProbeScheduler's tick at this interval and flow count
+constexpr qint64 ServiceUs = 50;
+
+struct QueueNoise {
+    double meanUs = 0;
+    double maxUs = 0;
+};
+
+QueueNoise bottleneckWait(const std::vector<qint64>& sendNs)
+{
+    QueueNoise noise;
+    qint64 freeAtNs = 0;
+    double sumUs = 0;
+    for (qint64 sent : sendNs) {
+        const qint64 startNs = qMax(sent, freeAtNs);
+        freeAtNs = startNs + ServiceUs * 1000;
+        const double waitUs = (startNs - sent) / 1000.0;
+        sumUs += waitUs;
+        noise.maxUs = qMax(noise.maxUs, waitUs);
+    }
+    noise.meanUs = sendNs.empty() ? 0 : sumUs / sendNs.size();
+    return noise;
+}
+
+quint32 peakPerMs(const std::vector<qint64>& sendNs)
+{
+    quint32 peak = 0;
+    quint32 count = 0;
+    qint64 currentMs = -1;
+    for (qint64 sent : sendNs) {
+        if (sent / 1000000 != currentMs) {
+            currentMs = sent / 1000000;
+            count = 0;
+        }
+        peak = qMax(peak, ++count);
+    }
+    return peak;
+}
+
+}
+
+void bench_ProbeScheduler::burstiness_data()
+{
+    QTest::addColumn<int>("targets");
+    QTest::addColumn<bool>("phased");
+    QTest::addColumn<bool>("stall");
+
+    for (int targets : {1, 8, 32}) {
+        QTest::addRow("phased, %d targets", targets) << targets << true << false;
+        QTest::addRow("lockstep, %d targets", targets) << targets << false << false;
+    }
+    QTest::addRow("phased, 8 targets, %d ms stall", StallMs) << 8 << true << true;
+}
+
+void bench_ProbeScheduler::burstiness()
+{
+    QFETCH(int, targets);
+    QFETCH(bool, phased);
+    QFETCH(bool, stall);
+
+    qint64 nowNs = 0;
+    std::vector<qint64> sendNs;
+    sendNs.reserve(static_cast<size_t>(targets) * HopCount * (RunMs / IntervalMs + 2));
+
+    // Seeds stand in for the target address keys PingTracer passes. The
+    // schedulers' own timers never fire, no events are processed
+    std::vector<std::unique_ptr<ProbeScheduler>> schedulers;
+    if (phased) {
+        for (int i = 0; i < targets; ++i) {
+            auto scheduler = std::make_unique<ProbeScheduler>();
+            scheduler->setInterval(IntervalMs);
+            scheduler->setSeed(Q_UINT64_C(0xc0a80001) + static_cast<quint64>(i) * 7919);
+            scheduler->setFlowCount(HopCount);
+            connect(scheduler.get(), &ProbeScheduler::flowDue, this, [&]() {
+                sendNs.push_back(nowNs);
+            });
+            scheduler->start();
+            schedulers.push_back(std::move(scheduler));
+        }
+    }
+
+    qint64 resumedNs = -1;
+    for (int ms = 0; ms <= RunMs; ++ms) {
+        bool resumed = false;
+        if (stall && ms == StallAtMs) {
+            ms += StallMs;
+            resumed = true;
+        }
+        nowNs = static_cast<qint64>(ms) * 1000000;
+        if (resumed) {
+            resumedNs = nowNs;
+        }
+        if (phased) {
+            if (ms % TickMs == 0 || resumed) {
+                for (auto& scheduler : schedulers) {
+                    scheduler->fireDue(nowNs);
+                }
+            }
+        } else if (ms % IntervalMs == 0) {
+            sendNs.insert(sendNs.end(), static_cast<size_t>(targets) * HopCount, nowNs);
+        }
+    }
+
+    quint32 targetPeak = 0;
+    quint64 skipped = 0;
+    quint64 fired = 0;
+    if (phased) {
+        for (auto& scheduler : schedulers) {
+            const ProbeScheduler::Stats stats = scheduler->stats();
+            targetPeak = qMax(targetPeak, stats.peakPerMs);
+            skipped += stats.skipped;
+            fired += stats.fired;
+            scheduler->stop();
+        }
+    } else {
+        targetPeak = HopCount;
+        fired = sendNs.size();
+    }
+
+    const qint64 elapsedMs = RunMs;
+    const double targetMean = static_cast<double>(fired) / targets / elapsedMs;
+    const quint32 peak = peakPerMs(sendNs);
+    const double mean = static_cast<double>(sendNs.size()) / elapsedMs;
+    const QueueNoise noise = bottleneckWait(sendNs);
+    qInfo("%s, %d targets%s: per target peak %u/ms mean %.3f/ms; all targets peak %u/ms mean %.3f/ms "
+          "(peak/mean %.1f); bottleneck wait mean %.1f us, max %.1f us; %llu slots skipped",
+          phased ? "phased" : "lockstep", targets, stall ? ", stalled" : "", targetPeak, targetMean, peak, mean,
+          mean > 0 ? peak / mean : 0.0, noise.meanUs, noise.maxUs, static_cast<unsigned long long>(skipped));
+
+    QVERIFY(!sendNs.empty());
+    if (!phased) {
+        QCOMPARE(peak, static_cast<quint32>(targets * HopCount));
+        return;
+    }
+
+    if (stall) {
+        // Every flow was overdue once; it fires once and the slots in between are dropped
+        const auto resumed = std::count(sendNs.begin(), sendNs.end(), resumedNs);
+        QCOMPARE(static_cast<int>(resumed), targets * HopCount);
+        QVERIFY(skipped >= static_cast<quint64>(targets) * HopCount * (StallMs / IntervalMs - 1));
+        QCOMPARE(fired, static_cast<quint64>(sendNs.size()));
+        return;
+    }
+
+    // Phased flows keep the per-target peak well below a whole round and the
+    // added delay to a fraction of the lockstep burst's
+    QCOMPARE(skipped, quint64(0));
+    QVERIFY(targetPeak < HopCount / 3);
+    QVERIFY(peak < static_cast<quint32>(targets * HopCount) || targets == 1);
+    QVERIFY(noise.maxUs < targets * HopCount * ServiceUs / 2.0 || targets == 1);
+}
+
+QTEST_GUILESS_MAIN(bench_ProbeScheduler)
+#include "bench_probescheduler.moc"
@@ -0,0 +1,107 @@
+#include <QtTest>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <cstdlib>
+#include <new>
+#include "probearena.h"
+
+// Allocations and time per probe setup, before and after the probe arena.
+// Before rebuilds what NetworkTester::sendPing did per probe: parse the target
+// string, build a QByteArray of "PING", the sequence and the formatted send
+// time, and start a single-shot functor timer for the simulated reply. After
+// takes a pooled context, patches sequence and timestamp into its preformatted
+// packet, matches the echo and returns the context.
+namespace {
+
+bool g_counting = false;
+quint64 g_allocations = 0;
+
+constexpr int Probes = 20000;
+
+}
+
+void* operator new(std::size_t size)
+{
+    if (g_counting) {
+        ++g_allocations;
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+class bench_ProbeSetup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void beforeAndAfter();
+};
+
+void bench_ProbeSetup::beforeAndAfter()
+{
+    const QString target = "192.168.7.50";
+    qint64 checksum = 0;
+
+    // Before: the timers die with their context object, none of them fires
+    QElapsedTimer timer;
+    {
+        QObject context;
+        timer.start();
+        g_allocations = 0;
+        g_counting = true;
+        for (int i = 0; i < Probes; ++i) {
+            const quint16 sequence = static_cast<quint16>(i);
+            const QHostAddress address(target);
+            QByteArray data;
+            data.append("PING");
+            data.append(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+            data.append(QDateTime::currentDateTime().toString().toUtf8());
+            QTimer::singleShot(60000, &context, []() {});
+            checksum += data.size() + address.protocol();
+        }
+        g_counting = false;
+    }
+    const qint64 beforeNs = timer.nsecsElapsed();
+    const quint64 beforeAllocations = g_allocations;
+
+    ProbeArena arena;
+    timer.restart();
+    g_allocations = 0;
+    g_counting = true;
+    for (int i = 0; i < Probes; ++i) {
+        ProbeContext* probe = arena.acquire();
+        probe->stamp(static_cast<quint16>(i), probeClockNs());
+        char echo[ProbeContext::HeaderSize];
+        std::memcpy(echo, probe->packet, sizeof(echo));
+        checksum += probe->matches(echo, sizeof(echo)) ? probe->packetSize : 0;
+        arena.release(probe);
+    }
+    g_counting = false;
+    const qint64 afterNs = timer.nsecsElapsed();
+    const quint64 afterAllocations = g_allocations;
+
+    qInfo("Per probe setup: before %.2f allocations in %.0f ns, after %.2f allocations in %.0f ns (checksum %lld)",
+          static_cast<double>(beforeAllocations) / Probes, static_cast<double>(beforeNs) / Probes,
+          static_cast<double>(afterAllocations) / Probes, static_cast<double>(afterNs) / Probes,
+          static_cast<long long>(checksum));
+
+    QVERIFY(beforeAllocations >= quint64(Probes));
+    QCOMPARE(afterAllocations, quint64(0));
+    QCOMPARE(arena.inUse(), 0);
+}
+
+QTEST_GUILESS_MAIN(bench_ProbeSetup)
+#include "bench_probesetup.moc"
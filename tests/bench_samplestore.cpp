@@ -0,0 +1,94 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <vector>
+#include "samplestore.h"
+
+// Scrolls a latency graph 1920 columns wide across a 7-day, 1 Hz session of
+// 30 hops at several zoom levels. Every frame reads all columns of all hops,
+// as the graph and heatmap do, and has to fit a 60 fps frame budget.
+class bench_SampleStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void scroll_data();
+    void scroll();
+
+private:
+    SampleStore m_store;
+};
+
+namespace {
+
+constexpr int HopCount = 30;
+constexpr int Columns = 1920;
+constexpr int Frames = 240;
+constexpr qint64 SessionMs = 7LL * 24 * 60 * 60 * 1000;
+constexpr double FrameBudgetMs = 1000.0 / 60;
+
+}
+
+void bench_SampleStore::initTestCase()
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_store.reset(HopCount);
+    for (qint64 timeMs = 0; timeMs < SessionMs; timeMs += 1000) {
+        for (int hop = 1; hop <= HopCount; ++hop) {
+            // Every 50th probe lost, the rest around the hop's base RTT
+            const qint64 second = timeMs / 1000;
+            m_store.add(hop, timeMs, (second + hop) % 50 == 0 ? -1.0 : hop * 2.0 + second % 7);
+        }
+    }
+    qInfo("7 days at 1 Hz for %d hops stored in %lld ms", HopCount, timer.elapsed());
+}
+
+void bench_SampleStore::scroll_data()
+{
+    QTest::addColumn<qint64>("columnMs");
+
+    for (qint64 columnMs : {1000LL, 10000LL, 60000LL, 600000LL}) {
+        QTest::addRow("%lld s per column", columnMs / 1000) << columnMs;
+    }
+}
+
+void bench_SampleStore::scroll()
+{
+    QFETCH(qint64, columnMs);
+
+    // Pans from the start of the session to its end in Frames steps
+    const qint64 rangeMs = qMax<qint64>(0, SessionMs - columnMs * Columns);
+    std::vector<SampleBucket> buckets(Columns);
+    std::vector<double> frameMs;
+    frameMs.reserve(Frames + 1);
+    quint64 empty = 0;
+
+    for (int i = 0; i <= Frames; ++i) {
+        const qint64 startMs = rangeMs * i / Frames;
+        QElapsedTimer frame;
+        frame.start();
+        for (int hop = 1; hop <= HopCount; ++hop) {
+            m_store.series(hop)->columns(startMs, columnMs, Columns, buckets.data());
+            for (int column = 0; column < Columns; ++column) {
+                const bool inSession = startMs + (column + 1) * columnMs <= SessionMs;
+                empty += inSession && buckets[column].isEmpty() ? 1 : 0;
+            }
+        }
+        frameMs.push_back(frame.nsecsElapsed() / 1e6);
+    }
+
+    std::sort(frameMs.begin(), frameMs.end());
+    const double median = frameMs[frameMs.size() / 2];
+    const double p99 = frameMs[frameMs.size() * 99 / 100];
+    qInfo("%lld s per column: %zu frames, median %.2f ms, p99 %.2f ms, worst %.2f ms",
+          columnMs / 1000, frameMs.size(), median, p99, frameMs.back());
+
+    // The whole week stays readable and a frame fits the 60 fps budget
+    QCOMPARE(empty, quint64(0));
+    QVERIFY2(p99 < FrameBudgetMs, qPrintable(QString("p99 frame %1 ms").arg(p99)));
+}
+
+QTEST_GUILESS_MAIN(bench_SampleStore)
+#include "bench_samplestore.moc"
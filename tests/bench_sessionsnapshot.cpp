@@ -0,0 +1,151 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cstring>
+#include "sessionsnapshot.h"
+
+// Restore cost of a large session snapshot: 5,000 tracers of 16 hops each,
+// with every tracer's settings, hostnames and alert rules in the string table
+// and every hop's change detector and alert window.
+// Reports the write time, the file size and the time to map the file and read
+// every record and string back the way PingTracer::resume does. Restoring is
+// a copy per field, so the read has to stay a small fraction of a second.
+class bench_SessionSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void restore();
+};
+
+namespace {
+
+constexpr int TracerCount = 5000;
+constexpr int HopsPerTracer = 16;
+
+SessionTracer tracerRecord(SessionWriter& writer, int index)
+{
+    SessionTracer tracer;
+    std::memset(&tracer, 0, sizeof(tracer));
+    tracer.target = writer.addString(QString("host-%1.example.net").arg(index));
+    tracer.addressHi = 0;
+    tracer.addressLo = Q_UINT64_C(0xffff0a000000) | static_cast<quint64>(index);
+    tracer.intervalMs = 1000;
+    tracer.timeoutMs = 5000;
+    tracer.maxHops = 30;
+    tracer.destinationHop = HopsPerTracer;
+    tracer.firstHop = writer.hopCount();
+    tracer.hopCount = HopsPerTracer;
+    tracer.probesSent = 3600;
+    tracer.probesReceived = 3590;
+    tracer.protocol = static_cast<quint32>(index % 4);
+    tracer.port = 8000 + index % 1000;
+    tracer.query = writer.addString(index % 2 ? QString("/health") : QString("example.net"));
+    tracer.alertRules = writer.addString(QString("p95 hop %1 > 80ms for 2m do log\nloss e2e > 5% do log")
+                                         .arg(1 + index % HopsPerTracer));
+    tracer.flags = (index % 2 ? SessionTracer::FastStart : 0) | SessionTracer::ReuseConnections;
+    return tracer;
+}
+
+}
+
+void bench_SessionSnapshot::restore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("session.ptsession");
+
+    QElapsedTimer timer;
+    timer.start();
+    SessionWriter writer;
+    for (int i = 0; i < TracerCount; ++i) {
+        const SessionTracer tracer = tracerRecord(writer, i);
+        for (int hop = 0; hop < HopsPerTracer; ++hop) {
+            SessionHop record;
+            std::memset(&record, 0, sizeof(record));
+            record.addressLo = Q_UINT64_C(0xffffc0a80000) | static_cast<quint64>(hop << 8 | (i & 0xff));
+            record.hostname = writer.addString(QString("router-%1-%2.example.net").arg(hop).arg(i % 500));
+            record.sent = 3600;
+            record.received = 3590;
+            record.recentCount = SampleWindow::Capacity;
+            record.bestTime = hop;
+            record.worstTime = hop * 4.0;
+            record.rttSum = hop * 2.0 * record.received;
+            record.srtt = hop * 2.0;
+            record.rttvar = 0.5;
+            for (int s = 0; s < SampleWindow::Capacity; ++s) {
+                record.recent[s] = static_cast<float>(hop * 2.0 + (s % 7) * 0.1);
+            }
+            record.detector.latencySamples = 10;
+            record.detector.lossSamples = 10;
+            record.detector.mean = hop * 2.0;
+            record.detector.lossRate = 0.003;
+            // The hop the tracer's rule watches has a full alert window
+            if (hop == i % HopsPerTracer) {
+                record.alertCount = AlertEngine::WindowSamples;
+                std::copy(record.recent, record.recent + AlertEngine::WindowSamples, record.alerts);
+            }
+            writer.addHop(record);
+        }
+        writer.addTracer(tracer);
+    }
+    QString error;
+    QVERIFY2(writer.commit(fileName, &error), qPrintable(error));
+    const qint64 writeMs = timer.elapsed();
+    const qint64 fileSize = QFileInfo(fileName).size();
+
+    // What resume reads: settings and strings per tracer, every field per hop
+    timer.restart();
+    SessionSnapshot snapshot;
+    QVERIFY2(snapshot.open(fileName, &error), qPrintable(error));
+    double checksum = 0;
+    qsizetype stringBytes = 0;
+    int fastStart = 0;
+    for (int i = 0; i < snapshot.tracerCount(); ++i) {
+        const SessionTracer& tracer = snapshot.tracer(i);
+        stringBytes += snapshot.string(tracer.target).size() + snapshot.string(tracer.query).size()
+                       + snapshot.string(tracer.alertRules).size();
+        checksum += tracer.protocol + tracer.port;
+        fastStart += (tracer.flags & SessionTracer::FastStart) ? 1 : 0;
+        const SessionHop* hops = snapshot.hops(i);
+        for (quint32 hop = 0; hop < tracer.hopCount; ++hop) {
+            const SessionHop& record = hops[hop];
+            stringBytes += snapshot.string(record.hostname).size();
+            checksum += record.sent + record.bestTime + record.srtt + record.rttvar;
+            for (int s = 0; s < record.recentCount; ++s) {
+                checksum += record.recent[s];
+            }
+            checksum += record.detector.mean + record.detector.lossRate;
+            for (int s = 0; s < record.alertCount; ++s) {
+                checksum += record.alerts[s];
+            }
+        }
+    }
+    const qint64 readNs = timer.nsecsElapsed();
+
+    qInfo("%d tracers x %d hops: written in %lld ms, %.1f MB; opened and read in %.1f ms (%.2f us per tracer, "
+          "%lld string bytes, checksum %.0f)", TracerCount, HopsPerTracer, writeMs, fileSize / 1048576.0,
+          readNs / 1e6, readNs / 1e3 / TracerCount, static_cast<long long>(stringBytes), checksum);
+
+    // Everything written comes back, settings included
+    QCOMPARE(snapshot.tracerCount(), TracerCount);
+    QCOMPARE(fastStart, TracerCount / 2);
+    const SessionTracer& last = snapshot.tracer(TracerCount - 1);
+    QCOMPARE(last.protocol, quint32((TracerCount - 1) % 4));
+    QCOMPARE(last.port, quint32(8000 + (TracerCount - 1) % 1000));
+    QCOMPARE(snapshot.string(last.query), QString("/health"));
+    const QString firstRule = QString("p95 hop %1 > 80ms").arg(1 + (TracerCount - 1) % HopsPerTracer);
+    QVERIFY(snapshot.string(last.alertRules).startsWith(firstRule));
+    QVERIFY(last.flags & SessionTracer::ReuseConnections);
+    const SessionHop& watched = snapshot.hops(TracerCount - 1)[(TracerCount - 1) % HopsPerTracer];
+    QCOMPARE(watched.alertCount, AlertEngine::WindowSamples);
+    QCOMPARE(watched.detector.latencySamples, 10);
+    QCOMPARE(watched.detector.mean, (TracerCount - 1) % HopsPerTracer * 2.0);
+
+    QVERIFY(readNs < 250 * 1000000LL);
+}
+
+QTEST_GUILESS_MAIN(bench_SessionSnapshot)
+#include "bench_sessionsnapshot.moc"
@@ -0,0 +1,138 @@
+#include <QtTest>
+#include <QMutex>
+#include <QThread>
+#include <atomic>
+#include <vector>
+#include "pingtracer.h"
+
+// Many readers load and walk the hop list while one writer publishes as fast
+// as it can, far above any real probe rate. Every published list carries one
+// stamp in all its hops, so a torn view shows up as mixed stamps. The mutex
+// rows are the old getHopData() design, a locked copy per read, for scale.
+class bench_SnapshotPublisher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void contention_data();
+    void contention();
+};
+
+namespace {
+
+constexpr int HopCount = 30;
+constexpr int RunMs = 1000;
+
+// The list readers copied under m_dataMutex before snapshots were published
+class LockedHops
+{
+public:
+    void publish(const QList<HopData>& hops)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_hops = hops;
+    }
+
+    QList<HopData> load() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_hops;
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QList<HopData> m_hops;
+};
+
+bool consistent(const QList<HopData>& hops)
+{
+    for (const HopData& hop : hops) {
+        if (hop.sent != hops.first().sent) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+void bench_SnapshotPublisher::contention_data()
+{
+    QTest::addColumn<int>("readers");
+    QTest::addColumn<bool>("locked");
+
+    for (int readers : {1, 4, 16, 64}) {
+        QTest::addRow("snapshot, %d readers", readers) << readers << false;
+        QTest::addRow("mutex, %d readers", readers) << readers << true;
+    }
+}
+
+void bench_SnapshotPublisher::contention()
+{
+    QFETCH(int, readers);
+    QFETCH(bool, locked);
+
+    SnapshotPublisher<QList<HopData>> publisher;
+    LockedHops lockedHops;
+    std::atomic<bool> stop(false);
+    std::atomic<quint64> reads(0);
+    std::atomic<quint64> torn(0);
+
+    std::vector<QThread*> threads;
+    for (int i = 0; i < readers; ++i) {
+        threads.push_back(QThread::create([&]() {
+            quint64 done = 0;
+            quint64 mixed = 0;
+            double sum = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (locked) {
+                    const QList<HopData> hops = lockedHops.load();
+                    mixed += consistent(hops) ? 0 : 1;
+                    sum += hops.isEmpty() ? 0 : hops.last().rttSum;
+                } else {
+                    const HopSnapshot snapshot = publisher.load();
+                    mixed += consistent(*snapshot) ? 0 : 1;
+                    sum += snapshot->isEmpty() ? 0 : snapshot->last().rttSum;
+                }
+                done++;
+            }
+            reads.fetch_add(done);
+            torn.fetch_add(mixed + (sum < 0 ? 1 : 0));
+        }));
+        threads.back()->start();
+    }
+
+    // The writer side of PingTracer: update the private list, publish it
+    QList<HopData> hops(HopCount);
+    quint64 publishes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < RunMs) {
+        ++publishes;
+        for (HopData& hop : hops) {
+            hop.sent = static_cast<int>(publishes);
+            hop.rttSum += 1.0;
+        }
+        if (locked) {
+            lockedHops.publish(hops);
+        } else {
+            publisher.publish(hops);
+        }
+    }
+    const qint64 elapsedMs = timer.elapsed();
+
+    stop = true;
+    for (QThread* thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    qInfo("%s, %d readers: %.2f M reads/s in total, %.2f M publishes/s, %llu publishes skipped",
+          locked ? "mutex" : "snapshot", readers, reads / 1000.0 / elapsedMs, publishes / 1000.0 / elapsedMs,
+          static_cast<unsigned long long>(locked ? 0 : publisher.skippedCount()));
+    QCOMPARE(torn.load(), quint64(0));
+    QVERIFY(reads > 0);
+}
+
+QTEST_GUILESS_MAIN(bench_SnapshotPublisher)
+#include "bench_snapshotpublisher.moc"
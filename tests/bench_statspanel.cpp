@@ -0,0 +1,133 @@
+#include <QtTest>
+#include <QApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTextEdit>
+#include <algorithm>
+#include <vector>
+#include "summarystatswidget.h"
+
+// GUI thread time per update of the statistics panel at 8, 32 and 64 hops.
+// "before" is the panel this replaced: every update formatted a line per hop
+// and set the whole text of a QTextEdit. "after" is MainWindow's: the summary
+// widget's fields are set from the session counters and only labels whose
+// text changed are touched, per-hop detail lives in the results table. Both
+// are shown and repaint after each update. The median update time of "after"
+// must not grow with the hop count.
+class bench_StatsPanel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void update_data();
+    void update();
+};
+
+namespace {
+
+constexpr int Updates = 300;
+constexpr int SmallestPath = 8;
+
+// Median "after" update time per hop count, filled as the rows run
+QMap<int, qint64> g_afterMedianNs;
+
+qint64 median(std::vector<qint64> samples)
+{
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+}
+
+void bench_StatsPanel::update_data()
+{
+    QTest::addColumn<int>("hops");
+    QTest::addColumn<bool>("summary");
+
+    for (int hops : {SmallestPath, 32, 64}) {
+        QTest::addRow("before, %d hops", hops) << hops << false;
+        QTest::addRow("after, %d hops", hops) << hops << true;
+    }
+}
+
+void bench_StatsPanel::update()
+{
+    QFETCH(int, hops);
+    QFETCH(bool, summary);
+
+    QTextEdit text;
+    text.setReadOnly(true);
+    SummaryStatsWidget fields;
+    QWidget* panel = summary ? static_cast<QWidget*>(&fields) : static_cast<QWidget*>(&text);
+    panel->resize(400, 600);
+    panel->show();
+    QVERIFY(QTest::qWaitForWindowExposed(panel));
+
+    std::vector<qint64> samples;
+    samples.reserve(Updates);
+    QElapsedTimer timer;
+    quint64 sent = 0;
+    quint64 received = 0;
+    for (int update = 0; update < Updates; ++update) {
+        sent += hops;
+        received += hops - 1;
+        const double loss = 100.0 * (sent - received) / sent;
+        const QString now = QDateTime::currentDateTime().toString("hh:mm:ss");
+
+        timer.start();
+        if (summary) {
+            fields.setField(SummaryStatsWidget::Target, "example.net");
+            fields.setField(SummaryStatsWidget::Hops, QString::number(hops));
+            fields.setField(SummaryStatsWidget::PacketsSent, QString::number(sent));
+            fields.setField(SummaryStatsWidget::PacketsReceived, QString::number(received));
+            fields.setField(SummaryStatsWidget::Loss, QString::number(loss, 'f', 2) + "%");
+            fields.setField(SummaryStatsWidget::ProbeRate, QString("%1 sent/s, %2 received/s")
+                            .arg(hops * 10.0, 0, 'f', 1).arg((hops - 1) * 10.0, 0, 'f', 1));
+            fields.setField(SummaryStatsWidget::LastUpdate, now);
+        } else {
+            QString statsText = QString("=== PingTracer Statistics ===\nTarget: %1\nTotal Hops: %2\n"
+                                        "Total Packets Sent: %3\nTotal Packets Received: %4\n"
+                                        "Overall Loss: %5%\nLast Update: %6\n\n")
+                                .arg("example.net").arg(hops).arg(sent).arg(received)
+                                .arg(QString::number(loss, 'f', 2)).arg(now);
+            statsText += "=== Hop Details ===\n";
+            for (int hop = 1; hop <= hops; ++hop) {
+                statsText += QString("Hop %1: %2 (%3) - Loss: %4% - Avg: %5ms\n")
+                             .arg(hop).arg(QString("router-%1.example.net").arg(hop))
+                             .arg(QString("192.168.%1.1").arg(hop))
+                             .arg(QString::number(hop == hops ? loss : 0.0, 'f', 1))
+                             .arg(QString::number(hop * 1.7 + update % 7 * 0.1, 'f', 1));
+            }
+            text.setPlainText(statsText);
+        }
+        QCoreApplication::processEvents();
+        samples.push_back(timer.nsecsElapsed());
+    }
+
+    const qint64 medianNs = median(samples);
+    qInfo("%s, %d hops: median %.1f us per update", summary ? "after" : "before", hops, medianNs / 1e3);
+
+    if (!summary) {
+        return;
+    }
+    g_afterMedianNs.insert(hops, medianNs);
+    if (hops != SmallestPath && g_afterMedianNs.contains(SmallestPath)) {
+        // Twice the short path's time, plus slack for timer noise on tiny figures
+        const qint64 baseNs = g_afterMedianNs.value(SmallestPath);
+        qInfo("after, %d hops against %d: %.2fx", hops, SmallestPath, static_cast<double>(medianNs) / baseNs);
+        QVERIFY(medianNs < 2 * baseNs + 50000);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Headless by default; set QT_QPA_PLATFORM to measure against a real display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    bench_StatsPanel bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_statspanel.moc"
@@ -0,0 +1,187 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "taskpool.h"
+
+// Probe timing while TaskPool is saturated. A high-priority thread runs a
+// precise 5 ms timer, like a tracer's network thread, and records how late
+// each tick fires. The run is repeated with the pool idle and with every
+// worker spinning on analytic work at each priority. The pool runs at low OS
+// priority and leaves a core free, so lateness should stay flat.
+//
+// Aggregation throughput against the number of workers: one parallelFor
+// builds per-chunk mean and log-spaced histograms over a block of latency
+// samples, the way the views and alert windows summarise history, on pools
+// of 1, 2, 4, ... workers up to the machine's core count less one.
+class bench_TaskPool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void probeJitter();
+    void coreScaling();
+};
+
+namespace {
+
+constexpr int TickMs = 5;
+constexpr int Ticks = 400;
+
+struct Jitter {
+    double p50Us;
+    double p99Us;
+    double maxUs;
+};
+
+Jitter measureTicks()
+{
+    std::vector<double> lateUs;
+    lateUs.reserve(Ticks);
+
+    QThread* thread = QThread::create([&lateUs]() {
+        QEventLoop loop;
+        QTimer timer;
+        timer.setTimerType(Qt::PreciseTimer);
+        QElapsedTimer clock;
+        qint64 dueNs = 0;
+        QObject::connect(&timer, &QTimer::timeout, &loop, [&]() {
+            const qint64 nowNs = clock.nsecsElapsed();
+            lateUs.push_back(qMax<qint64>(0, nowNs - dueNs) / 1000.0);
+            dueNs = nowNs + TickMs * 1000000LL;
+            if (static_cast<int>(lateUs.size()) == Ticks) {
+                loop.quit();
+            }
+        });
+        clock.start();
+        dueNs = TickMs * 1000000LL;
+        timer.start(TickMs);
+        loop.exec();
+    });
+    thread->start(QThread::HighPriority);
+    thread->wait();
+    delete thread;
+
+    std::sort(lateUs.begin(), lateUs.end());
+    return {lateUs[lateUs.size() / 2], lateUs[lateUs.size() * 99 / 100], lateUs.back()};
+}
+
+}
+
+void bench_TaskPool::probeJitter()
+{
+    TaskPool pool;
+    const Jitter idle = measureTicks();
+
+    // Keep every worker busy with spinning tasks of all priorities, more than they can run
+    std::atomic<bool> stop(false);
+    std::atomic<quint64> spins(0);
+    const int tasks = pool.workerCount() * 6;
+    for (int i = 0; i < tasks; ++i) {
+        pool.submit([&]() {
+            quint64 local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                local++;
+            }
+            spins += local;
+        }, static_cast<TaskPool::Priority>(i % 3));
+    }
+
+    // Plus parallelFor from outside the pool, as the views use it
+    QThread* parallel = QThread::create([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            pool.parallelFor(0, 1000, [](int first, int last) {
+                volatile double x = 0;
+                for (int i = first; i < last; ++i) {
+                    x = x + std::sqrt(static_cast<double>(i));
+                }
+            }, 10, TaskPool::Priority::High);
+        }
+    });
+    parallel->start(QThread::LowPriority);
+
+    const Jitter saturated = measureTicks();
+    stop = true;
+    parallel->wait();
+    delete parallel;
+
+    qInfo("%d workers; timer lateness idle: p50 %.0f us, p99 %.0f us, max %.0f us", pool.workerCount(),
+          idle.p50Us, idle.p99Us, idle.maxUs);
+    qInfo("saturated (%d spinning tasks): p50 %.0f us, p99 %.0f us, max %.0f us", tasks,
+          saturated.p50Us, saturated.p99Us, saturated.maxUs);
+
+    // Flat within a millisecond of noise at the 99th percentile
+    QVERIFY2(saturated.p99Us <= qMax(2 * idle.p99Us, idle.p99Us + 1000.0),
+             qPrintable(QString("p99 %1 us saturated, %2 us idle").arg(saturated.p99Us).arg(idle.p99Us)));
+}
+
+void bench_TaskPool::coreScaling()
+{
+    const int cores = QThread::idealThreadCount();
+    if (cores < 3) {
+        QSKIP("Needs at least three cores to compare worker counts");
+    }
+
+    constexpr int Samples = 1 << 22;
+    constexpr int Grain = 1 << 14;
+    constexpr int Bins = 64;
+    constexpr int Rounds = 5;
+    std::vector<float> samples(Samples);
+    for (int i = 0; i < Samples; ++i) {
+        samples[i] = 1.0f + (i * 7919 % 10007) * 0.01f;
+    }
+    std::vector<double> means(Samples / Grain);
+    std::vector<quint32> histograms(static_cast<size_t>(Samples / Grain) * Bins);
+
+    auto aggregate = [&](int first, int last) {
+        for (int chunk = first; chunk < last; ++chunk) {
+            double sum = 0;
+            quint32* bins = &histograms[static_cast<size_t>(chunk) * Bins];
+            std::fill(bins, bins + Bins, 0u);
+            for (int i = chunk * Grain; i < (chunk + 1) * Grain; ++i) {
+                sum += samples[i];
+                bins[qMin(Bins - 1, static_cast<int>(std::log(samples[i] / 0.1f) / std::log(1.2f)))]++;
+            }
+            means[chunk] = sum / Grain;
+        }
+    };
+
+    double singleMs = 0;
+    double bestSpeedup = 0;
+    int bestWorkers = 1;
+    for (int workers = 1; workers < cores; workers *= 2) {
+        TaskPool pool(workers);
+        pool.parallelFor(0, Samples / Grain, aggregate);
+
+        double bestMs = 0;
+        for (int round = 0; round < Rounds; ++round) {
+            QElapsedTimer timer;
+            timer.start();
+            pool.parallelFor(0, Samples / Grain, aggregate);
+            const double ms = timer.nsecsElapsed() / 1e6;
+            bestMs = round == 0 ? ms : qMin(bestMs, ms);
+        }
+
+        if (workers == 1) {
+            singleMs = bestMs;
+        }
+        const double speedup = singleMs / bestMs;
+        if (speedup > bestSpeedup) {
+            bestSpeedup = speedup;
+            bestWorkers = workers;
+        }
+        qInfo("%d workers: %.2f ms per pass, %.0f Msamples/s, %.2fx one worker", workers, bestMs,
+              Samples / bestMs / 1e3, speedup);
+    }
+
+    // One worker and the calling thread against at least two workers and the caller
+    QVERIFY2(bestWorkers >= 2 && bestSpeedup >= 1.2,
+             qPrintable(QString("best %1x with %2 workers").arg(bestSpeedup).arg(bestWorkers)));
+}
+
+QTEST_GUILESS_MAIN(bench_TaskPool)
+#include "bench_taskpool.moc"
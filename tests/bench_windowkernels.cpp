@@ -0,0 +1,96 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <vector>
+#include "windowstats.h"
+
+// Throughput of the window and rollup kernels per instruction set, in samples
+// (or buckets) per nanosecond. Sizes are a hop's raw window, the 8 buckets a
+// graph column reads and a long run of a zoomed-out view.
+class bench_WindowKernels : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanupTestCase();
+    void throughput_data();
+    void throughput();
+};
+
+namespace {
+
+constexpr qint64 RunNs = 200 * 1000 * 1000;
+
+}
+
+void bench_WindowKernels::cleanupTestCase()
+{
+    WindowKernels::setIsa(WindowKernels::Isa::Avx2);
+}
+
+void bench_WindowKernels::throughput_data()
+{
+    QTest::addColumn<int>("isa");
+    QTest::addColumn<bool>("rollup");
+    QTest::addColumn<int>("count");
+
+    for (WindowKernels::Isa isa : {WindowKernels::Isa::Scalar, WindowKernels::Isa::Sse2, WindowKernels::Isa::Avx2}) {
+        for (int count : {SampleWindow::Capacity, 4096}) {
+            QTest::addRow("%s, samples, %d", WindowKernels::isaName(isa), count)
+                << static_cast<int>(isa) << false << count;
+        }
+        for (int count : {SampleSeries::TierFactor, 4096}) {
+            QTest::addRow("%s, buckets, %d", WindowKernels::isaName(isa), count)
+                << static_cast<int>(isa) << true << count;
+        }
+    }
+}
+
+void bench_WindowKernels::throughput()
+{
+    QFETCH(int, isa);
+    QFETCH(bool, rollup);
+    QFETCH(int, count);
+
+    WindowKernels::setIsa(static_cast<WindowKernels::Isa>(isa));
+    if (WindowKernels::isa() != static_cast<WindowKernels::Isa>(isa)) {
+        QSKIP("Instruction set not available on this CPU");
+    }
+
+    QRandomGenerator random(1);
+    std::vector<float> rtt(count), mins(count), maxs(count), sums(count);
+    std::vector<quint32> received(count), lost(count);
+    for (int i = 0; i < count; ++i) {
+        rtt[i] = random.bounded(20) == 0 ? -1.0f : static_cast<float>(random.bounded(200.0));
+        received[i] = random.bounded(9);
+        lost[i] = random.bounded(2);
+        mins[i] = static_cast<float>(random.bounded(100.0));
+        maxs[i] = mins[i] + 10.0f;
+        sums[i] = mins[i] * received[i] + 5.0f;
+    }
+
+    // Results feed a checksum so the calls are not optimised away
+    double checksum = 0;
+    quint64 items = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.nsecsElapsed() < RunNs) {
+        for (int repeat = 0; repeat < 256; ++repeat) {
+            if (rollup) {
+                checksum += WindowKernels::buckets(mins.data(), maxs.data(), sums.data(),
+                                                   received.data(), lost.data(), count).sum;
+            } else {
+                checksum += WindowKernels::samples(rtt.data(), count).sum;
+            }
+        }
+        items += 256ULL * count;
+    }
+    const qint64 elapsedNs = timer.nsecsElapsed();
+
+    qInfo("%s, %s of %d: %.2f per ns (checksum %.0f)", WindowKernels::isaName(WindowKernels::isa()),
+          rollup ? "buckets" : "samples", count, static_cast<double>(items) / elapsedNs, checksum);
+    QVERIFY(items > 0);
+}
+
+QTEST_GUILESS_MAIN(bench_WindowKernels)
+#include "bench_windowkernels.moc"
@@ -0,0 +1,122 @@
+#include <QtTest>
+#include "alertengine.h"
+
+class tst_AlertEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parsesHop_data();
+    void parsesHop();
+    void firesAfterHold();
+    void lossWaitsForSamples();
+    void clearFollowsLogAction();
+};
+
+void tst_AlertEngine::parsesHop_data()
+{
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<int>("hop");
+
+    QTest::newRow("end-to-end") << "loss e2e > 5%" << true << 0;
+    QTest::newRow("first hop") << "p95 hop 1 > 80ms" << true << 1;
+    QTest::newRow("last hop") << "avg hop 64 > 80ms" << true << AlertRule::MaxHops;
+    QTest::newRow("hop 0") << "p95 hop 0 > 80ms" << false << 0;
+    QTest::newRow("past max hops") << "p95 hop 65 > 80ms" << false << 0;
+    QTest::newRow("int overflow") << "p95 hop 99999999999 > 80ms" << false << 0;
+}
+
+void tst_AlertEngine::parsesHop()
+{
+    QFETCH(QString, line);
+    QFETCH(bool, valid);
+    QFETCH(int, hop);
+
+    AlertRule rule;
+    QString error;
+    QCOMPARE(AlertRule::parse(line, &rule, &error), valid);
+    if (valid) {
+        QCOMPARE(rule.hop, hop);
+        QVERIFY(error.isEmpty());
+    } else {
+        QVERIFY(error.contains(QString::number(AlertRule::MaxHops)));
+    }
+}
+
+void tst_AlertEngine::firesAfterHold()
+{
+    AlertRule rule;
+    QString error;
+    QVERIFY(AlertRule::parse("avg hop 2 > 50ms for 10s do log", &rule, &error));
+
+    AlertEngine engine;
+    engine.setRules({rule});
+    QSignalSpy raised(&engine, &AlertEngine::alertRaised);
+    QSignalSpy cleared(&engine, &AlertEngine::alertCleared);
+
+    engine.addSample(2, 5, 0, 80.0);
+    engine.addSample(2, 5, 5000, 80.0);
+    QCOMPARE(raised.count(), 0);
+    engine.addSample(2, 5, 10000, 80.0);
+    QCOMPARE(raised.count(), 1);
+    QVERIFY(engine.isFiring(0));
+
+    // Samples of other hops leave the rule alone
+    engine.addSample(3, 5, 11000, 1.0);
+    QVERIFY(engine.isFiring(0));
+
+    for (int i = 0; i < AlertEngine::WindowSamples; ++i) {
+        engine.addSample(2, 5, 12000 + i * 1000, 1.0);
+    }
+    QCOMPARE(cleared.count(), 1);
+    QVERIFY(!engine.isFiring(0));
+}
+
+void tst_AlertEngine::lossWaitsForSamples()
+{
+    AlertRule rule;
+    QString error;
+    QVERIFY(AlertRule::parse("loss e2e > 5% do log", &rule, &error));
+
+    AlertEngine engine;
+    engine.setRules({rule});
+    QSignalSpy raised(&engine, &AlertEngine::alertRaised);
+
+    // A lost first probe is 100% of one result
+    engine.addSample(4, 4, 0, -1.0);
+    for (int i = 1; i < AlertEngine::MinLossSamples - 1; ++i) {
+        engine.addSample(4, 4, i * 1000, 10.0);
+    }
+    QCOMPARE(raised.count(), 0);
+    QVERIFY(!engine.isFiring(0));
+
+    // The window is full enough to judge: 2 lost out of 20 is 10%
+    engine.addSample(4, 4, 19000, -1.0);
+    QCOMPARE(raised.count(), 1);
+    QVERIFY(engine.isFiring(0));
+}
+
+void tst_AlertEngine::clearFollowsLogAction()
+{
+    AlertRule rule;
+    QString error;
+    QVERIFY(AlertRule::parse("avg hop 1 > 50ms do script=/bin/true", &rule, &error));
+
+    AlertEngine engine;
+    engine.setRules({rule});
+    QSignalSpy raised(&engine, &AlertEngine::alertRaised);
+    QSignalSpy cleared(&engine, &AlertEngine::alertCleared);
+
+    engine.addSample(1, 5, 0, 80.0);
+    QVERIFY(engine.isFiring(0));
+    for (int i = 1; i <= AlertEngine::WindowSamples; ++i) {
+        engine.addSample(1, 5, i * 1000, 1.0);
+    }
+    QVERIFY(!engine.isFiring(0));
+    QCOMPARE(raised.count(), 0);
+    QCOMPARE(cleared.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_AlertEngine)
+#include "tst_alertengine.moc"
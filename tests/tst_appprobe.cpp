@@ -0,0 +1,150 @@
+#include <QtTest>
+#include <QNetworkDatagram>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include "networktester.h"
+
+// DNS and HTTP probes of a NetworkTester against stub servers on loopback.
+// The DNS stub answers every query by echoing it with the QR bit set; the
+// HTTP stub answers every GET with a two byte body and keeps the connection
+// open. The request is set again before each probe, as a tracer does when its
+// settings are republished, which must not throw a kept-alive connection away.
+class tst_AppProbe : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void dns();
+    void http_data();
+    void http();
+
+private:
+    bool probe(ProbeStatus* status);
+
+    AddressId m_loopback = AddressTable::InvalidId;
+    ProbeArena m_arena;
+    ProbeResultQueue m_results;
+    NetworkTester* m_tester = nullptr;
+};
+
+namespace {
+
+constexpr int Probes = 5;
+
+}
+
+void tst_AppProbe::initTestCase()
+{
+    m_loopback = AddressTable::instance().intern(AddressKey::fromIPv4(0x7f000001));
+}
+
+bool tst_AppProbe::probe(ProbeStatus* status)
+{
+    QSignalSpy ready(m_tester, &NetworkTester::resultsReady);
+    m_tester->startProbe(m_loopback, 1, 3000);
+    if (ready.isEmpty() && !ready.wait(5000)) {
+        return false;
+    }
+
+    int count = m_results.drain([status](const ProbeResult& result) {
+        *status = result.status;
+    });
+    return count == 1;
+}
+
+void tst_AppProbe::dns()
+{
+    QUdpSocket server;
+    QVERIFY(server.bind(QHostAddress::LocalHost, 0));
+    QSet<quint16> ids;
+    connect(&server, &QUdpSocket::readyRead, this, [&server, &ids]() {
+        while (server.hasPendingDatagrams()) {
+            const QNetworkDatagram query = server.receiveDatagram();
+            QByteArray reply = query.data();
+            if (reply.size() < DnsQuery::HeaderSize) {
+                continue;
+            }
+            ids.insert(static_cast<quint16>(static_cast<quint8>(reply[0]) << 8 | static_cast<quint8>(reply[1])));
+            reply[2] = static_cast<char>(reply[2] | 0x80);
+            server.writeDatagram(query.makeReply(reply));
+        }
+    });
+
+    NetworkTester tester;
+    m_tester = &tester;
+    tester.setResultQueue(&m_results);
+    tester.setProbeArena(&m_arena);
+    tester.setProtocol(ProbeProtocol::Dns, server.localPort());
+    for (int i = 0; i < Probes; ++i) {
+        tester.setApplicationRequest("127.0.0.1", "example.net", true);
+        ProbeStatus status = ProbeStatus::SendFailed;
+        QVERIFY(probe(&status));
+        QCOMPARE(status, ProbeStatus::Success);
+    }
+
+    // Every probe is its own query
+    QCOMPARE(ids.size(), Probes);
+}
+
+void tst_AppProbe::http_data()
+{
+    QTest::addColumn<bool>("reuse");
+    QTest::addColumn<int>("connections");
+
+    QTest::newRow("keep-alive") << true << 1;
+    QTest::newRow("connection per probe") << false << Probes;
+}
+
+void tst_AppProbe::http()
+{
+    QFETCH(bool, reuse);
+    QFETCH(int, connections);
+
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    int accepted = 0;
+    int requests = 0;
+    QHash<QTcpSocket*, QByteArray> pending;
+    connect(&server, &QTcpServer::newConnection, this, [&]() {
+        while (QTcpSocket* socket = server.nextPendingConnection()) {
+            accepted++;
+            connect(socket, &QTcpSocket::readyRead, this, [socket, &pending, &requests]() {
+                // One reply per complete request head
+                QByteArray& received = pending[socket];
+                received += socket->readAll();
+                int end;
+                while ((end = received.indexOf("\r\n\r\n")) >= 0) {
+                    received.remove(0, end + 4);
+                    requests++;
+                    socket->write("HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\nok");
+                }
+            });
+        }
+    });
+
+    NetworkTester tester;
+    m_tester = &tester;
+    tester.setResultQueue(&m_results);
+    tester.setProbeArena(&m_arena);
+    tester.setProtocol(ProbeProtocol::Http, server.serverPort());
+    for (int i = 0; i < Probes; ++i) {
+        // An HTTP path is no DNS name, the request has to stand anyway
+        tester.setApplicationRequest("127.0.0.1", "/health", reuse);
+        ProbeStatus status = ProbeStatus::SendFailed;
+        QVERIFY(probe(&status));
+        QCOMPARE(status, ProbeStatus::Success);
+
+        // Let the tester read the rest of the response, the connection is idle after it
+        QTRY_COMPARE(requests, i + 1);
+        QTest::qWait(20);
+    }
+
+    QCOMPARE(requests, Probes);
+    QCOMPARE(accepted, connections);
+}
+
+QTEST_GUILESS_MAIN(tst_AppProbe)
+#include "tst_appprobe.moc"
@@ -0,0 +1,124 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QUdpSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "batchtracer.h"
+
+// A batch over a simulated topology: twenty loopback addresses answered by
+// one DNS stub, and the broadcast address, which no probe can be sent to
+// without SO_BROADCAST. Every reachable target gets a result line, the
+// broadcast one is reported as failed rather than traced, and all tracers
+// of the batch probe from one network thread.
+class tst_BatchTracer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void tracesSimulatedTopology();
+
+private:
+    void answer();
+
+    QUdpSocket* m_server = nullptr;
+};
+
+namespace {
+
+constexpr int Reachable = 20;
+const char* Unsendable = "255.255.255.255";
+
+}
+
+void tst_BatchTracer::answer()
+{
+    // Echo the query with the QR bit set, from the address it was sent to
+    while (m_server->hasPendingDatagrams()) {
+        char buffer[512];
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        const qint64 size = m_server->readDatagram(buffer, sizeof(buffer), &sender, &senderPort);
+        if (size < DnsQuery::HeaderSize) {
+            continue;
+        }
+        buffer[2] = static_cast<char>(buffer[2] | 0x80);
+        m_server->writeDatagram(buffer, size, sender, senderPort);
+    }
+}
+
+void tst_BatchTracer::tracesSimulatedTopology()
+{
+    m_server = new QUdpSocket(this);
+    QVERIFY(m_server->bind(QHostAddress::AnyIPv4, 0));
+    connect(m_server, &QUdpSocket::readyRead, this, &tst_BatchTracer::answer);
+
+    QStringList targets;
+    for (int i = 1; i <= Reachable; ++i) {
+        targets.append(QString("127.0.0.%1").arg(i));
+    }
+    targets.insert(Reachable / 2, Unsendable);
+
+    BatchTracer::Config config;
+    config.concurrency = 4;
+    config.rounds = 3;
+    config.intervalMs = 100;
+    config.timeoutMs = 1000;
+    config.maxHops = 4;
+    config.protocol = ProbeProtocol::Dns;
+    config.port = m_server->localPort();
+    config.query = "example.net";
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString output = dir.filePath("batch.ndjson");
+
+    BatchTracer batch;
+    QSignalSpy finished(&batch, &BatchTracer::finished);
+    QString error;
+    QVERIFY2(batch.start(targets, output, config, &error), qPrintable(error));
+
+    // All tracers of the batch share the network thread
+    const QList<PingTracer*> tracers = batch.findChildren<PingTracer*>();
+    QCOMPARE(tracers.size(), config.concurrency);
+    for (PingTracer* tracer : tracers) {
+        QVERIFY(tracer->networkThread());
+        QCOMPARE(tracer->networkThread(), tracers.first()->networkThread());
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 30000);
+    QVERIFY(!batch.isRunning());
+
+    QFile file(output);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QHash<QString, QJsonObject> results;
+    QJsonObject summary;
+    while (!file.atEnd()) {
+        const QJsonObject line = QJsonDocument::fromJson(file.readLine()).object();
+        if (line.contains("summary")) {
+            summary = line.value("summary").toObject();
+        } else {
+            QVERIFY(!results.contains(line.value("target").toString()));
+            results.insert(line.value("target").toString(), line);
+        }
+    }
+
+    // One line per target, each written once
+    QCOMPARE(results.size(), targets.size());
+    QCOMPARE(summary.value("targets").toInt(), targets.size());
+    QCOMPARE(summary.value("failed").toInt(), 1);
+
+    const QJsonObject failed = results.value(Unsendable);
+    QVERIFY(failed.contains("error"));
+    QVERIFY(!failed.contains("probes"));
+
+    for (int i = 1; i <= Reachable; ++i) {
+        const QJsonObject result = results.value(QString("127.0.0.%1").arg(i));
+        QVERIFY2(!result.contains("error"), qPrintable(result.value("error").toString()));
+        QVERIFY(result.value("reached").toBool());
+        QVERIFY(result.value("probes").toInt() >= config.rounds);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_BatchTracer)
+#include "tst_batchtracer.moc"
@@ -0,0 +1,134 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <QUdpSocket>
+#include <functional>
+#include "changedetector.h"
+#include "pingtracer.h"
+
+// A step in latency or loss is reported once, and the baseline that follows
+// is the post-change level rather than something in between. The detector is
+// fed fixed patterns directly; the tracer gets a shift injected with
+// setSimulatedShift while it probes a DNS stub on loopback.
+class tst_ChangeDetection : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void latencyStepReportedOnce();
+    void lossStepReportedOnce();
+    void simulatedShift();
+
+private:
+    void answer();
+
+    QUdpSocket* m_server = nullptr;
+};
+
+namespace {
+
+struct Report {
+    int sample;
+    ChangeDetector::Change change;
+};
+
+QList<Report> feed(ChangeDetector& detector, int samples, const std::function<double(int)>& rtt, int first = 0)
+{
+    QList<Report> reports;
+    for (int i = first; i < first + samples; ++i) {
+        const ChangeDetector::Change change = detector.add(rtt(i));
+        if (change.kind != ChangeDetector::Kind::None) {
+            reports.append({ i, change });
+        }
+    }
+    return reports;
+}
+
+}
+
+void tst_ChangeDetection::latencyStepReportedOnce()
+{
+    ChangeDetector detector;
+    auto before = [](int i) { return 10.0 + (i % 5) * 0.2; };
+    auto after = [](int i) { return 40.0 + (i % 5) * 0.2; };
+
+    QVERIFY(feed(detector, 200, before).isEmpty());
+
+    const QList<Report> reports = feed(detector, 300, after, 200);
+    QCOMPARE(reports.size(), 1);
+    QCOMPARE(reports.first().sample, 200);
+    QCOMPARE(reports.first().change.kind, ChangeDetector::Kind::LatencyUp);
+    QVERIFY(qAbs(reports.first().change.before - 10.4) < 0.5);
+    QVERIFY(qAbs(detector.baselineLatency() - 40.4) < 0.5);
+}
+
+void tst_ChangeDetection::lossStepReportedOnce()
+{
+    // One probe in ten lost, then every other one
+    ChangeDetector detector;
+    auto before = [](int i) { return i % 10 == 9 ? -1.0 : 10.0; };
+    auto after = [](int i) { return i % 2 ? -1.0 : 10.0; };
+
+    QVERIFY(feed(detector, 300, before).isEmpty());
+
+    const QList<Report> reports = feed(detector, 300, after, 300);
+    QCOMPARE(reports.size(), 1);
+    QCOMPARE(reports.first().change.kind, ChangeDetector::Kind::LossUp);
+    QVERIFY(reports.first().sample < 360);
+    QVERIFY(qAbs(detector.baselineLoss() - 0.5) < 0.15);
+}
+
+void tst_ChangeDetection::answer()
+{
+    // Echo the query with the QR bit set
+    while (m_server->hasPendingDatagrams()) {
+        char buffer[512];
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        const qint64 size = m_server->readDatagram(buffer, sizeof(buffer), &sender, &senderPort);
+        if (size < DnsQuery::HeaderSize) {
+            continue;
+        }
+        buffer[2] = static_cast<char>(buffer[2] | 0x80);
+        m_server->writeDatagram(buffer, size, sender, senderPort);
+    }
+}
+
+void tst_ChangeDetection::simulatedShift()
+{
+    m_server = new QUdpSocket(this);
+    QVERIFY(m_server->bind(QHostAddress::LocalHost, 0));
+    connect(m_server, &QUdpSocket::readyRead, this, &tst_ChangeDetection::answer);
+
+    // Loopback answers in well under a millisecond; 60 ms more from 1.5 s on
+    PingTracer tracer;
+    tracer.setTarget("127.0.0.1");
+    tracer.setInterval(50);
+    tracer.setTimeout(1000);
+    tracer.setMaxHops(4);
+    tracer.setResolveHostnames(false);
+    tracer.setProbeProtocol(ProbeProtocol::Dns, m_server->localPort());
+    tracer.setApplicationProbe("example.net", true);
+    tracer.setSimulatedShift(1, 1500, 60, 0);
+    // Scheduling hiccups on a loaded machine must not count as a shift of their own
+    tracer.setChangeSensitivity(20);
+    QSignalSpy changes(&tracer, &PingTracer::changeDetected);
+
+    QVERIFY(tracer.start());
+    QTRY_VERIFY_WITH_TIMEOUT(tracer.stats().elapsedMs > 1400, 5000);
+    QVERIFY(changes.isEmpty());
+
+    // Dozens of shifted probes go by after the one that trips the detector
+    QTRY_COMPARE_WITH_TIMEOUT(changes.count(), 1, 5000);
+    QTest::qWait(2000);
+    tracer.stop();
+
+    QCOMPARE(changes.count(), 1);
+    const QList<QVariant> change = changes.first();
+    QCOMPARE(change.at(0).toInt(), 1);
+    QCOMPARE(change.at(1).value<ChangeDetector::Kind>(), ChangeDetector::Kind::LatencyUp);
+    QVERIFY(change.at(2).toDouble() < 10.0);
+    QVERIFY(change.at(3).toDouble() > change.at(2).toDouble());
+}
+
+QTEST_GUILESS_MAIN(tst_ChangeDetection)
+#include "tst_changedetection.moc"
@@ -0,0 +1,64 @@
+#include <QtTest>
+#include "losslocalizer.h"
+
+// LossLocalizer fed one probe per hop per interval. A single lost probe at the
+// start must not leave a hop looking lossy for hundreds of intervals, and loss
+// that starts at a router and carries on behind it is placed at that router.
+class tst_LossLocalizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void lostFirstProbe();
+    void downstreamLossOrigin();
+};
+
+void tst_LossLocalizer::lostFirstProbe()
+{
+    LossLocalizer localizer;
+    localizer.reset(5);
+
+    // Hop 3's first probe is lost, nothing is lost after it
+    for (int interval = 0; interval < 80; ++interval) {
+        for (int hop = 1; hop <= 5; ++hop) {
+            localizer.record(hop, interval == 0 && hop == 3);
+        }
+        localizer.update(5);
+
+        QCOMPARE(localizer.originHop(), 0);
+        for (int hop = 1; hop <= 5; ++hop) {
+            QCOMPARE(localizer.verdict(hop), LossLocalizer::Verdict::None);
+        }
+    }
+    QVERIFY(localizer.hopLoss(3) < LossLocalizer::Config().minLossPercent);
+}
+
+void tst_LossLocalizer::downstreamLossOrigin()
+{
+    LossLocalizer localizer;
+    localizer.reset(6);
+
+    // Three probes in ten are dropped at hop 3 and so missing at every hop behind it
+    for (int interval = 0; interval < 200; ++interval) {
+        const bool dropped = interval % 10 < 3;
+        for (int hop = 1; hop <= 6; ++hop) {
+            localizer.record(hop, hop >= 3 && dropped);
+        }
+        localizer.update(6);
+
+        if (interval >= 30) {
+            QCOMPARE(localizer.originHop(), 3);
+        }
+    }
+
+    QCOMPARE(localizer.verdict(1), LossLocalizer::Verdict::None);
+    QCOMPARE(localizer.verdict(2), LossLocalizer::Verdict::None);
+    QCOMPARE(localizer.verdict(3), LossLocalizer::Verdict::LossOrigin);
+    for (int hop = 4; hop <= 6; ++hop) {
+        QCOMPARE(localizer.verdict(hop), LossLocalizer::Verdict::Downstream);
+    }
+    QVERIFY(qAbs(localizer.carriedLoss(3) - 30.0) < 8.0);
+}
+
+QTEST_GUILESS_MAIN(tst_LossLocalizer)
+#include "tst_losslocalizer.moc"
@@ -0,0 +1,219 @@
+#include <QtTest>
+#include <QAbstractEventDispatcher>
+#include <QThread>
+#include <QUdpSocket>
+#include <cstdlib>
+#include <new>
+#include "pingtracer.h"
+
+// Counts the heap allocations of a running PingTracer in steady state, on the
+// tracer's thread and on its network thread separately. Everything a probe
+// goes through is in it: the scheduler tick, posting the command, the tester's
+// send and timeout, queueing the result and waking the tracer, the topology
+// graph, change detectors, loss localizer, alert rules and sample store, the
+// published snapshot and the hopDataUpdated listener's copy. The UDP row times
+// out at simulated routers, the DNS row gets answers from a stub on loopback.
+// TCP and HTTP probes open a connection per probe or keep one, which Qt and the
+// kernel allocate for, and are not covered.
+namespace {
+
+thread_local bool t_counting = false;
+thread_local quint64 t_allocations = 0;
+
+constexpr int HopCount = 30;
+constexpr int WarmUpMs = 2000;
+constexpr int MeasureMs = 4000;
+
+// Runs fn on thread's event loop and waits for it to return
+template <typename Function>
+void runOn(QThread* thread, Function fn)
+{
+    QMetaObject::invokeMethod(QAbstractEventDispatcher::instance(thread), fn, Qt::BlockingQueuedConnection);
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    if (t_counting) {
+        ++t_allocations;
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Answers every query by echoing it with the QR bit set. It runs on a thread
+// of its own, which is not counted
+class DnsStub : public QObject
+{
+    Q_OBJECT
+
+public:
+    quint16 port() const { return m_port; }
+
+public slots:
+    void listen()
+    {
+        m_socket = new QUdpSocket(this);
+        if (!m_socket->bind(QHostAddress::LocalHost, 0)) {
+            return;
+        }
+        m_port = m_socket->localPort();
+        connect(m_socket, &QUdpSocket::readyRead, this, &DnsStub::answer);
+    }
+
+private slots:
+    void answer()
+    {
+        while (m_socket->hasPendingDatagrams()) {
+            QHostAddress sender;
+            quint16 senderPort = 0;
+            const qint64 size = m_socket->readDatagram(m_buffer, sizeof(m_buffer), &sender, &senderPort);
+            if (size < DnsQuery::HeaderSize) {
+                continue;
+            }
+            m_buffer[2] = static_cast<char>(m_buffer[2] | 0x80);
+            m_socket->writeDatagram(m_buffer, size, sender, senderPort);
+        }
+    }
+
+private:
+    QUdpSocket* m_socket = nullptr;
+    quint16 m_port = 0;
+    char m_buffer[512];
+};
+
+class tst_ProbeAllocations : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void steadyState_data();
+    void steadyState();
+};
+
+void tst_ProbeAllocations::steadyState_data()
+{
+    QTest::addColumn<bool>("dns");
+
+    QTest::newRow("UDP, 30 hops timing out") << false;
+    QTest::newRow("DNS, answered on loopback") << true;
+}
+
+void tst_ProbeAllocations::steadyState()
+{
+    QFETCH(bool, dns);
+
+    // Without a route out every send to a simulated router fails before a timeout is armed
+    if (!dns) {
+        QUdpSocket probe;
+        if (probe.writeDatagram("x", 1, QHostAddress("192.168.1.8"), 33434) < 0) {
+            QSKIP("No route for the simulated hop addresses");
+        }
+    }
+
+    QThread stubThread;
+    DnsStub* stub = new DnsStub();
+    stub->moveToThread(&stubThread);
+    connect(&stubThread, &QThread::finished, stub, &QObject::deleteLater);
+    stubThread.start();
+    QMetaObject::invokeMethod(stub, &DnsStub::listen, Qt::BlockingQueuedConnection);
+    QVERIFY(stub->port() != 0);
+
+    // Rules that never fire still run for every sample of their hop
+    QList<AlertRule> rules;
+    for (const char* line : { "p95 hop 1 > 10000ms do log", "loss e2e > 100% do log" }) {
+        AlertRule rule;
+        QString error;
+        QVERIFY2(AlertRule::parse(line, &rule, &error), qPrintable(error));
+        rules.append(rule);
+    }
+
+    PingTracer tracer;
+    tracer.setTarget("127.0.0.1");
+    tracer.setInterval(100);
+    tracer.setTimeout(500);
+    tracer.setMaxHops(HopCount);
+    tracer.setAlertRules(rules);
+    // A reverse lookup goes out once per router, not per probe
+    tracer.setResolveHostnames(false);
+    if (dns) {
+        tracer.setProbeProtocol(ProbeProtocol::Dns, stub->port());
+        tracer.setApplicationProbe("example.net", true);
+    }
+
+    // Listens the way MainWindow does, into a list of its own
+    QList<HopData> shown;
+    int updates = 0;
+    connect(&tracer, &PingTracer::hopDataUpdated, this, [&shown, &updates](const QList<HopData>& hops) {
+        copyElements(shown, hops);
+        updates++;
+    });
+
+    QVERIFY(tracer.start());
+    QTRY_VERIFY(tracer.isRunning());
+    QThread* networkThread = tracer.networkThread();
+    QVERIFY(networkThread);
+
+    // Every hop in flight, sample tiers and buffers sized
+    QTest::qWait(WarmUpMs);
+    const quint64 sentBefore = tracer.stats().sent;
+    const int updatesBefore = updates;
+
+    // The network thread counts first and stops last, so switching it is not
+    // counted on this thread. The window's timer is registered before counting
+    bool done = false;
+    QTimer window;
+    window.setSingleShot(true);
+    connect(&window, &QTimer::timeout, this, [&done]() { done = true; });
+    runOn(networkThread, []() {
+        t_allocations = 0;
+        t_counting = true;
+    });
+    window.start(MeasureMs);
+    t_allocations = 0;
+    t_counting = true;
+    while (!done) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    t_counting = false;
+    const quint64 tracerAllocations = t_allocations;
+    quint64 networkAllocations = 0;
+    runOn(networkThread, [&networkAllocations]() {
+        t_counting = false;
+        networkAllocations = t_allocations;
+    });
+
+    const quint64 probes = tracer.stats().sent - sentBefore;
+    const int published = updates - updatesBefore;
+    tracer.stop();
+    stubThread.quit();
+    stubThread.wait();
+
+    qInfo("%llu probes and %d updates in %d ms: %llu allocations on the tracer thread, %llu on the network thread",
+          static_cast<unsigned long long>(probes), published, MeasureMs,
+          static_cast<unsigned long long>(tracerAllocations), static_cast<unsigned long long>(networkAllocations));
+    QVERIFY(probes > 0);
+    QVERIFY(published > 0);
+    QCOMPARE(shown.size(), HopCount);
+    if (dns) {
+        QVERIFY(shown.first().received > 0);
+    }
+    QCOMPARE(tracerAllocations, quint64(0));
+    QCOMPARE(networkAllocations, quint64(0));
+}
+
+QTEST_GUILESS_MAIN(tst_ProbeAllocations)
+#include "tst_probeallocations.moc"
@@ -0,0 +1,86 @@
+#include <QtTest>
+#include <QApplication>
+#include <QSignalSpy>
+#include <QSet>
+#include "resultstable.h"
+
+// ResultsTable::update against a filled 30-hop table: a refresh with two hops
+// moved must only notify the view about cells in those two rows, and one with
+// nothing moved must not notify it at all.
+class tst_ResultsTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void touchesChangedRowsOnly();
+};
+
+namespace {
+
+constexpr int HopCount = 30;
+
+QList<HopData> path()
+{
+    QList<HopData> hops;
+    for (int i = 0; i < HopCount; ++i) {
+        HopData hop;
+        hop.hopNumber = i + 1;
+        hop.hostname = QString("router-%1.example.net").arg(i + 1);
+        hop.address = AddressTable::instance().intern(AddressKey::fromIPv4((10u << 24) | static_cast<quint32>(i + 1)));
+        hop.sent = 10;
+        hop.received = 10;
+        hop.bestTime = hop.avgTime = hop.worstTime = i + 1.0;
+        hop.rttSum = hop.avgTime * hop.received;
+        hops.append(hop);
+    }
+    return hops;
+}
+
+}
+
+void tst_ResultsTable::touchesChangedRowsOnly()
+{
+    QTableWidget table(0, 8);
+    const QList<HopData> shown = path();
+    QVERIFY(ResultsTable::update(&table, QList<HopData>(), shown));
+    QCOMPARE(table.rowCount(), HopCount);
+
+    QSet<int> touchedRows;
+    connect(table.model(), &QAbstractItemModel::dataChanged, this,
+            [&touchedRows](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+            touchedRows.insert(row);
+        }
+    });
+
+    // Nothing moved
+    QVERIFY(!ResultsTable::update(&table, shown, shown));
+    QVERIFY(touchedRows.isEmpty());
+
+    // Hop 5 lost a probe, hop 17 answered one more
+    QList<HopData> hops = shown;
+    hops[4].sent++;
+    hops[16].sent++;
+    hops[16].received++;
+    QVERIFY(ResultsTable::update(&table, shown, hops));
+    QCOMPARE(touchedRows, QSet<int>({ 4, 16 }));
+    QCOMPARE(table.item(4, 4)->text(), QString("11"));
+    QCOMPARE(table.item(4, 3)->text(), QString("9.1"));
+
+    // Same figures again: no cell, tooltip or colour is written
+    touchedRows.clear();
+    QVERIFY(!ResultsTable::update(&table, shown, shown.mid(0, 4) + hops.mid(4, 1) + shown.mid(5)));
+    QVERIFY(touchedRows.isEmpty());
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    tst_ResultsTable test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_resultstable.moc"
@@ -0,0 +1,93 @@
+#include <QtTest>
+#include "samplestore.h"
+
+class tst_SampleStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void recentColumnsReadTheFinestTier();
+    void droppedHistoryFallsBackToCoarserTiers();
+    void nothingBeforeTheFirstSample();
+};
+
+namespace {
+
+constexpr qint64 DayMs = 24 * 60 * 60 * 1000;
+
+double rttAt(qint64 timeMs)
+{
+    return 10.0 + (timeMs / 1000) % 5;
+}
+
+// One week at 1 Hz, longer than the rings of tier 0 (about 18 h) and tier 1 (about 6 days)
+const SampleSeries& weekAt1Hz()
+{
+    static SampleSeries series;
+    if (series.isEmpty()) {
+        for (qint64 timeMs = 0; timeMs < 7 * DayMs; timeMs += 1000) {
+            series.add(timeMs, rttAt(timeMs));
+        }
+    }
+    return series;
+}
+
+}
+
+void tst_SampleStore::recentColumnsReadTheFinestTier()
+{
+    const SampleSeries& series = weekAt1Hz();
+    const qint64 startMs = 7 * DayMs - 60 * 1000;
+
+    SampleBucket columns[60];
+    series.columns(startMs, 1000, 60, columns);
+    for (int i = 0; i < 60; ++i) {
+        QCOMPARE(columns[i].received, quint32(1));
+        QCOMPARE(columns[i].mean(), rttAt(startMs + i * 1000));
+    }
+}
+
+void tst_SampleStore::droppedHistoryFallsBackToCoarserTiers()
+{
+    const SampleSeries& series = weekAt1Hz();
+
+    // Day 3 is gone from tier 0 but still in tier 1's 8 s buckets
+    SampleBucket column;
+    series.columns(3 * DayMs, 1000, 1, &column);
+    QCOMPARE(column.received, quint32(SampleSeries::bucketWidthMs(1) / 1000));
+    QVERIFY(column.mean() >= 10.0 && column.mean() <= 14.0);
+
+    // The first hours are only left in tier 2
+    series.columns(60 * 60 * 1000, 1000, 1, &column);
+    QCOMPARE(column.received, quint32(SampleSeries::bucketWidthMs(2) / 1000));
+    QVERIFY(column.mean() >= 10.0 && column.mean() <= 14.0);
+
+    // No column of the session is empty, whichever tier serves it
+    const int count = static_cast<int>(7 * DayMs / (60 * 1000));
+    QVector<SampleBucket> minutes(count);
+    series.columns(0, 60 * 1000, count, minutes.data());
+    for (const SampleBucket& minute : minutes) {
+        QVERIFY(!minute.isEmpty());
+    }
+}
+
+void tst_SampleStore::nothingBeforeTheFirstSample()
+{
+    // A tier that dropped nothing is not replaced by a coarser bucket reaching back further
+    SampleSeries series;
+    for (qint64 timeMs = 100 * 1000; timeMs < 700 * 1000; timeMs += 1000) {
+        series.add(timeMs, rttAt(timeMs));
+    }
+
+    SampleBucket columns[100];
+    series.columns(0, 1000, 100, columns);
+    for (const SampleBucket& column : columns) {
+        QVERIFY(column.isEmpty());
+    }
+
+    series.columns(100 * 1000, 1000, 1, columns);
+    QCOMPARE(columns[0].received, quint32(1));
+}
+
+QTEST_GUILESS_MAIN(tst_SampleStore)
+#include "tst_samplestore.moc"
@@ -0,0 +1,136 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <QUdpSocket>
+#include "pingtracer.h"
+
+// Forward lookups of a PingTracer against a stub nameserver on loopback. The
+// stub answers A queries with 127.0.0.1 and AAAA queries with no records, so
+// the A lookup wins the race and the AAAA one is cancelled if still running.
+// A silent stub leaves both lookups pending for stop() to cancel. Pointing
+// QDnsLookup at a port other than 53 needs Qt 6.6.
+class tst_TargetResolve : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void resolvesThroughNameserver();
+    void stopWhileResolving();
+
+private:
+    void answer();
+
+    QUdpSocket* m_server = nullptr;
+    bool m_answering = true;
+    int m_queries = 0;
+};
+
+namespace {
+
+constexpr int HeaderSize = 12;
+constexpr quint16 TypeA = 1;
+
+const char* Target = "probe.example.test";
+
+}
+
+void tst_TargetResolve::init()
+{
+#if QT_VERSION < QT_VERSION_CHECK(6, 6, 0)
+    QSKIP("QDnsLookup takes a nameserver port from Qt 6.6 on");
+#endif
+    delete m_server;
+    m_server = new QUdpSocket(this);
+    QVERIFY(m_server->bind(QHostAddress::LocalHost, 0));
+    connect(m_server, &QUdpSocket::readyRead, this, &tst_TargetResolve::answer);
+    m_answering = true;
+    m_queries = 0;
+}
+
+void tst_TargetResolve::answer()
+{
+    while (m_server->hasPendingDatagrams()) {
+        char query[512];
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        const qint64 size = m_server->readDatagram(query, sizeof(query), &sender, &senderPort);
+        m_queries++;
+        if (!m_answering || size <= HeaderSize) {
+            continue;
+        }
+
+        // Header and question only, any EDNS record of the query is dropped
+        qint64 end = HeaderSize;
+        while (end < size && query[end] != 0) {
+            end += 1 + static_cast<quint8>(query[end]);
+        }
+        end += 1 + 4;
+        if (end > size) {
+            continue;
+        }
+        const quint16 type = static_cast<quint16>(static_cast<quint8>(query[end - 4]) << 8
+                                                  | static_cast<quint8>(query[end - 3]));
+
+        QByteArray reply(query, end);
+        reply[2] = static_cast<char>(0x81);     // Response, recursion desired
+        reply[3] = static_cast<char>(0x80);     // Recursion available, no error
+        reply[6] = 0;
+        reply[7] = type == TypeA ? 1 : 0;
+        reply[8] = reply[9] = reply[10] = reply[11] = 0;
+        if (type == TypeA) {
+            // Name pointer to the question, A, IN, TTL 60, 127.0.0.1
+            static const char record[] = { '\xc0', '\x0c', 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 127, 0, 0, 1 };
+            reply.append(record, sizeof(record));
+        }
+        m_server->writeDatagram(reply, sender, senderPort);
+    }
+}
+
+void tst_TargetResolve::resolvesThroughNameserver()
+{
+    PingTracer tracer;
+    tracer.setTarget(Target);
+    tracer.setResolveHostnames(false);
+    QVERIFY(tracer.setNameserver(QHostAddress::LocalHost, m_server->localPort()));
+    QSignalSpy resolved(&tracer, &PingTracer::targetResolved);
+    QSignalSpy failed(&tracer, &PingTracer::errorOccurred);
+
+    QVERIFY(tracer.start());
+    QTRY_COMPARE_WITH_TIMEOUT(resolved.count(), 1, 10000);
+    QCOMPARE(resolved.first().first().toString(), QString("127.0.0.1"));
+    QVERIFY(tracer.isRunning());
+    QVERIFY(failed.isEmpty());
+    QVERIFY(m_queries >= 1);
+
+    tracer.stop();
+    QVERIFY(!tracer.isRunning());
+}
+
+void tst_TargetResolve::stopWhileResolving()
+{
+    PingTracer tracer;
+    tracer.setTarget(Target);
+    tracer.setResolveHostnames(false);
+    QVERIFY(tracer.setNameserver(QHostAddress::LocalHost, m_server->localPort()));
+    QSignalSpy resolved(&tracer, &PingTracer::targetResolved);
+
+    // Both queries reach the stub and stay unanswered, then stop() cancels them
+    m_answering = false;
+    QVERIFY(tracer.start());
+    QTRY_VERIFY_WITH_TIMEOUT(m_queries >= 2, 10000);
+    tracer.stop();
+    QVERIFY(!tracer.isRunning());
+
+    // Nothing of the cancelled lookups comes through later
+    QTest::qWait(200);
+    QVERIFY(resolved.isEmpty());
+
+    // And the tracer is free to resolve again
+    m_answering = true;
+    QVERIFY(tracer.start());
+    QTRY_COMPARE_WITH_TIMEOUT(resolved.count(), 1, 10000);
+    tracer.stop();
+}
+
+QTEST_GUILESS_MAIN(tst_TargetResolve)
+#include "tst_targetresolve.moc"
@@ -0,0 +1,192 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <QSocketNotifier>
+#include <QTcpServer>
+#include <QElapsedTimer>
+#include <cstring>
+#include "tcpprobe.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// TcpProbe against loopback: a listener that accepts, a port nobody listens
+// on, and a SYN that "expires" at a router. There is no router on loopback,
+// so the last case captures the SYN on a raw socket and answers it with an
+// ICMP time exceeded from 127.0.0.2, as the router would; it needs Linux and
+// raw sockets and is skipped without them.
+class tst_TcpProbe : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void connected();
+    void refused();
+    void hopReplied();
+};
+
+namespace {
+
+// Waits the way NetworkTester does, for the descriptor to become writable
+bool waitWritable(const TcpProbe& probe)
+{
+    QSocketNotifier notifier(probe.descriptor(), QSocketNotifier::Write);
+    QSignalSpy ready(&notifier, &QSocketNotifier::activated);
+    return ready.wait(2000);
+}
+
+#ifdef Q_OS_LINUX
+quint16 checksum(const uchar* data, int size)
+{
+    quint32 sum = 0;
+    for (int i = 0; i + 1 < size; i += 2) {
+        sum += static_cast<quint32>(data[i] | data[i + 1] << 8);
+    }
+    if (size & 1) {
+        sum += data[size - 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<quint16>(~sum);
+}
+
+// Reads TCP segments arriving on loopback until the SYN from localPort shows up
+int captureSyn(int raw, quint16 localPort, uchar* packet, int capacity)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 2000) {
+        pollfd readable = { raw, POLLIN, 0 };
+        if (::poll(&readable, 1, 100) <= 0) {
+            continue;
+        }
+        const int size = static_cast<int>(::recv(raw, packet, capacity, 0));
+        const iphdr* ip = reinterpret_cast<const iphdr*>(packet);
+        if (size < static_cast<int>(sizeof(iphdr)) || size < ip->ihl * 4 + static_cast<int>(sizeof(tcphdr))) {
+            continue;
+        }
+        const tcphdr* tcp = reinterpret_cast<const tcphdr*>(packet + ip->ihl * 4);
+        if (tcp->syn && !tcp->ack && ntohs(tcp->source) == localPort) {
+            return size;
+        }
+    }
+    return -1;
+}
+#endif
+
+}
+
+void tst_TcpProbe::connected()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    TcpProbe probe;
+    QVERIFY(probe.start(QHostAddress::LocalHost, server.serverPort(), 0));
+    QVERIFY(probe.isOpen());
+    QVERIFY(waitWritable(probe));
+
+    AddressKey responder;
+    QCOMPARE(probe.finish(&responder), TcpProbe::Outcome::Connected);
+    QVERIFY(responder == AddressKey::fromHostAddress(QHostAddress::LocalHost));
+
+    probe.close();
+    QVERIFY(!probe.isOpen());
+}
+
+void tst_TcpProbe::refused()
+{
+    // A port that was just free
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    const quint16 port = server.serverPort();
+    server.close();
+
+    TcpProbe probe;
+    QVERIFY(probe.start(QHostAddress::LocalHost, port, 0));
+    QVERIFY(waitWritable(probe));
+
+    AddressKey responder;
+    QCOMPARE(probe.finish(&responder), TcpProbe::Outcome::Refused);
+    QVERIFY(responder == AddressKey::fromHostAddress(QHostAddress::LocalHost));
+}
+
+void tst_TcpProbe::hopReplied()
+{
+#ifdef Q_OS_LINUX
+    const int raw = ::socket(AF_INET, SOCK_RAW, IPPROTO_TCP);
+    const int icmp = ::socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (raw < 0 || icmp < 0) {
+        if (raw >= 0) {
+            ::close(raw);
+        }
+        if (icmp >= 0) {
+            ::close(icmp);
+        }
+        QSKIP("Raw sockets need CAP_NET_RAW");
+    }
+
+    // A listener with a full accept queue drops further SYNs, so the probe's
+    // handshake stays pending until the ICMP error arrives
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int queued = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in target;
+    std::memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(target);
+    QVERIFY(::bind(listener, reinterpret_cast<sockaddr*>(&target), sizeof(target)) == 0);
+    QVERIFY(::listen(listener, 0) == 0);
+    QVERIFY(::getsockname(listener, reinterpret_cast<sockaddr*>(&target), &length) == 0);
+    QVERIFY(::connect(queued, reinterpret_cast<sockaddr*>(&target), sizeof(target)) == 0);
+
+    TcpProbe probe;
+    QVERIFY(probe.start(QHostAddress::LocalHost, ntohs(target.sin_port), 1));
+    sockaddr_in local;
+    length = sizeof(local);
+    QVERIFY(::getsockname(static_cast<int>(probe.descriptor()), reinterpret_cast<sockaddr*>(&local), &length) == 0);
+
+    uchar syn[128];
+    const int synSize = captureSyn(raw, ntohs(local.sin_port), syn, sizeof(syn));
+    QVERIFY(synSize > 0);
+
+    // Time exceeded from the "router", quoting the SYN's IP header and first 8 bytes
+    const int quoted = reinterpret_cast<const iphdr*>(syn)->ihl * 4 + 8;
+    uchar error[8 + 68];
+    std::memset(error, 0, sizeof(error));
+    error[0] = 11;
+    std::memcpy(error + 8, syn, quoted);
+    const quint16 sum = checksum(error, 8 + quoted);
+    std::memcpy(error + 2, &sum, sizeof(sum));
+
+    sockaddr_in router = target;
+    router.sin_port = 0;
+    router.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1);
+    QVERIFY(::bind(icmp, reinterpret_cast<sockaddr*>(&router), sizeof(router)) == 0);
+    target.sin_port = 0;
+    QCOMPARE(static_cast<int>(::sendto(icmp, error, 8 + quoted, 0, reinterpret_cast<sockaddr*>(&target),
+                                       sizeof(target))), 8 + quoted);
+
+    QVERIFY(waitWritable(probe));
+    AddressKey responder;
+    QCOMPARE(probe.finish(&responder), TcpProbe::Outcome::HopReplied);
+    QVERIFY(responder == AddressKey::fromIPv4(INADDR_LOOPBACK + 1));
+
+    ::close(queued);
+    ::close(listener);
+    ::close(icmp);
+    ::close(raw);
+#else
+    QSKIP("Only Linux reports the router a SYN expired at");
+#endif
+}
+
+QTEST_GUILESS_MAIN(tst_TcpProbe)
+#include "tst_tcpprobe.moc"
@@ -0,0 +1,97 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QUdpSocket>
+#include "throughputtest.h"
+
+// A short ThroughputTest against a ThroughputReflector on loopback, in both
+// load modes. The reflector has to take in what the client sent and report
+// it back, and the UDP echoes have to give latency samples.
+class tst_ThroughputTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void loopback_data();
+    void loopback();
+};
+
+namespace {
+
+// A port free for both the reflector's TCP listener and its UDP socket
+quint16 freePort()
+{
+    for (int attempt = 0; attempt < 20; ++attempt) {
+        QTcpServer tcp;
+        if (!tcp.listen(QHostAddress::AnyIPv4)) {
+            continue;
+        }
+        QUdpSocket udp;
+        if (udp.bind(QHostAddress::AnyIPv4, tcp.serverPort())) {
+            return tcp.serverPort();
+        }
+    }
+    return 0;
+}
+
+}
+
+void tst_ThroughputTest::loopback_data()
+{
+    QTest::addColumn<bool>("udp");
+
+    QTest::newRow("TCP") << false;
+    QTest::newRow("UDP") << true;
+}
+
+void tst_ThroughputTest::loopback()
+{
+    QFETCH(bool, udp);
+    const ThroughputTest::Mode mode = udp ? ThroughputTest::Mode::Udp : ThroughputTest::Mode::Tcp;
+
+    const quint16 port = freePort();
+    QVERIFY(port != 0);
+    ThroughputReflector reflector;
+    QSignalSpy served(&reflector, &ThroughputReflector::sessionFinished);
+    QString error;
+    QVERIFY2(reflector.start(port, &error), qPrintable(error));
+
+    ThroughputTest::Config config;
+    config.reflector = QHostAddress::LocalHost;
+    config.port = port;
+    config.mode = mode;
+    config.durationMs = 1000;
+    config.udpRateMbps = 50;
+
+    // Result is handed over in a queued call, not as a registered metatype
+    ThroughputTest test;
+    bool finished = false;
+    ThroughputTest::Result result;
+    connect(&test, &ThroughputTest::finished, this, [&](const ThroughputTest::Result& r) {
+        result = r;
+        finished = true;
+    });
+    QVERIFY(test.start(config));
+    QVERIFY(test.isRunning());
+    QTRY_VERIFY_WITH_TIMEOUT(finished, 15000);
+
+    qInfo("%s", qPrintable(result.summary()));
+    QVERIFY2(result.ok(), qPrintable(result.error));
+    QVERIFY(result.mode == mode);
+    QVERIFY(result.bytes > 0);
+    QVERIFY(result.goodputMbps > 0);
+    if (udp) {
+        QVERIFY(result.datagramsSent > 0);
+        QVERIFY(result.datagramsReceived > 0);
+        QVERIFY(result.datagramsReceived <= result.datagramsSent);
+        QVERIFY(result.rttSamples > 0);
+        QVERIFY(result.rttMinMs >= 0 && result.rttMinMs <= result.rttMaxMs);
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(served.count(), 1, 5000);
+    reflector.stop();
+    QVERIFY(!reflector.isRunning());
+}
+
+QTEST_GUILESS_MAIN(tst_ThroughputTest)
+#include "tst_throughputtest.moc"
@@ -0,0 +1,86 @@
+#include <QtTest>
+#include <cstring>
+#include "topologygraph.h"
+
+class tst_TopologyGraph : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void borrowRunIsBounded();
+    void lossIsNotLent();
+};
+
+namespace {
+
+constexpr int Hop = 3;
+
+ProbeResult probe(AddressId address, bool answered)
+{
+    ProbeResult result;
+    std::memset(&result, 0, sizeof(result));
+    result.rttNs = answered ? 5000000 : -1;
+    result.address = address;
+    result.hop = Hop;
+    result.status = answered ? ProbeStatus::Success : ProbeStatus::Timeout;
+    return result;
+}
+
+}
+
+void tst_TopologyGraph::borrowRunIsBounded()
+{
+    TopologyGraph& graph = TopologyGraph::instance();
+    const int owner = graph.addPath();
+    const int borrower = graph.addPath();
+    const AddressId router = AddressTable::instance().intern(AddressKey::fromIPv4(0x0a000001));
+    graph.recordProbe(borrower, probe(router, true));
+
+    // The owner always has a fresh result; the borrower probes only when refused
+    int run = 0;
+    int longestRun = 0;
+    int ownProbes = 0;
+    for (int turn = 0; turn < 5 * TopologyGraph::MaxBorrowRun; ++turn) {
+        graph.recordProbe(owner, probe(router, true));
+        ProbeResult shared;
+        if (graph.borrowProbe(borrower, Hop, router, 1000, &shared)) {
+            QCOMPARE(static_cast<int>(shared.hop), Hop);
+            longestRun = qMax(longestRun, ++run);
+        } else {
+            graph.recordProbe(borrower, probe(router, true));
+            ownProbes++;
+            run = 0;
+        }
+    }
+
+    QCOMPARE(longestRun, TopologyGraph::MaxBorrowRun);
+    QCOMPARE(ownProbes, 4);
+
+    graph.removePath(owner);
+    graph.removePath(borrower);
+}
+
+void tst_TopologyGraph::lossIsNotLent()
+{
+    TopologyGraph& graph = TopologyGraph::instance();
+    const int owner = graph.addPath();
+    const int borrower = graph.addPath();
+    const AddressId router = AddressTable::instance().intern(AddressKey::fromIPv4(0x0a000002));
+    graph.recordProbe(borrower, probe(router, true));
+    graph.recordProbe(owner, probe(router, true));
+
+    // A timeout counts for the owner's hop but is no answer for the borrower's
+    graph.recordProbe(owner, probe(router, false));
+    ProbeResult shared;
+    QVERIFY(!graph.borrowProbe(borrower, Hop, router, 1000, &shared));
+
+    graph.recordProbe(owner, probe(router, true));
+    QVERIFY(graph.borrowProbe(borrower, Hop, router, 1000, &shared));
+    QVERIFY(shared.success());
+
+    graph.removePath(owner);
+    graph.removePath(borrower);
+}
+
+QTEST_GUILESS_MAIN(tst_TopologyGraph)
+#include "tst_topologygraph.moc"
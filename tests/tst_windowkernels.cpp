@@ -0,0 +1,131 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <vector>
+#include "windowstats.h"
+
+// Every vector kernel has to agree with the scalar one: counts, minimum and
+// maximum exactly, sums up to float rounding since the lanes add in a
+// different order. Lengths cover empty input, partial vectors and the tails.
+class tst_WindowKernels : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void samplesMatchScalar_data();
+    void samplesMatchScalar();
+    void bucketsMatchScalar_data();
+    void bucketsMatchScalar();
+};
+
+namespace {
+
+void addIsaRows()
+{
+    QTest::addColumn<int>("isa");
+
+    QTest::newRow("sse2") << static_cast<int>(WindowKernels::Isa::Sse2);
+    QTest::newRow("avx2") << static_cast<int>(WindowKernels::Isa::Avx2);
+}
+
+bool pinIsa(WindowKernels::Isa isa)
+{
+    WindowKernels::setIsa(isa);
+    return WindowKernels::isa() == isa;
+}
+
+bool closeTo(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-5 * qMax(1.0, qMax(std::fabs(a), std::fabs(b)));
+}
+
+}
+
+void tst_WindowKernels::cleanup()
+{
+    WindowKernels::setIsa(WindowKernels::Isa::Avx2);
+}
+
+void tst_WindowKernels::samplesMatchScalar_data()
+{
+    addIsaRows();
+}
+
+void tst_WindowKernels::samplesMatchScalar()
+{
+    QFETCH(int, isa);
+
+    QRandomGenerator random(42);
+    std::vector<float> rtt(300);
+    for (float& sample : rtt) {
+        sample = random.bounded(10) == 0 ? -1.0f : static_cast<float>(random.bounded(500.0));
+    }
+
+    for (int count = 0; count <= static_cast<int>(rtt.size()); ++count) {
+        for (int offset : {0, 1, 3}) {
+            if (offset + count > static_cast<int>(rtt.size())) {
+                continue;
+            }
+            QVERIFY(pinIsa(WindowKernels::Isa::Scalar));
+            const WindowStats expected = WindowKernels::samples(rtt.data() + offset, count);
+            if (!pinIsa(static_cast<WindowKernels::Isa>(isa))) {
+                QSKIP("Instruction set not available on this CPU");
+            }
+            const WindowStats actual = WindowKernels::samples(rtt.data() + offset, count);
+
+            QCOMPARE(actual.count, expected.count);
+            QCOMPARE(actual.received, expected.received);
+            if (expected.received > 0) {
+                QCOMPARE(actual.min, expected.min);
+                QCOMPARE(actual.max, expected.max);
+            }
+            QVERIFY2(closeTo(actual.sum, expected.sum), qPrintable(QString("count %1").arg(count)));
+            QVERIFY2(closeTo(actual.sumSquares, expected.sumSquares), qPrintable(QString("count %1").arg(count)));
+        }
+    }
+}
+
+void tst_WindowKernels::bucketsMatchScalar_data()
+{
+    addIsaRows();
+}
+
+void tst_WindowKernels::bucketsMatchScalar()
+{
+    QFETCH(int, isa);
+
+    // Every 7th bucket is empty, every 5th only lost probes
+    QRandomGenerator random(7);
+    const int size = 300;
+    std::vector<float> mins(size), maxs(size), sums(size);
+    std::vector<quint32> received(size), lost(size);
+    for (int i = 0; i < size; ++i) {
+        received[i] = i % 7 == 0 || i % 5 == 0 ? 0 : 1 + random.bounded(8);
+        lost[i] = i % 7 == 0 ? 0 : random.bounded(3);
+        mins[i] = received[i] > 0 ? static_cast<float>(random.bounded(100.0)) : 0.0f;
+        maxs[i] = received[i] > 0 ? mins[i] + static_cast<float>(random.bounded(50.0)) : 0.0f;
+        sums[i] = received[i] > 0 ? (mins[i] + maxs[i]) / 2 * received[i] : 0.0f;
+    }
+
+    for (int count = 0; count <= size; ++count) {
+        QVERIFY(pinIsa(WindowKernels::Isa::Scalar));
+        const SampleBucket expected = WindowKernels::buckets(mins.data(), maxs.data(), sums.data(),
+                                                             received.data(), lost.data(), count);
+        if (!pinIsa(static_cast<WindowKernels::Isa>(isa))) {
+            QSKIP("Instruction set not available on this CPU");
+        }
+        const SampleBucket actual = WindowKernels::buckets(mins.data(), maxs.data(), sums.data(),
+                                                           received.data(), lost.data(), count);
+
+        QCOMPARE(actual.received, expected.received);
+        QCOMPARE(actual.lost, expected.lost);
+        if (expected.received > 0) {
+            QCOMPARE(actual.min, expected.min);
+            QCOMPARE(actual.max, expected.max);
+        }
+        QVERIFY2(closeTo(actual.sum, expected.sum), qPrintable(QString("count %1").arg(count)));
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_WindowKernels)
+#include "tst_windowkernels.moc"